@@ -4,67 +4,167 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <assert.h>
+#include <setjmp.h>
 #include <libcomp/include/token.h>
 #include <libcomp/include/lexer.h>
+#include <libcomp/include/lex_scan.h>
 #include <libcomp/include/pp.h>
+#include <libcomp/include/pch.h>
 #include <libcomp/include/parse.h>
 #include <libcomp/include/code_gen.h>
 #include <libcomp/include/sema.h>
 #include "libcomp/include/comp_opt.h"
 #include <libcomp/include/abi.h>
+#include <libcomp/include/jcc_context.h>
+#include <libcomp/include/src_cache.h>
+#include <libcomp/include/time_trace.h>
+#include <libcomp/include/mem_cat.h>
 
 #include <libj/include/platform.h>
 #include <libj/include/str_buff.h>
 
 static comp_opt_t options;
 
-void asm_print(const char* line, bool lf, void* data)
+/*
+include paths read from the config file
+*/
+#define MAX_CONFIG_INC_PATHS 20
+static char* _config_inc_paths[MAX_CONFIG_INC_PATHS];
+static uint32_t _config_inc_path_count = 0;
+
+/*
+Assembly output sink. Lines are gathered in a growable buffer which is written
+out in large blocks. The output file is only created by the first write so a
+failed compile does not leave an empty file behind
+*/
+#define ASM_FLUSH_SIZE (1024 * 1024)
+
+typedef struct
 {
-    data;
-    printf("%s", line);
-    if (lf)
-        printf("\n");
+    const char* path; //NULL for stdout
+    FILE* f;
+    str_buff_t* buff;
+    bool failed;
+}asm_writer_t;
+
+/*
+A single input file compiled by a worker thread when compiling multiple inputs.
+Output and diagnostics are buffered so they can be reported in input order
+*/
+typedef struct
+{
+    const char* input_path;
+    asm_writer_t out;
+    str_buff_t* diags;
+    int result;
+    jmp_buf err_jmp;
+
+    /*
+    translation unit being generated, destroyed by run_job() if an error ends the compilation
+    */
+    valid_trans_unit_t* tl;
+}compile_job_t;
+
+typedef struct
+{
+    compile_job_t* jobs;
+    uint32_t count;
+    uint32_t next;
+    mutex_t* lock;
+}job_queue_t;
+
+/*
+the job being compiled on this thread, NULL when compiling a single input
+*/
+static THREAD_LOCAL compile_job_t* _cur_job = NULL;
+
+/*
+files and tokens kept between requests in server mode
+*/
+static src_cache_t* _src_cache = NULL;
+
+static void asm_writer_init(asm_writer_t* writer, const char* path)
+{
+    memset(writer, 0, sizeof(asm_writer_t));
+    writer->path = path;
+    writer->buff = sb_create(64 * 1024);
 }
 
-void diag_err_print(token_t* tok, uint32_t err, const char* msg, void* data)
+static void asm_writer_flush(asm_writer_t* writer)
 {
-    data;
+    if (writer->failed)
+        return;
 
-    file_pos_t fp = src_get_pos_info(tok->loc);
+    if (!writer->f)
+        writer->f = writer->path ? fopen(writer->path, "wb") : stdout;
 
-    fprintf(stderr, "%s(Ln: %d Ch: %d): Err %d: %s\n",
-        fp.path ? fp.path : "unknown",
-        fp.line, fp.col,
-        err, msg);    
-      exit(1); 
+    if (!writer->f || fwrite(writer->buff->buff, 1, writer->buff->len, writer->f) != writer->buff->len)
+        writer->failed = true;
+    sb_clear(writer->buff);
 }
 
-source_range_t _file_loader(const char* dir, const char* file, void* data)
+/*
+flush any remaining output and close the file.
+If the compile failed any partial output file is removed
+returns false if the output could not be written
+*/
+static bool asm_writer_close(asm_writer_t* writer, bool success)
 {
-    data;
-    const char* path = path_combine(dir, file);
+    if (success)
+        asm_writer_flush(writer);
 
- //   printf("opening %s dir %s file %s\n", path, dir, file);
-
-    source_range_t result = {NULL, NULL};
-    FILE* f = fopen(path, "rb");
-    if (f)
+    if (writer->f && writer->f != stdout)
     {
-        fseek(f, 0, SEEK_END);
-        unsigned long len = (unsigned long)ftell(f);
-        fseek(f, 0, SEEK_SET);
-        char* buff = (char*)malloc(len + 1);
-        size_t b = fread(buff, 1, len, f);
-        if (b == len)
-        {
-            buff[len] = '\0';
-            result.ptr = buff;
-            result.end = buff + len;
-        }
-        fclose(f);
+        if (fclose(writer->f) != 0)
+            writer->failed = true;
+        if (!success || writer->failed)
+            remove(writer->path);
     }
-    free((void*)path);
-    return result;
+    else if (writer->f)
+    {
+        fflush(writer->f);
+    }
+    writer->f = NULL;
+    sb_destroy(writer->buff);
+    writer->buff = NULL;
+    return !writer->failed;
+}
+
+void asm_write(const char* line, bool lf, void* data)
+{
+    asm_writer_t* writer = (asm_writer_t*)data;
+    sb_append(writer->buff, line);
+    if (lf)
+        sb_append_ch(writer->buff, '\n');
+    if (writer->buff->len >= ASM_FLUSH_SIZE)
+        asm_writer_flush(writer);
+}
+
+static void report_err(const char* msg)
+{
+    if (_cur_job)
+        sb_append(_cur_job->diags, msg);
+    else
+        fputs(msg, stderr);
+}
+
+void diag_err_print(src_loc_t loc, uint32_t err, const char* msg, void* data)
+{
+    jcc_context_t* ctx = (jcc_context_t*)data;
+
+    file_pos_t fp = src_get_loc_info(ctx, loc);
+
+    char buff[1024];
+    snprintf(buff, sizeof(buff), "%s(Ln: %d Ch: %d): Err %d: %s\n",
+        fp.path ? fp.path : "unknown",
+        fp.line, fp.col,
+        err, msg);
+    report_err(buff);
+
+    //the first error ends the compilation of this input
+    if (_cur_job)
+        longjmp(_cur_job->err_jmp, 1);
+    exit(1); 
 }
 
 char* trim(char* str)
@@ -96,8 +196,8 @@ bool load_config(const char* path)
         *eq = '\0';
         eq++;
         eq = trim(eq);
-        if (strcmp(line, "inc_path") == 0 && strlen(eq))
-            src_add_header_path(eq);
+        if (strcmp(line, "inc_path") == 0 && strlen(eq) && _config_inc_path_count < MAX_CONFIG_INC_PATHS)
+            _config_inc_paths[_config_inc_path_count++] = mem_strdup(mc_general, eq);
     }
 
     fclose(f);
@@ -105,6 +205,12 @@ bool load_config(const char* path)
     return true;
 }
 
+static void apply_config(jcc_context_t* ctx)
+{
+    for (uint32_t i = 0; i < _config_inc_path_count; i++)
+        src_add_header_path(ctx, _config_inc_paths[i]);
+}
+
 void on_observe_user_type_def(ast_type_spec_t* spec)
 {
     if (options.dump_type_info && spec->data.user_type_spec->kind != user_type_enum)
@@ -146,59 +252,96 @@ bool run_code_gen()
     return !options.dump_type_info;
 }
 
-int main(int argc, char* argv[])
+/*
+write the precompiled header of input_path to the -o path or <input>.pch
+*/
+static int write_pch(jcc_context_t* ctx, const char* input_path, token_range_t* preproced)
 {
-    diag_set_handler(&diag_err_print, NULL);
-
-    options = parse_command_line(argc, (const char**)argv);
-
-    if (!options.valid)
+    str_buff_t* path = sb_create(256);
+    if (options.output_path)
     {
-        fprintf(stderr, "invalid parameters\n");
-        return -1;
+        sb_append(path, options.output_path);
+    }
+    else
+    {
+        sb_append(path, input_path);
+        sb_append(path, ".pch");
     }
 
-    if (options.display_version)
+    trace_begin(ctx, "WritePCH", NULL);
+    int result = pch_write(ctx, sb_str(path), preproced) ? 0 : -1;
+    pre_proc_deinit(ctx);
+    trace_end(ctx);
+    if (result)
     {
-        puts("jcompiler version 0.1");
-        return 0;
+        char buff[1024];
+        snprintf(buff, sizeof(buff), "failed to write %s\n", sb_str(path));
+        report_err(buff);
     }
+    sb_destroy(path);
+    return result;
+}
+
+/*
+run the full pipeline for a single input, passing the generated assembly to asm_cb
+*/
+int compile_file(jcc_context_t* ctx, const char* input_path, write_asm_cb asm_cb, void* asm_data)
+{
+    diag_set_handler(ctx, &diag_err_print, ctx);
 
-    const char* path = path_resolve(options.input_path);
+    const char* path = path_resolve(input_path);
     if (!path)
     {
-        fprintf(stderr, "unknown file: %s\n", options.input_path);
+        char buff[1024];
+        snprintf(buff, sizeof(buff), "unknown file: %s\n", input_path);
+        report_err(buff);
         return -1;
     }
 
     const char* src_dir = path_dirname(path);
     const char* src_file = path_filename(path);
-    free((void*)path);
+    mem_free((void*)path);
         
     if (!src_file || !src_dir)
+    {
+        mem_free((void*)src_dir);
+        mem_free((void*)src_file);
         return -1;
+    }
 
-    src_init(&_file_loader, NULL);
-
-    if (options.config_path && !load_config(options.config_path))
-        return -1;
+    if (ctx->cache)
+        src_init(ctx, &src_cache_load, ctx->cache);
+    else
+        src_init(ctx, &src_map_file, NULL);
+    apply_config(ctx);
 
     //load file
-    source_range_t* sr = src_load_file(src_dir, src_file);
-    free((void*)src_file);
+    source_range_t* sr = src_load_file(ctx, src_dir, src_file);
+    mem_free((void*)src_dir);
+    mem_free((void*)src_file);
     if (!sr)
         return -1;
 
-    //lex
-    lex_init();
-    token_range_t range = lex_source(sr);
-    if (!range.start)
+    //lex and pre proc, the lexer runs as the pre processor needs tokens
+    trace_begin(ctx, "PreProcess", NULL);
+    lex_init(ctx);
+    pre_proc_init(ctx);
+    if (options.include_pch && !pch_load(ctx, options.include_pch))
+    {
+        char buff[1024];
+        snprintf(buff, sizeof(buff), "cannot use precompiled header %s, it is not valid or a file it was built from has changed\n", options.include_pch);
+        report_err(buff);
+        trace_end(ctx);
+        return -1;
+    }
+    //includes are found relative to the path sr was loaded from
+    token_range_t preproced = pre_proc_source(ctx, NULL, sr);
+    //a precompiled header is written from the preprocessor's macros once the input has been analysed
+    if (!options.emit_pch)
+        pre_proc_deinit(ctx);
+    trace_end(ctx);
+    if (!preproced.start)
         return -1;
-
-    //pre proc
-    pre_proc_init();
-    token_range_t preproced = pre_proc_file(src_dir, &range);
-    pre_proc_deinit();
 
     if (options.pre_proc_only)
     {
@@ -207,22 +350,348 @@ int main(int argc, char* argv[])
     }
 
     //parse
-    parse_init(preproced.start);
-    ast_trans_unit_t* ast = parse_translation_unit();
+    trace_begin(ctx, "Parse", NULL);
+    parse_init(ctx, preproced.start);
+    ast_trans_unit_t* ast = parse_translation_unit(ctx);
+    trace_end(ctx);
 
     //semantic analysis
+    trace_begin(ctx, "Sema", NULL);
     sema_observer_t so = { &on_observe_user_type_def };
-    sema_init(so);
-    valid_trans_unit_t* tl = sema_analyse(ast);
+    sema_init(ctx, so);
+    valid_trans_unit_t* tl = sema_analyse(ctx, ast);
+    trace_end(ctx);
     if (!tl)
         return -1;
 
+    if (options.emit_pch)
+    {
+        tl_destroy(tl);
+        return write_pch(ctx, input_path, &preproced);
+    }
+
     //code generation
-    if(run_code_gen())
-        code_gen(tl, &asm_print, NULL, options.annotate_asm);
+    if (run_code_gen())
+    {
+        if (_cur_job)
+            _cur_job->tl = tl;
+        trace_begin(ctx, "CodeGen", NULL);
+        code_gen(ctx, tl, asm_cb, asm_data, options.annotate_asm);
+        trace_end(ctx);
+        if (_cur_job)
+            _cur_job->tl = NULL;
+    }
     
     tl_destroy(tl);
-    src_deinit();
     return 0;
 }
 
+/*
+-ftime-trace output path, <output>.json beside the assembly or <name>.json in the working directory when writing to stdout
+*/
+static const char* trace_output_path(const char* asm_path, const char* input_path)
+{
+    char* base = asm_path ? mem_strdup(mc_general, asm_path) : (char*)path_filename(input_path);
+    if (!base)
+        return NULL;
+    char* ext = strrchr(base, '.');
+    char* sep = strrchr(base, '/');
+    if (ext && (!sep || ext > sep))
+        *ext = '\0';
+    str_buff_t* sb = sb_create(strlen(base) + 6);
+    sb_append(sb, base);
+    sb_append(sb, ".json");
+    mem_free(base);
+    return sb_release(sb);
+}
+
+static void begin_time_trace(jcc_context_t* ctx, const char* input_path)
+{
+    if (!options.time_trace)
+        return;
+    ctx->trace = trace_create();
+    trace_begin(ctx, "Compile", input_path);
+}
+
+/*
+write the trace of a successful compile
+returns false if it could not be written
+*/
+static bool end_time_trace(jcc_context_t* ctx, const char* asm_path, const char* input_path)
+{
+    if (!ctx->trace)
+        return true;
+    trace_end(ctx);
+
+    const char* path = trace_output_path(asm_path, input_path);
+    bool result = path && trace_write(ctx->trace, path);
+    if (!result)
+    {
+        char buff[1024];
+        snprintf(buff, sizeof(buff), "failed to write %s\n", path ? path : "time trace");
+        report_err(buff);
+    }
+    mem_free((void*)path);
+    return result;
+}
+
+static void run_job(compile_job_t* job)
+{
+    _cur_job = job;
+    jcc_context_t* ctx = jcc_context_create();
+    ctx->cache = _src_cache;
+    ctx->tok_cache_dir = options.token_cache_dir;
+    begin_time_trace(ctx, job->input_path);
+
+    if (setjmp(job->err_jmp) == 0)
+    {
+        job->result = compile_file(ctx, job->input_path, &asm_write, &job->out);
+    }
+    else
+    {
+        job->result = 1;
+        tl_destroy(job->tl);
+        job->tl = NULL;
+    }
+    if (job->result == 0 && !end_time_trace(ctx, job->out.path, job->input_path))
+        job->result = -1;
+    _cur_job = NULL;
+    jcc_context_destroy(ctx);
+
+    if (!asm_writer_close(&job->out, job->result == 0))
+    {
+        char buff[1024];
+        snprintf(buff, sizeof(buff), "failed to write %s\n", job->out.path);
+        sb_append(job->diags, buff);
+        job->result = -1;
+    }
+}
+
+static void worker_main(void* data)
+{
+    job_queue_t* queue = (job_queue_t*)data;
+
+    for (;;)
+    {
+        mutex_lock(queue->lock);
+        compile_job_t* job = queue->next < queue->count ? &queue->jobs[queue->next++] : NULL;
+        mutex_unlock(queue->lock);
+
+        if (!job)
+            break;
+        run_job(job);
+    }
+}
+
+/*
+compile each input on a pool of worker threads, writing <name>.s for each
+*/
+int compile_files()
+{
+    job_queue_t queue;
+    memset(&queue, 0, sizeof(job_queue_t));
+    queue.count = options.input_count;
+    queue.jobs = (compile_job_t*)mem_alloc(mc_general, sizeof(compile_job_t) * queue.count);
+    memset(queue.jobs, 0, sizeof(compile_job_t) * queue.count);
+    queue.lock = mutex_create();
+
+    for (uint32_t i = 0; i < queue.count; i++)
+    {
+        compile_job_t* job = &queue.jobs[i];
+        job->input_path = options.input_paths[i];
+        asm_writer_init(&job->out, comp_opt_asm_path(job->input_path));
+        job->diags = sb_create(256);
+    }
+
+    uint32_t thread_count = options.jobs ? options.jobs : cpu_count();
+    if (thread_count > queue.count)
+        thread_count = queue.count;
+
+    //the main thread works through the queue alongside thread_count - 1 workers
+    thread_t** threads = (thread_t**)mem_alloc(mc_general, sizeof(thread_t*) * thread_count);
+    for (uint32_t i = 1; i < thread_count; i++)
+        threads[i] = thread_start(&worker_main, &queue);
+
+    worker_main(&queue);
+
+    for (uint32_t i = 1; i < thread_count; i++)
+    {
+        if (threads[i])
+            thread_join(threads[i]);
+    }
+    mem_free(threads);
+
+    int result = 0;
+    for (uint32_t i = 0; i < queue.count; i++)
+    {
+        compile_job_t* job = &queue.jobs[i];
+        fputs(sb_str(job->diags), stderr);
+        if (job->result != 0)
+            result = 1;
+        sb_destroy(job->diags);
+        mem_free((void*)job->out.path);
+    }
+    mem_free(queue.jobs);
+    mutex_destroy(queue.lock);
+    return result;
+}
+
+/*
+Read compile requests from stdin, one per line:
+<input> [<output>]
+The output defaults to <name>.s in the working directory.
+The diagnostics for each request are written to stdout followed by a line containing 'ok' or 'error'.
+Loaded files and the tokens lexed from them are kept between requests
+*/
+int run_server()
+{
+    _src_cache = src_cache_create();
+
+    char line[4096];
+    while (fgets(line, sizeof(line), stdin))
+    {
+        const char* input = strtok(line, " \t\r\n");
+        if (!input)
+            continue;
+        const char* output = strtok(NULL, " \t\r\n");
+        const char* output_path = output ? mem_strdup(mc_general, output) : comp_opt_asm_path(input);
+        if (!output_path)
+        {
+            puts("error");
+            fflush(stdout);
+            continue;
+        }
+
+        compile_job_t job;
+        memset(&job, 0, sizeof(compile_job_t));
+        job.input_path = input;
+        asm_writer_init(&job.out, output_path);
+        job.diags = sb_create(256);
+
+        src_cache_begin(_src_cache);
+        run_job(&job);
+
+        fputs(sb_str(job.diags), stdout);
+        puts(job.result == 0 ? "ok" : "error");
+        fflush(stdout);
+        sb_destroy(job.diags);
+        mem_free((void*)job.out.path);
+    }
+
+    src_cache_destroy(_src_cache);
+    _src_cache = NULL;
+    return 0;
+}
+
+/*
+compile the single input to the -o path or stdout
+*/
+static int compile_single()
+{
+    asm_writer_t out;
+    //-o names the precompiled header when emitting one, there is no assembly
+    asm_writer_init(&out, options.emit_pch ? NULL : options.output_path);
+
+    jcc_context_t* ctx = jcc_context_create();
+    ctx->tok_cache_dir = options.token_cache_dir;
+    begin_time_trace(ctx, options.input_path);
+    int result = compile_file(ctx, options.input_path, &asm_write, &out);
+    if (result == 0 && !end_time_trace(ctx, options.output_path, options.input_path))
+        result = -1;
+    jcc_context_destroy(ctx);
+
+    if (!asm_writer_close(&out, result == 0))
+    {
+        fprintf(stderr, "failed to write %s\n", options.output_path ? options.output_path : "output");
+        return -1;
+    }
+    return result;
+}
+
+static void print_mem_report()
+{
+    fprintf(stderr, "%-10s %12s %16s %16s\n", "category", "allocations", "total bytes", "peak bytes");
+    for (uint32_t cat = 0; cat <= mc_count; cat++)
+    {
+        mem_stats_t stats;
+        if (!mem_get_stats(cat == mc_count ? MEM_ALL_CATEGORIES : (mem_cat_t)cat, &stats))
+            return;
+        fprintf(stderr, "%-10s %12llu %16llu %16llu\n",
+            cat == mc_count ? "total" : mem_category_name((mem_category)cat),
+            (unsigned long long)stats.count,
+            (unsigned long long)stats.total,
+            (unsigned long long)stats.peak);
+    }
+
+    fprintf(stderr, "\n%-26s %6s\n", "ast node", "bytes");
+    for (const ast_node_size_t* node = ast_node_sizes(); node->name; node++)
+        fprintf(stderr, "%-26s %6zu\n", node->name, node->size);
+}
+
+int main(int argc, char* argv[])
+{
+    //statistics are recorded by the allocator so must be enabled before anything is allocated
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-fmem-report") == 0)
+            mem_enable_stats();
+    }
+
+    options = parse_command_line(argc, (const char**)argv);
+
+    //before any worker thread is lexing
+    lex_scan_init();
+
+    if (!options.valid)
+    {
+        fprintf(stderr, "invalid parameters\n");
+        return -1;
+    }
+
+    if (options.display_version)
+    {
+        puts("jcompiler version 0.1");
+        return 0;
+    }
+
+    if (options.config_path && !load_config(options.config_path))
+        return -1;
+
+    int result;
+    if (options.server)
+    {
+        if (options.input_count || options.pre_proc_only || options.dump_type_info || options.output_path || options.emit_pch)
+        {
+            fprintf(stderr, "input files, -E, -d, -o and -emit-pch cannot be used with --server\n");
+            return -1;
+        }
+        result = run_server();
+    }
+    else if (options.input_count > 1)
+    {
+        if (options.pre_proc_only || options.dump_type_info || options.output_path || options.emit_pch)
+        {
+            fprintf(stderr, "-E, -d, -o and -emit-pch cannot be used with multiple input files\n");
+            return -1;
+        }
+
+        //the inputs are compiled at the same time, two writing the same file would leave only one result
+        uint32_t clash = comp_opt_find_output_clash(&options);
+        if (clash < options.input_count)
+        {
+            const char* path = comp_opt_asm_path(options.input_paths[clash]);
+            fprintf(stderr, "%s: output %s is also written by an earlier input\n", options.input_paths[clash], path ? path : "");
+            mem_free((void*)path);
+            return -1;
+        }
+        result = compile_files();
+    }
+    else
+    {
+        result = compile_single();
+    }
+
+    if (options.mem_report)
+        print_mem_report();
+    return result;
+}
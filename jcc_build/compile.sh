@@ -1,23 +1,22 @@
 #!/bin/bash
 
-comp()
-{
-	echo $1
-	../build/compiler/jcc -c comp.cfg ../libcomp/src/$1 > asm/$1
-}
+# compile each source in a single jcc process, writing asm/<name>.s
 
-comp abi.c
-comp ast.c
-comp code_gen.c
-comp code_gen_expr.c
-comp comp_opt.c
-comp diag.c
-comp id_map.c
-comp id_map.c
-comp int_val.c 
-comp lexer.c
-comp parse.c
-comp parse_decl.c
-comp parse_smnt.c
-comp parse_type.c
-comp pp_built_in_defs.c
\ No newline at end of file
+SOURCES="abi.c
+ast.c
+code_gen.c
+code_gen_expr.c
+comp_opt.c
+diag.c
+id_map.c
+int_val.c
+lexer.c
+parse.c
+parse_decl.c
+parse_stmt.c
+parse_type.c
+pp_built_in_defs.c"
+
+mkdir -p asm
+cd asm
+../../build/compiler/jcc -c ../comp.cfg $(for s in $SOURCES; do echo ../../libcomp/src/$s; done)
@@ -7,7 +7,8 @@
 #include "int_val.h"
 #include "ast_op_kinds.h"
 
-#define MAX_LITERAL_NAME 32
+#include <libj/include/arena.h>
+
 #define MAX_LBL_LEN 16
 
 /*
@@ -37,7 +38,7 @@ eg x or y in x = y + 5;
 */
 typedef struct
 {
-	char name[MAX_LITERAL_NAME];
+	const char* name; //interned
 	struct ast_declaration* decl; //set in sema
 }ast_expr_identifier_t;
 
@@ -76,16 +77,6 @@ typedef struct
 	*/
 	ast_func_call_param_t* first_param;
 	ast_func_call_param_t* last_param;
-
-	uint32_t param_count;
-
-	struct {
-		/*
-		result type of target expression above
-		*/
-		struct ast_type_spec* target_type;
-	}sema;
-
 }ast_expr_func_call_t;
 
 /*
@@ -222,7 +213,7 @@ expression data
 */
 typedef struct ast_expression
 {
-	token_range_t tokens;
+	src_loc_range_t loc;
 	expression_kind kind;
 	union
 	{
@@ -314,8 +305,8 @@ member of a user defined enumeration
 */
 typedef struct ast_enum_member
 {
-	token_range_t tokens;
-	char name[MAX_LITERAL_NAME]; //name is optional
+	src_loc_range_t loc;
+	const char* name; //interned, NULL if not named
 	ast_expression_t* value;
 	struct ast_enum_member* next;
 }ast_enum_member_t;
@@ -344,8 +335,8 @@ user type specification - struct, union or enum
 */
 typedef struct ast_user_type_spec
 {
-	token_range_t tokens;
-	char name[MAX_LITERAL_NAME]; //name is optional
+	src_loc_range_t loc;
+	const char* name; //interned, NULL if not named
 	user_type_kind kind;
 
 	union
@@ -422,7 +413,7 @@ a reference to a type specification including type qual and storage class inform
 */
 typedef struct ast_type_ref
 {
-	token_range_t tokens;
+	src_loc_range_t loc;
 	ast_type_spec_t* spec;
 	uint32_t flags;
 }ast_type_ref_t;
@@ -509,11 +500,11 @@ A declaration
 */
 typedef struct ast_declaration
 {
-	token_range_t tokens;
+	src_loc_range_t loc;
 	ast_decl_kind kind;
 
-	//optional name
-	char name[MAX_LITERAL_NAME];
+	//optional name, interned. NULL if not named
+	const char* name;
 
 	ast_type_ref_t* type_ref;
 
@@ -584,7 +575,7 @@ for loop statement data
 */
 typedef struct
 {
-	ast_decl_list_t decls; //for(int i = 0;...;...)
+	ast_declaration_t* decls; //for(int i = 0;...;...)
 
 	ast_expression_t* init; //for(i = 0;...;...)
 	ast_expression_t* condition; //for(...;i<10;...)
@@ -619,7 +610,7 @@ typedef struct
 	struct
 	{
 		ast_case_smnt_data_t* dflt_case;
-		size_t case_count;
+		uint32_t case_count;
 		bool last_smnt_was_case;
 
 		ast_case_smnt_data_t** case_smnts;
@@ -636,9 +627,9 @@ label statement data
 typedef struct
 {
 	/*
-	label name
+	label name, interned
 	*/
-	char label[MAX_LITERAL_NAME];
+	const char* label;
 
 	/*
 	labels can optionally include a statement, ie 'label: return 0;'
@@ -651,7 +642,7 @@ goto statement case data
 */
 typedef struct
 {
-	char label[MAX_LITERAL_NAME];
+	const char* label; //interned
 }ast_goto_smnt_data_t;
 
 /*
@@ -659,7 +650,7 @@ a statement
 */
 typedef struct ast_statement
 {
-	token_range_t tokens;
+	src_loc_range_t loc;
 	statement_kind kind;
 
 	union
@@ -688,7 +679,7 @@ a block item - either a declaration or a statement
 */
 typedef struct ast_block_item
 {
-	token_range_t tokens;
+	src_loc_range_t loc;
 	ast_block_item_type kind;
 
 	union
@@ -704,12 +695,17 @@ translation unit
 */
 typedef struct
 {
-	token_range_t tokens;
+	src_loc_range_t loc;
 	char path[256];
 	/*
 	list of declrations - each either a global var, type or function
 	*/
 	ast_decl_list_t decls;
+
+	/*
+	all nodes of the translation unit, including the ast_trans_unit_t, are allocated from here
+	*/
+	arena_t* arena;
 }ast_trans_unit_t;
 
 /*
@@ -740,7 +736,7 @@ returns the type name
 const char* ast_type_name(ast_type_spec_t* type);
 
 /*
-find a user type member by name
+find a user type member by name, which must be interned
 */
 ast_struct_member_t* ast_find_struct_member(ast_user_type_spec_t* struct_spec, const char* name);
 
@@ -826,11 +822,30 @@ returns true if the given struct member is a bit field
 */
 bool ast_is_bit_field_member(ast_struct_member_t* member);
 
-void ast_destroy_decl_list(ast_decl_list_t decl_list);
+/*
+create an empty translation unit which takes ownership of arena
+*/
+ast_trans_unit_t* ast_create_translation_unit(arena_t* arena);
+
+/*
+allocate zeroed memory for a node from the arena of the translation unit being parsed or analysed
+on the current context. Nodes are never freed individually, only with their translation unit
+*/
+void* ast_alloc(size_t sz);
+
 void ast_destory_translation_unit(ast_trans_unit_t* tl);
-void ast_destroy_statement(ast_statement_t*);
-void ast_destroy_expression(ast_expression_t*);
 void ast_destroy_expression_data(ast_expression_t*);
-void ast_destroy_declaration(ast_declaration_t*);
-void ast_destroy_expression_list(ast_expression_list_t* list);
-void ast_destroy_type_spec(ast_type_spec_t*);
+
+/*
+size in bytes of each kind of AST node
+*/
+typedef struct
+{
+	const char* name;
+	size_t size;
+}ast_node_size_t;
+
+/*
+returns the sizes of the AST node types. The table ends with an entry whose name is NULL
+*/
+const ast_node_size_t* ast_node_sizes();
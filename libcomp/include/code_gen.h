@@ -5,6 +5,7 @@
 #include "diag.h"
 #include "sema.h"
 #include "var_set.h"
+#include "jcc_context.h"
 
 /*
 callback used to output asm.
@@ -23,9 +24,46 @@ cb - callback for writing assembly output
 data - context data passed to callback
 annotate - generate code annotations if true
 */
-void code_gen(valid_trans_unit_t* tl, write_asm_cb cb, void* data, bool annotate);
+void code_gen(jcc_context_t* ctx, valid_trans_unit_t* tl, write_asm_cb cb, void* data, bool annotate);
+
+/*
+release code gen state left behind when an error unwound code_gen()
+*/
+void code_gen_deinit(jcc_context_t* ctx);
 
 //internal
+
+struct gen_context
+{
+	write_asm_cb asm_cb;
+	void* asm_cb_data;
+	bool annotation;
+	uint32_t annotate_depth;
+
+	var_set_t* var_set;
+	bool returned;
+	ast_declaration_t* cur_fun;
+	valid_trans_unit_t* cur_tl;
+
+	/*
+	targets of break and continue statements in the current loop or switch
+	*/
+	const char* break_label;
+	const char* cont_label;
+
+	uint32_t next_label;
+
+	/*
+	generating the address of an expression rather than its value
+	*/
+	bool lval;
+};
+
+static inline gen_context_t* gen_ctx()
+{
+	return jcc_ctx()->gen;
+}
+
 void gen_expression(ast_expression_t* expr);
 var_set_t* gen_var_set();
 void gen_make_label_name(char* name);
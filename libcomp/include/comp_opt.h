@@ -3,6 +3,7 @@
 //compiler options
 
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct
 {
@@ -32,10 +33,21 @@ typedef struct
 	char* output_path;
 
 	/*
-	source input path
+	source input path, the first of input_paths
 	*/
 	char* input_path;
 
+	/*
+	all source input paths
+	*/
+	char** input_paths;
+	uint32_t input_count;
+
+	/*
+	number of worker threads used when compiling multiple inputs, 0 to use one per processor
+	*/
+	uint32_t jobs;
+
 	/*
 	config file path
 	*/
@@ -46,9 +58,50 @@ typedef struct
 	*/
 	bool dump_type_info;
 
+	/*
+	read compile requests from stdin, keeping loaded files between requests
+	*/
+	bool server;
+
+	/*
+	write a Chrome trace event file of the time spent in each phase, header and function
+	*/
+	bool time_trace;
+
+	/*
+	print allocation statistics for each part of the compiler and the size of each AST node
+	*/
+	bool mem_report;
+
+	/*
+	directory of token files, headers are lexed once and the tokens reused by later compilations
+	*/
+	char* token_cache_dir;
+
+	/*
+	write a precompiled header of the input, to the -o path or <input>.pch, rather than compiling it
+	*/
+	bool emit_pch;
+
+	/*
+	precompiled header to process before the input
+	*/
+	char* include_pch;
+
 }comp_opt_t;
 
 /*
 parse the command line
 */
-comp_opt_t parse_command_line(int argc, const char* argv[]);
\ No newline at end of file
+comp_opt_t parse_command_line(int argc, const char* argv[]);
+
+/*
+default assembly output path of an input, <dir>/<name>.c -> <name>.s in the working directory
+*/
+const char* comp_opt_asm_path(const char* input_path);
+
+/*
+index of the first input whose default assembly output path is the same as an earlier input's,
+input_count if each input writes a different file
+*/
+uint32_t comp_opt_find_output_clash(comp_opt_t* opt);
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 //diagnostics
 
+#include "source.h"
+
 #include <stdint.h>
 #include <stdarg.h>
 
@@ -32,29 +34,30 @@
 
 
 struct token;
+struct jcc_context;
 
 /*
 callback used to indicate errors
 
-tok - token at which error occured
+loc - location at which error occured, see src_get_loc_info()
 err - error constant from above
 msg - error text
 data - callback context data
 */
-typedef void (*diag_cb)(struct token* tok, uint32_t err, const char* msg, void* data);
+typedef void (*diag_cb)(src_loc_t loc, uint32_t err, const char* msg, void* data);
 
 /*
-set callback and context data
+set callback and context data for a compiler context
 */
-void diag_set_handler(diag_cb, void* data);
+void diag_set_handler(struct jcc_context* ctx, diag_cb, void* data);
 
 /*
 generate an error
-tok - token at which error occured
+loc - location at which error occured, tok_loc() of a token
 err - error constant from above
 format, ... - error text
 */
-void* diag_err(struct token* tok, uint32_t err, const char* format, ...);
+void* diag_err(src_loc_t loc, uint32_t err, const char* format, ...);
 
 /*
 return a description for a token suitable for inserting into a error message
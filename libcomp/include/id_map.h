@@ -69,6 +69,11 @@ typedef struct
 	multiple string literals with the same value will map to the same label
 	*/
 	hash_table_t* string_literals;
+
+	/*
+	number of string literal labels allocated
+	*/
+	uint32_t string_literal_count;
 }identfier_map_t;
 
 /*
@@ -77,10 +82,15 @@ create an identifier map
 identfier_map_t* idm_create();
 
 /*
-destroy identifier map
+destroy identifier map, along with its string literals unless they have been taken by setting string_literals to NULL
 */
 void idm_destroy(identfier_map_t*);
 
+/*
+destroy a map of string literals to labels taken from an identifier map
+*/
+void idm_destroy_string_literals(hash_table_t* string_literals);
+
 /*
 add a declaration into the map, does not check for duplicates
 */
@@ -96,6 +106,10 @@ update the declaration, used when we encounter a definition after encountering t
 */
 ast_declaration_t* idm_update_decl(identfier_map_t* map, ast_declaration_t* decl);
 
+/*
+Names are interned (see tok_intern()) and compared by pointer
+*/
+
 /*
 search the map for a declaration 
 */
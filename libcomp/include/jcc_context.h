@@ -0,0 +1,106 @@
+#pragma once
+
+//compiler context - all state belonging to a single compilation
+
+#include "diag.h"
+
+#include <libj/include/platform.h>
+#include <libj/include/arena.h>
+#include <libj/include/intern.h>
+
+#include <stdint.h>
+
+typedef struct src_context src_context_t;
+typedef struct pp_context pp_context_t;
+typedef struct parse_context parse_context_t;
+typedef struct sema_context sema_context_t;
+typedef struct gen_context gen_context_t;
+typedef struct src_cache src_cache_t;
+typedef struct time_trace time_trace_t;
+
+typedef struct jcc_context
+{
+	/*
+	diagnostic callback and context data
+	*/
+	diag_cb diag_cb;
+	void* diag_data;
+	char diag_desc_buff[1024];
+
+	/*
+	id assigned to the next token created
+	*/
+	uint32_t next_tok_id;
+
+	/*
+	tokens created by the compilation and their literal payloads
+	*/
+	arena_t* tok_arena;
+
+	/*
+	tokens returned with tok_release(), linked through next and reused by tok_create()
+	*/
+	struct token* free_toks;
+
+	/*
+	identifier spellings, interned so names are compared by pointer
+	*/
+	intern_table_t* idents;
+
+	/*
+	per phase state, owned by the phase which creates it
+	*/
+	src_context_t* src;
+	pp_context_t* pp;
+	parse_context_t* parse;
+	sema_context_t* sema;
+	gen_context_t* gen;
+
+	/*
+	arena of the translation unit being parsed or analysed, AST nodes are allocated from here.
+	Not owned by the context, set by parse_init() and sema_analyse()
+	*/
+	arena_t* ast_arena;
+
+	/*
+	optional cache of files and tokens shared with other compilations, not owned by the context
+	*/
+	src_cache_t* cache;
+
+	/*
+	optional directory of token files, see tok_file.h. Not owned by the context
+	*/
+	const char* tok_cache_dir;
+
+	/*
+	optional timing of the compilation, owned by the context. NULL when not tracing
+	*/
+	time_trace_t* trace;
+}jcc_context_t;
+
+/*
+create an empty context
+*/
+jcc_context_t* jcc_context_create();
+
+/*
+destroy a context and any phase state it still holds
+*/
+void jcc_context_destroy(jcc_context_t* ctx);
+
+/*
+The context in use on the calling thread.
+Each phase's entry points make their context current so the functions
+they call do not need to pass it along. A thread works on a single context at a time
+*/
+extern THREAD_LOCAL jcc_context_t* _cur_ctx;
+
+static inline jcc_context_t* jcc_ctx()
+{
+	return _cur_ctx;
+}
+
+static inline void jcc_ctx_set(jcc_context_t* ctx)
+{
+	_cur_ctx = ctx;
+}
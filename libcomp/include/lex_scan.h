@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+Scanning kernels for the lexer's long runs of characters, whitespace, comments and identifier bodies.
+Each returns the first position in [p, end) where the scan stops, or end.
+The kernels look at 16 (SSE2) or 32 (AVX2) bytes per step, the best the cpu supports is selected at runtime
+with a scalar fallback for other cpus and the tail of the range
+*/
+
+typedef enum
+{
+	lex_scan_scalar,
+	lex_scan_sse2,
+	lex_scan_avx2
+}lex_scan_isa;
+
+/*
+first character which is neither ' ' nor '\t'
+*/
+const char* lex_scan_blanks(const char* p, const char* end);
+
+/*
+first character which is not [a-zA-Z0-9_]
+*/
+const char* lex_scan_identifier(const char* p, const char* end);
+
+/*
+first occurrence of either a or b
+*/
+const char* lex_scan_either(const char* p, const char* end, char a, char b);
+
+/*
+select the best kernels the cpu supports, the scalar kernels are used until this is called.
+Call once at startup, before any thread is lexing
+*/
+void lex_scan_init();
+
+/*
+the kernels in use
+*/
+lex_scan_isa lex_scan_get_isa();
+
+/*
+use the kernels for isa, or the best supported below it. Returns the isa in use.
+As with lex_scan_init(), no thread may be lexing
+*/
+lex_scan_isa lex_scan_set_isa(lex_scan_isa isa);
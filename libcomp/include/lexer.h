@@ -2,5 +2,32 @@
 
 #include "token.h"
 
-void lex_init();
-token_range_t lex_source(source_range_t*); 
+struct jcc_context;
+
+void lex_init(struct jcc_context* ctx);
+token_range_t lex_source(struct jcc_context* ctx, source_range_t*); 
+
+/*
+A cursor lexes a source range one token at a time, as the tokens are asked for, so only the tokens
+still in use need be held. Tokens returned by lex_next() are not linked to each other.
+When the context has a cache the range is lexed, or copied from the cache, up front
+*/
+typedef struct lex_cursor lex_cursor_t;
+
+/*
+path is the file sr was loaded from, or NULL. With a path and a token cache directory in the context
+the tokens are read from, or lexed up front and written to, the file's token file
+*/
+lex_cursor_t* lex_begin(struct jcc_context* ctx, source_range_t* sr, const char* path);
+
+/*
+the next token, tok_eof at the end of the range and from every call after it
+*/
+token_t* lex_next(lex_cursor_t* cursor);
+
+/*
+true if lexing stopped at an error before the end of the range
+*/
+bool lex_failed(lex_cursor_t* cursor);
+
+void lex_end(lex_cursor_t* cursor);
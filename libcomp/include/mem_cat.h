@@ -0,0 +1,20 @@
+#pragma once
+
+//categories used to tag the compiler's memory allocations
+
+#include <libj/include/mem.h>
+
+typedef enum
+{
+	mc_general,
+	mc_source,
+	mc_tokens,
+	mc_macros,
+	mc_ast,
+	mc_types,
+	mc_symbols,
+	mc_codegen,
+	mc_count
+}mem_category;
+
+const char* mem_category_name(mem_category cat);
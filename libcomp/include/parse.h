@@ -3,6 +3,9 @@
 #include "token.h"
 #include "ast.h"
 
-void parse_init(token_t* tok);
-ast_trans_unit_t* parse_translation_unit();
+struct jcc_context;
+
+void parse_init(struct jcc_context* ctx, token_t* tok);
+void parse_deinit(struct jcc_context* ctx);
+ast_trans_unit_t* parse_translation_unit(struct jcc_context* ctx);
 
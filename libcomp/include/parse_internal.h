@@ -2,6 +2,7 @@
 
 #include "token.h"
 #include "ast.h"
+#include "jcc_context.h"
 
 typedef enum
 {
@@ -18,6 +19,7 @@ ast_expression_t* try_parse_expression();
 ast_block_item_t* parse_block_list();
 ast_expression_t* parse_constant_expression();
 void parse_type_init();
+void parse_type_deinit(parse_context_t* parse);
 ast_expression_t* parse_alloc_expr();
 
 //attempt to parse a type_spec, return flags indicating any qualifiers
@@ -37,34 +39,67 @@ ast_expression_t* opt_parse_array_size();
 
 void parse_on_enter_block();
 void parse_on_leave_block();
-void parse_register_alias_name(const char* name); //typedef name
+void parse_register_alias_name(const char* name); //typedef name, interned
 
 //helper functions
 bool expect_cur(tok_kind k);
 void* parse_err(int err, const char* format, ...);
 bool parse_seen_err();
 
-extern token_t* _cur_tok;
+struct parse_context
+{
+	token_t* cur_tok;
+	bool err;
+
+	/*
+	typedef names declared in each enclosing block
+	*/
+	struct alias_name_set* alias_name_stack;
+
+	/*
+	arena the AST is allocated from, owned until parse_translation_unit() hands it to a complete translation unit
+	*/
+	arena_t* arena;
+};
+
+static inline parse_context_t* parse_ctx()
+{
+	return jcc_ctx()->parse;
+}
 
 static inline token_t* current()
 {
-	return _cur_tok;
+	return parse_ctx()->cur_tok;
+}
+
+/*
+location of tok, nodes record one or two each
+*/
+static inline src_loc_t parse_loc(token_t* tok)
+{
+	return tok->loc;
+}
+
+static inline src_loc_t current_loc()
+{
+	return parse_loc(parse_ctx()->cur_tok);
 }
 
 static inline bool current_is(tok_kind k)
 {
-	return _cur_tok->kind == k;
+	return parse_ctx()->cur_tok->kind == k;
 }
 
 static inline token_t* next_tok()
 {
-	_cur_tok = _cur_tok->next;
-	return _cur_tok;
+	parse_context_t* parse = parse_ctx();
+	parse->cur_tok = parse->cur_tok->next;
+	return parse->cur_tok;
 }
 
 static inline bool next_is(tok_kind k)
 {
-	return _cur_tok->next->kind == k;
+	return parse_ctx()->cur_tok->next->kind == k;
 }
 
 
@@ -0,0 +1,26 @@
+#pragma once
+
+//precompiled prefix headers
+
+#include "token.h"
+
+struct jcc_context;
+
+/*
+A precompiled header holds the state of the preprocessor after a prefix header; its macros, include guards,
+#pragma once files and the preprocessed tokens, along with the size, modification time and a hash of each file they came from.
+Token locations refer to those files so diagnostics report positions in the header as though it had been included
+*/
+
+/*
+Write the state of the current preprocessor, which produced toks, to path.
+Returns false if the file could not be written
+*/
+bool pch_write(struct jcc_context* ctx, const char* path, token_range_t* toks);
+
+/*
+Seed the preprocessor, after pre_proc_init(), with the header at path so the tokens of the source which follows are
+preprocessed as though the header was included first and its tokens come before them.
+Returns false if the file is not a precompiled header or any of the files it was created from have changed
+*/
+bool pch_load(struct jcc_context* ctx, const char* path);
@@ -2,6 +2,13 @@
 
 #include "token.h"
 
-void pre_proc_init();
-void pre_proc_deinit();
-token_range_t pre_proc_file(const char* src_dir, token_range_t* range);
\ No newline at end of file
+struct jcc_context;
+
+void pre_proc_init(struct jcc_context* ctx);
+void pre_proc_deinit(struct jcc_context* ctx);
+token_range_t pre_proc_file(struct jcc_context* ctx, const char* src_dir, token_range_t* range);
+
+/*
+preprocess sr, lexing it and its includes as the tokens are needed rather than up front
+*/
+token_range_t pre_proc_source(struct jcc_context* ctx, const char* src_dir, source_range_t* sr);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "token.h"
+#include "lexer.h"
+#include "jcc_context.h"
 
 #include <libj/include/hash_table.h>
 
@@ -31,30 +33,81 @@ typedef struct
 	const char* name;
 
 	/*
-	hash set of token ids. This macro is hidden from these tokens
+	unique for the life of the preprocessor, a redefinition gets a new id.
+	Hide sets refer to macros by id
 	*/
-	hash_table_t* hidden_toks;
+	uint32_t id;
 }macro_t;
 
+/*
+A hide set is the set of macros a token may not be expanded as.
+Sets are immutable and stored once in pp_context_t, token_t::hide_set is the index of its set and 0 the empty set.
+Each set is its highest macro id added to the set of lower ids in parent so equal sets share the same index
+and the number of sets is bounded by the macro nesting seen rather than the number of tokens expanded
+*/
+typedef struct
+{
+	uint32_t macro_id;
+	uint32_t parent;
+}hide_set_t;
+
+/*
+The argument given for a parameter of a function like macro, its tokens are followed by an end marker
+*/
+typedef struct
+{
+	const char* name; //interned parameter name
+	token_range_t tokens;
+}macro_arg_t;
+
 typedef struct expansion_context
 {
 	macro_t* macro;
-	hash_table_t* params;
+
+	/*
+	arguments of a function like macro, one for each of macro->fn_params.
+	The tokens are released when the expansion ends and the array is kept when the context is recycled
+	*/
+	macro_arg_t* args;
+	uint32_t arg_count;
+	uint32_t arg_capacity;
 
 	bool complete;
 
 	struct expansion_context* next;
+
+	/*
+	every context the preprocessor has allocated, in use or not, freed when it ends
+	*/
+	struct expansion_context* next_alloc;
 }expansion_context_t;
 
+/*
+Tokens are read either from a token range or, for a source file, pulled from a lexer.
+The tokens of a file belong to the preprocessor, a range such as a macro's replacement list is only borrowed
+and _pop_next() duplicates its tokens
+*/
 typedef struct input_range
 {
-	token_range_t* tokens;
+	token_range_t tokens;
+	lex_cursor_t* lexer;
+	bool owned;
+
+	/*
+	unique for the life of the preprocessor, input ranges are recycled once read
+	*/
+	uint32_t id;
+
 	token_t* current;
 
 	expansion_context_t* macro_expansion;
 
-	const char* path;
-	uint32_t line_num;
+	/*
+	locations of the start of the input and of the first token of the line being read.
+	The file and line of each are only looked up when needed by __FILE__, __LINE__ or #include
+	*/
+	src_loc_t file_pos;
+	src_loc_t line_pos;
 
 	struct input_range* next;
 }input_range_t;
@@ -68,10 +121,10 @@ typedef struct dest_range
 
 #define FLAGS_UNSET 0xFF
 
-typedef struct
+struct pp_context
 {
 	/*
-	Map of identifier string to macro_t*
+	Map of interned identifier to macro_t*
 	*/
 	hash_table_t* defs;
 
@@ -87,7 +140,54 @@ typedef struct
 	uint8_t define_id_supression_state;
 
 	hash_table_t* praga_once_paths;
-}pp_context_t;
+
+	/*
+	files wrapped in #ifndef X / #endif, keyed by the including directory and the #include's path.
+	The value is the interned name X
+	*/
+	hash_table_t* include_guards;
+
+	/*
+	interned spellings of the identifiers the preprocessor gives a meaning to
+	*/
+	struct
+	{
+		const char* defined;
+		const char* once;
+		const char* file;
+		const char* line;
+		const char* date;
+		const char* time;
+	}names;
+
+	uint32_t next_macro_id;
+
+	uint32_t next_input_id;
+
+	/*
+	input ranges and expansion contexts which have been read, reused before allocating more
+	*/
+	input_range_t* free_inputs;
+	expansion_context_t* free_expansions;
+	expansion_context_t* all_expansions;
+
+	/*
+	path of the #include being processed
+	*/
+	str_buff_t* inc_path;
+
+	/*
+	hide sets referenced by token_t::hide_set, entry 0 is the empty set.
+	lookup maps (parent, macro id) to the index of the set
+	*/
+	struct
+	{
+		hide_set_t* sets;
+		uint32_t count;
+		uint32_t capacity;
+		hash_table_t* lookup;
+	}hide_sets;
+};
 
 bool pre_proc_eval_expr(pp_context_t* pp, token_range_t range, uint32_t* val);
 
@@ -30,6 +30,18 @@ typedef struct
 	sema_user_type_def_cb user_type_def_cb;
 }sema_observer_t;
 
-void sema_init(sema_observer_t);
-valid_trans_unit_t* sema_analyse(ast_trans_unit_t*);
+struct jcc_context;
+
+void sema_init(struct jcc_context* ctx, sema_observer_t);
+void sema_deinit(struct jcc_context* ctx);
+
+/*
+analyse ast, which is owned by the returned translation unit.
+On failure ast is destroyed and NULL returned, if the analysis does not return both are destroyed with the context
+*/
+valid_trans_unit_t* sema_analyse(struct jcc_context* ctx, ast_trans_unit_t*);
+
+/*
+destroy tl and the AST it owns
+*/
 void tl_destroy(valid_trans_unit_t*);
\ No newline at end of file
@@ -43,7 +43,7 @@ typedef struct
 	//set of goto statements found in the function
 	hash_table_t* goto_smnts;
 
-	//set of strings used as labels
+	//set of interned label names
 	hash_table_t* labels;
 }func_context_t;
 
@@ -51,8 +51,8 @@ func_context_t* sema_get_cur_fn_ctx();
 
 identfier_map_t* sema_id_map();
 bool sema_resolve_type_ref(ast_type_ref_t* ref);
-ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start);
-bool sema_resolve_function_sig_types(ast_func_sig_type_spec_t* fsig, token_t* start);
+ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, src_loc_t start);
+bool sema_resolve_function_sig_types(ast_func_sig_type_spec_t* fsig, src_loc_t start);
 bool sema_can_convert_type(ast_type_spec_t* target, ast_type_spec_t* type);
 bool sema_is_same_type(ast_type_spec_t* lhs, ast_type_spec_t* rhs);
 bool sema_is_same_func_sig(ast_func_sig_type_spec_t* lhs, ast_func_sig_type_spec_t* rhs);
@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+struct jcc_context;
+
 /*
 A range of memory containing source code
 */
@@ -26,6 +28,27 @@ typedef struct
     const char* file_name; //file name only
 }file_pos_t;
 
+/*
+A position within any loaded file in 32 bits.
+Each file is given its own block of the location space when it is loaded, the offset of a position into that block
+identifies both the file and the position within it
+*/
+typedef uint32_t src_loc_t;
+
+/*
+Location of a position not within a range known to the context
+*/
+#define SRC_LOC_NONE 0
+
+/*
+Locations of the first and last tokens of a construct
+*/
+typedef struct
+{
+    src_loc_t start;
+    src_loc_t end;
+}src_loc_range_t;
+
 /*
 Include type - <blah.h> or "blah.h"
 */
@@ -41,39 +64,88 @@ Callback used to load source file into memory
 typedef source_range_t (*src_load_cb)(const char* dir, const char* file, void* data);
 
 /*
-Set the callback used to load source files into memory
+Loader which maps files into memory read only rather than copying them.
+The mappings are held until src_deinit()
+*/
+source_range_t src_map_file(const char* dir, const char* file, void* data);
+
+/*
+Set the callback used to load source files into memory, replacing any source data held by ctx.
+A new context maps files with src_map_file()
 */
-void src_init(src_load_cb load_cb, void* load_data);
+void src_init(struct jcc_context* ctx, src_load_cb load_cb, void* load_data);
 
 /*
 Destroy data structures
 */
-void src_deinit();
+void src_deinit(struct jcc_context* ctx);
 
 /*
 Add a path to be searched when loading a header
 */
-void src_add_header_path(const char* path);
+void src_add_header_path(struct jcc_context* ctx, const char* path);
 
 /*
 Return info (path, line & column) about a given source char
 */
-file_pos_t src_get_pos_info(const char* pos);
+file_pos_t src_get_pos_info(struct jcc_context* ctx, const char* pos);
+
+/*
+The location of a source char, SRC_LOC_NONE if pos is not within a loaded file
+*/
+src_loc_t src_get_loc(struct jcc_context* ctx, const char* pos);
+
+/*
+The source char at loc, NULL for SRC_LOC_NONE
+*/
+const char* src_loc_ptr(struct jcc_context* ctx, src_loc_t loc);
+
+/*
+Return info (path, line & column) about a location
+*/
+file_pos_t src_get_loc_info(struct jcc_context* ctx, src_loc_t loc);
+
+/*
+The contents and path of the loaded file containing pos, NULL if pos is not within a loaded file.
+path is set to NULL for a range with no file, such as the scratch space
+*/
+source_range_t* src_find_file(struct jcc_context* ctx, const char* pos, const char** path);
+
+/*
+64 bit hash of len bytes, used to check a file is unchanged
+*/
+uint64_t src_hash(const void* data, size_t len);
 
 /*
 Load a source file
 */
-source_range_t* src_load_file(const char* path, const char* file_name);
+source_range_t* src_load_file(struct jcc_context* ctx, const char* path, const char* file_name);
 
 /*
 Attempt to load a header file
 */
-source_range_t* src_load_header(const char* cur_dir, const char* path, include_kind kind);
+source_range_t* src_load_header(struct jcc_context* ctx, const char* cur_dir, const char* path, include_kind kind);
 
 /*
 Return true if the given source_range_t is valid
 */
 bool src_is_valid_range(source_range_t* src);
 
-//used for test code
-void src_register_range(source_range_t range, char* file);
+/*
+Give a range not loaded through the context a block of locations. file may be NULL.
+The range must stay valid for the life of the context
+*/
+void src_register_range(struct jcc_context* ctx, source_range_t range, const char* file);
+
+/*
+The location of the start of range, registering range without a file if it is not within one already known.
+SRC_LOC_NONE if the context has no source data
+*/
+src_loc_t src_range_loc(struct jcc_context* ctx, source_range_t* range);
+
+/*
+Copy len chars of str, followed by a NUL, into the scratch space and return the copy.
+The scratch space has locations like a loaded file and is freed by src_deinit(). It holds the spelling of
+tokens which are created rather than lexed from a file, such as those pasted or stringized by the preprocessor
+*/
+const char* src_scratch(struct jcc_context* ctx, const char* str, size_t len);
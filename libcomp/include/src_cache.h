@@ -0,0 +1,46 @@
+#pragma once
+
+//cache of source files and their tokens shared by a series of compilations
+
+#include "source.h"
+#include "token.h"
+
+struct jcc_context;
+
+/*
+Files stay mapped and their lexed tokens are kept between compilations.
+A file is checked for changes to its size or modification time the first time it is loaded
+by each compilation.
+The cache is not thread safe; compilations using it must run one after another
+*/
+typedef struct src_cache src_cache_t;
+
+/*
+create an empty cache
+*/
+src_cache_t* src_cache_create();
+
+/*
+destroy the cache, releasing all files and tokens
+*/
+void src_cache_destroy(src_cache_t* cache);
+
+/*
+Start a new compilation. Entries replaced during the previous compilation are released
+*/
+void src_cache_begin(src_cache_t* cache);
+
+/*
+src_load_cb returning the cached copy of a file, data is the src_cache_t*
+*/
+source_range_t src_cache_load(const char* dir, const char* file, void* data);
+
+/*
+If tokens have been stored for the range, copy them into result and return true
+*/
+bool src_cache_find_tokens(struct jcc_context* ctx, src_cache_t* cache, source_range_t* sr, token_range_t* result);
+
+/*
+Store a copy of the tokens lexed from sr if it is a range held by the cache
+*/
+void src_cache_store_tokens(struct jcc_context* ctx, src_cache_t* cache, source_range_t* sr, token_range_t* toks);
@@ -10,6 +10,4 @@ extern ast_type_spec_t* uint16_type_spec;
 extern ast_type_spec_t* int32_type_spec;
 extern ast_type_spec_t* uint32_type_spec;
 extern ast_type_spec_t* int64_type_spec;
-extern ast_type_spec_t* uint64_type_spec;
-
-void types_init();
\ No newline at end of file
+extern ast_type_spec_t* uint64_type_spec;
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+//hierarchical timing of a compilation, written in the Chrome trace event format
+
+#include "jcc_context.h"
+
+#include <stdbool.h>
+
+typedef struct time_trace time_trace_t;
+
+/*
+create an empty trace, timestamps are relative to its creation
+*/
+time_trace_t* trace_create();
+
+void trace_destroy(time_trace_t* trace);
+
+/*
+open a span nested in the innermost open span.
+name must outlive the trace, detail is copied and may be NULL
+*/
+void trace_span_begin(time_trace_t* trace, const char* name, const char* detail);
+
+/*
+close the innermost open span
+*/
+void trace_span_end(time_trace_t* trace);
+
+/*
+write the recorded spans as JSON, viewable in chrome://tracing or Perfetto
+*/
+bool trace_write(time_trace_t* trace, const char* path);
+
+/*
+Record a span on ctx's trace. These do nothing unless tracing is enabled
+*/
+static inline void trace_begin(jcc_context_t* ctx, const char* name, const char* detail)
+{
+	if (ctx->trace)
+		trace_span_begin(ctx->trace, name, detail);
+}
+
+static inline void trace_end(jcc_context_t* ctx)
+{
+	if (ctx->trace)
+		trace_span_end(ctx->trace);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+//on disk cache of the tokens lexed from source files, shared by separate compiler processes
+
+#include "source.h"
+#include "token.h"
+
+struct jcc_context;
+
+/*
+A token file in the cache directory holds the tokens lexed from one source file along with the size,
+modification time and a hash of the contents they were lexed from, the tokens are only used while all three match.
+Token locations are stored as offsets so loaded tokens point into the source range as though lexed from it
+*/
+
+/*
+If dir holds the tokens of the file at path, whose contents are sr, create them in the current context and return true
+*/
+bool tok_file_load(struct jcc_context* ctx, const char* dir, const char* path, source_range_t* sr, token_range_t* result);
+
+/*
+Write the tokens lexed from the file at path, whose contents are sr, to dir.
+Returns false if the file could not be written
+*/
+bool tok_file_store(struct jcc_context* ctx, const char* dir, const char* path, source_range_t* sr, token_range_t* toks);
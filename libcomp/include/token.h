@@ -5,6 +5,8 @@
 #include "int_val.h"
 
 #include <libj/include/str_buff.h>
+#include <libj/include/arena.h>
+#include <libj/include/intern.h>
 
 #include <stdbool.h>
 #include <stdlib.h>
@@ -16,21 +18,49 @@ enum tok_flags
     TF_LEADING_SPACE = 0x02
 };
 
+/*
+limits of the narrow token fields
+*/
+#define TOK_MAX_LEN 0xFFFFFF
+#define TOK_MAX_HIDE_SET 0xFFFFFF
+
+/*
+alignment of the arenas tokens are allocated from. Tokens and their payloads need no more than 8 bytes
+so each token takes sizeof(token_t), rather than being rounded up to ARENA_ALIGN
+*/
+#define TOK_ARENA_ALIGN 8
+
 typedef struct token
 {
-    const char* loc;
-    size_t len;
-    tok_kind kind;
+    /*
+    location of the spelling, see tok_spelling()
+    */
+    src_loc_t loc;
+    uint32_t id;
+
+    /*
+    len is the length of the spelling, kind a tok_kind.
+    Stored narrow to keep the token small
+    */
+    uint32_t len : 24;
+    uint32_t kind : 8;
 
+    /*
+    index of the preprocessor hide set of the macros this token may not be expanded as, 0 when empty
+    */
+    uint32_t hide_set : 24;
+    uint32_t flags : 8;
+
+    /*
+    literal payloads are held out of line, in the same arena as the token.
+    The spelling of an identifier is interned in the context, see tok_intern()
+    */
     union
     {
-        int_val_t int_val;
-        char* str;
+        int_val_t* int_val;
+        const char* str;
     }data;
 
-    uint32_t id;
-
-    uint8_t flags;
     struct token* next;
     struct token* prev;
 }token_t;
@@ -41,7 +71,49 @@ typedef struct
     token_t* end;
 }token_range_t;
 
+/*
+Tokens are allocated from the token arena of the current context, reusing any returned by tok_release() first.
+The arena, and any tokens still on the free list, are freed with the context.
+tok_create() assigns a new id, tok_duplicate() keeps the id and shares the payload of tok
+*/
 token_t* tok_create();
+token_t* tok_duplicate(token_t* tok);
+
+/*
+return tok to the current context for reuse by the next tok_create() or tok_duplicate().
+Nothing may refer to tok afterwards
+*/
+void tok_release(token_t* tok);
+void tok_range_release(token_range_t* range);
+
+/*
+copy tok and its payload into arena.
+An identifier's spelling is interned in idents or, when idents is NULL, copied into arena
+*/
+token_t* tok_copy(arena_t* arena, intern_table_t* idents, token_t* tok);
+
+/*
+out of line literal payloads for tokens of the current context
+*/
+int_val_t* tok_alloc_int_val(int_val_t val);
+char* tok_alloc_str(const char* str, size_t len);
+
+/*
+intern an identifier spelling in the current context.
+Identifiers with the same spelling share the same pointer so they can be compared with ==
+*/
+const char* tok_intern(const char* str, size_t len);
+
+/*
+location of the spelling of tok, SRC_LOC_NONE if it has none
+*/
+src_loc_t tok_loc(token_t* tok);
+
+/*
+the spelling of tok, tok->len chars which may include line continuations. NULL if tok has no location
+*/
+const char* tok_spelling(token_t* tok);
+
 token_t* tok_find_next(token_t* start, tok_kind kind);
 const char* tok_kind_spelling(tok_kind);
 void tok_printf(token_t* tok);
@@ -49,11 +121,8 @@ void tok_printf(token_t* tok);
 size_t tok_spelling_len(token_t* tok);
 void tok_spelling_cpy(token_t* tok, char* dest, size_t len);
 void tok_spelling_extract(const char* src_loc, size_t src_len, str_buff_t* result);
-void tok_destory(token_t* tok);
 bool tok_equals(token_t* lhs, token_t* rhs);
-token_t* tok_duplicate(token_t* tok);
 
-void tok_range_destroy(token_range_t* range);
 void tok_range_print(token_range_t* range);
 bool tok_range_equals(token_range_t* lhs, token_range_t* rhs);
 token_range_t* tok_range_create(token_t* start, token_t* end);
@@ -6,8 +6,8 @@
 typedef struct var_data
 {
 	int bsp_offset;
-	char name[MAX_LITERAL_NAME];
-	char global_name[MAX_LITERAL_NAME * 2];
+	const char* name; //interned
+	char* global_name; //label of a global variable
 
 	enum
 	{
@@ -51,7 +51,7 @@ void var_leave_block(var_set_t*);
 var_data_t* var_decl_stack_var(var_set_t*, ast_declaration_t*);
 var_data_t* var_decl_global_var(var_set_t*, ast_declaration_t*);
 
-/* search from the current block outwards looking for a variable */
+/* search from the current block outwards looking for a variable, name must be interned */
 var_data_t* var_find(var_set_t*, const char* name);
 
 token_t* var_get_tok(var_data_t*);
@@ -1,290 +1,40 @@
 #include "ast.h"
+#include "jcc_context.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
-void ast_destroy_statement(ast_statement_t* smnt);
-void ast_destroy_type_ref(ast_type_ref_t* type_ref);
-
-//destroy any data held by the expression. used to 'reset' an expression before reusing
-void ast_destroy_expression_data(ast_expression_t* expr)
-{
-	if (!expr) return;
-
-	switch (expr->kind)
-	{
-	case expr_unary_op:
-		ast_destroy_expression(expr->data.unary_op.expression);
-		break;
-	case expr_binary_op:
-		ast_destroy_expression(expr->data.binary_op.lhs);
-		ast_destroy_expression(expr->data.binary_op.rhs);
-		break;
-	case expr_int_literal:
-		break;
-	case expr_identifier:
-		break;
-	case expr_condition:
-		ast_destroy_expression(expr->data.condition.cond);
-		ast_destroy_expression(expr->data.condition.true_branch);
-		ast_destroy_expression(expr->data.condition.false_branch);
-		break;
-	case expr_func_call:
-	{
-		ast_destroy_expression(expr->data.func_call.target);
-		ast_func_call_param_t* param = expr->data.func_call.first_param;
-		while (param)
-		{
-			ast_func_call_param_t* next = param->next;
-			ast_destroy_expression(param->expr);
-			free(param);
-			param = next;
-		}
-		break;
-	}
-	case expr_sizeof:
-		if (expr->data.sizeof_call.kind == sizeof_expr)
-			ast_destroy_expression(expr->data.sizeof_call.data.expr);
-		break;
-	case expr_cast:
-		ast_destroy_expression(expr->data.cast.expr);
-		break;
-	}
-
-	//don't free the expression
-	expr->kind = expr_null;
-}
-
-void ast_destroy_expression(ast_expression_t* expr)
-{
-	if (!expr) return;
-
-	switch (expr->kind)
-	{
-	case expr_unary_op:
-		ast_destroy_expression(expr->data.unary_op.expression);
-		break;
-	case expr_binary_op:
-		ast_destroy_expression(expr->data.binary_op.lhs);
-		ast_destroy_expression(expr->data.binary_op.rhs);
-		break;
-	case expr_int_literal:
-		break;
-	case expr_identifier:
-		break;	
-	case expr_condition:
-		ast_destroy_expression(expr->data.condition.cond);
-		ast_destroy_expression(expr->data.condition.true_branch);
-		ast_destroy_expression(expr->data.condition.false_branch);
-		break;
-	case expr_func_call:
-	{
-		ast_func_call_param_t* param = expr->data.func_call.first_param;
-		while (param)
-		{
-			ast_func_call_param_t* next = param->next;
-			ast_destroy_expression(param->expr);
-			free(param);
-			param = next;
-		}
-	}
-		break;
-	}
-		
-	free(expr);
-}
-
-void ast_destroy_struct_member(ast_struct_member_t* member)
-{
-	ast_destroy_declaration(member->decl);
-	free(member);
-}
-
-void ast_destroy_enum_member(ast_enum_member_t* member)
-{
-	ast_destroy_expression(member->value);
-	free(member);
-}
-
-void ast_destroy_user_type(ast_user_type_spec_t* user_type)
-{
-	if (user_type->kind == user_type_enum)
-	{
-		ast_enum_member_t* member = user_type->data.enum_members;
-		while (member)
-		{
-			ast_enum_member_t* next = member->next;
-			ast_destroy_enum_member(member);
-			member = next;
-		}
-	}
-	else
-	{
-		ast_struct_member_t* member = user_type->data.struct_members;
-		while (member)
-		{
-			ast_struct_member_t* next = member->next;
-			ast_destroy_struct_member(member);
-			member = next;
-		}
-	}
-	free(user_type);
-}
-
-void ast_destroy_type_spec(ast_type_spec_t* type)
+ast_trans_unit_t* ast_create_translation_unit(arena_t* arena)
 {
-	type;
-	/*if (!type) return;
-
-	if (type->kind == type_ptr)
-	{
-		ast_destroy_type_spec(type->ptr_type);
-		free(type);
-	}
-	else if (type->kind == type_user)
-	{
-		ast_destroy_user_type(type->user_type_spec);
-	}*/
+	ast_trans_unit_t* tl = (ast_trans_unit_t*)arena_alloc(arena, sizeof(ast_trans_unit_t));
+	tl->arena = arena;
+	return tl;
 }
 
-void ast_destroy_type_ref(ast_type_ref_t* type_ref)
+void* ast_alloc(size_t sz)
 {
-	if (!type_ref) return;
-	//we dont destroy the type here, that happens when we destroy the declaration
-	free(type_ref);
+	assert(jcc_ctx()->ast_arena);
+	return arena_alloc(jcc_ctx()->ast_arena, sz);
 }
 
-void ast_destroy_declaration(ast_declaration_t* decl)
-{
-	if (!decl) return;
-
-	ast_destroy_type_ref(decl->type_ref);
-	switch (decl->kind)
-	{
-	case decl_var:
-		ast_destroy_expression(decl->data.var.init_expr);
-		break;
-	case decl_func:
-		//ast_destroy_expression(decl->data.func.params);
-		break;
-	}
-	free(decl);
-}
-
-void ast_destroy_expression_list(ast_expression_list_t* list)
-{
-	while (list)
-	{
-		ast_expression_list_t* next = list->next;
-		ast_destroy_expression(list->expr);
-		free(list);
-		list = next;
-	}
-}
-
-void ast_destroy_block_item(ast_block_item_t* b)
-{
-	if (!b) return;
-	switch (b->kind)
-	{
-	case blk_smnt:
-		ast_destroy_statement(b->data.smnt);
-		break;
-	case blk_decl:
-		ast_destroy_decl_list(b->data.decls);
-	};
-	free(b);
-
-}
-
-void ast_destroy_statement(ast_statement_t* smnt)
-{
-	if (!smnt) return;
-
-	ast_block_item_t* block = NULL;
-	switch (smnt->kind)
-	{
-		case smnt_return:
-		case smnt_expr:
-			ast_destroy_expression(smnt->data.expr);
-			break;
-		case smnt_if:
-			ast_destroy_expression(smnt->data.if_smnt.condition);
-			ast_destroy_statement(smnt->data.if_smnt.true_branch);
-			ast_destroy_statement(smnt->data.if_smnt.false_branch);
-			break;
-		case smnt_compound:
-			block = smnt->data.compound.blocks;
-			while (block)
-			{
-				ast_block_item_t* next = block->next;
-				ast_destroy_block_item(block);
-				block = next;
-			}
-			break;
-		case smnt_break:
-		case smnt_continue:
-			break;
-		case smnt_while:
-		case smnt_do:
-			ast_destroy_expression(smnt->data.while_smnt.condition);
-			ast_destroy_statement(smnt->data.while_smnt.statement);
-			break;
-		case smnt_for:
-		case smnt_for_decl:
-			ast_destroy_decl_list(smnt->data.for_smnt.decls);
-			ast_destroy_expression(smnt->data.for_smnt.init);
-			ast_destroy_expression(smnt->data.for_smnt.condition);
-			ast_destroy_expression(smnt->data.for_smnt.post);
-			ast_destroy_statement(smnt->data.for_smnt.statement);
-			break;
-	}
-	free(smnt);
-}
-
-void ast_destroy_function_decl(ast_function_decl_data_t* fn)
-{
-	if (!fn) return;
-	/*ast_block_item_t* smnt = fn->blocks;
-	while (smnt)
-	{
-		ast_block_item_t* next = smnt->next;
-		ast_destroy_block_item(smnt);
-		smnt = next;
-	}*/
-
-	/*ast_function_param_t* param = fn->params;
-
-	while (param)
-	{
-		ast_function_param_t* next = param->next;
-		free(param);
-		param = next;
-	}*/
-
-	free(fn);
-}
-
-void ast_destroy_decl_list(ast_decl_list_t decl_list)
+//used to 'reset' an expression before reusing, the data it held is released with the translation unit
+void ast_destroy_expression_data(ast_expression_t* expr)
 {
-	ast_declaration_t* decl = decl_list.first;
-
-	while (decl)
-	{
-		ast_declaration_t* next = decl->next;
-		ast_destroy_declaration(decl);
-		decl = next;
-	}
+	if (!expr) return;
+	expr->kind = expr_null;
 }
 
 void ast_destory_translation_unit(ast_trans_unit_t* tl)
 {
 	if (!tl) return;
 
-	ast_destroy_decl_list(tl->decls);
+	jcc_context_t* ctx = jcc_ctx();
+	if (ctx && ctx->ast_arena == tl->arena)
+		ctx->ast_arena = NULL;
 
-	free(tl);
+	//the translation unit is itself allocated from the arena
+	arena_destroy(tl->arena);
 }
 
 const char* ast_type_name(ast_type_spec_t* type)
@@ -306,7 +56,7 @@ const char* ast_type_name(ast_type_spec_t* type)
 	case type_uint32:
 		return "uint32";
 	case type_user:
-		return type->data.user_type_spec->name;
+		return type->data.user_type_spec->name ? type->data.user_type_spec->name : "";
 	case type_array:
 		return "array"; //todo
 	case type_ptr:
@@ -343,7 +93,7 @@ void ast_type_spec_desc(str_buff_t* sb, ast_type_spec_t* spec)
 	case type_user:
 		sb_append(sb, ast_user_type_kind_name(spec->data.user_type_spec->kind));
 		sb_append(sb, " ");
-		if(strlen(spec->data.user_type_spec->name))
+		if(spec->data.user_type_spec->name)
 			sb_append(sb, spec->data.user_type_spec->name);
 		else
 			sb_append(sb, "<anonymous>");
@@ -401,7 +151,7 @@ ast_struct_member_t* ast_find_struct_member(ast_user_type_spec_t* user_type_spec
 	ast_struct_member_t* member = user_type_spec->data.struct_members;
 	while (member)
 	{
-		if (strcmp(member->decl->name, name) == 0)
+		if (member->decl->name == name)
 		{
 			return member;
 		}
@@ -412,12 +162,10 @@ ast_struct_member_t* ast_find_struct_member(ast_user_type_spec_t* user_type_spec
 
 ast_type_spec_t* ast_make_array_type(ast_type_spec_t* element_type, ast_expression_t* size_expr)
 {
-	ast_type_spec_t* result = (ast_type_spec_t*)malloc(sizeof(ast_type_spec_t));
-	memset(result, 0, sizeof(ast_type_spec_t));
+	ast_type_spec_t* result = (ast_type_spec_t*)ast_alloc(sizeof(ast_type_spec_t));
 	result->kind = type_array;
 	result->size = 0;
-	result->data.array_spec = (ast_array_spec_t*)malloc(sizeof(ast_array_spec_t));
-	memset(result->data.array_spec, 0, sizeof(ast_array_spec_t));
+	result->data.array_spec = (ast_array_spec_t*)ast_alloc(sizeof(ast_array_spec_t));
 	result->data.array_spec->element_type = element_type;
 	result->data.array_spec->size_expr = size_expr;
 	return result;
@@ -425,8 +173,7 @@ ast_type_spec_t* ast_make_array_type(ast_type_spec_t* element_type, ast_expressi
 
 ast_type_spec_t* ast_make_ptr_type(ast_type_spec_t* type)
 {
-	ast_type_spec_t* result = (ast_type_spec_t*)malloc(sizeof(ast_type_spec_t));
-	memset(result, 0, sizeof(ast_type_spec_t));
+	ast_type_spec_t* result = (ast_type_spec_t*)ast_alloc(sizeof(ast_type_spec_t));
 	result->kind = type_ptr;
 	result->size = 4;
 	result->data.ptr_type = type;
@@ -435,13 +182,11 @@ ast_type_spec_t* ast_make_ptr_type(ast_type_spec_t* type)
 
 ast_type_spec_t* ast_make_func_sig_type(ast_type_spec_t* ret_type, ast_func_params_t* params)
 {
-	ast_type_spec_t* result = (ast_type_spec_t*)malloc(sizeof(ast_type_spec_t));
-	memset(result, 0, sizeof(ast_type_spec_t));
+	ast_type_spec_t* result = (ast_type_spec_t*)ast_alloc(sizeof(ast_type_spec_t));
 	result->kind = type_func_sig;
 	result->size = 4;
 
-	result->data.func_sig_spec = (ast_func_sig_type_spec_t*)malloc(sizeof(ast_func_sig_type_spec_t));
-	memset(result->data.func_sig_spec, 0, sizeof(result->data.func_sig_spec));
+	result->data.func_sig_spec = (ast_func_sig_type_spec_t*)ast_alloc(sizeof(ast_func_sig_type_spec_t));
 	result->data.func_sig_spec->ret_type = ret_type;
 	result->data.func_sig_spec->params = params;
 	return result;
@@ -647,4 +392,32 @@ const char* ast_op_name(op_kind k)
 		return "[*] Defererence";
 	}
 	return "ERROR";
-}
\ No newline at end of file
+}
+
+#define NODE_SIZE(t) { #t, sizeof(t) }
+
+static const ast_node_size_t _node_sizes[] =
+{
+	NODE_SIZE(ast_expression_t),
+	NODE_SIZE(ast_statement_t),
+	NODE_SIZE(ast_declaration_t),
+	NODE_SIZE(ast_block_item_t),
+	NODE_SIZE(ast_type_ref_t),
+	NODE_SIZE(ast_type_spec_t),
+	NODE_SIZE(ast_user_type_spec_t),
+	NODE_SIZE(ast_struct_member_t),
+	NODE_SIZE(ast_enum_member_t),
+	NODE_SIZE(ast_func_sig_type_spec_t),
+	NODE_SIZE(ast_func_params_t),
+	NODE_SIZE(ast_func_param_decl_t),
+	NODE_SIZE(ast_func_call_param_t),
+	NODE_SIZE(ast_array_spec_t),
+	NODE_SIZE(ast_compound_init_item_t),
+	NODE_SIZE(ast_expression_list_t),
+	{ NULL, 0 }
+};
+
+const ast_node_size_t* ast_node_sizes()
+{
+	return _node_sizes;
+}
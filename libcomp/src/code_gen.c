@@ -3,6 +3,8 @@
 
 #include "id_map.h"
 #include "std_types.h"
+#include "time_trace.h"
+#include "mem_cat.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -14,88 +16,113 @@
 void gen_statement(ast_statement_t* smnt);
 void gen_block_item(ast_block_item_t* bi);
 
-static write_asm_cb _asm_cb;
-static void* _asm_cb_data;
-static bool _annotation = false;
-static uint32_t gen_annotate_depth = 0;
+var_set_t* gen_var_set()
+{
+	return gen_ctx()->var_set;
+}
 
-static var_set_t* _var_set;
-static bool _returned = false;
-static ast_declaration_t* _cur_fun = NULL;
-static valid_trans_unit_t* _cur_tl = NULL;
+/*
+format into buff, or into a heap allocation if the result does not fit.
+lines are never truncated, string literals in particular can be long
+*/
+static char* _format_line(char* buff, size_t sz, const char* format, va_list args)
+{
+	va_list copy;
+	va_copy(copy, args);
+	int len = vsnprintf(buff, sz, format, copy);
+	va_end(copy);
 
-static const char* _cur_break_label = NULL;
-static const char* _cur_cont_label = NULL;
+	if (len < 0 || (size_t)len < sz)
+		return buff;
 
-var_set_t* gen_var_set()
+	char* result = (char*)mem_alloc(mc_codegen, (size_t)len + 1);
+	vsnprintf(result, (size_t)len + 1, format, args);
+	return result;
+}
+
+static void _write_line(const char* line)
 {
-	return _var_set;
+	gen_context_t* gen = gen_ctx();
+	if (gen->annotation)
+	{
+		int tabs = gen->annotate_depth;
+		while ((--tabs) > 0)
+		{
+			gen->asm_cb("\t", false, gen->asm_cb_data);
+		}
+	}
+
+	gen->asm_cb(line, true, gen->asm_cb_data);
 }
 
 void gen_asm(const char* format, ...)
 {
+	//most instructions have no arguments, pass them straight through
+	if (!strchr(format, '%'))
+	{
+		_write_line(format);
+		return;
+	}
+
 	char buff[256];
 
 	va_list args;
 	va_start(args, format);
-	vsnprintf(buff, 256, format, args);
+	char* line = _format_line(buff, sizeof(buff), format, args);
 	va_end(args);
 
-	if (_annotation)
-	{
-		int tabs = gen_annotate_depth;
-		while ((--tabs) > 0)
-		{
-			_asm_cb("\t", false, _asm_cb_data);
-		}
-	}
-
-	_asm_cb(buff, true, _asm_cb_data);
+	_write_line(line);
+	if (line != buff)
+		mem_free(line);
 }
 
 void gen_annotate(const char* format, ...)
 {
-	if (_annotation)
+	if (gen_ctx()->annotation)
 	{
 		char buff[256];
 
 		va_list args;
 		va_start(args, format);
-		vsnprintf(buff, 256, format, args);
+		char* msg = _format_line(buff, sizeof(buff), format, args);
 		va_end(args);
 
-		gen_asm("#%s", buff);
+		gen_asm("#%s", msg);
+		if (msg != buff)
+			mem_free(msg);
 	}
 }
 
 void gen_annotate_start(const char* format, ...)
 {
-	gen_annotate_depth++;
-	if (_annotation)
+	gen_context_t* gen = gen_ctx();
+	gen->annotate_depth++;
+	if (gen->annotation)
 	{
 		char buff[256];
 
 		va_list args;
 		va_start(args, format);
-		vsnprintf(buff, 256, format, args);
+		char* msg = _format_line(buff, sizeof(buff), format, args);
 		va_end(args);
 
 		//newline before tabbed annotation start message
-		_asm_cb("", true, _asm_cb_data);
-		gen_asm("#%s", buff);
+		gen->asm_cb("", true, gen->asm_cb_data);
+		gen_asm("#%s", msg);
+		if (msg != buff)
+			mem_free(msg);
 	}
 }
 
 void gen_annotate_end()
 {
-	gen_annotate_depth--;
+	gen_ctx()->annotate_depth--;
 }
 
 //todo - replace with sema version
 void gen_make_label_name(char* name)
 {
-	static uint32_t next_label = 0;
-	sprintf(name, "_label%d", ++next_label);
+	sprintf(name, "_label%d", ++gen_ctx()->next_label);
 }
 
 static bool _is_unsigned_int_type(ast_type_spec_t* type)
@@ -229,7 +256,7 @@ void gen_compound_init(int32_t bsp_offset, ast_type_spec_t* decl_type, ast_expr_
 
 void gen_var_decl(ast_declaration_t* decl)
 {
-	var_data_t* var = var_decl_stack_var(_var_set, decl);
+	var_data_t* var = var_decl_stack_var(gen_ctx()->var_set, decl);
 	assert(var);
 	gen_annotate_start("local variable '%s' at stack %d", decl->name, var->bsp_offset);
 	if (decl->data.var.init_expr)
@@ -278,12 +305,12 @@ void gen_var_decl(ast_declaration_t* decl)
 
 void gen_scope_block_enter()
 {
-	var_enter_block(_var_set);
+	var_enter_block(gen_ctx()->var_set);
 }
 
 void gen_scope_block_leave()
 {
-	var_leave_block(_var_set);
+	var_leave_block(gen_ctx()->var_set);
 }
 
 void gen_case_statement(ast_statement_t* smnt)
@@ -324,8 +351,8 @@ void gen_switch_statement(ast_statement_t* smnt)
 		gen_asm("jmp %s", lbl_end);
 	}
 
-	const char* prev_break_lbl = _cur_break_label;
-	_cur_break_label = lbl_end;
+	const char* prev_break_lbl = gen_ctx()->break_label;
+	gen_ctx()->break_label = lbl_end;
 	gen_statement(smnt->data.switch_smnt.smnt);
 
 	if (data->sema.dflt_case)
@@ -334,7 +361,7 @@ void gen_switch_statement(ast_statement_t* smnt)
 		gen_statement(data->sema.dflt_case->smnt);
 	}
 	gen_asm("%s:", lbl_end);
-	_cur_break_label = prev_break_lbl;
+	gen_ctx()->break_label = prev_break_lbl;
 
 	gen_annotate_end();
 }
@@ -342,7 +369,7 @@ void gen_switch_statement(ast_statement_t* smnt)
 void gen_return_statement(ast_statement_t* smnt)
 {
 	gen_annotate_start("smnt_return");
-	ast_type_spec_t* ret_type = _get_func_sig_ret_type(_cur_fun->type_ref);
+	ast_type_spec_t* ret_type = _get_func_sig_ret_type(gen_ctx()->cur_fun->type_ref);
 	if (ret_type->size > 4)
 	{
 		gen_expression(smnt->data.expr);
@@ -386,14 +413,14 @@ void gen_return_statement(ast_statement_t* smnt)
 		gen_asm("leave");
 		gen_asm("ret");
 	}
-	_returned = true;
+	gen_ctx()->returned = true;
 	gen_annotate_end();
 }
 
 void gen_statement(ast_statement_t* smnt)
 {
-	const char* cur_break = _cur_break_label;
-	const char* cur_cont = _cur_cont_label;
+	const char* cur_break = gen_ctx()->break_label;
+	const char* cur_cont = gen_ctx()->cont_label;
 
 	if (smnt->kind == smnt_switch)
 	{
@@ -448,8 +475,8 @@ void gen_statement(ast_statement_t* smnt)
 		gen_make_label_name(label_start);
 		gen_make_label_name(label_end);
 
-		_cur_break_label = label_end;
-		_cur_cont_label = label_start;
+		gen_ctx()->break_label = label_end;
+		gen_ctx()->cont_label = label_start;
 
 		gen_asm("%s:", label_start);
 		gen_expression(smnt->data.while_smnt.condition);
@@ -468,8 +495,8 @@ void gen_statement(ast_statement_t* smnt)
 		gen_make_label_name(label_end);
 		gen_make_label_name(label_cont);
 
-		_cur_break_label = label_end;
-		_cur_cont_label = label_cont;
+		gen_ctx()->break_label = label_end;
+		gen_ctx()->cont_label = label_cont;
 
 		gen_asm("%s:", label_start);
 		gen_statement(smnt->data.while_smnt.statement);
@@ -496,8 +523,8 @@ void gen_statement(ast_statement_t* smnt)
 		if (f_data->init)
 			gen_expression(f_data->init);
 
-		_cur_break_label = label_end;
-		_cur_cont_label = label_cont;
+		gen_ctx()->break_label = label_end;
+		gen_ctx()->cont_label = label_cont;
 
 		gen_asm("%s:", label_start);
 		gen_expression(f_data->condition);
@@ -525,15 +552,15 @@ void gen_statement(ast_statement_t* smnt)
 
 		gen_scope_block_enter();
 
-		ast_declaration_t* decl = f_data->decls.first;
+		ast_declaration_t* decl = f_data->decls;
 		while (decl)
 		{
 			gen_var_decl(decl);
 			decl = decl->next;
 		}
 
-		_cur_break_label = label_end;
-		_cur_cont_label = label_cont;
+		gen_ctx()->break_label = label_end;
+		gen_ctx()->cont_label = label_cont;
 
 		gen_asm("%s:", label_start);
 		gen_expression(f_data->condition);
@@ -549,15 +576,15 @@ void gen_statement(ast_statement_t* smnt)
 	}
 	else if (smnt->kind == smnt_break)
 	{
-		if (!_cur_break_label)
-			diag_err(smnt->tokens.start, ERR_SYNTAX, "Invalid break");
-		gen_asm("jmp %s", _cur_break_label);
+		if (!gen_ctx()->break_label)
+			diag_err(smnt->loc.start, ERR_SYNTAX, "Invalid break");
+		gen_asm("jmp %s", gen_ctx()->break_label);
 	}
 	else if (smnt->kind == smnt_continue)
 	{
-		if (!_cur_cont_label)
-			diag_err(smnt->tokens.start, ERR_SYNTAX, "Invalid continue");
-		gen_asm("jmp %s", _cur_cont_label);
+		if (!gen_ctx()->cont_label)
+			diag_err(smnt->loc.start, ERR_SYNTAX, "Invalid continue");
+		gen_asm("jmp %s", gen_ctx()->cont_label);
 	}
 	else if (smnt->kind == smnt_label)
 	{
@@ -569,8 +596,8 @@ void gen_statement(ast_statement_t* smnt)
 		gen_asm("jmp %s", smnt->data.goto_smnt.label);
 	}
 
-	_cur_break_label = cur_break;
-	_cur_cont_label = cur_cont;
+	gen_ctx()->break_label = cur_break;
+	gen_ctx()->cont_label = cur_cont;
 }
 
 void gen_block_item(ast_block_item_t* bi)
@@ -593,8 +620,9 @@ void gen_block_item(ast_block_item_t* bi)
 
 void gen_function(ast_declaration_t* fn)
 {
-	_returned = false;
-	_cur_fun = fn;
+	trace_begin(jcc_ctx(), "Function", fn->name);
+	gen_ctx()->returned = false;
+	gen_ctx()->cur_fun = fn;
 
 	gen_annotate_start("function '%s'", fn->name);
 	gen_asm(".globl %s", fn->name);
@@ -619,7 +647,7 @@ void gen_function(ast_declaration_t* fn)
 		blk = blk->next;
 	}
 
-	if (!_returned)
+	if (!gen_ctx()->returned)
 	{
 		gen_annotate("epilogue");
 		//function epilogue
@@ -632,7 +660,8 @@ void gen_function(ast_declaration_t* fn)
 	gen_asm("\n");
 	gen_asm("\n");
 
-	_cur_fun = NULL;
+	gen_ctx()->cur_fun = NULL;
+	trace_end(jcc_ctx());
 }
 
 void gen_global_var_init(ast_expression_t* expr, ast_type_spec_t* spec);
@@ -709,7 +738,7 @@ void gen_global_var(ast_declaration_t* decl)
 {
 	gen_annotate_start("global variable '%s'", decl->name);
 
-	var_data_t* var = var_decl_global_var(_var_set, decl);
+	var_data_t* var = var_decl_global_var(gen_ctx()->var_set, decl);
 
 	gen_asm(".globl %s", var->global_name); //export symbol
 	ast_expression_t* var_expr = decl->data.var.init_expr;
@@ -748,13 +777,20 @@ void gen_string_literal(const char* value, const char* label)
 	gen_annotate_end();
 }
 
-void code_gen(valid_trans_unit_t* tl, write_asm_cb cb, void* data, bool annotation)
+void code_gen(jcc_context_t* ctx, valid_trans_unit_t* tl, write_asm_cb cb, void* data, bool annotation)
 {
-	_asm_cb = cb;
-	_asm_cb_data = data;
-	_cur_tl = tl;
-	_annotation = annotation;
-	_var_set = var_init_set();
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_codegen);
+
+	//code gen state only lives for the duration of this call, or until the context is destroyed if an error unwinds it
+	gen_context_t* gen = (gen_context_t*)mem_alloc(mc_codegen, sizeof(gen_context_t));
+	memset(gen, 0, sizeof(gen_context_t));
+	gen->asm_cb = cb;
+	gen->asm_cb_data = data;
+	gen->cur_tl = tl;
+	gen->annotation = annotation;
+	gen->var_set = var_init_set();
+	ctx->gen = gen;
 
 	tl_decl_t* var_decl = tl->var_decls;
 	while (var_decl)
@@ -776,15 +812,22 @@ void code_gen(valid_trans_unit_t* tl, write_asm_cb cb, void* data, bool annotati
 	{
 		if (fn_decl->decl->data.func.blocks)
 		{
-			var_enter_function(_var_set, fn_decl->decl);
+			var_enter_function(gen->var_set, fn_decl->decl);
 			gen_function(fn_decl->decl);
-			var_leave_function(_var_set);
+			var_leave_function(gen->var_set);
 		}
 		fn_decl = fn_decl->next;
 	}
-	var_destory_set(_var_set);
-	_cur_tl = NULL;
-	_var_set = NULL;
-	_asm_cb_data = NULL;
-	_asm_cb = NULL;
+	code_gen_deinit(ctx);
+}
+
+void code_gen_deinit(jcc_context_t* ctx)
+{
+	gen_context_t* gen = ctx->gen;
+	if (!gen)
+		return;
+
+	var_destory_set(gen->var_set);
+	mem_free(gen);
+	ctx->gen = NULL;
 }
\ No newline at end of file
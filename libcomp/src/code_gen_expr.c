@@ -7,8 +7,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-bool lval = false;
-
 static bool _is_unsigned_int_type(ast_type_spec_t* type)
 {
 	return type->kind == type_uint8 ||
@@ -46,15 +44,15 @@ void gen_assignment(ast_expression_t* expr)
 	gen_annotate_start("assignment expression");
 
 	gen_annotate("lval");
-	bool lval_prev = lval;
-	lval = true;
+	bool lval_prev = gen_ctx()->lval;
+	gen_ctx()->lval = true;
 	gen_expression(expr->data.binary_op.lhs);
 	gen_asm("push %%eax");
 	
 	gen_annotate("rval");
-	lval = false;
+	gen_ctx()->lval = false;
 	gen_expression(expr->data.binary_op.rhs);
-	lval = lval_prev;
+	gen_ctx()->lval = lval_prev;
 	gen_asm("pop %%edx");
 
 	//if the target is a user defined type we assume eax and edx are pointers
@@ -90,15 +88,15 @@ void gen_op_assign(ast_expression_t* expr)
 	// x+= 5;
 
 	gen_annotate("lval");
-	bool lval_prev = lval;
-	lval = true;
+	bool lval_prev = gen_ctx()->lval;
+	gen_ctx()->lval = true;
 	gen_expression(expr->data.binary_op.lhs);
 	gen_asm("push %%eax");	//eax contains the address of lhs
 
 	gen_annotate("rval");
-	lval = false;
+	gen_ctx()->lval = false;
 	gen_expression(expr->data.binary_op.rhs);
-	lval = lval_prev;
+	gen_ctx()->lval = lval_prev;
 	gen_annotate("move rhs to ecx");
 	gen_asm("movl %%eax, %%ecx");
 
@@ -222,10 +220,10 @@ void gen_identifier(ast_expression_t* expr)
 		else
 			gen_annotate("'%s' is local at %d(%%ebp)", expr->data.identifier.name, var->bsp_offset);
 
-		//if we are processing an lval or we are referencing a user defined type load the address into eax
-		if (lval || ast_type_is_struct_union(expr->sema.result.type) || ast_type_is_array(expr->sema.result.type))
+		//if we are processing an gen_ctx()->lval or we are referencing a user defined type load the address into eax
+		if (gen_ctx()->lval || ast_type_is_struct_union(expr->sema.result.type) || ast_type_is_array(expr->sema.result.type))
 		{
-			if (lval)
+			if (gen_ctx()->lval)
 				gen_annotate("loading address of lval into eax");
 			else if (ast_type_is_array(expr->sema.result.type))
 				gen_annotate("loading address of array into eax");
@@ -429,10 +427,10 @@ void gen_member_access(ast_expression_t* expr)
 		gen_asm("addl $%d, %%eax", member->sema.offset);
 	}
 
-	if (!lval && !ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type))
+	if (!gen_ctx()->lval && !ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type))
 	{
 		gen_annotate("store member value in eax");
-		//we are not processing an lval and the member type is not a user type so move the value into eax
+		//we are not processing an gen_ctx()->lval and the member type is not a user type so move the value into eax
 		gen_asm("movl (%%eax), %%eax");
 	}
 	gen_annotate_end();
@@ -454,7 +452,7 @@ void gen_ptr_member_access(ast_expression_t* expr)
 	gen_annotate("lhs");
 	gen_expression(expr->data.binary_op.lhs);
 
-	if (lval)
+	if (gen_ctx()->lval)
 	{
 		//we want to be left with the address of the member in eax
 		gen_asm("movl (%%eax), %%eax");
@@ -464,10 +462,10 @@ void gen_ptr_member_access(ast_expression_t* expr)
 	gen_annotate("add offset %d", member->sema.offset);
 	gen_asm("addl $%d, %%eax", member->sema.offset);
 
-	if (!lval && !ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type))
+	if (!gen_ctx()->lval && !ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type))
 	{
 		gen_annotate("store member value in eax");
-		//we are not processing an lval and the member type is not a user type so move the value into eax
+		//we are not processing an gen_ctx()->lval and the member type is not a user type so move the value into eax
 		gen_asm("movl (%%eax), %%eax");
 	}
 	gen_annotate_end();
@@ -490,7 +488,7 @@ void gen_array_subscript(ast_expression_t* expr)
 	gen_expression(expr->data.binary_op.lhs);
 
 	//lhs is not an array (it's a pointer) so we need to dereference it if we are tracking its address
-	if (lval && !ast_type_is_array(expr->data.binary_op.lhs->sema.result.type))
+	if (gen_ctx()->lval && !ast_type_is_array(expr->data.binary_op.lhs->sema.result.type))
 	{
 		gen_asm("movl (%%eax), %%eax");
 	}
@@ -501,10 +499,10 @@ void gen_array_subscript(ast_expression_t* expr)
 	//index
 	gen_annotate("rhs");
 
-	bool prev_lval = lval;
-	lval = false;
+	bool prev_lval = gen_ctx()->lval;
+	gen_ctx()->lval = false;
 	gen_expression(expr->data.binary_op.rhs);
-	lval = prev_lval;
+	gen_ctx()->lval = prev_lval;
 	gen_annotate("mul by size of item in array");
 	gen_asm("imul $%d, %%eax", expr->sema.result.type->size);
 
@@ -512,10 +510,10 @@ void gen_array_subscript(ast_expression_t* expr)
 	gen_asm("popl %%ecx");
 	gen_asm("addl %%ecx, %%eax");
 
-	if (!lval && !ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type))
+	if (!gen_ctx()->lval && !ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type))
 	{
 		gen_annotate("store item value in eax");
-		//we are not processing an lval and the result is not a user type or an array so move the value into eax
+		//we are not processing an gen_ctx()->lval and the result is not a user type or an array so move the value into eax
 		gen_asm("movl (%%eax), %%eax");
 	}
 
@@ -525,10 +523,10 @@ void gen_array_subscript(ast_expression_t* expr)
 void gen_address_of(ast_expression_t* expr)
 {
 	gen_annotate_start("address of");
-	bool p = lval;
-	lval = true;
+	bool p = gen_ctx()->lval;
+	gen_ctx()->lval = true;
 	gen_expression(expr->data.unary_op.expression);
-	lval = p;
+	gen_ctx()->lval = p;
 	gen_annotate_end();
 }
 
@@ -537,7 +535,7 @@ void gen_dereference(ast_expression_t* expr)
 	gen_annotate_start("dereference");
 	gen_expression(expr->data.unary_op.expression);
 
-	if (lval || (!ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type)))
+	if (gen_ctx()->lval || (!ast_type_is_struct_union(expr->sema.result.type) && !ast_type_is_array(expr->sema.result.type)))
 	{
 		gen_asm("movl (%%eax), %%eax");
 	}
@@ -549,8 +547,9 @@ void gen_func_call(ast_expression_t* expr)
 	gen_annotate_start("funcation call");
 
 	//find the sig of the function we're calling
-	ast_type_spec_t* target_fn_type = ast_type_is_fn_ptr(expr->data.func_call.sema.target_type) ?
-		expr->data.func_call.sema.target_type->data.ptr_type : expr->data.func_call.sema.target_type;
+	ast_type_spec_t* target_type = expr->data.func_call.target->sema.result.type;
+	ast_type_spec_t* target_fn_type = ast_type_is_fn_ptr(target_type) ?
+		target_type->data.ptr_type : target_type;
 	assert(target_fn_type->kind == type_func_sig);
 	ast_func_sig_type_spec_t* sig = target_fn_type->data.func_sig_spec;
 	assert(sig);
@@ -624,7 +623,7 @@ void gen_func_call(ast_expression_t* expr)
 	}
 
 	//are we calling a function directly by name, or via a pointer?
-	if (ast_type_is_fn_ptr(expr->data.func_call.sema.target_type))
+	if (ast_type_is_fn_ptr(target_type))
 	{
 		gen_annotate("function pointer target");
 		gen_expression(expr->data.func_call.target);
@@ -682,10 +681,10 @@ void gen_prefix_unary(ast_expression_t* expr)
 {
 	gen_annotate_start("prefix op %s", ast_op_name(expr->data.unary_op.operation));
 	
-	bool prev_lval = lval;
-	lval = true;
+	bool prev_lval = gen_ctx()->lval;
+	gen_ctx()->lval = true;
 	gen_expression(expr->data.unary_op.expression);
-	lval = prev_lval;
+	gen_ctx()->lval = prev_lval;
 
 	gen_annotate("store target address");
 	gen_asm("movl %%eax, %%edx");
@@ -712,11 +711,11 @@ void gen_postfix_op(ast_expression_t* expr)
 {
 	gen_annotate_start("postfix op %s", ast_op_name(expr->data.unary_op.operation));
 
-	bool prev_lval = lval;
-	lval = true;
+	bool prev_lval = gen_ctx()->lval;
+	gen_ctx()->lval = true;
 	gen_annotate("param");
 	gen_expression(expr->data.unary_op.expression);
-	lval = prev_lval;
+	gen_ctx()->lval = prev_lval;
 
 	gen_annotate("store target address");
 	gen_asm("movl %%eax, %%edx");
@@ -814,7 +813,7 @@ void gen_expression(ast_expression_t* expr)
 		gen_expression(expr->data.cast.expr);
 	else if (expr->kind != expr_null)
 	{
-		diag_err(expr->tokens.start, ERR_UNKNOWN, "Compiler error. unexpected %s expression", ast_expr_kind_name(expr->kind));
+		diag_err(expr->loc.start, ERR_UNKNOWN, "Compiler error. unexpected %s expression", ast_expr_kind_name(expr->kind));
 		assert(false);
 	}
 }
@@ -1,4 +1,9 @@
 #include "comp_opt.h"
+#include "mem_cat.h"
+
+#include <libj/include/platform.h>
+#include <libj/include/str_buff.h>
+#include <libj/include/hash_table.h>
 
 #include <string.h>
 #include <stdlib.h>
@@ -12,7 +17,35 @@ comp_opt_t parse_command_line(int argc, const char* argv[])
 
 	while (idx < argc)
 	{
-		if (argv[idx][0] == '-')
+		if (strcmp(argv[idx], "--server") == 0)
+		{
+			result.server = true;
+		}
+		else if (strcmp(argv[idx], "-ftime-trace") == 0)
+		{
+			result.time_trace = true;
+		}
+		else if (strcmp(argv[idx], "-fmem-report") == 0)
+		{
+			result.mem_report = true;
+		}
+		else if (strcmp(argv[idx], "-emit-pch") == 0)
+		{
+			result.emit_pch = true;
+		}
+		else if (strcmp(argv[idx], "-include-pch") == 0)
+		{
+			if (++idx == argc)
+				goto _err_ret;
+			result.include_pch = mem_strdup(mc_general, argv[idx]);
+		}
+		else if (strcmp(argv[idx], "--token-cache") == 0)
+		{
+			if (++idx == argc)
+				goto _err_ret;
+			result.token_cache_dir = mem_strdup(mc_general, argv[idx]);
+		}
+		else if (argv[idx][0] == '-')
 		{
 			const char* pos = &argv[idx][1];
 			while (*pos)
@@ -37,14 +70,24 @@ comp_opt_t parse_command_line(int argc, const char* argv[])
 				{
 					if (++idx == argc)
 						goto _err_ret;
-					result.output_path = strdup(argv[idx]);
+					result.output_path = mem_strdup(mc_general, argv[idx]);
 					break;
 				}
 				else if (*pos == 'c')
 				{
 					if (++idx == argc)
 						goto _err_ret;
-					result.config_path = strdup(argv[idx]);
+					result.config_path = mem_strdup(mc_general, argv[idx]);
+					break;
+				}
+				else if (*pos == 'j')
+				{
+					if (++idx == argc)
+						goto _err_ret;
+					int jobs = atoi(argv[idx]);
+					if (jobs <= 0)
+						goto _err_ret;
+					result.jobs = (uint32_t)jobs;
 					break;
 				}
 				pos++;
@@ -53,9 +96,9 @@ comp_opt_t parse_command_line(int argc, const char* argv[])
 		else
 		{
 			//input file
-			if (result.input_path)
-				goto _err_ret;
-			result.input_path = strdup(argv[idx]);
+			result.input_paths = (char**)mem_realloc(result.input_paths, mc_general, sizeof(char*) * (result.input_count + 1));
+			result.input_paths[result.input_count++] = mem_strdup(mc_general, argv[idx]);
+			result.input_path = result.input_paths[0];
 		}
 		idx++;
 	}
@@ -63,14 +106,54 @@ comp_opt_t parse_command_line(int argc, const char* argv[])
 	//Display version is always valid, otherwise require an input file
 	//result.valid = result.input_path != NULL || result.display_version;
 
-	if (result.input_path != NULL || result.display_version)
+	if (result.input_path != NULL || result.display_version || result.server)
 		result.valid = true;
 
 	return result;
 
 _err_ret:
 	result.valid = false;
-	free(result.output_path);
-	free(result.input_path);
+	mem_free(result.output_path);
+	mem_free(result.token_cache_dir);
+	mem_free(result.include_pch);
+	for (uint32_t i = 0; i < result.input_count; i++)
+		mem_free(result.input_paths[i]);
+	mem_free(result.input_paths);
+	result.input_path = NULL;
+	result.input_paths = NULL;
+	result.input_count = 0;
 	return result;
+}
+
+const char* comp_opt_asm_path(const char* input_path)
+{
+	char* fn = (char*)path_filename(input_path);
+	if (!fn)
+		return NULL;
+	char* ext = strrchr(fn, '.');
+	if (ext)
+		*ext = '\0';
+	str_buff_t* sb = sb_create(strlen(fn) + 3);
+	sb_append(sb, fn);
+	sb_append(sb, ".s");
+	mem_free(fn);
+	return sb_release(sb);
+}
+
+uint32_t comp_opt_find_output_clash(comp_opt_t* opt)
+{
+	hash_table_t* outputs = sht_create(64);
+	uint32_t i;
+	for (i = 0; i < opt->input_count; i++)
+	{
+		const char* path = comp_opt_asm_path(opt->input_paths[i]);
+		bool clash = !path || sht_contains(outputs, path);
+		if (path)
+			sht_insert(outputs, path, (void*)1);
+		mem_free((void*)path);
+		if (clash)
+			break;
+	}
+	ht_destroy(outputs);
+	return i;
 }
\ No newline at end of file
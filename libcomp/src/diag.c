@@ -1,23 +1,23 @@
 #include "diag.h"
 #include "source.h"
 #include "token.h"
+#include "jcc_context.h"
 
 #include <stddef.h>
 #include <assert.h>
 #include <stdio.h>
 
-static diag_cb _diag_cb = NULL;
-static void* _cb_data = NULL;
-
-void diag_set_handler(diag_cb cb, void* data)
+void diag_set_handler(struct jcc_context* ctx, diag_cb cb, void* data)
 {
-	_diag_cb = cb;
-	_cb_data = data;
+	jcc_ctx_set(ctx);
+	ctx->diag_cb = cb;
+	ctx->diag_data = data;
 }
 
-void* diag_err(token_t* tok, uint32_t err, const char* format, ...)
+void* diag_err(src_loc_t loc, uint32_t err, const char* format, ...)
 {
-	assert(_diag_cb);
+	jcc_context_t* ctx = jcc_ctx();
+	assert(ctx->diag_cb);
 	char buff[512];
 
 	va_list args;
@@ -25,19 +25,17 @@ void* diag_err(token_t* tok, uint32_t err, const char* format, ...)
 	vsnprintf(buff, 512, format, args);
 	va_end(args);
 
-	_diag_cb(tok, err, buff, _cb_data);
+	ctx->diag_cb(loc, err, buff, ctx->diag_data);
 	return NULL;
 }
 
-
-static char _desc_buff[1024];
-
 const char* diag_tok_desc(token_t* tok)
 {
 	if (tok->kind == tok_identifier)
 	{
-		sprintf(_desc_buff, "identifier '%s'", tok->data.str);
-		return _desc_buff;
+		char* buff = jcc_ctx()->diag_desc_buff;
+		snprintf(buff, sizeof(jcc_ctx()->diag_desc_buff), "identifier '%s'", tok->data.str);
+		return buff;
 	}
 	return tok_kind_spelling(tok->kind);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "id_map.h"
+#include "mem_cat.h"
 
 #include <assert.h>
 #include <string.h>
@@ -8,12 +9,12 @@
 static inline bool _id_is_decl(identifier_t* id, const char* name)
 {
 	return (id->kind == id_decl &&
-		strcmp(name, ast_declaration_name(id->data.decl)) == 0);
+		name == ast_declaration_name(id->data.decl));
 }
 
 identfier_map_t* idm_create()
 {
-	identfier_map_t* result = (identfier_map_t*)malloc(sizeof(identfier_map_t));
+	identfier_map_t* result = (identfier_map_t*)mem_alloc(mc_symbols, sizeof(identfier_map_t));
 	memset(result, 0, sizeof(identfier_map_t));
 	result->string_literals = sht_create(32);
 	return result;
@@ -21,16 +22,48 @@ identfier_map_t* idm_create()
 
 void idm_destroy(identfier_map_t* map)
 {	
-	free(map);
+	if (!map)
+		return;
+
+	identifier_t* id = map->identifiers;
+	while (id)
+	{
+		identifier_t* next = id->next;
+		mem_free(id);
+		id = next;
+	}
+
+	type_t* tag = map->tags;
+	while (tag)
+	{
+		type_t* next = tag->next;
+		mem_free(tag);
+		tag = next;
+	}
+
+	idm_destroy_string_literals(map->string_literals);
+	mem_free(map);
 }
 
-static const char* _alloc_label()
+void idm_destroy_string_literals(hash_table_t* string_literals)
 {
-	static uint32_t count = 0;
+	if (!string_literals)
+		return;
 
-	char* ret = (char*)malloc(16);
+	sht_iterator_t it = sht_begin(string_literals);
+	while (!sht_end(string_literals, &it))
+	{
+		mem_free(it.val);
+		sht_next(string_literals, &it);
+	}
+	ht_destroy(string_literals);
+}
+
+static const char* _alloc_label(identfier_map_t* map)
+{
+	char* ret = (char*)mem_alloc(mc_symbols, 16);
 	memset(ret, 0, 16);
-	sprintf(ret, "SC%d", count++);
+	sprintf(ret, "SC%d", map->string_literal_count++);
 	return ret;
 }
 
@@ -39,7 +72,7 @@ const char* idm_add_string_literal(identfier_map_t* map, const char* literal)
 	const char* lbl = (const char*)sht_lookup(map->string_literals, literal);
 	if (!lbl)
 	{
-		lbl = _alloc_label();
+		lbl = _alloc_label(map);
 		sht_insert(map->string_literals, literal, (void*)lbl);
 	}
 	return lbl;
@@ -47,7 +80,7 @@ const char* idm_add_string_literal(identfier_map_t* map, const char* literal)
 
 void idm_add_tag(identfier_map_t* map, ast_type_spec_t* type)
 {
-	type_t* tag = (type_t*)malloc(sizeof(type_t));
+	type_t* tag = (type_t*)mem_alloc(mc_types, sizeof(type_t));
 	memset(tag, 0, sizeof(type_t));
 
 	tag->spec = type;
@@ -57,7 +90,7 @@ void idm_add_tag(identfier_map_t* map, ast_type_spec_t* type)
 
 void idm_add_decl(identfier_map_t* map, ast_declaration_t* decl)
 {
-	identifier_t* id = (identifier_t*)malloc(sizeof(identifier_t));
+	identifier_t* id = (identifier_t*)mem_alloc(mc_symbols, sizeof(identifier_t));
 	memset(id, 0, sizeof(identifier_t));
 
 	id->kind = id_decl;
@@ -75,7 +108,7 @@ ast_type_spec_t* idm_find_block_tag(identfier_map_t* map, const char* name)
 		if (!tag->spec) //indicates the end of the current scope block
 			break;
 
-		if (strcmp(name, tag->spec->data.user_type_spec->name) == 0)
+		if (name == tag->spec->data.user_type_spec->name)
 		{
 			return tag->spec;
 		}
@@ -91,7 +124,7 @@ ast_type_spec_t* idm_find_tag(identfier_map_t* map, const char* name)
 	while (tag)
 	{
 		if (tag->spec &&
-			strcmp(name, tag->spec->data.user_type_spec->name) == 0)
+			name == tag->spec->data.user_type_spec->name)
 		{
 			return tag->spec;
 		}
@@ -171,7 +204,7 @@ void idm_leave_function(identfier_map_t* map)
 void idm_enter_block(identfier_map_t* map)
 {
 	//add block marker to identifier stack
-	identifier_t* id = (identifier_t*)malloc(sizeof(identifier_t));
+	identifier_t* id = (identifier_t*)mem_alloc(mc_symbols, sizeof(identifier_t));
 	memset(id, 0, sizeof(identifier_t));
 
 	id->kind = id_marker;
@@ -179,7 +212,7 @@ void idm_enter_block(identfier_map_t* map)
 	map->identifiers = id;
 
 	//add block market to type stack
-	type_t* type = (type_t*)malloc(sizeof(type_t));
+	type_t* type = (type_t*)mem_alloc(mc_types, sizeof(type_t));
 	memset(type, 0, sizeof(type_t));
 
 	type->spec = NULL;
@@ -197,10 +230,10 @@ void idm_leave_block(identfier_map_t* map)
 		if (id->kind == id_marker)
 		{
 			map->identifiers = id->next;
-			free(id);
+			mem_free(id);
 			break;
 		}
-		free(id);
+		mem_free(id);
 		id = next;
 	}
 
@@ -212,10 +245,10 @@ void idm_leave_block(identfier_map_t* map)
 		if (type->spec == NULL)
 		{
 			map->tags = type->next;
-			free(type);
+			mem_free(type);
 			break;
 		}
-		free(type);
+		mem_free(type);
 		type = next;
 	}
 }
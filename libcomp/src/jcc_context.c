@@ -0,0 +1,47 @@
+#include "jcc_context.h"
+#include "source.h"
+#include "pp.h"
+#include "parse.h"
+#include "sema.h"
+#include "code_gen.h"
+#include "time_trace.h"
+#include "mem_cat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TOK_ARENA_BLOCK_SZ (64 * 1024)
+
+THREAD_LOCAL jcc_context_t* _cur_ctx = NULL;
+
+jcc_context_t* jcc_context_create()
+{
+	jcc_context_t* ctx = (jcc_context_t*)mem_alloc(mc_general, sizeof(jcc_context_t));
+	memset(ctx, 0, sizeof(jcc_context_t));
+	ctx->next_tok_id = 1;
+	ctx->tok_arena = arena_create(mc_tokens, TOK_ARENA_BLOCK_SZ, TOK_ARENA_ALIGN);
+	ctx->idents = intern_create(mc_symbols);
+
+	//tokens are located in the source data, even when lexed from a range not loaded from a file
+	src_init(ctx, &src_map_file, NULL);
+	return ctx;
+}
+
+void jcc_context_destroy(jcc_context_t* ctx)
+{
+	if (!ctx)
+		return;
+
+	pre_proc_deinit(ctx);
+	parse_deinit(ctx);
+	sema_deinit(ctx);
+	code_gen_deinit(ctx);
+	src_deinit(ctx);
+	trace_destroy(ctx->trace);
+	arena_destroy(ctx->tok_arena);
+	intern_destroy(ctx->idents);
+
+	if (_cur_ctx == ctx)
+		_cur_ctx = NULL;
+	mem_free(ctx);
+}
@@ -0,0 +1,285 @@
+#include "lex_scan.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LEX_SCAN_X64
+#include <immintrin.h>
+#ifndef __GNUC__
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef __GNUC__
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+typedef struct
+{
+	lex_scan_isa isa;
+	const char* (*blanks)(const char* p, const char* end);
+	const char* (*identifier)(const char* p, const char* end);
+	const char* (*either)(const char* p, const char* end, char a, char b);
+}scan_kernels_t;
+
+static inline bool _is_blank(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static inline bool _is_identifier_char(char c)
+{
+	return (c >= 'A' && c <= 'Z') ||
+		(c >= 'a' && c <= 'z') ||
+		(c >= '0' && c <= '9') ||
+		c == '_';
+}
+
+static const char* _blanks_scalar(const char* p, const char* end)
+{
+	while (p < end && _is_blank(*p))
+		p++;
+	return p;
+}
+
+static const char* _identifier_scalar(const char* p, const char* end)
+{
+	while (p < end && _is_identifier_char(*p))
+		p++;
+	return p;
+}
+
+static const char* _either_scalar(const char* p, const char* end, char a, char b)
+{
+	while (p < end && *p != a && *p != b)
+		p++;
+	return p;
+}
+
+#ifdef LEX_SCAN_X64
+
+static inline uint32_t _ctz(uint32_t mask)
+{
+#ifdef __GNUC__
+	return (uint32_t)__builtin_ctz(mask);
+#else
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return (uint32_t)idx;
+#endif
+}
+
+/*
+SSE2, 16 bytes per step
+*/
+static const char* _blanks_sse2(const char* p, const char* end)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab));
+		uint32_t mask = ~(uint32_t)_mm_movemask_epi8(blank) & 0xFFFF;
+		if (mask)
+			return p + _ctz(mask);
+	}
+	return _blanks_scalar(p, end);
+}
+
+static const char* _identifier_sse2(const char* p, const char* end)
+{
+	//setting bit 0x20 folds upper case letters to lower case, bytes above 0x7F are negative and fail every range
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i before_a = _mm_set1_epi8('a' - 1);
+	const __m128i after_z = _mm_set1_epi8('z' + 1);
+	const __m128i before_0 = _mm_set1_epi8('0' - 1);
+	const __m128i after_9 = _mm_set1_epi8('9' + 1);
+	const __m128i underscore = _mm_set1_epi8('_');
+
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i lower = _mm_or_si128(v, case_bit);
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a), _mm_cmplt_epi8(lower, after_z));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, before_0), _mm_cmplt_epi8(v, after_9));
+		__m128i ident = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(v, underscore));
+		uint32_t mask = ~(uint32_t)_mm_movemask_epi8(ident) & 0xFFFF;
+		if (mask)
+			return p + _ctz(mask);
+	}
+	return _identifier_scalar(p, end);
+}
+
+static const char* _either_sse2(const char* p, const char* end, char a, char b)
+{
+	const __m128i va = _mm_set1_epi8(a);
+	const __m128i vb = _mm_set1_epi8(b);
+
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+		if (mask)
+			return p + _ctz(mask);
+	}
+	return _either_scalar(p, end, a, b);
+}
+
+/*
+AVX2, 32 bytes per step
+*/
+TARGET_AVX2 static const char* _blanks_avx2(const char* p, const char* end)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+
+	for (; end - p >= 32; p += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)p);
+		__m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(blank);
+		if (mask)
+			return p + _ctz(mask);
+	}
+	return _blanks_sse2(p, end);
+}
+
+TARGET_AVX2 static const char* _identifier_avx2(const char* p, const char* end)
+{
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	const __m256i before_a = _mm256_set1_epi8('a' - 1);
+	const __m256i after_z = _mm256_set1_epi8('z' + 1);
+	const __m256i before_0 = _mm256_set1_epi8('0' - 1);
+	const __m256i after_9 = _mm256_set1_epi8('9' + 1);
+	const __m256i underscore = _mm256_set1_epi8('_');
+
+	for (; end - p >= 32; p += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)p);
+		__m256i lower = _mm256_or_si256(v, case_bit);
+		__m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, before_a), _mm256_cmpgt_epi8(after_z, lower));
+		__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, before_0), _mm256_cmpgt_epi8(after_9, v));
+		__m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit), _mm256_cmpeq_epi8(v, underscore));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ident);
+		if (mask)
+			return p + _ctz(mask);
+	}
+	return _identifier_sse2(p, end);
+}
+
+TARGET_AVX2 static const char* _either_avx2(const char* p, const char* end, char a, char b)
+{
+	const __m256i va = _mm256_set1_epi8(a);
+	const __m256i vb = _mm256_set1_epi8(b);
+
+	for (; end - p >= 32; p += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)p);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+		if (mask)
+			return p + _ctz(mask);
+	}
+	return _either_sse2(p, end, a, b);
+}
+
+static bool _cpu_has_avx2()
+{
+#ifdef __GNUC__
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	//the OS must save the ymm registers
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif //LEX_SCAN_X64
+
+static const scan_kernels_t _kernels[] =
+{
+	{ lex_scan_scalar, &_blanks_scalar, &_identifier_scalar, &_either_scalar },
+#ifdef LEX_SCAN_X64
+	{ lex_scan_sse2, &_blanks_sse2, &_identifier_sse2, &_either_sse2 },
+	{ lex_scan_avx2, &_blanks_avx2, &_identifier_avx2, &_either_avx2 },
+#endif
+};
+
+static bool _cpu_supports(lex_scan_isa isa)
+{
+	switch (isa)
+	{
+	case lex_scan_scalar:
+		return true;
+#ifdef LEX_SCAN_X64
+	case lex_scan_sse2:
+		//part of x86-64
+		return true;
+	case lex_scan_avx2:
+		return _cpu_has_avx2();
+#endif
+	default:
+		break;
+	}
+	return false;
+}
+
+/*
+scalar until lex_scan_init() selects the best the cpu supports.
+Only changed before lexing starts so threads lexing in parallel read it without synchronisation
+*/
+static const scan_kernels_t* _selected = &_kernels[lex_scan_scalar];
+
+static inline const scan_kernels_t* _get_kernels()
+{
+	return _selected;
+}
+
+void lex_scan_init()
+{
+	lex_scan_set_isa(lex_scan_avx2);
+}
+
+lex_scan_isa lex_scan_set_isa(lex_scan_isa isa)
+{
+	while (isa > lex_scan_scalar && !_cpu_supports(isa))
+		isa--;
+	_selected = &_kernels[isa];
+	return isa;
+}
+
+lex_scan_isa lex_scan_get_isa()
+{
+	return _get_kernels()->isa;
+}
+
+const char* lex_scan_blanks(const char* p, const char* end)
+{
+	return _get_kernels()->blanks(p, end);
+}
+
+const char* lex_scan_identifier(const char* p, const char* end)
+{
+	return _get_kernels()->identifier(p, end);
+}
+
+const char* lex_scan_either(const char* p, const char* end, char a, char b)
+{
+	return _get_kernels()->either(p, end, a, b);
+}
@@ -1,5 +1,10 @@
 #include "lexer.h"
+#include "lex_scan.h"
 #include "diag.h"
+#include "jcc_context.h"
+#include "src_cache.h"
+#include "mem_cat.h"
+#include "tok_file.h"
 
 #include <libj/include/str_buff.h>
 #include <libj/include/byte_buff.h>
@@ -9,12 +14,48 @@
 #include <stdint.h>
 #include <string.h>
 
-static inline bool _can_adv(source_range_t* sr, const char** pos)
+/*
+the range being lexed.
+splice is the next line continuation, at or after the position the lexer has reached, or end if there are none.
+Characters before splice are advanced over without looking for a continuation.
+loc_base is the location of ptr and tok_pos the start of the spelling of the token being lexed
+*/
+typedef struct
+{
+	const char* ptr;
+	const char* end;
+	const char* splice;
+	src_loc_t loc_base;
+	const char* tok_pos;
+}lex_src_t;
+
+/*
+the first '\\' followed by a newline in [p, end)
+*/
+static const char* _find_splice(const char* p, const char* end)
+{
+	while (p < end)
+	{
+		p = (const char*)memchr(p, '\\', end - p);
+		if (!p)
+			break;
+		if ((p + 1 < end && p[1] == '\n') ||
+			(p + 2 < end && p[1] == '\r' && p[2] == '\n'))
+			return p;
+		p++;
+	}
+	return end;
+}
+
+static inline bool _can_adv(lex_src_t* sr, const char** pos)
 {
 	return *pos < sr->end;
 }
 
-static inline bool _adv_pos(source_range_t* sr, const char** pos)
+/*
+the careful path, the next character may start a line continuation
+*/
+static bool _adv_pos_splice(lex_src_t* sr, const char** pos)
 {
 	if (_can_adv(sr, pos))
 	{
@@ -35,13 +76,39 @@ static inline bool _adv_pos(source_range_t* sr, const char** pos)
 			}
 		}
 
+		if (*pos >= sr->splice)
+			sr->splice = _find_splice(*pos + 1, sr->end);
 		return true;
 	}
 	return false;
 }
 
-static inline char _peek_next(source_range_t* sr, const char* pos)
+static inline bool _adv_pos(lex_src_t* sr, const char** pos)
+{
+	//splice is never beyond end so this also checks the position can advance
+	if (*pos + 1 < sr->splice)
+	{
+		(*pos)++;
+		return true;
+	}
+	return _adv_pos_splice(sr, pos);
+}
+
+/*
+move to the position q found by a lex_scan_ kernel as though it had been reached with _adv_pos() so a line continuation at q is skipped.
+q must follow the start of the range
+*/
+static inline bool _adv_pos_to(lex_src_t* sr, const char** pos, const char* q)
 {
+	*pos = q - 1;
+	return _adv_pos(sr, pos);
+}
+
+static inline char _peek_next(lex_src_t* sr, const char* pos)
+{
+	if (pos + 1 < sr->splice)
+		return pos[1];
+
 	if (_can_adv(sr, &pos))
 	{
 		pos++;
@@ -63,11 +130,42 @@ static inline char _peek_next(source_range_t* sr, const char* pos)
 	return 0;
 }
 
+/*
+runs of whitespace and identifier characters are usually short, the first characters are lexed one at a time
+and the lex_scan_ kernels used for the rest of a longer run
+*/
+#define LEX_SCAN_MIN_RUN 8
+
 #define ADV_POS(SR, POS)	if (!_adv_pos(SR, POS)) \
 							{	result->kind = tok_eof; return; }
 
+/*
+the token being lexed starts at pos
+*/
+static inline void _tok_start(lex_src_t* sr, const char* pos, token_t* result)
+{
+	sr->tok_pos = pos;
+	result->loc = sr->loc_base ? sr->loc_base + (src_loc_t)(pos - sr->ptr) : SRC_LOC_NONE;
+}
+
+/*
+the token being lexed ends before pos
+*/
+static inline bool _tok_end(lex_src_t* sr, const char* pos, token_t* result)
+{
+	if (pos - sr->tok_pos > TOK_MAX_LEN)
+	{
+		diag_err(tok_loc(result), ERR_SYNTAX, "token too long");
+		result->len = 0;
+		result->kind = tok_eof;
+		return false;
+	}
+	result->len = (uint32_t)(pos - sr->tok_pos);
+	return true;
+}
+
 #define ADV_POS_ERR(TOK, SR, POS)	if (!_adv_pos(SR, POS)) \
-									{ diag_err(TOK, ERR_SYNTAX, "Unexpected EOF"); result->kind = tok_eof; return; }
+									{ diag_err(tok_loc(TOK), ERR_SYNTAX, "Unexpected EOF"); result->kind = tok_eof; return; }
 
 /*
 [0-9]
@@ -156,7 +254,7 @@ static inline bool _is_white_space(char ch)
 		ch == '\r';
 }
 
-static uint8_t _lex_escaped_char(source_range_t* sr, token_t* tok, const char* pos, int* len)
+static uint8_t _lex_escaped_char(lex_src_t* sr, token_t* tok, const char* pos, int* len)
 {
 	//skip the slash
 	if (!_adv_pos(sr, &pos))
@@ -192,7 +290,7 @@ static uint8_t _lex_escaped_char(source_range_t* sr, token_t* tok, const char* p
 
 		if (i > 255)
 		{
-			diag_err(tok, ERR_SYNTAX, "Hex/Octal literal too large %d", i);
+			diag_err(tok_loc(tok), ERR_SYNTAX, "Hex/Octal literal too large %d", i);
 			goto esc_err_ret;
 		}
 		return (uint8_t)i;
@@ -232,7 +330,7 @@ static uint8_t _lex_escaped_char(source_range_t* sr, token_t* tok, const char* p
 		return 0;
 	default:
 		(*len)++;
-		diag_err(tok, ERR_SYNTAX, "Unrecognised escape sequence %c", *pos);
+		diag_err(tok_loc(tok), ERR_SYNTAX, "Unrecognised escape sequence %c", *pos);
 		break;
 	}
 
@@ -245,9 +343,9 @@ static inline bool _is_valid_string_literal_char(char c)
 	return c != '\r' && c != '\n';
 }
 
-static void _lex_string_literal(source_range_t* sr, const char* pos, token_t* result, const char end_char)
+static void _lex_string_literal(lex_src_t* sr, const char* pos, token_t* result, const char end_char)
 {
-	result->loc = pos;
+	_tok_start(sr, pos, result);
 	result->len = 1;
 	result->kind = tok_string_literal;
 
@@ -260,7 +358,7 @@ static void _lex_string_literal(source_range_t* sr, const char* pos, token_t* re
 	{
 		if (!_is_valid_string_literal_char(*pos))
 		{
-			diag_err(result, ERR_SYNTAX, "Unterminated string literal");
+			diag_err(tok_loc(result), ERR_SYNTAX, "Unterminated string literal");
 			result->kind = tok_eof;
 			return;
 		}
@@ -284,13 +382,14 @@ static void _lex_string_literal(source_range_t* sr, const char* pos, token_t* re
 
 	bb_append(bb, 0);
 	
-	result->len = pos - result->loc;
-	result->data.str = (char*)bb_release(bb);
+	_tok_end(sr, pos, result);
+	result->data.str = tok_alloc_str((const char*)bb->buff, bb->len - 1);
+	bb_destroy(bb);
 }
 
-static void _lex_char_literal(source_range_t* sr, const char* pos, token_t* result)
+static void _lex_char_literal(lex_src_t* sr, const char* pos, token_t* result)
 {
-	result->loc = pos;
+	_tok_start(sr, pos, result);
 	result->len = 1;
 	result->kind = tok_num_literal;
 
@@ -301,37 +400,37 @@ static void _lex_char_literal(source_range_t* sr, const char* pos, token_t* resu
 	{
 		int len;
 		uint8_t val = _lex_escaped_char(sr, result, pos, &len);
-		result->data.int_val = int_val_unsigned(val);
+		result->data.int_val = tok_alloc_int_val(int_val_unsigned(val));
 		result->len = len;
 		pos += result->len;
 	}
 	else if (*pos == '\'')
 	{
-		diag_err(result, ERR_SYNTAX, "Empty char literal");
+		diag_err(tok_loc(result), ERR_SYNTAX, "Empty char literal");
 		result->kind = tok_eof;
 		return;
 	}
 	else
 	{
 		uint8_t val = *pos;
-		result->data.int_val = int_val_unsigned(val);
+		result->data.int_val = tok_alloc_int_val(int_val_unsigned(val));
 		ADV_POS_ERR(result, sr, &pos);
 	}
 
 	if (*pos != '\'')
 	{
-		diag_err(result, ERR_SYNTAX, "Char literal too long");
+		diag_err(tok_loc(result), ERR_SYNTAX, "Char literal too long");
 		result->kind = tok_eof;
 		return;
 	}
 	//slip trailing apostrophe
 	ADV_POS_ERR(result, sr, &pos);
-	result->len = pos - result->loc;
+	_tok_end(sr, pos, result);
 }
 
-static void _lex_num_literal(source_range_t* sr, const char* pos, token_t* result)
+static void _lex_num_literal(lex_src_t* sr, const char* pos, token_t* result)
 {
-	result->loc = pos;
+	_tok_start(sr, pos, result);
 	result->len = 0;
 	result->kind = tok_num_literal;
 	
@@ -360,115 +459,135 @@ static void _lex_num_literal(source_range_t* sr, const char* pos, token_t* resul
 		ADV_POS(sr, &pos);
 	} while (_is_valid_num_char(base, *pos));
 
-	result->data.int_val = int_val_unsigned(i);
+	result->data.int_val = tok_alloc_int_val(int_val_unsigned(i));
 
 	while (_is_valid_num_suffix(*pos))
 		ADV_POS(sr, &pos);
-	result->len = pos - result->loc;
+	_tok_end(sr, pos, result);
 }
 
-static void _lex_identifier(source_range_t* sr, const char* pos, token_t* result)
+typedef struct
+{
+	const char* spelling;
+	uint8_t len;
+	uint8_t kind;
+}keyword_t;
+
+/*
+Keywords are found with a perfect hash of the first two characters, the last character and the length.
+KEYWORD_HASH_MUL was found by search so that no two keywords share a slot, adding a keyword needs a new
+multiplier and table
+*/
+#define KEYWORD_HASH_MUL 0x2699032bu
+#define KEYWORD_HASH_BITS 6
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 8
+
+static const keyword_t _keywords[1 << KEYWORD_HASH_BITS] =
 {
-	result->loc = pos;
+	[2] = { "void", 4, tok_void },
+	[3] = { "default", 7, tok_default },
+	[4] = { "break", 5, tok_break },
+	[7] = { "struct", 6, tok_struct },
+	[8] = { "do", 2, tok_do },
+	[10] = { "char", 4, tok_char },
+	[12] = { "while", 5, tok_while },
+	[13] = { "float", 5, tok_float },
+	[15] = { "typedef", 7, tok_typedef },
+	[19] = { "register", 8, tok_register },
+	[20] = { "extern", 6, tok_extern },
+	[21] = { "signed", 6, tok_signed },
+	[23] = { "sizeof", 6, tok_sizeof },
+	[25] = { "if", 2, tok_if },
+	[33] = { "int", 3, tok_int },
+	[35] = { "const", 5, tok_const },
+	[36] = { "long", 4, tok_long },
+	[37] = { "union", 5, tok_union },
+	[38] = { "auto", 4, tok_auto },
+	[40] = { "for", 3, tok_for },
+	[43] = { "double", 6, tok_double },
+	[44] = { "else", 4, tok_else },
+	[46] = { "volatile", 8, tok_volatile },
+	[48] = { "switch", 6, tok_switch },
+	[49] = { "short", 5, tok_short },
+	[52] = { "case", 4, tok_case },
+	[53] = { "inline", 6, tok_inline },
+	[55] = { "continue", 8, tok_continue },
+	[57] = { "static", 6, tok_static },
+	[58] = { "goto", 4, tok_goto },
+	[59] = { "return", 6, tok_return },
+	[62] = { "unsigned", 8, tok_unsigned },
+	[63] = { "enum", 4, tok_enum },
+};
+
+/*
+the keyword kind of str[0..len) or tok_identifier
+*/
+static tok_kind _keyword_kind(const char* str, size_t len)
+{
+	if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN)
+		return tok_identifier;
+
+	uint32_t key = (uint8_t)str[0] | (uint8_t)str[1] << 8 | (uint8_t)str[len - 1] << 16 | (uint32_t)len << 24;
+	const keyword_t* kw = &_keywords[(key * KEYWORD_HASH_MUL) >> (32 - KEYWORD_HASH_BITS)];
+
+	if (kw->len == len && memcmp(kw->spelling, str, len) == 0)
+		return (tok_kind)kw->kind;
+	return tok_identifier;
+}
+
+static void _lex_identifier(lex_src_t* sr, const char* pos, token_t* result)
+{
+	_tok_start(sr, pos, result);
 	result->len = 0;
-	result->kind = tok_identifier;
 
 	do
 	{
 		ADV_POS(sr, &pos);
-	} while (_is_identifier_body(*pos));
-	result->len = pos - result->loc;
+	} while (_is_identifier_body(*pos) && pos - sr->tok_pos < LEX_SCAN_MIN_RUN);
 
-	str_buff_t* sb = sb_create(64);
-	tok_spelling_extract(result->loc, result->len, sb);
-
-	//Keywords
-	if (strcmp(sb->buff, "int") == 0)
-		result->kind = tok_int;
-	else if (strcmp(sb->buff, "char") == 0)
-		result->kind = tok_char;
-	else if (strcmp(sb->buff, "short") == 0)
-		result->kind = tok_short;
-	else if (strcmp(sb->buff, "long") == 0)
-		result->kind = tok_long;
-	else if (strcmp(sb->buff, "void") == 0)
-		result->kind = tok_void;
-	else if (strcmp(sb->buff, "signed") == 0)
-		result->kind = tok_signed;
-	else if (strcmp(sb->buff, "unsigned") == 0)
-		result->kind = tok_unsigned;
-	else if (strcmp(sb->buff, "float") == 0)
-		result->kind = tok_float;
-	else if (strcmp(sb->buff, "double") == 0)
-		result->kind = tok_double;
-	else if (strcmp(sb->buff, "const") == 0)
-		result->kind = tok_const;
-	else if (strcmp(sb->buff, "volatile") == 0)
-		result->kind = tok_volatile;
-	else if (strcmp(sb->buff, "typedef") == 0)
-		result->kind = tok_typedef;
-	else if (strcmp(sb->buff, "extern") == 0)
-		result->kind = tok_extern;
-	else if (strcmp(sb->buff, "static") == 0)
-		result->kind = tok_static;
-	else if (strcmp(sb->buff, "auto") == 0)
-		result->kind = tok_auto;
-	else if (strcmp(sb->buff, "register") == 0)
-		result->kind = tok_register;
-	else if (strcmp(sb->buff, "inline") == 0)
-		result->kind = tok_inline;
-	else if (strcmp(sb->buff, "return") == 0)
-		result->kind = tok_return;
-	else if (strcmp(sb->buff, "if") == 0)
-		result->kind = tok_if;
-	else if (strcmp(sb->buff, "else") == 0)
-		result->kind = tok_else;
-	else if (strcmp(sb->buff, "for") == 0)
-		result->kind = tok_for;
-	else if (strcmp(sb->buff, "while") == 0)
-		result->kind = tok_while;
-	else if (strcmp(sb->buff, "do") == 0)
-		result->kind = tok_do;
-	else if (strcmp(sb->buff, "break") == 0)
-		result->kind = tok_break;
-	else if (strcmp(sb->buff, "continue") == 0)
-		result->kind = tok_continue;
-	else if (strcmp(sb->buff, "struct") == 0)
-		result->kind = tok_struct;
-	else if (strcmp(sb->buff, "union") == 0)
-		result->kind = tok_union;
-	else if (strcmp(sb->buff, "enum") == 0)
-		result->kind = tok_enum;
-	else if (strcmp(sb->buff, "sizeof") == 0)
-		result->kind = tok_sizeof;
-	else if (strcmp(sb->buff, "switch") == 0)
-		result->kind = tok_switch;
-	else if (strcmp(sb->buff, "case") == 0)
-		result->kind = tok_case;
-	else if (strcmp(sb->buff, "default") == 0)
-		result->kind = tok_default;
-	else if (strcmp(sb->buff, "goto") == 0)
-		result->kind = tok_goto;
-	
-	if (result->kind == tok_identifier)
-		result->data.str = sb_release(sb);
-	else
+	if (_is_identifier_body(*pos) && _can_adv(sr, &pos))
+	{
+		//a long identifier, a '\\' stops the scan and the loop below deals with line continuations
+		_adv_pos_to(sr, &pos, lex_scan_identifier(pos + 1, sr->end));
+	}
+	while (_is_identifier_body(*pos))
+		ADV_POS(sr, &pos);
+	if (!_tok_end(sr, pos, result))
+		return;
+
+	const char* spelling = sr->tok_pos;
+	if (memchr(spelling, '\\', result->len))
+	{
+		//split by a line continuation
+		str_buff_t* sb = sb_create(64);
+		tok_spelling_extract(spelling, result->len, sb);
+		result->kind = _keyword_kind(sb->buff, sb->len);
+		if (result->kind == tok_identifier)
+			result->data.str = tok_intern(sb->buff, sb->len);
 		sb_destroy(sb);
+		return;
+	}
+
+	result->kind = _keyword_kind(spelling, result->len);
+	if (result->kind == tok_identifier)
+		result->data.str = tok_intern(spelling, result->len);
 }
 
-static void _lex_pre_proc_directive(source_range_t* sr, const char* pos, token_t* result)
+static void _lex_pre_proc_directive(lex_src_t* sr, const char* pos, token_t* result)
 {
-	result->loc = pos;
+	_tok_start(sr, pos, result);
 	result->len = 0;
 
 	do
 	{
 		ADV_POS(sr, &pos);
 	} while (_is_identifier_body(*pos) || *pos == '#');
-	result->len = pos - result->loc;
+	if (!_tok_end(sr, pos, result))
+		return;
 
 	str_buff_t* sb = sb_create(64);
-	tok_spelling_extract(result->loc + 1, result->len - 1, sb);
+	tok_spelling_extract(sr->tok_pos + 1, result->len - 1, sb);
 
 	if (result->len == 1)
 		result->kind = tok_pp_null;
@@ -498,33 +617,37 @@ static void _lex_pre_proc_directive(source_range_t* sr, const char* pos, token_t
 		result->kind = tok_pp_endif;
 	else
 	{
-		diag_err(result, ERR_SYNTAX, "unknown preprocessor directive %s", sb->buff);
+		diag_err(tok_loc(result), ERR_SYNTAX, "unknown preprocessor directive %s", sb->buff);
 		result->kind = tok_eof;
 	}
 	sb_destroy(sb);
 }
 
-bool lex_next_tok(source_range_t* src, const char* pos, token_t* result)
+static bool _lex_next_tok(lex_src_t* src, const char* pos, token_t* result)
 {
-lex_next_tok:
+_lex_next_tok:
 
 	//Skip any white space
 	while(*pos == ' ' || *pos == '\t')
 	{
 		result->flags |= TF_LEADING_SPACE;
 		if (!_adv_pos(src, &pos)) goto _hit_end;
+
+		//indentation and alignment, longer than the usual single space
+		if ((*pos == ' ' || *pos == '\t') && _can_adv(src, &pos))
+			_adv_pos_to(src, &pos, lex_scan_blanks(pos + 1, src->end));
 	};
 
 	if (*pos == '\0')
 	{
 		//end of file
-		result->loc = pos;
+		_tok_start(src, pos, result);
 		result->kind = tok_eof;
 		result->len = 0;
 		return true;
 	}
 
-	result->loc = pos;
+	_tok_start(src, pos, result);
 	result->len = 0;
 
 	bool slashslash = false;
@@ -538,7 +661,7 @@ lex_next_tok:
 		//Skip newline, mark token flags as starting of line and lex next token
 		pos++;
 		result->flags = TF_START_LINE;
-		goto lex_next_tok;
+		goto _lex_next_tok;
 	case '(':
 		_adv_pos(src, &pos);
 		result->kind = tok_l_paren;
@@ -853,31 +976,38 @@ lex_next_tok:
 
 	if (slashslash)
 	{
-		//Skip up to eol
-		do
+		//Skip up to eol, a '\\' stops the scan so a line continuation extends the comment
+		while (*pos != '\n')
 		{
-			if (!_adv_pos(src, &pos)) goto _hit_end;
-		} while (*pos != '\n');
+			if (!_can_adv(src, &pos)) goto _hit_end;
+			_adv_pos_to(src, &pos, lex_scan_either(pos + 1, src->end, '\n', '\\'));
+		}
 
 		//replace with single space
 		result->flags |= TF_LEADING_SPACE;
-		goto lex_next_tok;
+		goto _lex_next_tok;
 	}
 
 	if (slashstar)
 	{
 		/* */
-		bool star = false;
 		while(1)
 		{
-			star = *pos == '*';
-
-			if (!_adv_pos(src, &pos))
+			if (!_can_adv(src, &pos))
 			{
-				diag_err(result, ERR_SYNTAX, "unterminated comment");
+				diag_err(tok_loc(result), ERR_SYNTAX, "unterminated comment");
 				goto _hit_end;
 			}
-			if (star && *pos == '/')
+
+			if (*pos != '*')
+			{
+				//only a '*' can end the comment, a '\\' stops the scan so line continuations are seen by _adv_pos()
+				_adv_pos_to(src, &pos, lex_scan_either(pos + 1, src->end, '*', '\\'));
+				continue;
+			}
+
+			_adv_pos(src, &pos);
+			if (*pos == '/')
 			{
 				_adv_pos(src, &pos);
 				break;
@@ -886,11 +1016,11 @@ lex_next_tok:
 
 		//replace with single space
 		result->flags |= TF_LEADING_SPACE;
-		goto lex_next_tok;
+		goto _lex_next_tok;
 	}
 
 	if(result->len == 0)
-		result->len = pos - result->loc;
+		_tok_end(src, pos, result);
 
 	return result->kind != tok_invalid;
 
@@ -899,57 +1029,191 @@ _hit_end:
 	return true;
 }
 
-token_range_t lex_source(source_range_t* sr)
+struct lex_cursor
+{
+	lex_src_t src;
+
+	/*
+	where the next token starts when lexing on demand
+	*/
+	const char* pos;
+
+	/*
+	when the tokens were lexed up front, or copied from the cache, the next of them to return
+	*/
+	token_t* next;
+
+	/*
+	once reached the end of file token is returned from every call
+	*/
+	token_t* eof;
+	bool first;
+	bool failed;
+};
+
+static token_t* _lex_cursor_next(lex_cursor_t* cursor)
+{
+	if (cursor->eof)
+		return cursor->eof;
+
+	token_t* tok = tok_create();
+	tok->kind = tok_invalid;
+
+	if (cursor->first)
+	{
+		tok->flags |= TF_START_LINE;
+		cursor->first = false;
+	}
+
+	cursor->src.tok_pos = cursor->pos;
+	_lex_next_tok(&cursor->src, cursor->pos, tok);
+
+	if (tok->kind == tok_eof)
+	{
+		cursor->failed = cursor->src.tok_pos < cursor->src.end - 1;
+
+		//enfore newline before eol
+		tok->flags |= TF_START_LINE;
+		cursor->eof = tok;
+	}
+
+	cursor->pos = cursor->src.tok_pos + tok->len;
+	return tok;
+}
+
+static void _lex_cursor_init(lex_cursor_t* cursor, source_range_t* range)
 {
-	const char* pos = sr->ptr;
+	memset(cursor, 0, sizeof(lex_cursor_t));
+	cursor->src.ptr = range->ptr;
+	cursor->src.end = range->end;
+	cursor->src.splice = _find_splice(range->ptr, range->end);
+	cursor->src.loc_base = src_range_loc(jcc_ctx(), range);
+	cursor->pos = range->ptr;
+	cursor->first = true;
+}
+
+static token_range_t _lex_range(source_range_t* range)
+{
+	lex_cursor_t cursor;
+	_lex_cursor_init(&cursor, range);
+
 	token_range_t result = { NULL, NULL };
 	token_t* tok;
 	do
 	{
-		tok = tok_create();
-		tok->kind = tok_invalid;
+		tok = _lex_cursor_next(&cursor);
+		if (cursor.failed)
+		{
+			//the tokens are released with the context
+			result.start = result.end = NULL;
+			return result;
+		}
 
 		if (result.start == NULL)
 		{
-			tok->flags |= TF_START_LINE;
 			result.start = result.end = tok;
 		}
 		else
 		{
 			tok->prev = result.end;
 			result.end->next = tok;
+			result.end = tok;
 		}
+	} while (tok->kind != tok_eof);
+	return result;
+}
 
-		lex_next_tok(sr, pos, tok);
+token_range_t lex_source(jcc_context_t* ctx, source_range_t* sr)
+{
+	jcc_ctx_set(ctx);
+	mem_cat_t scope = mem_set_scope(mc_tokens);
 
-		if (tok->kind == tok_eof && tok->loc < sr->end-1)
-			goto return_err;
+	token_range_t result;
+	if (!ctx->cache || !src_cache_find_tokens(ctx, ctx->cache, sr, &result))
+	{
+		result = _lex_range(sr);
+		if (ctx->cache && result.start)
+			src_cache_store_tokens(ctx, ctx->cache, sr, &result);
+	}
 
-		if (tok->kind == tok_eof)
+	mem_set_scope(scope);
+	return result;
+}
+
+/*
+hand out the tokens of range, lexed up front, from the cursor
+*/
+static void _lex_cursor_list(lex_cursor_t* cursor, token_range_t* range)
+{
+	cursor->next = range->start;
+	cursor->failed = range->start == NULL;
+	if (cursor->failed)
+	{
+		cursor->eof = tok_create();
+		cursor->eof->kind = tok_eof;
+		cursor->eof->loc = cursor->src.loc_base;
+		cursor->eof->flags = TF_START_LINE;
+	}
+}
+
+lex_cursor_t* lex_begin(jcc_context_t* ctx, source_range_t* sr, const char* path)
+{
+	jcc_ctx_set(ctx);
+	lex_cursor_t* cursor = (lex_cursor_t*)mem_alloc(mc_tokens, sizeof(lex_cursor_t));
+	_lex_cursor_init(cursor, sr);
+
+	token_range_t range;
+	if (ctx->cache)
+	{
+		//the cache holds whole files, lex the file up front so it can be stored
+		range = lex_source(ctx, sr);
+		_lex_cursor_list(cursor, &range);
+	}
+	else if (path && ctx->tok_cache_dir)
+	{
+		if (!tok_file_load(ctx, ctx->tok_cache_dir, path, sr, &range))
 		{
-			//enfore newline before eol
-			tok->flags |= TF_START_LINE;
+			range = lex_source(ctx, sr);
+			if (range.start)
+				tok_file_store(ctx, ctx->tok_cache_dir, path, sr, &range);
 		}
+		_lex_cursor_list(cursor, &range);
+	}
+	return cursor;
+}
 
-		result.end = tok;
-		pos = tok->loc + tok->len;
-	} while (tok->kind != tok_eof);
-	return result;
-
-return_err:
+token_t* lex_next(lex_cursor_t* cursor)
+{
+	if (cursor->eof)
+		return cursor->eof;
 
-	tok = result.start;
-	while (tok)
+	if (cursor->next)
 	{
-		token_t* next = tok->next;
-		free(tok);
-		tok = next;
+		token_t* tok = cursor->next;
+		cursor->next = tok->next;
+		if (tok->kind == tok_eof)
+			cursor->eof = tok;
+		tok->next = tok->prev = NULL;
+		return tok;
 	}
-	result.start = result.end = NULL;
-	return result;
+
+	mem_cat_t scope = mem_set_scope(mc_tokens);
+	token_t* tok = _lex_cursor_next(cursor);
+	mem_set_scope(scope);
+	return tok;
 }
 
-void lex_init()
+bool lex_failed(lex_cursor_t* cursor)
 {
-	
+	return cursor->failed;
+}
+
+void lex_end(lex_cursor_t* cursor)
+{
+	mem_free(cursor);
+}
+
+void lex_init(jcc_context_t* ctx)
+{
+	jcc_ctx_set(ctx);
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "mem_cat.h"
+
+const char* mem_category_name(mem_category cat)
+{
+	switch (cat)
+	{
+	case mc_general:
+		return "general";
+	case mc_source:
+		return "source";
+	case mc_tokens:
+		return "tokens";
+	case mc_macros:
+		return "macros";
+	case mc_ast:
+		return "ast";
+	case mc_types:
+		return "types";
+	case mc_symbols:
+		return "symbols";
+	case mc_codegen:
+		return "codegen";
+	default:
+		break;
+	}
+	return "unknown";
+}
@@ -3,12 +3,15 @@
 #include "parse.h"
 #include "diag.h"
 #include "std_types.h"
+#include "mem_cat.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+#define AST_ARENA_BLOCK_SZ (64 * 1024)
+
 /*
 see https://www.lysator.liu.se/c/ANSI-C-grammar-y.html
  
@@ -109,12 +112,9 @@ Note <declaration_specifiers> is incorrect for cast and size of - need to handle
 <enum_specifier> ::= "enum" [ <id> ] [ "{" { <id> [ = <int> ] } "}" ]
 */
 
-token_t* _cur_tok = NULL;
-static bool _parse_err = false;
-
 bool parse_seen_err()
 {
-	return _parse_err;
+	return parse_ctx()->err;
 }
 
 void* parse_err(int err, const char* format, ...)
@@ -126,8 +126,8 @@ void* parse_err(int err, const char* format, ...)
 	vsnprintf(buff, 512, format, args);
 	va_end(args);
 
-	_parse_err = true;
-	diag_err(current(), err, buff);
+	parse_ctx()->err = true;
+	diag_err(current_loc(), err, buff);
 	return NULL;
 }
 
@@ -325,9 +325,8 @@ static op_kind _get_binary_operator(token_t* tok)
 
 ast_expression_t* parse_alloc_expr()
 {
-	ast_expression_t* result = (ast_expression_t*)malloc(sizeof(ast_expression_t));
-	memset(result, 0, sizeof(ast_expression_t));
-	result->tokens.start = result->tokens.end = current();
+	ast_expression_t* result = (ast_expression_t*)ast_alloc(sizeof(ast_expression_t));
+	result->loc.start = result->loc.end = current_loc();
 	return result;
 }
 
@@ -339,7 +338,6 @@ ast_expression_t* parse_binary_expression(tok_kind* op_set, bin_parse_fn sub_par
 	ast_expression_t* expr = sub_parse();
 	if (parse_seen_err() || !expr)
 	{
-		ast_destroy_expression(expr);
 		return NULL;
 	}
 	while (tok_in_set(current()->kind, op_set))
@@ -350,7 +348,6 @@ ast_expression_t* parse_binary_expression(tok_kind* op_set, bin_parse_fn sub_par
 
 		if (!rhs_expr)
 		{
-			ast_destroy_expression(expr);
 			return NULL;
 		}
 
@@ -358,18 +355,17 @@ ast_expression_t* parse_binary_expression(tok_kind* op_set, bin_parse_fn sub_par
 		//build a new binary op expression for expr
 		ast_expression_t* cur_expr = expr;
 		expr = parse_alloc_expr();
-		expr->tokens.start = start;
+		expr->loc.start = parse_loc(start);
 		expr->kind = expr_binary_op;
 		expr->data.binary_op.operation = op;
 		expr->data.binary_op.lhs = cur_expr;
 		expr->data.binary_op.rhs = rhs_expr;
+		expr->loc.end = current_loc();
 	}
 	if (parse_seen_err() || !expr)
 	{
-		ast_destroy_expression(expr);
 		return NULL;
 	}
-	expr->tokens.end = current();
 	return expr;
 }
 
@@ -384,9 +380,9 @@ ast_expression_t* parse_identifier()
 	//<factor> ::= <id>
 	ast_expression_t* expr = parse_alloc_expr();
 	expr->kind = expr_identifier;
-	tok_spelling_cpy(current(), expr->data.identifier.name, MAX_LITERAL_NAME);
+	expr->data.identifier.name = current()->data.str;
 	next_tok();
-	expr->tokens.end = current();
+	expr->loc.end = current_loc();
 	return expr;
 }
 
@@ -397,7 +393,7 @@ ast_expression_t* try_parse_literal()
 		//<factor> ::= <int>
 		ast_expression_t* expr = parse_alloc_expr();
 		expr->kind = expr_int_literal;
-		expr->data.int_literal.val = current()->data.int_val;
+		expr->data.int_literal.val = *current()->data.int_val;
 		next_tok();
 		return expr;
 	}
@@ -432,11 +428,11 @@ ast_expression_t* try_parse_primary_expr()
 
 		if (!expr)
 		{
-			_cur_tok = start;
+			parse_ctx()->cur_tok = start;
 			return NULL;
 		}
 
-		expr->tokens.start = start; //otherwise we miss the initial '('
+		expr->loc.start = parse_loc(start); //otherwise we miss the initial '('
 		expect_cur(tok_r_paren);
 		next_tok();
 	}
@@ -445,7 +441,7 @@ ast_expression_t* try_parse_primary_expr()
 		expr = try_parse_literal();
 	}
 	if(expr)
-		expr->tokens.end = current();
+		expr->loc.end = current_loc();
 	return expr;
 }
 
@@ -484,7 +480,7 @@ ast_expression_t* try_parse_postfix_expr()
 	while (tok_in_set(current()->kind, postfix_ops))
 	{
 		ast_expression_t* expr = parse_alloc_expr();
-		expr->tokens = primary->tokens;
+		expr->loc = primary->loc;
 		if (current_is(tok_l_paren))
 		{
 			//function call
@@ -499,8 +495,7 @@ ast_expression_t* try_parse_postfix_expr()
 					expect_cur(tok_comma);
 					next_tok();
 				}
-				ast_func_call_param_t* param = (ast_func_call_param_t*)malloc(sizeof(ast_func_call_param_t));
-				memset(param, 0, sizeof(ast_func_call_param_t));
+				ast_func_call_param_t* param = (ast_func_call_param_t*)ast_alloc(sizeof(ast_func_call_param_t));
 				param->expr = parse_expression();
 
 				if (!expr->data.func_call.first_param)
@@ -513,11 +508,9 @@ ast_expression_t* try_parse_postfix_expr()
 					expr->data.func_call.last_param->next = param;
 					expr->data.func_call.last_param = param;
 				}
-
-				expr->data.func_call.param_count++;
 			}
 			next_tok();
-			expr->tokens.end = current();
+			expr->loc.end = current_loc();
 		}
 		else if (current_is(tok_fullstop))
 		{
@@ -527,7 +520,7 @@ ast_expression_t* try_parse_postfix_expr()
 			expr->data.binary_op.lhs = primary;
 			expr->data.binary_op.rhs = parse_identifier();
 			expr->data.binary_op.operation = op_member_access;
-			expr->tokens.end = current();
+			expr->loc.end = current_loc();
 		}
 		else if (current_is(tok_minusgreater))
 		{
@@ -537,7 +530,7 @@ ast_expression_t* try_parse_postfix_expr()
 			expr->data.binary_op.lhs = primary;
 			expr->data.binary_op.rhs = parse_identifier();
 			expr->data.binary_op.operation = op_ptr_member_access;
-			expr->tokens.end = current();
+			expr->loc.end = current_loc();
 		}
 		else if (current_is(tok_plusplus) || current_is(tok_minusminus))
 		{
@@ -546,7 +539,7 @@ ast_expression_t* try_parse_postfix_expr()
 			expr->data.unary_op.operation = _get_postfix_operator(current());
 			expr->data.unary_op.expression = primary;
 			next_tok();
-			expr->tokens.end = current();
+			expr->loc.end = current_loc();
 		}
 		else if (current_is(tok_l_square_paren))
 		{
@@ -558,7 +551,7 @@ ast_expression_t* try_parse_postfix_expr()
 			expr->data.binary_op.operation = op_array_subscript;
 			expect_cur(tok_r_square_paren);
 			next_tok();			
-			expr->tokens.end = current();
+			expr->loc.end = current_loc();
 		}
 		primary = expr;
 	}
@@ -587,20 +580,19 @@ ast_expression_t* try_parse_cast_expr()
 			next_tok();
 
 			ast_expression_t* expr = parse_alloc_expr();
-			expr->tokens.start = start;
-			expr->tokens.end = current();
+			expr->loc.start = parse_loc(start);
+			expr->loc.end = current_loc();
 			expr->kind = expr_cast;
 			expr->data.cast.type_ref = type;
 			expr->data.cast.expr = try_parse_cast_expr();
 			if (!expr->data.cast.expr)
 			{
 				parse_err(ERR_SYNTAX, "Expected expression after cast");
-				ast_destroy_expression(expr);
 				return NULL;
 			}
 			return expr;
 		}
-		_cur_tok = start;
+		parse_ctx()->cur_tok = start;
 	}
 
 	return try_parse_unary_expr();
@@ -632,7 +624,6 @@ ast_expression_t* parse_sizeof_expr()
 
 		if (!expect_cur(tok_r_paren))
 		{
-			ast_destroy_expression(expr);
 			return NULL;
 		}
 		next_tok();
@@ -642,7 +633,7 @@ ast_expression_t* parse_sizeof_expr()
 		expr->data.sizeof_call.kind = sizeof_expr;
 		expr->data.sizeof_call.data.expr = try_parse_unary_expr();
 	}
-	expr->tokens.end = current();
+	expr->loc.end = current_loc();
 
 	if (expr->data.sizeof_call.kind == sizeof_expr && !expr->data.sizeof_call.data.expr)
 	{
@@ -671,11 +662,10 @@ ast_expression_t* try_parse_unary_expr()
 		if (!expr->data.unary_op.expression)
 		{
 			parse_err(ERR_SYNTAX, "Expected expression after %s", ast_op_name(expr->data.unary_op.operation));
-			ast_destroy_expression(expr);
 			return NULL;
 		}
 
-		expr->tokens.end = current();
+		expr->loc.end = current_loc();
 		return expr;
 	}
 	else if (current_is(tok_sizeof))
@@ -790,7 +780,7 @@ ast_expression_t* parse_conditional_expression()
 		ast_expression_t* condition = expr;
 		
 		expr = parse_alloc_expr();
-		expr->tokens.start = start;
+		expr->loc.start = parse_loc(start);
 		expr->kind = expr_condition;
 		expr->data.condition.cond = condition;
 		expr->data.condition.true_branch = parse_expression();
@@ -800,10 +790,9 @@ ast_expression_t* parse_conditional_expression()
 	}
 	if (parse_seen_err() || !expr)
 	{
-		ast_destroy_expression(expr);
 		return NULL;
 	}
-	expr->tokens.end = current();
+	expr->loc.end = current_loc();
 	return expr;
 }
 
@@ -823,7 +812,7 @@ ast_expression_t* parse_constant_expression()
 ast_expression_t* parse_assignment_expression()
 {
 	ast_expression_t* expr;
-	token_t* start = _cur_tok;
+	token_t* start = current();
 
 	expr = try_parse_unary_expr();
 
@@ -832,26 +821,25 @@ ast_expression_t* parse_assignment_expression()
 		op_kind op = _get_assignment_operator(current());
 		next_tok();
 		ast_expression_t* assignment = parse_alloc_expr();
-		assignment->tokens = expr->tokens;
+		assignment->loc = expr->loc;
 		assignment->kind = expr_binary_op;
 		assignment->data.binary_op.operation = op;
 		assignment->data.binary_op.lhs = expr;
 		assignment->data.binary_op.rhs = parse_assignment_expression();
-		assignment->tokens.end = current();
+		assignment->loc.end = current_loc();
 		return assignment;
 	}
 	else
 	{
-		_cur_tok = start;
+		parse_ctx()->cur_tok = start;
 		expr = parse_conditional_expression();
 	}
 	if (parse_seen_err() || !expr)
 	{
-		ast_destroy_expression(expr);
 		return NULL;
 	}
 
-	expr->tokens.end = current();
+	expr->loc.end = current_loc();
 	return expr;
 }
 
@@ -875,9 +863,8 @@ ast_expression_t* parse_expression()
 */
 ast_block_item_t* parse_block_item()
 {
-	ast_block_item_t* result = (ast_block_item_t*)malloc(sizeof(ast_block_item_t));
-	memset(result, 0, sizeof(ast_block_item_t));
-	result->tokens.start = current();
+	ast_block_item_t* result = (ast_block_item_t*)ast_alloc(sizeof(ast_block_item_t));
+	result->loc.start = current_loc();
 
 	ast_decl_list_t decls = try_parse_decl_list(dpc_normal);
 	if (decls.first)
@@ -885,7 +872,6 @@ ast_block_item_t* parse_block_item()
 		if (!current_is(tok_semi_colon))
 		{
 			parse_err(ERR_SYNTAX, "expected ';' after declaration of %s", ast_declaration_name(decls.first));
-			ast_destroy_decl_list(decls);
 			return NULL;
 		}
 		next_tok();
@@ -900,17 +886,39 @@ ast_block_item_t* parse_block_item()
 	}
 	if (parse_seen_err())
 		return NULL;
-	result->tokens.end = current();
+	result->loc.end = current_loc();
 	return result;
 }
 
-void parse_init(token_t* tok)
+void parse_init(jcc_context_t* ctx, token_t* tok)
 {
-	types_init();
+	parse_deinit(ctx);
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_ast);
+
+	parse_context_t* parse = (parse_context_t*)mem_alloc(mc_ast, sizeof(parse_context_t));
+	memset(parse, 0, sizeof(parse_context_t));
+	parse->cur_tok = tok;
+	parse->arena = arena_create(mc_ast, AST_ARENA_BLOCK_SZ, ARENA_ALIGN);
+	ctx->parse = parse;
+	ctx->ast_arena = parse->arena;
 	parse_type_init();
-	_cur_tok = tok;
-	_parse_err = false;
-	
+}
+
+void parse_deinit(jcc_context_t* ctx)
+{
+	if (!ctx->parse)
+		return;
+	parse_type_deinit(ctx->parse);
+	if (ctx->parse->arena)
+	{
+		//nothing parsed was handed over to a translation unit
+		if (ctx->ast_arena == ctx->parse->arena)
+			ctx->ast_arena = NULL;
+		arena_destroy(ctx->parse->arena);
+	}
+	mem_free(ctx->parse);
+	ctx->parse = NULL;
 }
 
 ast_block_item_t* parse_block_list()
@@ -942,11 +950,14 @@ ast_block_item_t* parse_block_list()
 }
 
 //<translation_unit> :: = { <function> | <declaration> }
-ast_trans_unit_t* parse_translation_unit()
+ast_trans_unit_t* parse_translation_unit(jcc_context_t* ctx)
 {
-	ast_trans_unit_t* result = (ast_trans_unit_t*)malloc(sizeof(ast_trans_unit_t));
-	memset(result, 0, sizeof(ast_trans_unit_t));
-	result->tokens.start = current();
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_ast);
+
+	//the translation unit is allocated from the parse context's arena, which keeps it until parsing succeeds
+	ast_trans_unit_t* result = ast_create_translation_unit(parse_ctx()->arena);
+	result->loc.start = current_loc();
 	
 	while (!current_is(tok_eof))
 	{
@@ -968,7 +979,7 @@ ast_trans_unit_t* parse_translation_unit()
 				decls.first->data.func.blocks = parse_block_list();
 				if (parse_seen_err())
 					goto parse_failure;
-				decls.first->tokens.end = current();
+				decls.first->loc.end = current_loc();
 			}
 			else
 			{
@@ -988,11 +999,15 @@ ast_trans_unit_t* parse_translation_unit()
 		}
 	}
 
-	result->tokens.end = current();
+	result->loc.end = current_loc();
 	expect_cur(tok_eof);
+
+	//the translation unit takes ownership of everything parsed
+	parse_ctx()->arena = NULL;
 	return result;
 
 parse_failure:
+	parse_ctx()->arena = NULL;
 	ast_destory_translation_unit(result);
 	return NULL;
 }
\ No newline at end of file
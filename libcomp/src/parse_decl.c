@@ -19,8 +19,7 @@ ast_expression_t* parse_compound_init_list()
 	while (!current_is(tok_r_brace))
 	{
 		//todo parse designator
-		ast_compound_init_item_t* item = (ast_compound_init_item_t*)malloc(sizeof(ast_compound_init_item_t));
-		memset(item, 0, sizeof(ast_compound_init_item_t));
+		ast_compound_init_item_t* item = (ast_compound_init_item_t*)ast_alloc(sizeof(ast_compound_init_item_t));
 
 		if (current_is(tok_l_brace))
 		{
@@ -32,11 +31,7 @@ ast_expression_t* parse_compound_init_list()
 			item->expr = parse_expression();
 		}
 		if (!item->expr)
-		{
-			free(item);
-			ast_destroy_expression(result);
 			return NULL;
-		}
 
 		if (result->data.compound_init.item_list == NULL)
 			result->data.compound_init.item_list = item;
@@ -49,7 +44,7 @@ ast_expression_t* parse_compound_init_list()
 	}
 	next_tok();
 
-	result->tokens.end = current();
+	result->loc.end = current_loc();
 	return result;
 }
 
@@ -89,8 +84,7 @@ ast_expression_t* opt_parse_array_size()
 */
 ast_func_params_t* parse_function_parameters()
 {
-	ast_func_params_t* params = (ast_func_params_t*)malloc(sizeof(ast_func_params_t));
-	memset(params, 0, sizeof(ast_func_params_t));
+	ast_func_params_t* params = (ast_func_params_t*)ast_alloc(sizeof(ast_func_params_t));
 
 	expect_cur(tok_l_paren);
 	next_tok();
@@ -111,8 +105,7 @@ ast_func_params_t* parse_function_parameters()
 		if (!decl)
 			return parse_err(ERR_UNKNOWN_TYPE, "Error parsing declaration");
 
-		ast_func_param_decl_t* param = (ast_func_param_decl_t*)malloc(sizeof(ast_func_param_decl_t));
-		memset(param, 0, sizeof(ast_func_param_decl_t));
+		ast_func_param_decl_t* param = (ast_func_param_decl_t*)ast_alloc(sizeof(ast_func_param_decl_t));
 		param->decl = decl;
 
 		if (!params->first_param)
@@ -135,7 +128,6 @@ ast_func_params_t* parse_function_parameters()
 	// if single void param remove it
 	if (params->param_count == 1 && params->first_param->decl->type_ref->spec->kind == type_void)
 	{
-		free(params->first_param);
 		params->first_param = params->last_param = NULL;
 		params->param_count = 0;
 	}
@@ -157,10 +149,9 @@ ast_declaration_t* parse_declarator(ast_type_spec_t* type_spec, uint32_t type_fl
 	parse_type_ref_result_t type_ref_parse = parse_type_ref(type_spec, type_flags);
 	ast_type_ref_t* type_ref = type_ref_parse.type;
 
-	ast_declaration_t* result = (ast_declaration_t*)malloc(sizeof(ast_declaration_t));
-	memset(result, 0, sizeof(ast_declaration_t));
-	result->tokens.start = current();
-	result->tokens.end = current();
+	ast_declaration_t* result = (ast_declaration_t*)ast_alloc(sizeof(ast_declaration_t));
+	result->loc.start = current_loc();
+	result->loc.end = current_loc();
 	result->type_ref = type_ref;
 
 	result->kind = decl_type;
@@ -168,15 +159,15 @@ ast_declaration_t* parse_declarator(ast_type_spec_t* type_spec, uint32_t type_fl
 	if (type_ref_parse.identifier)
 	{
 		//copy the name seen while parsing the function or array pointer type
-		tok_spelling_cpy(type_ref_parse.identifier, result->name, MAX_LITERAL_NAME);
+		result->name = type_ref_parse.identifier->data.str;
 	}
 	else if (current_is(tok_identifier))
 	{
-		tok_spelling_cpy(current(), result->name, MAX_LITERAL_NAME);
+		result->name = current()->data.str;
 		next_tok();
 	}
 
-	if (strlen(result->name) && current_is(tok_l_paren))
+	if (result->name && current_is(tok_l_paren))
 	{
 		//function
 		result->kind = decl_func;
@@ -246,22 +237,20 @@ ast_declaration_t* parse_declarator(ast_type_spec_t* type_spec, uint32_t type_fl
 		if (type_ref->flags & TF_SC_TYPEDEF)
 		{
 			//typedef
-			if (strlen(result->name) == 0)
+			if (!result->name)
 			{
 				parse_err(ERR_SYNTAX, "typedef requires a name");
-				ast_destroy_declaration(result);
 				return NULL;
 			}
 
 			if (result->data.var.init_expr)
 			{
 				parse_err(ERR_SYNTAX, "typedef cannot be initialised");
-				ast_destroy_declaration(result);
 				return NULL;
 			}
 			parse_register_alias_name(result->name);
 		}
-		else if (strlen(result->name))
+		else if (result->name)
 		{
 			//variable
 			result->kind = decl_var;
@@ -271,7 +260,7 @@ ast_declaration_t* parse_declarator(ast_type_spec_t* type_spec, uint32_t type_fl
 			//unnamed param or type decl
 		}
 	}
-	result->tokens.end = current();
+	result->loc.end = current_loc();
 	return result;
 }
 
@@ -313,7 +302,6 @@ ast_decl_list_t try_parse_decl_list(decl_parse_context context)
 
 	return decl_list;
 _err_ret:
-	ast_destroy_decl_list(decl_list);
 	decl_list.first = decl_list.last = NULL;
 	return decl_list;
 	
@@ -7,17 +7,15 @@
 
 static inline ast_statement_t* _alloc_smnt()
 {
-	ast_statement_t* result = (ast_statement_t*)malloc(sizeof(ast_statement_t));
-	memset(result, 0, sizeof(ast_statement_t));
-	result->tokens.start = current();
+	ast_statement_t* result = (ast_statement_t*)ast_alloc(sizeof(ast_statement_t));
+	result->loc.start = current_loc();
 	return result;
 }
 
 static ast_expression_t* _alloc_expr()
 {
-	ast_expression_t* result = (ast_expression_t*)malloc(sizeof(ast_expression_t));
-	memset(result, 0, sizeof(ast_expression_t));
-	result->tokens.start = result->tokens.end = current();
+	ast_expression_t* result = (ast_expression_t*)ast_alloc(sizeof(ast_expression_t));
+	result->loc.start = result->loc.end = current_loc();
 	return result;
 }
 
@@ -44,7 +42,6 @@ ast_expression_t* parse_optional_expression(tok_kind term_tok)
 	
 	if (!expect_cur(term_tok))
 	{
-		ast_destroy_expression(expr);
 		return NULL;
 	}
 
@@ -75,8 +72,7 @@ ast_switch_case_data_t* parse_switch_case()
 		return NULL;
 	next_tok();
 
-	ast_switch_case_data_t* result = (ast_switch_case_data_t*)malloc(sizeof(ast_switch_case_data_t));
-	memset(result, 0, sizeof(ast_switch_case_data_t));
+	ast_switch_case_data_t* result = (ast_switch_case_data_t*)ast_alloc(sizeof(ast_switch_case_data_t));
 	
 	result->const_expr = expr;
 	//statement is optional if this is not the default case
@@ -180,14 +176,13 @@ ast_statement_t* parse_switch_statement()
 	return smnt;
 
 _parse_switch_err:
-	ast_destroy_statement(smnt);
 	return NULL;
 }
 
 //<statement> ::= "return" < exp > ";"
 ast_statement_t* parse_return_statement()
 {
-	token_t* start = current();
+	src_loc_t start = current_loc();
 	next_tok();
 	
 	ast_expression_t* expr = parse_optional_expression(tok_semi_colon);
@@ -203,8 +198,8 @@ ast_statement_t* parse_return_statement()
 	next_tok();
 
 	ast_statement_t* smnt = _alloc_smnt();
-	smnt->tokens.start = start;
-	smnt->tokens.end = current();
+	smnt->loc.start = start;
+	smnt->loc.end = current_loc();
 	smnt->kind = smnt_return;
 	smnt->data.expr = expr;
 	return smnt;
@@ -226,8 +221,8 @@ ast_statement_t* parse_for_statement()
 	parse_on_enter_block();
 
 	//initialisation
-	data->decls = try_parse_decl_list(dpc_normal);
-	if (data->decls.first)
+	data->decls = try_parse_decl_list(dpc_normal).first;
+	if (data->decls)
 	{
 		expect_cur(tok_semi_colon);
 		next_tok();
@@ -286,21 +281,20 @@ ast_statement_t* parse_for_statement()
 
 	return result;
 _parse_for_err:
-	ast_destroy_statement(result);
 	return NULL;
 }
 
 //<statement> ::= "if" "(" <exp> ")" <statement> [ "else" <statement> ]
 ast_statement_t* parse_if_statement()
 {
-	token_t* start = current();
+	src_loc_t start = current_loc();
 	next_tok();
 	if (!expect_cur(tok_l_paren))
 		return NULL;
 	next_tok();
 
 	ast_statement_t* smnt = _alloc_smnt();
-	smnt->tokens.start = start;
+	smnt->loc.start = start;
 	smnt->kind = smnt_if;
 	smnt->data.if_smnt.condition = parse_expression();
 	if (!smnt->data.if_smnt.condition)
@@ -320,11 +314,10 @@ ast_statement_t* parse_if_statement()
 		if(!smnt->data.if_smnt.false_branch)
 			goto _parse_if_err;
 	}
-	smnt->tokens.end = current();
+	smnt->loc.end = current_loc();
 	return smnt;
 
 _parse_if_err:
-	ast_destroy_statement(smnt);
 	return NULL;
 }
 
@@ -350,14 +343,13 @@ ast_statement_t* parse_do_statement()
 	return smnt;
 
 _parse_do_err:
-	ast_destroy_statement(smnt);
 	return NULL;
 }
 
 //<statement> :: = "while" "(" <exp> ")" <statement> ";"
 ast_statement_t* parse_while_statement()
 {
-	token_t* start = current();
+	src_loc_t start = current_loc();
 	next_tok();
 	if (!expect_cur(tok_l_paren))
 		return NULL;
@@ -365,7 +357,7 @@ ast_statement_t* parse_while_statement()
 	next_tok();
 	ast_statement_t* smnt = _alloc_smnt();
 	smnt->kind = smnt_while;
-	smnt->tokens.start = start;
+	smnt->loc.start = start;
 	smnt->data.while_smnt.condition = parse_expression();
 	if (!smnt->data.while_smnt.condition)
 		goto _parse_while_err;
@@ -379,7 +371,6 @@ ast_statement_t* parse_while_statement()
 	return smnt;
 
 _parse_while_err:
-	ast_destroy_statement(smnt);
 	return NULL;
 }
 
@@ -399,7 +390,7 @@ _parse_while_err:
 */
 ast_statement_t* parse_statement()
 {
-	token_t* start = current();
+	src_loc_t start = current_loc();
 
 	if (current_is(tok_return))
 	{
@@ -415,8 +406,8 @@ ast_statement_t* parse_statement()
 		next_tok();
 
 		ast_statement_t* smnt = _alloc_smnt();
-		smnt->tokens.start = start;
-		smnt->tokens.end = current();
+		smnt->loc.start = start;
+		smnt->loc.end = current_loc();
 		smnt->kind = smnt_continue;
 		return smnt;
 	}
@@ -430,8 +421,8 @@ ast_statement_t* parse_statement()
 		next_tok();
 
 		ast_statement_t* smnt = _alloc_smnt();
-		smnt->tokens.start = start;
-		smnt->tokens.end = current();
+		smnt->loc.start = start;
+		smnt->loc.end = current_loc();
 		smnt->kind = smnt_break;
 		return smnt;
 	}
@@ -456,10 +447,10 @@ ast_statement_t* parse_statement()
 		//<statement> ::= "{" { <block - item> } "}"
 
 		ast_statement_t* smnt = _alloc_smnt();
-		smnt->tokens.start = start;
+		smnt->loc.start = start;
 		smnt->kind = smnt_compound;
 		smnt->data.compound.blocks = parse_block_list();
-		smnt->tokens.end = current();
+		smnt->loc.end = current_loc();
 		return smnt;
 	}
 	else if (current_is(tok_switch))
@@ -475,13 +466,13 @@ ast_statement_t* parse_statement()
 		//statement ::= <label_smnt>
 
 		ast_statement_t* smnt = _alloc_smnt();
-		smnt->tokens.start = start;
+		smnt->loc.start = start;
 		smnt->kind = smnt_label;
-		tok_spelling_cpy(current(), smnt->data.label_smnt.label, MAX_LITERAL_NAME);
+		smnt->data.label_smnt.label = current()->data.str;
 		next_tok(); //identifier
 		next_tok(); //colon
 		smnt->data.label_smnt.smnt = parse_statement();
-		smnt->tokens.end = current();
+		smnt->loc.end = current_loc();
 		return smnt;
 	}
 	else if (current_is(tok_goto))
@@ -491,11 +482,11 @@ ast_statement_t* parse_statement()
 			return NULL;
 		
 		ast_statement_t* smnt = _alloc_smnt();
-		smnt->tokens.start = start;
+		smnt->loc.start = start;
 		smnt->kind = smnt_goto;		
-		tok_spelling_cpy(current(), smnt->data.goto_smnt.label, MAX_LITERAL_NAME);
+		smnt->data.goto_smnt.label = current()->data.str;
 		next_tok();
-		smnt->tokens.end = current();
+		smnt->loc.end = current_loc();
 		return smnt;
 	}
 	else if (current_is(tok_case))
@@ -518,8 +509,8 @@ ast_statement_t* parse_statement()
 	next_tok();
 
 	ast_statement_t* smnt = _alloc_smnt();
-	smnt->tokens.start = start;
-	smnt->tokens.end = current();
+	smnt->loc.start = start;
+	smnt->loc.end = current_loc();
 	smnt->kind = smnt_expr;
 	smnt->data.expr = expr;
 	return smnt;
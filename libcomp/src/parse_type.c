@@ -1,6 +1,7 @@
 #include "parse_internal.h"
 #include "diag.h"
 #include "std_types.h"
+#include "mem_cat.h"
 
 #include <libj/include/hash_table.h>
 
@@ -14,43 +15,41 @@ typedef struct alias_name_set
 	struct alias_name_set* next;
 }alias_name_set_t;
 
-static alias_name_set_t* _alias_name_stack;
-
 static alias_name_set_t* _alloc_alias_name_set()
 {
-	alias_name_set_t* result = (alias_name_set_t*)malloc(sizeof(alias_name_set_t));
+	alias_name_set_t* result = (alias_name_set_t*)mem_alloc(mc_symbols, sizeof(alias_name_set_t));
 	memset(result, 0, sizeof(alias_name_set_t));
-	result->names = sht_create(64);
+	result->names = iht_create(64);
 	return result;
 }
 
 void parse_on_enter_block()
 {
 	alias_name_set_t* set = _alloc_alias_name_set();
-	set->next = _alias_name_stack;
-	_alias_name_stack = set;
+	set->next = parse_ctx()->alias_name_stack;
+	parse_ctx()->alias_name_stack = set;
 }
 
 void parse_on_leave_block()
 {
-	alias_name_set_t* set = _alias_name_stack;
-	_alias_name_stack = _alias_name_stack->next;
+	alias_name_set_t* set = parse_ctx()->alias_name_stack;
+	parse_ctx()->alias_name_stack = parse_ctx()->alias_name_stack->next;
 	ht_destroy(set->names);
-	free(set);
+	mem_free(set);
 }
 
 void parse_register_alias_name(const char* name)
 {
-	sht_insert(_alias_name_stack->names, name, NULL);
+	iht_insert(parse_ctx()->alias_name_stack->names, name, NULL);
 }
 
 static bool _is_alias_name(const char* name)
 {
-	alias_name_set_t* set = _alias_name_stack;
+	alias_name_set_t* set = parse_ctx()->alias_name_stack;
 
 	while(set)
 	{
-		if (sht_contains(set->names, name))
+		if (iht_contains(set->names, name))
 			return true;
 		set = set->next;
 	}
@@ -193,14 +192,13 @@ static bool _is_type_spec(uint32_t flags, uint32_t type_flags)
 */
 ast_user_type_spec_t* parse_enum_spec()
 {
-	ast_user_type_spec_t* result = (ast_user_type_spec_t*)malloc(sizeof(ast_user_type_spec_t));
-	memset(result, 0, sizeof(ast_user_type_spec_t));
-	result->tokens.start = current();
+	ast_user_type_spec_t* result = (ast_user_type_spec_t*)ast_alloc(sizeof(ast_user_type_spec_t));
+	result->loc.start = current_loc();
 	result->kind = user_type_enum;
 
 	if (current_is(tok_identifier))
 	{
-		tok_spelling_cpy(current(), result->name, MAX_LITERAL_NAME);
+		result->name = current()->data.str;
 		next_tok();
 	}
 
@@ -215,10 +213,9 @@ ast_user_type_spec_t* parse_enum_spec()
 			if (!expect_cur(tok_identifier))
 				goto _enum_parse_err;
 
-			ast_enum_member_t* member = (ast_enum_member_t*)malloc(sizeof(ast_enum_member_t));
-			memset(member, 0, sizeof(ast_enum_member_t));
-			member->tokens.start = current();
-			tok_spelling_cpy(current(), member->name, MAX_LITERAL_NAME);
+			ast_enum_member_t* member = (ast_enum_member_t*)ast_alloc(sizeof(ast_enum_member_t));
+			member->loc.start = current_loc();
+			member->name = current()->data.str;
 			next_tok();
 
 			if (current_is(tok_equal))
@@ -243,7 +240,7 @@ ast_user_type_spec_t* parse_enum_spec()
 			}
 			last_member = member;
 
-			member->tokens.end = current();
+			member->loc.end = current_loc();
 
 			if (!current_is(tok_comma))
 				break;
@@ -253,10 +250,9 @@ ast_user_type_spec_t* parse_enum_spec()
 			goto _enum_parse_err;
 		next_tok();
 	}
-	result->tokens.end = current();
+	result->loc.end = current_loc();
 	return result;
 _enum_parse_err:
-	free(result);
 	return NULL;
 }
 
@@ -265,14 +261,13 @@ _enum_parse_err:
 */
 ast_user_type_spec_t* parse_struct_spec(user_type_kind kind)
 {
-	ast_user_type_spec_t* result = (ast_user_type_spec_t*)malloc(sizeof(ast_user_type_spec_t));
-	memset(result, 0, sizeof(ast_user_type_spec_t));
-	result->tokens.start = current();
+	ast_user_type_spec_t* result = (ast_user_type_spec_t*)ast_alloc(sizeof(ast_user_type_spec_t));
+	result->loc.start = current_loc();
 	result->kind = kind;
 
 	if (current_is(tok_identifier))
 	{
-		tok_spelling_cpy(current(), result->name, MAX_LITERAL_NAME);
+		result->name = current()->data.str;
 		next_tok();
 	}
 	else if(!current_is(tok_l_brace))
@@ -280,7 +275,6 @@ ast_user_type_spec_t* parse_struct_spec(user_type_kind kind)
 		//if there is no name there should be a definition
 		parse_err(ERR_SYNTAX, "expected definition or tag name after %s",
 			kind == user_type_struct ? "struct" : "union");
-		free(result);
 		return NULL;
 	}
 
@@ -312,8 +306,7 @@ ast_user_type_spec_t* parse_struct_spec(user_type_kind kind)
 
 			while (decl)
 			{
-				ast_struct_member_t* member = (ast_struct_member_t*)malloc(sizeof(ast_struct_member_t));
-				memset(member, 0, sizeof(ast_struct_member_t));
+				ast_struct_member_t* member = (ast_struct_member_t*)ast_alloc(sizeof(ast_struct_member_t));
 				member->decl = decl;
 
 				if (last_member == NULL)
@@ -330,14 +323,13 @@ ast_user_type_spec_t* parse_struct_spec(user_type_kind kind)
 		}
 		next_tok();
 	}
-	result->tokens.end = current();
+	result->loc.end = current_loc();
 	return result;
 }
 
 static inline ast_type_spec_t* _alloc_type_spec()
 {
-	ast_type_spec_t* result = (ast_type_spec_t*)malloc(sizeof(ast_type_spec_t));
-	memset(result, 0, sizeof(ast_type_spec_t));
+	ast_type_spec_t* result = (ast_type_spec_t*)ast_alloc(sizeof(ast_type_spec_t));
 	return result;
 }
 
@@ -483,7 +475,7 @@ ast_type_spec_t* try_parse_type_spec(uint32_t* flag_result)
 			//alias -> occurs when the type has been typedef'd
 			if (type_type != tt_none)
 				break; //we've already seen int, struct, void etc
-			alias = strdup(current()->data.str);
+			alias = current()->data.str;
 			type_type = tt_alias;
 			next_tok();
 		}
@@ -599,11 +591,10 @@ parse_type_ref_result_t parse_type_ref(ast_type_spec_t* type_spec, uint32_t flag
 {
 	parse_type_ref_result_t result;
 	result.identifier = NULL;
-	result.type = (ast_type_ref_t*)malloc(sizeof(ast_type_ref_t));
-	memset(result.type, 0, sizeof(ast_type_ref_t));
+	result.type = (ast_type_ref_t*)ast_alloc(sizeof(ast_type_ref_t));
 	result.type->flags = flags;
 	result.type->spec = type_spec;
-	result.type->tokens.start = current();
+	result.type->loc.start = current_loc();
 
 	while (current_is(tok_star))
 	{
@@ -653,7 +644,7 @@ parse_type_ref_result_t parse_type_ref(ast_type_spec_t* type_spec, uint32_t flag
 		
 	}
 	
-	result.type->tokens.end = current();
+	result.type->loc.end = current_loc();
 	return result;
 }
 
@@ -670,5 +661,16 @@ ast_type_ref_t* try_parse_type_ref()
 
 void parse_type_init()
 {
-	_alias_name_stack = _alloc_alias_name_set();
+	parse_ctx()->alias_name_stack = _alloc_alias_name_set();
+}
+
+void parse_type_deinit(parse_context_t* parse)
+{
+	while (parse->alias_name_stack)
+	{
+		alias_name_set_t* set = parse->alias_name_stack;
+		parse->alias_name_stack = set->next;
+		ht_destroy(set->names);
+		mem_free(set);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,700 @@
+#include "pch.h"
+#include "pp_internal.h"
+#include "jcc_context.h"
+#include "mem_cat.h"
+
+#include <libj/include/platform.h>
+#include <libj/include/hash_table.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define PCH_MAGIC 0x4843504a //JPCH
+
+/*
+increase when the layout or the token kinds change
+*/
+#define PCH_VERSION 1
+
+#define PCH_NONE UINT32_MAX
+
+/*
+pch_tok_t::file of a token which is not in a file, such as one formed by ##. Its spelling is held in the strings
+*/
+#define PCH_SPELLING UINT32_MAX
+
+/*
+pch_tok_t::file of a token with no location
+*/
+#define PCH_NO_LOC (UINT32_MAX - 1)
+
+/*
+The file is the header followed by the files, tokens, macros, include guards, #pragma once paths and strings.
+Strings are NUL terminated and, like the number payloads also held there, 8 byte aligned
+*/
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+
+	/*
+	hash of everything after the header, a partly written file is never used
+	*/
+	uint64_t body_hash;
+	uint32_t file_count;
+	uint32_t tok_count;
+
+	/*
+	the first output_count tokens are the preprocessed header, the replacement lists of the macros follow
+	*/
+	uint32_t output_count;
+	uint32_t macro_count;
+	uint32_t guard_count;
+	uint32_t once_count;
+	uint32_t strings_size;
+	uint32_t reserved;
+}pch_header_t;
+
+typedef struct
+{
+	uint32_t path;
+	uint32_t reserved;
+	uint64_t size;
+	uint64_t mtime;
+	uint64_t hash;
+}pch_file_t;
+
+typedef struct
+{
+	uint32_t file; //index, PCH_SPELLING or PCH_NO_LOC
+	uint32_t offset; //in the file or, for PCH_SPELLING, the strings
+	uint32_t len;
+	uint8_t kind;
+	uint8_t flags;
+	uint16_t reserved;
+
+	/*
+	offset in the strings, PCH_NONE if none.
+	Identifiers and string literals have a NUL terminated string and number literals a pch_num_t
+	*/
+	uint32_t payload;
+}pch_tok_t;
+
+typedef struct
+{
+	uint32_t name;
+	uint32_t kind;
+	uint32_t define; //index of the #define token
+	uint32_t params; //index of the first parameter
+	uint32_t param_count;
+	uint32_t tokens; //index of the first token of the replacement list
+	uint32_t token_count;
+	uint32_t reserved;
+}pch_macro_t;
+
+typedef struct
+{
+	uint32_t key;
+	uint32_t name;
+}pch_guard_t;
+
+typedef struct
+{
+	uint64_t val;
+	uint64_t is_signed;
+}pch_num_t;
+
+typedef struct
+{
+	uint8_t* data;
+	size_t len;
+	size_t cap;
+}pch_buff_t;
+
+typedef struct
+{
+	jcc_context_t* ctx;
+
+	pch_buff_t files;
+	pch_buff_t toks;
+	pch_buff_t macros;
+	pch_buff_t guards;
+	pch_buff_t once;
+	pch_buff_t strings;
+
+	/*
+	path to index + 1 and string to offset + 1
+	*/
+	hash_table_t* file_indices;
+	hash_table_t* string_offsets;
+
+	/*
+	file of the previous token, most tokens are in the same file as the one before them
+	*/
+	source_range_t* last_file;
+	uint32_t last_file_index;
+
+	uint32_t tok_count;
+	bool failed;
+}pch_writer_t;
+
+static size_t _append(pch_buff_t* buff, const void* data, size_t len)
+{
+	if (buff->len + len > buff->cap)
+	{
+		buff->cap = (buff->len + len) * 2 + 256;
+		buff->data = (uint8_t*)mem_realloc(buff->data, mc_macros, buff->cap);
+	}
+	size_t offset = buff->len;
+	memcpy(buff->data + offset, data, len);
+	buff->len += len;
+	return offset;
+}
+
+/*
+append len chars and a NUL terminator, padded to keep the strings aligned
+*/
+static uint32_t _append_str(pch_buff_t* strings, const char* str, size_t len)
+{
+	static const uint8_t zeros[8] = { 0 };
+	uint32_t offset = (uint32_t)_append(strings, str, len);
+	_append(strings, zeros, 8 - (len & 7));
+	return offset;
+}
+
+static uint32_t _add_string(pch_writer_t* w, const char* str)
+{
+	void* existing = sht_lookup(w->string_offsets, str);
+	if (existing)
+		return (uint32_t)((size_t)existing - 1);
+
+	uint32_t offset = _append_str(&w->strings, str, strlen(str));
+	sht_insert(w->string_offsets, str, (void*)((size_t)offset + 1));
+	return offset;
+}
+
+/*
+index of the file containing pos, adding it if required, and the offset of pos in it.
+PCH_SPELLING if pos is not within a file, such as in the scratch space
+*/
+static uint32_t _file_index(pch_writer_t* w, const char* pos, uint32_t* offset)
+{
+	if (!w->last_file || pos < w->last_file->ptr || pos > w->last_file->end)
+	{
+		const char* path;
+		source_range_t* range = src_find_file(w->ctx, pos, &path);
+		if (!range || !path)
+			return PCH_SPELLING;
+
+		void* existing = sht_lookup(w->file_indices, path);
+		if (existing)
+		{
+			w->last_file_index = (uint32_t)((size_t)existing - 1);
+		}
+		else
+		{
+			size_t size = (size_t)(range->end - range->ptr);
+			file_info_t info;
+			if (!file_info(path, &info) || info.size != size)
+			{
+				//not read from disk, the header could not be checked when loaded
+				w->failed = true;
+				return PCH_SPELLING;
+			}
+
+			pch_file_t file;
+			memset(&file, 0, sizeof(pch_file_t));
+			file.path = _add_string(w, path);
+			file.size = info.size;
+			file.mtime = info.mtime;
+			file.hash = src_hash(range->ptr, size);
+			w->last_file_index = (uint32_t)(_append(&w->files, &file, sizeof(pch_file_t)) / sizeof(pch_file_t));
+			sht_insert(w->file_indices, path, (void*)((size_t)w->last_file_index + 1));
+		}
+		w->last_file = range;
+	}
+	*offset = (uint32_t)(pos - w->last_file->ptr);
+	return w->last_file_index;
+}
+
+static uint32_t _add_tok(pch_writer_t* w, token_t* tok)
+{
+	pch_tok_t rec;
+	memset(&rec, 0, sizeof(pch_tok_t));
+	rec.len = tok->len;
+	rec.kind = tok->kind;
+	rec.flags = tok->flags;
+	rec.payload = PCH_NONE;
+
+	const char* pos = tok_spelling(tok);
+	if (!pos)
+	{
+		rec.file = PCH_NO_LOC;
+	}
+	else
+	{
+		rec.file = _file_index(w, pos, &rec.offset);
+		if (rec.file == PCH_SPELLING)
+			rec.offset = _append_str(&w->strings, pos, tok->len);
+	}
+
+	if ((tok->kind == tok_identifier || tok->kind == tok_string_literal) && tok->data.str)
+	{
+		rec.payload = _add_string(w, tok->data.str);
+	}
+	else if (tok->kind == tok_num_literal && tok->data.int_val)
+	{
+		pch_num_t num = { tok->data.int_val->v.uint64, tok->data.int_val->is_signed };
+		rec.payload = (uint32_t)_append(&w->strings, &num, sizeof(pch_num_t));
+	}
+
+	_append(&w->toks, &rec, sizeof(pch_tok_t));
+	return w->tok_count++;
+}
+
+/*
+add the tokens from start up to end, or an end marker, returning the index of the first
+*/
+static uint32_t _add_range(pch_writer_t* w, token_t* start, token_t* end, uint32_t* count)
+{
+	uint32_t first = w->tok_count;
+	*count = 0;
+	for (token_t* tok = start; tok && tok != end && tok->kind != tok_pp_end_marker; tok = tok->next)
+	{
+		_add_tok(w, tok);
+		(*count)++;
+	}
+	return first;
+}
+
+static bool _is_built_in(macro_t* macro)
+{
+	const char* built_in = pp_built_in_defs();
+	const char* pos = tok_spelling(macro->define);
+	return pos >= built_in && pos < built_in + strlen(built_in);
+}
+
+static void _add_macros(pch_writer_t* w, pp_context_t* pp)
+{
+	ht_iterator_t it = ht_begin(pp->defs);
+	while (!ht_end(pp->defs, &it))
+	{
+		macro_t* macro = (macro_t*)it.node->val;
+
+		//defined again by the preprocessor which loads the header
+		if (!_is_built_in(macro))
+		{
+			pch_macro_t rec;
+			memset(&rec, 0, sizeof(pch_macro_t));
+			rec.name = _add_string(w, macro->name);
+			rec.kind = macro->kind;
+			rec.define = _add_tok(w, macro->define);
+			rec.params = _add_range(w, macro->fn_params, NULL, &rec.param_count);
+			rec.tokens = _add_range(w, macro->tokens.start, macro->tokens.end, &rec.token_count);
+			_append(&w->macros, &rec, sizeof(pch_macro_t));
+		}
+		ht_next(pp->defs, &it);
+	}
+}
+
+static void _add_include_state(pch_writer_t* w, pp_context_t* pp)
+{
+	sht_iterator_t it = sht_begin(pp->include_guards);
+	while (!sht_end(pp->include_guards, &it))
+	{
+		pch_guard_t guard = { _add_string(w, it.key), _add_string(w, (const char*)it.val) };
+		_append(&w->guards, &guard, sizeof(pch_guard_t));
+		sht_next(pp->include_guards, &it);
+	}
+
+	it = sht_begin(pp->praga_once_paths);
+	while (!sht_end(pp->praga_once_paths, &it))
+	{
+		uint32_t path = _add_string(w, it.key);
+		_append(&w->once, &path, sizeof(uint32_t));
+		sht_next(pp->praga_once_paths, &it);
+	}
+}
+
+static bool _write_file(pch_writer_t* w, const char* path, uint32_t output_count)
+{
+	pch_buff_t* sections[] = { &w->files, &w->toks, &w->macros, &w->guards, &w->once, &w->strings };
+	size_t section_count = sizeof(sections) / sizeof(sections[0]);
+
+	pch_buff_t body;
+	memset(&body, 0, sizeof(pch_buff_t));
+	for (size_t i = 0; i < section_count; i++)
+	{
+		if (sections[i]->len)
+			_append(&body, sections[i]->data, sections[i]->len);
+	}
+
+	pch_header_t header;
+	memset(&header, 0, sizeof(pch_header_t));
+	header.magic = PCH_MAGIC;
+	header.version = PCH_VERSION;
+	header.body_hash = src_hash(body.data, body.len);
+	header.file_count = (uint32_t)(w->files.len / sizeof(pch_file_t));
+	header.tok_count = w->tok_count;
+	header.output_count = output_count;
+	header.macro_count = (uint32_t)(w->macros.len / sizeof(pch_macro_t));
+	header.guard_count = (uint32_t)(w->guards.len / sizeof(pch_guard_t));
+	header.once_count = (uint32_t)(w->once.len / sizeof(uint32_t));
+	header.strings_size = (uint32_t)w->strings.len;
+
+	bool result = false;
+	FILE* f = fopen(path, "wb");
+	if (f)
+	{
+		result = fwrite(&header, sizeof(pch_header_t), 1, f) == 1 &&
+			(body.len == 0 || fwrite(body.data, 1, body.len, f) == body.len);
+		result = fclose(f) == 0 && result;
+		if (!result)
+			remove(path);
+	}
+	mem_free(body.data);
+	return result;
+}
+
+bool pch_write(jcc_context_t* ctx, const char* path, token_range_t* toks)
+{
+	jcc_ctx_set(ctx);
+	mem_cat_t scope = mem_set_scope(mc_macros);
+
+	pch_writer_t w;
+	memset(&w, 0, sizeof(pch_writer_t));
+	w.ctx = ctx;
+	w.file_indices = sht_create(32);
+	w.string_offsets = sht_create(1024);
+
+	//the header's tokens without the tok_eof which ends them
+	uint32_t output_count;
+	_add_range(&w, toks->start, toks->end, &output_count);
+	_add_macros(&w, ctx->pp);
+	_add_include_state(&w, ctx->pp);
+
+	bool result = !w.failed && w.strings.len < PCH_NONE && _write_file(&w, path, output_count);
+
+	ht_destroy(w.file_indices);
+	ht_destroy(w.string_offsets);
+	mem_free(w.files.data);
+	mem_free(w.toks.data);
+	mem_free(w.macros.data);
+	mem_free(w.guards.data);
+	mem_free(w.once.data);
+	mem_free(w.strings.data);
+	mem_set_scope(scope);
+	return result;
+}
+
+typedef struct
+{
+	pch_header_t header;
+	const char* files;
+	const char* toks;
+	const char* macros;
+	const char* guards;
+	const char* once;
+	const char* strings;
+
+	/*
+	contents of each file, loaded through the source manager
+	*/
+	source_range_t** file_ranges;
+
+	/*
+	interned spelling of each identifier payload, by offset / 8
+	*/
+	const char** idents;
+}pch_reader_t;
+
+/*
+the NUL terminated string at offset in the strings, NULL if there is none
+*/
+static const char* _string(pch_reader_t* r, uint32_t offset)
+{
+	if (offset >= r->header.strings_size)
+		return NULL;
+	const char* str = r->strings + offset;
+	return memchr(str, 0, r->header.strings_size - offset) ? str : NULL;
+}
+
+static bool _load_files(pch_reader_t* r, jcc_context_t* ctx)
+{
+	for (uint32_t i = 0; i < r->header.file_count; i++)
+	{
+		pch_file_t rec;
+		memcpy(&rec, r->files + i * sizeof(pch_file_t), sizeof(pch_file_t));
+		const char* path = _string(r, rec.path);
+		file_info_t info;
+		if (!path || !file_info(path, &info) || info.size != rec.size || info.mtime != rec.mtime)
+			return false;
+
+		const char* dir = path_dirname(path);
+		const char* fn = path_filename(path);
+		source_range_t* range = dir && fn ? src_load_file(ctx, dir, fn) : NULL;
+		mem_free((void*)dir);
+		mem_free((void*)fn);
+
+		const char* loaded_path = NULL;
+		if (!range ||
+			(uint64_t)(range->end - range->ptr) != rec.size ||
+			!src_find_file(ctx, range->ptr, &loaded_path) ||
+			strcmp(loaded_path, path) != 0 ||
+			src_hash(range->ptr, (size_t)rec.size) != rec.hash)
+			return false;
+		r->file_ranges[i] = range;
+	}
+	return true;
+}
+
+static bool _valid_tok(pch_reader_t* r, uint32_t index)
+{
+	pch_tok_t rec;
+	memcpy(&rec, r->toks + index * sizeof(pch_tok_t), sizeof(pch_tok_t));
+	if (rec.kind > tok_string_literal)
+		return false;
+
+	if (rec.file == PCH_SPELLING)
+	{
+		if ((uint64_t)rec.offset + rec.len >= r->header.strings_size)
+			return false;
+	}
+	else if (rec.file != PCH_NO_LOC)
+	{
+		if (rec.file >= r->header.file_count ||
+			(uint64_t)rec.offset + rec.len > (uint64_t)(r->file_ranges[rec.file]->end - r->file_ranges[rec.file]->ptr))
+			return false;
+	}
+
+	if (rec.payload == PCH_NONE)
+		return true;
+	if (rec.kind == tok_identifier)
+		return rec.payload % 8 == 0 && _string(r, rec.payload);
+	if (rec.kind == tok_string_literal)
+		return _string(r, rec.payload) != NULL;
+	if (rec.kind == tok_num_literal)
+		return rec.payload < r->header.strings_size && r->header.strings_size - rec.payload >= sizeof(pch_num_t);
+	return false;
+}
+
+static bool _valid_range(pch_reader_t* r, uint32_t first, uint32_t count)
+{
+	return (uint64_t)first + count <= r->header.tok_count;
+}
+
+static bool _validate(pch_reader_t* r)
+{
+	for (uint32_t i = 0; i < r->header.tok_count; i++)
+	{
+		if (!_valid_tok(r, i))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < r->header.macro_count; i++)
+	{
+		pch_macro_t rec;
+		memcpy(&rec, r->macros + i * sizeof(pch_macro_t), sizeof(pch_macro_t));
+		if (!_string(r, rec.name) ||
+			(rec.kind != macro_obj && rec.kind != macro_fn) ||
+			rec.define >= r->header.tok_count ||
+			!_valid_range(r, rec.params, rec.param_count) ||
+			!_valid_range(r, rec.tokens, rec.token_count))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < r->header.guard_count; i++)
+	{
+		pch_guard_t rec;
+		memcpy(&rec, r->guards + i * sizeof(pch_guard_t), sizeof(pch_guard_t));
+		if (!_string(r, rec.key) || !_string(r, rec.name))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < r->header.once_count; i++)
+	{
+		uint32_t path;
+		memcpy(&path, r->once + i * sizeof(uint32_t), sizeof(uint32_t));
+		if (!_string(r, path))
+			return false;
+	}
+	return _valid_range(r, 0, r->header.output_count);
+}
+
+static token_t* _create_tok(pch_reader_t* r, uint32_t index)
+{
+	pch_tok_t rec;
+	memcpy(&rec, r->toks + index * sizeof(pch_tok_t), sizeof(pch_tok_t));
+
+	token_t* tok = tok_create();
+	tok->len = rec.len;
+	tok->kind = rec.kind;
+	tok->flags = rec.flags;
+	if (rec.file == PCH_SPELLING)
+		tok->loc = src_get_loc(jcc_ctx(), src_scratch(jcc_ctx(), r->strings + rec.offset, rec.len));
+	else if (rec.file != PCH_NO_LOC)
+		tok->loc = src_get_loc(jcc_ctx(), r->file_ranges[rec.file]->ptr + rec.offset);
+
+	if (rec.payload == PCH_NONE)
+		return tok;
+
+	const char* payload = r->strings + rec.payload;
+	if (rec.kind == tok_identifier)
+	{
+		const char** ident = &r->idents[rec.payload / 8];
+		if (!*ident)
+			*ident = tok_intern(payload, strlen(payload));
+		tok->data.str = *ident;
+	}
+	else if (rec.kind == tok_string_literal)
+	{
+		tok->data.str = tok_alloc_str(payload, strlen(payload));
+	}
+	else
+	{
+		pch_num_t num;
+		memcpy(&num, payload, sizeof(pch_num_t));
+		int_val_t val = num.is_signed ? int_val_signed((int64_t)num.val) : int_val_unsigned(num.val);
+		tok->data.int_val = tok_alloc_int_val(val);
+	}
+	return tok;
+}
+
+/*
+create count tokens from first, linked and followed by an end marker if end_marker is set
+*/
+static void _link_tok(token_range_t* range, token_t* tok)
+{
+	tok->prev = range->end;
+	if (range->end)
+		range->end->next = tok;
+	else
+		range->start = tok;
+	range->end = tok;
+}
+
+static token_range_t _create_range(pch_reader_t* r, uint32_t first, uint32_t count, bool end_marker)
+{
+	token_range_t range = { NULL, NULL };
+	for (uint32_t i = first; i < first + count; i++)
+		_link_tok(&range, _create_tok(r, i));
+
+	if (end_marker)
+	{
+		token_t* end = tok_create();
+		end->kind = tok_pp_end_marker;
+		_link_tok(&range, end);
+	}
+	return range;
+}
+
+static void _create_macros(pch_reader_t* r, pp_context_t* pp)
+{
+	for (uint32_t i = 0; i < r->header.macro_count; i++)
+	{
+		pch_macro_t rec;
+		memcpy(&rec, r->macros + i * sizeof(pch_macro_t), sizeof(pch_macro_t));
+
+		macro_t* macro = (macro_t*)mem_alloc(mc_macros, sizeof(macro_t));
+		memset(macro, 0, sizeof(macro_t));
+		macro->kind = (macro_kind)rec.kind;
+		macro->id = ++pp->next_macro_id;
+		const char* name = _string(r, rec.name);
+		macro->name = tok_intern(name, strlen(name));
+		macro->define = _create_tok(r, rec.define);
+		if (rec.param_count)
+			macro->fn_params = _create_range(r, rec.params, rec.param_count, true).start;
+		macro->tokens = _create_range(r, rec.tokens, rec.token_count, true);
+
+		macro_t* existing = (macro_t*)iht_lookup(pp->defs, macro->name);
+		if (existing)
+		{
+			iht_remove(pp->defs, macro->name);
+			mem_free(existing);
+		}
+		iht_insert(pp->defs, macro->name, macro);
+	}
+}
+
+static void _create_include_state(pch_reader_t* r, pp_context_t* pp)
+{
+	for (uint32_t i = 0; i < r->header.guard_count; i++)
+	{
+		pch_guard_t rec;
+		memcpy(&rec, r->guards + i * sizeof(pch_guard_t), sizeof(pch_guard_t));
+		const char* name = _string(r, rec.name);
+		sht_insert(pp->include_guards, _string(r, rec.key), (void*)tok_intern(name, strlen(name)));
+	}
+
+	for (uint32_t i = 0; i < r->header.once_count; i++)
+	{
+		uint32_t path;
+		memcpy(&path, r->once + i * sizeof(uint32_t), sizeof(uint32_t));
+		sht_insert(pp->praga_once_paths, _string(r, path), (void*)1);
+	}
+}
+
+static bool _load(jcc_context_t* ctx, const char* data, size_t len)
+{
+	pch_reader_t r;
+	memset(&r, 0, sizeof(pch_reader_t));
+	if (len < sizeof(pch_header_t))
+		return false;
+	memcpy(&r.header, data, sizeof(pch_header_t));
+
+	const char* body = data + sizeof(pch_header_t);
+	size_t body_len = len - sizeof(pch_header_t);
+	uint64_t expected_len = (uint64_t)r.header.file_count * sizeof(pch_file_t) +
+		(uint64_t)r.header.tok_count * sizeof(pch_tok_t) +
+		(uint64_t)r.header.macro_count * sizeof(pch_macro_t) +
+		(uint64_t)r.header.guard_count * sizeof(pch_guard_t) +
+		(uint64_t)r.header.once_count * sizeof(uint32_t) +
+		r.header.strings_size;
+	if (r.header.magic != PCH_MAGIC ||
+		r.header.version != PCH_VERSION ||
+		expected_len != body_len ||
+		src_hash(body, body_len) != r.header.body_hash)
+		return false;
+
+	r.files = body;
+	r.toks = r.files + (size_t)r.header.file_count * sizeof(pch_file_t);
+	r.macros = r.toks + (size_t)r.header.tok_count * sizeof(pch_tok_t);
+	r.guards = r.macros + (size_t)r.header.macro_count * sizeof(pch_macro_t);
+	r.once = r.guards + (size_t)r.header.guard_count * sizeof(pch_guard_t);
+	r.strings = r.once + (size_t)r.header.once_count * sizeof(uint32_t);
+
+	size_t ranges_size = sizeof(source_range_t*) * (r.header.file_count + 1);
+	r.file_ranges = (source_range_t**)mem_alloc(mc_macros, ranges_size);
+	memset(r.file_ranges, 0, ranges_size);
+	bool result = _load_files(&r, ctx) && _validate(&r);
+	if (result)
+	{
+		size_t idents_size = sizeof(const char*) * (r.header.strings_size / 8 + 1);
+		r.idents = (const char**)mem_alloc(mc_macros, idents_size);
+		memset(r.idents, 0, idents_size);
+
+		pp_context_t* pp = ctx->pp;
+		pp->result = _create_range(&r, 0, r.header.output_count, false);
+		_create_macros(&r, pp);
+		_create_include_state(&r, pp);
+		mem_free(r.idents);
+	}
+	mem_free(r.file_ranges);
+	return result;
+}
+
+bool pch_load(jcc_context_t* ctx, const char* path)
+{
+	jcc_ctx_set(ctx);
+	size_t len = 0;
+	const char* data = file_map(path, &len);
+	if (!data)
+		return false;
+
+	mem_cat_t scope = mem_set_scope(mc_macros);
+	bool result = _load(ctx, data, len);
+	mem_set_scope(scope);
+
+	file_unmap(data, len);
+	return result;
+}
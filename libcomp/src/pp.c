@@ -4,6 +4,8 @@
 #include "source.h"
 #include "lexer.h"
 #include "ast.h"
+#include "time_trace.h"
+#include "mem_cat.h"
 
 #include <libj/include/platform.h>
 
@@ -14,58 +16,111 @@
 #include <assert.h>
 
 static bool _process_token(token_t* tok);
-static pp_context_t* _context = NULL;
+static bool _process_condition(token_t* directive, bool* single_group);
+static inline pp_context_t* _pp()
+{
+	return jcc_ctx()->pp;
+}
 
+/*
+lex the single token spelt by sb, which is destroyed.
+The spelling is copied to the scratch space so the token has a location like any other
+*/
 static token_t* _lex_single_tok(str_buff_t* sb)
 {
-	source_range_t sr = { sb->buff, sb->buff + sb->len };
+	const char* spelling = src_scratch(jcc_ctx(), sb->buff, sb->len);
+	source_range_t sr = { spelling, spelling + sb->len };
+	sb_destroy(sb);
 
-	token_range_t range = lex_source(&sr);
+	token_range_t range = lex_source(jcc_ctx(), &sr);
 
 	if (range.start && range.start->next == range.end)
 	{
-		tok_destory(range.end);
+		tok_release(range.end);
 		range.start->next = NULL;
 		return range.start;
 	}
-	sb_destroy(sb);
-	tok_range_destroy(&range);
+	tok_range_release(&range);
 	return NULL;
 }
 
 static void _push_dest(token_range_t* range)
 {
-	dest_range_t* dest = (dest_range_t*)malloc(sizeof(dest_range_t));
+	dest_range_t* dest = (dest_range_t*)mem_alloc(mc_macros, sizeof(dest_range_t));
 	memset(dest, 0, sizeof(dest_range_t));
 	dest->range = range;
 	dest->next_tok_flags = FLAGS_UNSET;
-	dest->next = _context->dest_stack;
-	_context->dest_stack = dest;
+	dest->next = _pp()->dest_stack;
+	_pp()->dest_stack = dest;
 }
 
 static void _pop_dest()
 {
-	dest_range_t* dest = _context->dest_stack;
+	dest_range_t* dest = _pp()->dest_stack;
 	assert(dest);
-	_context->dest_stack = _context->dest_stack->next;
-	assert(_context->dest_stack); //result should never be popped
-	free(dest);
+	_pp()->dest_stack = _pp()->dest_stack->next;
+	assert(_pp()->dest_stack); //result should never be popped
+	mem_free(dest);
 }
 
 static void _set_next_tok_flags(uint8_t flags)
 {
-	if(_context->dest_stack->next_tok_flags == FLAGS_UNSET)
-		_context->dest_stack->next_tok_flags = flags;
+	if(_pp()->dest_stack->next_tok_flags == FLAGS_UNSET)
+		_pp()->dest_stack->next_tok_flags = flags;
+}
+
+static inline bool _is_expansion_at_end(input_range_t* ir)
+{
+	if (ir->lexer)
+		return ir->current->kind == tok_eof;
+	return ir->current == ir->tokens.end;
+}
+
+static input_range_t* _alloc_input_range()
+{
+	input_range_t* ir = _pp()->free_inputs;
+	if (ir)
+		_pp()->free_inputs = ir->next;
+	else
+		ir = (input_range_t*)mem_alloc(mc_macros, sizeof(input_range_t));
+	memset(ir, 0, sizeof(input_range_t));
+	ir->id = ++_pp()->next_input_id;
+	return ir;
+}
+
+static void _free_input_range(input_range_t* ir)
+{
+	if (ir->lexer)
+		lex_end(ir->lexer);
+	ir->next = _pp()->free_inputs;
+	_pp()->free_inputs = ir;
+}
+
+/*
+path of the file the input came from, NULL if it was not from a file
+*/
+static const char* _input_path(input_range_t* ir)
+{
+	const char* path = NULL;
+	const char* pos = src_loc_ptr(jcc_ctx(), ir->file_pos);
+	if (pos)
+		src_find_file(jcc_ctx(), pos, &path);
+	return path;
+}
+
+static uint32_t _input_line(input_range_t* ir)
+{
+	return src_get_loc_info(jcc_ctx(), ir->line_pos).line;
 }
 
 static token_t* _peek_next()
 {
-	assert(_context->input_stack);
+	assert(_pp()->input_stack);
 
-	input_range_t* ir = _context->input_stack;
+	input_range_t* ir = _pp()->input_stack;
 	while (ir)
 	{
-		if (ir->current != ir->tokens->end || ir->next == NULL)
+		if (!_is_expansion_at_end(ir) || ir->next == NULL)
 			return ir->current;
 		ir = ir->next;
 	}
@@ -75,33 +130,34 @@ static token_t* _peek_next()
 
 static token_t* _pop_next()
 {
-	assert(_context->input_stack);
+	assert(_pp()->input_stack);
 	
-	input_range_t* ir = _context->input_stack;
+	input_range_t* ir = _pp()->input_stack;
 	while (ir)
 	{
-		if (ir->current != ir->tokens->end || ir->next == NULL)
+		if (!_is_expansion_at_end(ir) || ir->next == NULL)
 			break;
 
 		if (ir->macro_expansion)
 			ir->macro_expansion->complete = true;
 
-		_context->input_stack = ir->next;
-		free(ir->tokens);
-		free(ir);
-		ir = _context->input_stack;
+		//a file's end of file token is dropped with it
+		if (ir->lexer)
+			tok_release(ir->current);
+
+		_pp()->input_stack = ir->next;
+		_free_input_range(ir);
+		ir = _pp()->input_stack;
 	}
 	token_t* tok = ir->current;
-	ir->current = ir->current->next;
+	ir->current = ir->lexer ? lex_next(ir->lexer) : tok->next;
 
 	if (tok->flags & TF_START_LINE)
-	{
-		ir->line_num = src_get_pos_info(tok->loc).line;
-	}
+		ir->line_pos = tok->loc;
 
-	if (ir->next)
+	if (!ir->owned)
 	{
-		//not the root level means we are expanding a macro or param, so duplicate tok
+		//expanding a macro or param, so duplicate tok
 		return tok_duplicate(tok);
 	}
 
@@ -140,59 +196,105 @@ static token_range_t _extract_till_eol(token_t* start)
 	return range;
 }
 
-static input_range_t* _begin_token_range_expansion(token_range_t* range)
+static input_range_t* _begin_token_range_expansion(token_range_t* range, bool owned)
 {
-	input_range_t* ir = (input_range_t*)malloc(sizeof(input_range_t));
-	memset(ir, 0, sizeof(input_range_t));
-	ir->tokens = tok_range_dup(range);
-	ir->current = ir->tokens->start;
-	ir->next = _context->input_stack;
-
-	file_pos_t fp = src_get_pos_info(range->start->loc);
-	ir->path = fp.path;
-	ir->line_num = fp.line;
+	input_range_t* ir = _alloc_input_range();
+	ir->tokens = *range;
+	ir->owned = owned;
+	ir->current = range->start;
+	ir->file_pos = ir->line_pos = range->start->loc;
+	ir->next = _pp()->input_stack;
+	_pp()->input_stack = ir;
+	return ir;
+}
 
-	_context->input_stack = ir;
+static input_range_t* _begin_lexer_expansion(lex_cursor_t* lexer, source_range_t* sr)
+{
+	input_range_t* ir = _alloc_input_range();
+	ir->lexer = lexer;
+	ir->owned = true;
+	ir->current = lex_next(lexer);
+	ir->file_pos = ir->line_pos = src_range_loc(jcc_ctx(), sr);
+	ir->next = _pp()->input_stack;
+	_pp()->input_stack = ir;
 	return ir;
 }
 
-static input_range_t* _begin_macro_expansion(macro_t* macro, hash_table_t* params)
+/*
+a context for an expansion of macro, the caller adds any arguments before _begin_macro_expansion()
+*/
+static expansion_context_t* _alloc_macro_expansion(macro_t* macro)
 {
-	expansion_context_t* me = (expansion_context_t*)malloc(sizeof(expansion_context_t));
-	memset(me, 0, sizeof(expansion_context_t));
+	expansion_context_t* me = _pp()->free_expansions;
+	if (me)
+	{
+		_pp()->free_expansions = me->next;
+	}
+	else
+	{
+		me = (expansion_context_t*)mem_alloc(mc_macros, sizeof(expansion_context_t));
+		memset(me, 0, sizeof(expansion_context_t));
+		me->next_alloc = _pp()->all_expansions;
+		_pp()->all_expansions = me;
+	}
 	me->macro = macro;
-	me->params = params;
-	input_range_t* input = _begin_token_range_expansion(&macro->tokens);
-	input->macro_expansion = me;
-	me->next = _context->expansion_stack;
-	_context->expansion_stack = me;
-	return input;
+	me->arg_count = 0;
+	me->complete = false;
+	me->next = NULL;
+	return me;
 }
 
-static void _pop_macro_expansion(macro_t* macro)
+static void _free_macro_expansion(expansion_context_t* me)
 {
-	expansion_context_t* me = _context->expansion_stack;
-	assert(me && me->macro == macro);
-	_context->expansion_stack = me->next;
-	free(me);
+	//the arguments were only read through the expansion, their tokens can be reused
+	for (uint32_t i = 0; i < me->arg_count; i++)
+		tok_range_release(&me->args[i].tokens);
+	me->arg_count = 0;
+	me->next = _pp()->free_expansions;
+	_pp()->free_expansions = me;
 }
 
-static inline bool _is_expansion_at_end(input_range_t* ir)
+static uint32_t _begin_macro_expansion(expansion_context_t* me)
 {
-	return ir->current == ir->tokens->end;
+	input_range_t* input = _begin_token_range_expansion(&me->macro->tokens, false);
+	input->macro_expansion = me;
+	me->next = _pp()->expansion_stack;
+	_pp()->expansion_stack = me;
+	return input->id;
 }
 
-static bool _is_expansion_complete(input_range_t* expansion)
+static void _pop_macro_expansion(macro_t* macro)
 {
-	input_range_t* ir = _context->input_stack;
+	expansion_context_t* me = _pp()->expansion_stack;
+	assert(me && me->macro == macro);
+	_pp()->expansion_stack = me->next;
 
+	//the input range may outlive the expansion context
+	input_range_t* ir = _pp()->input_stack;
 	while (ir)
+	{
+		if (ir->macro_expansion == me)
+			ir->macro_expansion = NULL;
+		ir = ir->next;
+	}
+	_free_macro_expansion(me);
+}
+
+/*
+true once the input range with id, and any above it, have been read.
+Ids increase as ranges are pushed so reaching an older range means it has been popped
+*/
+static bool _is_expansion_complete(uint32_t id)
+{
+	input_range_t* ir = _pp()->input_stack;
+
+	while (ir && ir->id >= id)
 	{
 		if (!_is_expansion_at_end(ir)) //either expansion, or something before it is not complete
 			return false;
 
-		if (ir == expansion)
-			return _is_expansion_at_end(ir);
+		if (ir->id == id)
+			return true;
 
 		ir = ir->next;
 	}
@@ -202,7 +304,7 @@ static bool _is_expansion_complete(input_range_t* expansion)
 
 static bool _is_macro_expanding(macro_t* macro)
 {
-	expansion_context_t* me = _context->expansion_stack;
+	expansion_context_t* me = _pp()->expansion_stack;
 
 	while (me)
 	{
@@ -213,18 +315,94 @@ static bool _is_macro_expanding(macro_t* macro)
 	return false;
 }
 
+static inline hide_set_t* _hide_set(uint32_t set)
+{
+	return &_pp()->hide_sets.sets[set];
+}
+
+/*
+hide_sets.lookup is keyed on a copy of each set's hide_set_t, the sets array moves as it grows
+*/
+static size_t _hide_set_hash(void* key)
+{
+	hide_set_t* hs = (hide_set_t*)key;
+	return (size_t)hs->parent * 31 + hs->macro_id;
+}
+
+static bool _hide_set_comp(void* lhs, void* rhs)
+{
+	hide_set_t* l = (hide_set_t*)lhs;
+	hide_set_t* r = (hide_set_t*)rhs;
+	return l->parent == r->parent && l->macro_id == r->macro_id;
+}
+
+static void _hide_set_destroy_item(void* key, void* val)
+{
+	(void)val;
+	mem_free(key);
+}
+
+static uint32_t _hide_set_node(uint32_t parent, uint32_t macro_id)
+{
+	hide_set_t node = { macro_id, parent };
+	uint32_t set = (uint32_t)(size_t)ht_lookup(_pp()->hide_sets.lookup, &node);
+	if (set)
+		return set;
+
+	if (_pp()->hide_sets.count == _pp()->hide_sets.capacity)
+	{
+		_pp()->hide_sets.capacity *= 2;
+		_pp()->hide_sets.sets = (hide_set_t*)mem_realloc(_pp()->hide_sets.sets, mc_macros,
+			sizeof(hide_set_t) * _pp()->hide_sets.capacity);
+	}
+
+	set = _pp()->hide_sets.count++;
+	*_hide_set(set) = node;
+
+	hide_set_t* key = (hide_set_t*)mem_alloc(mc_macros, sizeof(hide_set_t));
+	*key = node;
+	ht_insert(_pp()->hide_sets.lookup, key, (void*)(size_t)set);
+	return set;
+}
+
+/*
+the set of set's macros and macro_id. Ids are kept in descending order so each set has a single representation
+*/
+static uint32_t _hide_set_add(uint32_t set, uint32_t macro_id)
+{
+	if (set == 0 || _hide_set(set)->macro_id < macro_id)
+		return _hide_set_node(set, macro_id);
+
+	uint32_t head = _hide_set(set)->macro_id;
+	if (head == macro_id)
+		return set;
+
+	return _hide_set_node(_hide_set_add(_hide_set(set)->parent, macro_id), head);
+}
+
+static bool _hide_set_contains(uint32_t set, uint32_t macro_id)
+{
+	while (set && _hide_set(set)->macro_id >= macro_id)
+	{
+		if (_hide_set(set)->macro_id == macro_id)
+			return true;
+		set = _hide_set(set)->parent;
+	}
+	return false;
+}
+
 static void _destroy_input_stack()
 {
-	input_range_t* ir = _context->input_stack;
+	input_range_t* ir = _pp()->input_stack;
 
 	while (ir)
 	{
 		assert(_is_expansion_at_end(ir));
 		input_range_t* next = ir->next;
-		free(ir);
+		_free_input_range(ir);
 		ir = next;
 	}
-	_context->input_stack = NULL;
+	_pp()->input_stack = NULL;
 }
 
 /*
@@ -247,11 +425,11 @@ typedef enum
 
 static void _update_defined_id_supression_state(token_t* tok)
 {
-	if (_context->define_id_supression_state == dss_normal)
+	if (_pp()->define_id_supression_state == dss_normal)
 	{
 		if (tok->kind == tok_pp_if || tok->kind == tok_pp_elif)
 		{
-			_context->define_id_supression_state = dss_in_cond;
+			_pp()->define_id_supression_state = dss_in_cond;
 			return;
 		}
 		return;
@@ -260,37 +438,37 @@ static void _update_defined_id_supression_state(token_t* tok)
 	if (tok->flags & TF_START_LINE)
 	{
 		//reset
-		_context->define_id_supression_state = dss_normal;
+		_pp()->define_id_supression_state = dss_normal;
 		return;
 	}
 
-	if (_context->define_id_supression_state == dss_in_cond)
+	if (_pp()->define_id_supression_state == dss_in_cond)
 	{
-		if (tok->kind == tok_identifier && strcmp(tok->data.str, "defined") == 0)
-			_context->define_id_supression_state = dss_saw_defined;
+		if (tok->kind == tok_identifier && tok->data.str == _pp()->names.defined)
+			_pp()->define_id_supression_state = dss_saw_defined;
 		return;
 	}
 	
-	if (_context->define_id_supression_state == dss_saw_defined)
+	if (_pp()->define_id_supression_state == dss_saw_defined)
 	{
 		if (tok->kind == tok_l_paren)
-			_context->define_id_supression_state = dss_saw_r_paren;
+			_pp()->define_id_supression_state = dss_saw_r_paren;
 		else
-			_context->define_id_supression_state = dss_in_cond;
+			_pp()->define_id_supression_state = dss_in_cond;
 		return;
 	}
 
-	if(_context->define_id_supression_state == dss_saw_r_paren)
-		_context->define_id_supression_state = dss_in_cond;
+	if(_pp()->define_id_supression_state == dss_saw_r_paren)
+		_pp()->define_id_supression_state = dss_in_cond;
 }
 
 static inline bool _supress_identifier_expansion(token_t* tok)
 {
-	if ((_context->define_id_supression_state == dss_saw_defined ||
-		_context->define_id_supression_state == dss_saw_r_paren) &&
+	if ((_pp()->define_id_supression_state == dss_saw_defined ||
+		_pp()->define_id_supression_state == dss_saw_r_paren) &&
 		tok->kind == tok_identifier)
 	{
-		_context->define_id_supression_state = dss_in_cond;
+		_pp()->define_id_supression_state = dss_in_cond;
 
 		return true;
 	}
@@ -301,18 +479,20 @@ static inline void _emit_token(token_t* tok)
 {
 	_update_defined_id_supression_state(tok);
 
-	token_range_t* range = _context->dest_stack->range;
+	token_range_t* range = _pp()->dest_stack->range;
 
-	if (_context->dest_stack->next_tok_flags != FLAGS_UNSET)
+	if (_pp()->dest_stack->next_tok_flags != FLAGS_UNSET)
 	{
-		tok->flags = _context->dest_stack->next_tok_flags;
-		_context->dest_stack->next_tok_flags = FLAGS_UNSET;
+		tok->flags = _pp()->dest_stack->next_tok_flags;
+		_pp()->dest_stack->next_tok_flags = FLAGS_UNSET;
 	}
 
-	if(_context->expansion_stack && _context->expansion_stack->macro)
+	if(_pp()->expansion_stack && _pp()->expansion_stack->macro)
 	{
-		size_t id = tok->id;
-		phs_insert(_context->expansion_stack->macro->hidden_toks, (void*)id);
+		uint32_t hide_set = _hide_set_add(tok->hide_set, _pp()->expansion_stack->macro->id);
+		if (hide_set > TOK_MAX_HIDE_SET)
+			diag_err(tok_loc(tok), ERR_UNSUPPORTED, "too many macro expansions");
+		tok->hide_set = hide_set;
 	}
 
 	tok->prev = tok->next = NULL;
@@ -331,7 +511,7 @@ static inline void _emit_token(token_t* tok)
 
 static inline void* _diag_expected(token_t* tok, tok_kind kind)
 {
-	diag_err(tok, ERR_SYNTAX, "syntax error: expected '%s' before '%s'",
+	diag_err(tok_loc(tok), ERR_SYNTAX, "syntax error: expected '%s' before '%s'",
 		tok_kind_spelling(kind), diag_tok_desc(tok));
 	return NULL;
 }
@@ -357,9 +537,12 @@ static token_t* _find_eol(token_t* from)
 	return tok;
 }
 
-static bool _process_token_range(token_range_t* range)
+/*
+process the tokens of range, which are taken rather than duplicated if owned is set
+*/
+static bool _process_token_range(token_range_t* range, bool owned)
 {
-	input_range_t* ir = _begin_token_range_expansion(range);
+	uint32_t ir = _begin_token_range_expansion(range, owned)->id;
 
 	while (!_is_expansion_complete(ir))
 	{
@@ -369,9 +552,46 @@ static bool _process_token_range(token_range_t* range)
 	return true;
 }
 
+/*
+lex sr, loaded from path if not NULL, as its tokens are needed and process them.
+If guard is not NULL it is set to X when the whole of sr is within #ifndef X / #endif
+*/
+static bool _process_source(source_range_t* sr, const char* path, const char** guard)
+{
+	lex_cursor_t* lexer = lex_begin(jcc_ctx(), sr, path);
+	input_range_t* ir = _begin_lexer_expansion(lexer, sr);
+	uint32_t id = ir->id;
+
+	if (guard)
+	{
+		*guard = NULL;
+		if (ir->current->kind == tok_pp_ifndef)
+		{
+			token_t* tok = _pop_next();
+			const char* name = ir->current->kind == tok_identifier ? ir->current->data.str : NULL;
+
+			bool single_group;
+			if (!_process_condition(tok, &single_group))
+				return false;
+
+			//nothing may follow the #endif
+			if (single_group && _is_expansion_at_end(ir) && !lex_failed(lexer))
+				*guard = name;
+		}
+	}
+
+	while (!_is_expansion_complete(id))
+	{
+		if (!_process_token(_pop_next()))
+			return false;
+	}
+	//the input range, and lexer, are popped with the next token
+	return !lex_failed(lexer);
+}
+
 static macro_t* _find_macro_def(token_t* ident)
 {
-	return (macro_t*)sht_lookup(_context->defs, ident->data.str);
+	return (macro_t*)iht_lookup(_pp()->defs, ident->data.str);
 }
 
 static inline bool _leadingspace_or_startline(token_t* tok)
@@ -384,26 +604,26 @@ static token_t* _is_standard_macro(token_t* tok)
 	if (tok->kind != tok_identifier)
 		return NULL;
 
-	if (strcmp(tok->data.str, "__FILE__") == 0)
+	if (tok->data.str == _pp()->names.file)
 	{
 		str_buff_t* sb = sb_create(128);
 		sb_append_ch(sb, '\"');
-		sb_append(sb, _context->input_stack->path);
+		sb_append(sb, _input_path(_pp()->input_stack));
 		sb_append_ch(sb, '\"');
 
 		return _lex_single_tok(sb);
 	}
-	else if (strcmp(tok->data.str, "__LINE__") == 0)
+	else if (tok->data.str == _pp()->names.line)
 	{
 		str_buff_t* sb = sb_create(128);
-		sb_append_int(sb, _context->input_stack->line_num, 10);
+		sb_append_int(sb, _input_line(_pp()->input_stack), 10);
 		return _lex_single_tok(sb);
 	}
-	else if (strcmp(tok->data.str, "__DATE__") == 0)
+	else if (tok->data.str == _pp()->names.date)
 	{
 
 	}
-	else if (strcmp(tok->data.str, "__TIME__") == 0)
+	else if (tok->data.str == _pp()->names.time)
 	{
 
 	}
@@ -412,20 +632,21 @@ static token_t* _is_standard_macro(token_t* tok)
 
 static bool _process_undef(token_t* tok)
 {
-	tok;
 	token_t* identifier = _pop_next();
 
 	if (!_expect_kind(identifier, tok_identifier))
 		return false;
 
-	char* name = identifier->data.str;
+	const char* name = identifier->data.str;
 
-	macro_t* macro = (macro_t*)sht_lookup(_context->defs, name);
+	macro_t* macro = (macro_t*)iht_lookup(_pp()->defs, name);
 	if (macro)
 	{
-		sht_remove(_context->defs, name);
-		free(macro);
+		iht_remove(_pp()->defs, name);
+		mem_free(macro);
 	}
+	tok_release(tok);
+	tok_release(identifier);
 	return true;
 }
 
@@ -436,6 +657,7 @@ static bool _process_fn_params(macro_t* macro)
 {
 	token_t* tok = _pop_next();
 	assert(tok->kind == tok_l_paren);
+	tok_release(tok);
 
 	//Process parameters
 	tok = _pop_next();
@@ -459,6 +681,7 @@ static bool _process_fn_params(macro_t* macro)
 		tok = _pop_next();
 		if (tok->kind != tok_comma)
 			break;
+		tok_release(tok);
 		tok = _pop_next();
 	}
 	param.end = _create_end_marker(param.end);
@@ -467,9 +690,9 @@ static bool _process_fn_params(macro_t* macro)
 	if (tok->kind != tok_r_paren)
 	{
 		_diag_expected(tok, tok_r_paren);
-		free(macro);
 		return false;
 	}
+	tok_release(tok);
 	return true;
 }
 
@@ -481,12 +704,15 @@ static bool _process_define(token_t* def)
 	if (!_expect_kind(identifier, tok_identifier))
 		return false;
 
-	macro_t* macro = (macro_t*)malloc(sizeof(macro_t));
+	//built on the stack so an error part way through has nothing to free
+	macro_t def_macro;
+	macro_t* macro = &def_macro;
 	memset(macro, 0, sizeof(macro_t));
 	macro->define = def;
 	macro->kind = macro_obj;
-	macro->hidden_toks = phs_create(64);
+	macro->id = ++_pp()->next_macro_id;
 	macro->name = identifier->data.str;
+	tok_release(identifier);
 
 	token_t* tok = _peek_next();
 
@@ -494,10 +720,7 @@ static bool _process_define(token_t* def)
 	{
 		macro->kind = macro_fn;
 		if (!_process_fn_params(macro))
-		{
-			free(macro);
 			return false;
-		}
 		tok = _peek_next();
 	}
 	else
@@ -506,8 +729,7 @@ static bool _process_define(token_t* def)
 		//There shall be white-space between the identifier and the replacement list in the definition of an object-like macro.
 		if (!_leadingspace_or_startline(tok))
 		{
-			diag_err(def, ERR_SYNTAX, "expected white space after macro name '%s'", macro->name);
-			free(macro);
+			diag_err(tok_loc(def), ERR_SYNTAX, "expected white space after macro name '%s'", macro->name);
 			return false;
 		}
 	}
@@ -532,19 +754,19 @@ static bool _process_define(token_t* def)
 		*/
 		if (macro->tokens.start->kind == tok_hashhash)
 		{
-			diag_err(macro->tokens.start, ERR_SYNTAX,
+			diag_err(tok_loc(macro->tokens.start), ERR_SYNTAX,
 				"macro replacement list may not start with '##'");
 			return false;
 		}
 		if(macro->tokens.end->prev->kind == tok_hashhash)
 		{
-			diag_err(macro->tokens.end->prev, ERR_SYNTAX,
+			diag_err(tok_loc(macro->tokens.end->prev), ERR_SYNTAX,
 				"macro replacement list may not end with '##'");
 			return false;
 		}
 	}
 
-	macro_t* existing = (macro_t*)sht_lookup(_context->defs, macro->name);
+	macro_t* existing = (macro_t*)iht_lookup(_pp()->defs, macro->name);
 	if (existing)
 	{
 		/*
@@ -553,33 +775,33 @@ static bool _process_define(token_t* def)
 			definition and the two replacement lists are identical.
 		*/
 		if (existing->kind == macro_obj && tok_range_equals(&existing->tokens, &macro->tokens))
-		{	
-			free(macro);
 			return true;
-		}
 
-		file_pos_t exist_fp = src_get_pos_info(existing->define->loc);
+		file_pos_t exist_fp = src_get_loc_info(jcc_ctx(), existing->define->loc);
 
-		diag_err(def, ERR_SYNTAX, "redefinition of macro '%s'. Previously defined at: %s(Ln: %d Ch: %d)", macro->name,
+		diag_err(tok_loc(def), ERR_SYNTAX, "redefinition of macro '%s'. Previously defined at: %s(Ln: %d Ch: %d)", macro->name,
 			exist_fp.path ? exist_fp.path : "unknown",
 			exist_fp.line, exist_fp.col);
-		free(macro);
 		return false;
 	}
 
-	sht_insert(_context->defs, macro->name, macro);
+	macro = (macro_t*)mem_alloc(mc_macros, sizeof(macro_t));
+	*macro = def_macro;
+	iht_insert(_pp()->defs, macro->name, macro);
 	return true;
 }
 
-static bool _process_pragma(token_t* tok)
+static bool _process_pragma(token_t* pragma)
 {
-	tok = _pop_next();
+	token_t* tok = _pop_next();
 
-	if (tok->kind == tok_identifier && strcmp(tok->data.str, "once") == 0)
+	if (tok->kind == tok_identifier && tok->data.str == _pp()->names.once)
 	{
-		const char* path = src_get_pos_info(tok->loc).path;
+		const char* path = src_get_loc_info(jcc_ctx(), tok->loc).path;
 		assert(path);
-		sht_insert(_context->praga_once_paths, path, (void*)1);
+		sht_insert(_pp()->praga_once_paths, path, (void*)1);
+		tok_release(pragma);
+		tok_release(tok);
 		return true;
 	}
 	//todo warn
@@ -594,12 +816,10 @@ is
 tok_lesser, tok_identifier (proj), tok_slash, tok_identifier (include)..., tok_fullstop, tok_identifier (h), tok_greater
 
 note: '\' will be included in string literals
-we are not very strict about the path format here, if it looks resonable we return it and let the file loading code report any error
+we are not very strict about the path format here, if it looks resonable we append it to path_buff and let the file loading code report any error
 */
-static str_buff_t* _make_system_inc_path(token_range_t* range)
+static bool _make_system_inc_path(token_range_t* range, str_buff_t* path_buff)
 {
-	str_buff_t* path_buff = sb_create(128);
-
 	token_t* tok = range->start;
 
 	assert(tok->kind == tok_lesser);
@@ -628,9 +848,8 @@ static str_buff_t* _make_system_inc_path(token_range_t* range)
 		{
 			if (saw_fullstop && tok->kind != tok_identifier)
 			{
-				diag_err(range->start, ERR_SYNTAX, "syntax error: invalid path in #include");
-				sb_destroy(path_buff);
-				return NULL;
+				diag_err(tok_loc(range->start), ERR_SYNTAX, "syntax error: invalid path in #include");
+				return false;
 			}
 			sb_append_ch(path_buff, '.');
 			saw_fullstop = true;
@@ -644,39 +863,38 @@ static str_buff_t* _make_system_inc_path(token_range_t* range)
 
 	if (tok->kind != tok_greater || path_buff->len == 0)
 	{
-		diag_err(range->start, ERR_SYNTAX, "syntax error: invalid path in #include");
-		sb_destroy(path_buff);
-		return NULL;
+		diag_err(tok_loc(range->start), ERR_SYNTAX, "syntax error: invalid path in #include");
+		return false;
 	}
-
-	return path_buff;
+	return true;
 }
 
 static bool _process_include(token_t* tok)
 {
 	token_t* source = tok;
 	tok = _pop_next();
-	token_range_t* range = tok_range_create(tok, tok);
-	*range = _extract_till_eol(tok);
+	token_range_t line = _extract_till_eol(tok);
+	token_range_t* range = &line;
+	token_range_t expanded = { NULL, NULL };
 
 	if (tok->kind == tok_identifier)
 	{
 		//#define INC <blah.h>
 		//#include INC
-		token_range_t* expanded = tok_range_create(NULL, NULL);
+		_pp()->define_id_supression_state = dss_in_cond;
 
-		_context->define_id_supression_state = dss_in_cond;
-
-		_push_dest(expanded);
-		if (!_process_token_range(range))
+		_push_dest(&expanded);
+		if (!_process_token_range(range, false))
 			return false;
 		_pop_dest();
-		expanded->end = _create_end_marker(expanded->end);
+		expanded.end = _create_end_marker(expanded.end);
 
-		range = expanded;
+		range = &expanded;
 	}
 
-	str_buff_t* path_buff = sb_create(128);
+	//the path is finished with before any nested #include is processed so the buffer is shared
+	str_buff_t* path_buff = _pp()->inc_path;
+	sb_clear(path_buff);
 	include_kind inc_kind = include_local;
 	if (range->start->kind == tok_string_literal)
 	{
@@ -686,9 +904,8 @@ static bool _process_include(token_t* tok)
 		sb_append(path_buff, range->start->data.str);
 		if(range->start->next != range->end)
 		{
-			diag_err(tok, ERR_SYNTAX,
+			diag_err(tok_loc(tok), ERR_SYNTAX,
 				"expected newline after #include directive");
-			sb_destroy(path_buff);
 			return false;
 		}
 	}
@@ -696,42 +913,67 @@ static bool _process_include(token_t* tok)
 	{
 		//#include <blah.h>
 		inc_kind = include_system;
-		path_buff = _make_system_inc_path(range);
+		if (!_make_system_inc_path(range, path_buff))
+			return false;
 	}
 	
 	if(path_buff->len == 0)
 	{
-		diag_err(tok, ERR_SYNTAX, "expected '<path>' or '\"path\"' after #include directive");
-		sb_destroy(path_buff);
+		diag_err(tok_loc(tok), ERR_SYNTAX, "expected '<path>' or '\"path\"' after #include directive");
 		return false;
 	}
 
-	const char* cur_path = path_dirname(_context->input_stack->path);
-	source_range_t* sr = src_load_header(cur_path, sb_str(path_buff), inc_kind);
-	free((void*)cur_path);
-	if (!src_is_valid_range(sr))
+	const char* cur_path = path_dirname(_input_path(_pp()->input_stack));
+
+	//the same directive in the same directory finds the same file
+	str_buff_t* inc_key = sb_create(128);
+	sb_append(inc_key, cur_path);
+	sb_append_ch(inc_key, inc_kind == include_local ? '"' : '<');
+	sb_append(inc_key, sb_str(path_buff));
+
+	//a file with an include guard is skipped without loading it while the guard is defined
+	const char* guard = (const char*)sht_lookup(_pp()->include_guards, sb_str(inc_key));
+	bool skip = guard && iht_lookup(_pp()->defs, guard);
+
+	source_range_t* sr = skip ? NULL : src_load_header(jcc_ctx(), cur_path, sb_str(path_buff), inc_kind);
+	mem_free((void*)cur_path);
+	if (!skip && !src_is_valid_range(sr))
 	{
-		file_pos_t src = src_get_pos_info(source->loc);
+		file_pos_t src = src_get_loc_info(jcc_ctx(), source->loc);
 
-		diag_err(tok, ERR_UNKNOWN_SRC_FILE, "unknown file '%s' included from '%s'", sb_str(path_buff), src.file_name);
-		sb_destroy(path_buff);
+		sb_destroy(inc_key);
+		diag_err(tok_loc(tok), ERR_UNKNOWN_SRC_FILE, "unknown file '%s' included from '%s'", sb_str(path_buff), src.file_name);
 		return false;
 	}
 
-	sb_destroy(path_buff);
+	//done with the directive's tokens
+	tok_range_release(&expanded);
+	tok_range_release(&line);
+	tok_release(source);
+
+	if (skip)
+	{
+		sb_destroy(inc_key);
+		return true;
+	}
 
 	//check if previously #pragma once'd
-	const char* inc_path = src_get_pos_info(sr->ptr).path;
+	const char* inc_path = src_get_pos_info(jcc_ctx(), sr->ptr).path;
 	assert(inc_path);
-	if (sht_lookup(_context->praga_once_paths, inc_path))
+	if (sht_lookup(_pp()->praga_once_paths, inc_path))
+	{
+		sb_destroy(inc_key);
 		return true;
+	}
 
-	//lex the file
-	token_range_t toks = lex_source(sr);
-	if (!toks.start)
-		return false;
-
-	return _process_token_range(&toks);
+	//lex and process the file
+	trace_begin(jcc_ctx(), "Include", inc_path);
+	bool result = _process_source(sr, inc_path, &guard);
+	if (result && guard)
+		sht_insert(_pp()->include_guards, sb_str(inc_key), (void*)guard);
+	sb_destroy(inc_key);
+	trace_end(jcc_ctx());
+	return result;
 }
 
 /*
@@ -744,42 +986,48 @@ static bool _eval_pp_expression(token_t* start, bool* result)
 	token_range_t expanded = { NULL, NULL };
 	token_range_t range = _extract_till_eol(start);
 
-	_context->define_id_supression_state = dss_in_cond;
+	_pp()->define_id_supression_state = dss_in_cond;
 
 	_push_dest(&expanded);
-	if (!_process_token_range(&range))
+	if (!_process_token_range(&range, false))
 		return false;
 	_pop_dest();
 	expanded.end = _create_end_marker(expanded.end);
 
 	uint32_t val;
-	if (!pre_proc_eval_expr(_context, expanded, &val))
+	if (!pre_proc_eval_expr(_pp(), expanded, &val))
 	{
-		diag_err(range.start, ERR_SYNTAX, "cannot parse constant expression %s",
+		diag_err(tok_loc(range.start), ERR_SYNTAX, "cannot parse constant expression %s",
 			tok_kind_spelling(tok_identifier));
 		return false;
 	}
 	*result = val != 0;
+
+	tok_range_release(&expanded);
+	tok_range_release(&range);
 	return true;
 }
 
 /*
 Process a conditional pp expression
 tok points at one of: tok_pp_if, tok_pp_ifdef, tok_pp_ifndef
+single_group, when not NULL, is set if there was no #elif or #else
 */
-static bool _process_condition(token_t* tok)
+static bool _process_condition(token_t* directive, bool* single_group)
 {
+	token_t* tok = directive;
 	bool inc_group = false;
 	if (tok->kind == tok_pp_ifdef)
 	{
 		tok = _pop_next();
 		if (tok->kind != tok_identifier)
 		{
-			diag_err(tok, ERR_SYNTAX, "expected %s after #ifdef",
+			diag_err(tok_loc(tok), ERR_SYNTAX, "expected %s after #ifdef",
 				tok_kind_spelling(tok_identifier));
 			return false;
 		}
 		inc_group = _find_macro_def(tok) != NULL;
+		tok_release(tok);
 		assert(_peek_next()->flags & TF_START_LINE);
 	}
 	else if (tok->kind == tok_pp_ifndef)
@@ -787,11 +1035,12 @@ static bool _process_condition(token_t* tok)
 		tok = _pop_next();
 		if (tok->kind != tok_identifier)
 		{
-			diag_err(tok, ERR_SYNTAX, "expected %s after #ifndef",
+			diag_err(tok_loc(tok), ERR_SYNTAX, "expected %s after #ifndef",
 				tok_kind_spelling(tok_identifier));
 			return false;
 		}
 		inc_group = _find_macro_def(tok) == NULL;
+		tok_release(tok);
 		assert(_peek_next()->flags & TF_START_LINE);
 	}
 	else if (tok->kind == tok_pp_if)
@@ -802,32 +1051,45 @@ static bool _process_condition(token_t* tok)
 	}
 	else
 	{
-		diag_err(tok, ERR_SYNTAX, "unexpected token looking for pp conditional");
+		diag_err(tok_loc(tok), ERR_SYNTAX, "unexpected token looking for pp conditional");
 		return false;
 	}
 
 	//have we hit a true case yet?
 	bool any_true = inc_group;
+	if (single_group)
+		*single_group = true;
 
 	while (_peek_next()->kind != tok_pp_endif)
 	{
 		tok = _pop_next();
 
+		if (tok->kind == tok_eof)
+		{
+			diag_err(tok_loc(directive), ERR_SYNTAX, "unterminated conditional directive");
+			return false;
+		}
+
 		if (inc_group)
 			any_true = true;
 
+		if (single_group && (tok->kind == tok_pp_elif || tok->kind == tok_pp_else))
+			*single_group = false;
+
 		if (tok->kind == tok_pp_elif)
 		{
+			tok_release(tok);
 			inc_group = !any_true;
 			if (!_eval_pp_expression(_pop_next(), &inc_group))
 				return false;
 		}
 		else if (tok->kind == tok_pp_else)
 		{
+			tok_release(tok);
 			inc_group = !any_true;
 			if (_peek_next()->kind == tok_if)
 			{
-				tok = _pop_next();
+				tok_release(_pop_next());
 				if (!_eval_pp_expression(_pop_next(), &inc_group))
 					return false;
 			}
@@ -837,8 +1099,14 @@ static bool _process_condition(token_t* tok)
 			if (!_process_token(tok))
 				return false;
 		}
+		else
+		{
+			//skipped group
+			tok_release(tok);
+		}
 	}
-	_pop_next();
+	tok_release(_pop_next());
+	tok_release(directive);
 	return true;
 }
 
@@ -867,7 +1135,7 @@ static token_t* _stringize_range(token_range_t* range)
 		{
 			str_buff_t* sl_buff = sb_create(128);
 
-			tok_spelling_extract(tok->loc, tok->len, sl_buff);
+			tok_spelling_extract(tok_spelling(tok), tok->len, sl_buff);
 
 			char* c = sl_buff->buff;
 
@@ -884,7 +1152,7 @@ static token_t* _stringize_range(token_range_t* range)
 			break;
 		}
 		default:
-			tok_spelling_extract(tok->loc, tok->len, sb);
+			tok_spelling_extract(tok_spelling(tok), tok->len, sb);
 			break;
 		}
 
@@ -895,52 +1163,66 @@ static token_t* _stringize_range(token_range_t* range)
 	return _lex_single_tok(sb);
 }
 
-static token_range_t* _expand_param_range(token_range_t* range)
+/*
+macro expand the tokens of an argument into result, which takes new tokens
+*/
+static bool _expand_param_range(token_range_t* range, token_range_t* result)
 {
 	if (tok_range_empty(range))
-		return range;
+	{
+		*result = *range;
+		return true;
+	}
 
-	token_range_t* result = tok_range_create(NULL, NULL);
+	result->start = result->end = NULL;
 
 	//save and reset the expansion stack to prevent looking past the token range
-	input_range_t* prev_me_stack = _context->input_stack;
-	_context->input_stack = NULL;
-	expansion_context_t* ec = _context->expansion_stack;
-	_context->expansion_stack = NULL;
+	input_range_t* prev_me_stack = _pp()->input_stack;
+	_pp()->input_stack = NULL;
+	expansion_context_t* ec = _pp()->expansion_stack;
+	_pp()->expansion_stack = NULL;
 
 	//setup the unexpanded param tokens for expansion
-	input_range_t* me = _begin_token_range_expansion(range);
+	uint32_t me = _begin_token_range_expansion(range, false)->id;
 
 	_push_dest(result);
 
 	while (!_is_expansion_complete(me))
 	{
-		if (!_process_token(tok_duplicate(_pop_next())))
-			return NULL;
+		if (!_process_token(_pop_next()))
+			return false;
 	}
 
-	_context->expansion_stack = ec;
+	_pp()->expansion_stack = ec;
 
 	//restore the expansion stack
 	_destroy_input_stack();
-	_context->input_stack = prev_me_stack;
+	_pp()->input_stack = prev_me_stack;
 
 	_pop_dest();
 
 	result->end = _create_end_marker(result->end);
-	return result;
+	return true;
 }
 
+/*
+the argument for the parameter name of the innermost function like macro being expanded
+*/
 static token_range_t* _lookup_fn_param(const char* name)
 {
-	expansion_context_t* expansion = _context->expansion_stack;
+	expansion_context_t* expansion = _pp()->expansion_stack;
 
 	while (expansion)
 	{
-		if (expansion->params)
+		if (expansion->macro->kind == macro_fn)
 		{
-			token_range_t* range = (token_range_t*)sht_lookup(expansion->params, name);
-			return range;
+			//macros have few parameters, a scan of the interned names beats hashing
+			for (uint32_t i = 0; i < expansion->arg_count; i++)
+			{
+				if (expansion->args[i].name == name)
+					return &expansion->args[i].tokens;
+			}
+			return NULL;
 		}
 		expansion = expansion->next;
 	}
@@ -948,30 +1230,57 @@ static token_range_t* _lookup_fn_param(const char* name)
 }
 
 /*
-Returns a sht of param name -> token_range_t*
+add an empty argument to me for each parameter of its macro.
+An argument beyond the last parameter is held by the slot of the parameter list's end marker, which has no name
 */
-static hash_table_t* _process_fn_call_params(macro_t* macro)
+static void _init_fn_call_args(expansion_context_t* me)
 {
+	for (token_t* param = me->macro->fn_params; param; param = param->next)
+	{
+		if (me->arg_count == me->arg_capacity)
+		{
+			me->arg_capacity = me->arg_capacity ? me->arg_capacity * 2 : 8;
+			me->args = (macro_arg_t*)mem_realloc(me->args, mc_macros, sizeof(macro_arg_t) * me->arg_capacity);
+		}
+		macro_arg_t* arg = &me->args[me->arg_count++];
+		arg->name = param->kind == tok_pp_end_marker ? NULL : param->data.str;
+		arg->tokens.start = arg->tokens.end = NULL;
+	}
+}
+
+/*
+Collect the arguments of an invocation of me's macro
+*/
+static bool _process_fn_call_params(expansion_context_t* me)
+{
+	macro_t* macro = me->macro;
 	token_t* tok = _pop_next();
 	if (!_expect_kind(tok, tok_l_paren))
 		return false;
+	tok_release(tok);
 	
 	tok = _pop_next();
 
-	hash_table_t* params = sht_create(8);
+	_init_fn_call_args(me);
 
-	//process the parameters and build a table of param name to token range
-	token_t* param = macro->fn_params;
+	//process the arguments into the slot of each param
+	uint32_t param = 0;
 	while (tok->kind != tok_r_paren)
 	{
-		if (!param)
+		if (param == me->arg_count)
 			return false; //todo error
 
-		token_range_t* range = tok_range_create(NULL, NULL);
+		token_range_t* range = &me->args[param].tokens;
 
 		int paren_count = 0;
 		while (!((tok->kind == tok_comma || tok->kind == tok_r_paren) && paren_count == 0))
 		{
+			if (tok->kind == tok_eof)
+			{
+				diag_err(tok_loc(tok), ERR_SYNTAX, "unterminated argument list invoking macro '%s'", macro->name);
+				return NULL;
+			}
+
 			if (tok->kind == tok_l_paren)
 				paren_count++;
 			if (tok->kind == tok_r_paren)
@@ -987,8 +1296,11 @@ static hash_table_t* _process_fn_call_params(macro_t* macro)
 				token_range_t* p_range = _lookup_fn_param(tok->data.str);
 				if (p_range)
 				{
-					p_range = _expand_param_range(p_range);
-					tok_range_append(range, p_range);
+					token_range_t expanded;
+					if (!_expand_param_range(p_range, &expanded))
+						return false;
+					tok_range_append(range, &expanded);
+					tok_release(tok);
 					tok = _pop_next();
 					continue;
 				}
@@ -1007,37 +1319,25 @@ static hash_table_t* _process_fn_call_params(macro_t* macro)
 			range->end = _create_end_marker(range->end);
 		}
 
-		sht_insert(params, param->data.str, range);
 		if (tok->kind == tok_r_paren)
 		{
 			break;
 		}
-		param = param->next;
+		param++;
+		tok_release(tok);
 		tok = _pop_next();
 	}
+	tok_release(tok);
 
-	param = macro->fn_params;
-	while (param && param->kind != tok_pp_end_marker)
-	{
-		if (!sht_lookup(params, param->data.str))
-		{
-			//add empty tok range for missing parameter
-			token_range_t* range = tok_range_create(NULL, NULL);
-
-			sht_insert(params, param->data.str, range);
-		}
-		param = param->next;
-	}
-
-	return params;
+	//parameters without an argument keep their empty range
+	return true;
 }
 
 static bool _should_expand_macro(token_t* identifier, macro_t* macro)
 {
 	if (_is_macro_expanding(macro))
 		return false;
-	size_t id = identifier->id;
-	return !ht_contains(macro->hidden_toks, (void*)id);
+	return !_hide_set_contains(identifier->hide_set, macro->id);
 }
 
 static bool _process_arg_substitution(token_t* identifier, token_range_t* param)
@@ -1046,21 +1346,35 @@ static bool _process_arg_substitution(token_t* identifier, token_range_t* param)
 
 	if (tok_range_empty(param))
 	{
-		_context->dest_stack->next_tok_flags = FLAGS_UNSET;
+		_pp()->dest_stack->next_tok_flags = FLAGS_UNSET;
 		return true;
 	}
 
-	token_range_t* range = _expand_param_range(param);
+	token_range_t range;
+	if (!_expand_param_range(param, &range))
+		return false;
 
-	return _process_token_range(range);
+	//the argument expanded to nothing
+	if (!range.start)
+	{
+		_pp()->dest_stack->next_tok_flags = FLAGS_UNSET;
+		return true;
+	}
+
+	//the expansion is only used here so its tokens are emitted rather than copied
+	return _process_token_range(&range, true);
 }
 
-static bool _process_replacement_list(token_t* replaced, macro_t* macro, hash_table_t* params)
+static bool _process_replacement_list(token_t* replaced, expansion_context_t* me)
 {
+	macro_t* macro = me->macro;
 	if (tok_range_empty(&macro->tokens))
+	{
+		_free_macro_expansion(me);
 		return true;
+	}
 
-	input_range_t* ir = _begin_macro_expansion(macro, params);
+	uint32_t ir = _begin_macro_expansion(me);
 
 	_set_next_tok_flags(replaced->flags);
 
@@ -1086,6 +1400,7 @@ static bool _process_identifier(token_t* identifier)
 	token_t* built_in = _is_standard_macro(identifier);
 	if (built_in)
 	{
+		tok_release(identifier);
 		_emit_token(built_in);
 		return true;
 	}
@@ -1094,25 +1409,33 @@ static bool _process_identifier(token_t* identifier)
 	token_range_t* p_range = _lookup_fn_param(identifier->data.str);
 	if (p_range)
 	{
-		return _process_arg_substitution(identifier, p_range);
+		//replaced by the argument
+		bool result = _process_arg_substitution(identifier, p_range);
+		tok_release(identifier);
+		return result;
 	}
 
 	macro_t* macro = _find_macro_def(identifier);
 	if (macro && _should_expand_macro(identifier, macro))
 	{
-		if (macro->kind == macro_obj)
-		{
-			return _process_replacement_list(identifier, macro, NULL);
-		}
 		//identifier maps to a function like macro but we only invoke it if it looks like a call
-		else if (_peek_next()->kind == tok_l_paren)
+		if (macro->kind == macro_fn && _peek_next()->kind != tok_l_paren)
 		{
-			hash_table_t* params = _process_fn_call_params(macro);
-			if (!params)
-				return false;
+			_emit_token(identifier);
+			return true;
+		}
 
-			return _process_replacement_list(identifier, macro, params);
+		expansion_context_t* me = _alloc_macro_expansion(macro);
+		if (macro->kind == macro_fn && !_process_fn_call_params(me))
+		{
+			_free_macro_expansion(me);
+			return false;
 		}
+
+		//replaced by the macro's expansion
+		bool result = _process_replacement_list(identifier, me);
+		tok_release(identifier);
+		return result;
 	}
 	_emit_token(identifier);
 	return true;
@@ -1131,6 +1454,8 @@ static bool _process_hash_op(token_t* hash)
 
 	token_t* tok = _stringize_range(p_range);
 	_set_next_tok_flags(hash->flags);
+	tok_release(hash);
+	tok_release(identifier);
 
 	return _process_token(tok);
 }
@@ -1149,8 +1474,8 @@ static token_t* _paste_tokens(token_t* lhs, token_t* rhs)
 
 	str_buff_t* sb = sb_create(64);
 
-	tok_spelling_extract(lhs->loc, lhs->len, sb);
-	tok_spelling_extract(rhs->loc, rhs->len, sb);
+	tok_spelling_extract(tok_spelling(lhs), lhs->len, sb);
+	tok_spelling_extract(tok_spelling(rhs), rhs->len, sb);
 
 	token_t* tok = _lex_single_tok(sb);
 
@@ -1191,9 +1516,10 @@ static bool _process_hashhash(token_t* first)
 				//first arg is a macro param, output all but the final token
 				p_range->end = p_range->end->prev;
 				if (!tok_range_empty(p_range))
-					if (!_process_token_range(p_range))
+					if (!_process_token_range(p_range, false))
 						return false;
-				first = p_range->end;
+				//the argument is kept for other uses of the param
+				first = tok_duplicate(p_range->end);
 			}
 		}
 	}
@@ -1211,7 +1537,7 @@ static bool _process_hashhash(token_t* first)
 			{
 				//second arg is a macro param, use the first token in the pasting
 
-				second = p_range->start;
+				second = tok_duplicate(p_range->start);
 				p_range->start = p_range->start->next;
 
 				token_t* result = _paste_tokens(first, second);
@@ -1219,7 +1545,7 @@ static bool _process_hashhash(token_t* first)
 					return false;
 
 				if (!tok_range_empty(p_range))
-					if (!_process_token_range(p_range))
+					if (!_process_token_range(p_range, false))
 						return false;
 				first = p_range->end;
 				return true;
@@ -1242,7 +1568,7 @@ static bool _process_hashhash(token_t* first)
 static bool _process_token(token_t* tok)
 {
 	//Check for ## operator if we are processing a macro's replacement list
-	if (_context->expansion_stack && _peek_next()->kind == tok_hashhash)
+	if (_pp()->expansion_stack && _peek_next()->kind == tok_hashhash)
 	{
 		return _process_hashhash(tok);
 	}
@@ -1260,11 +1586,12 @@ static bool _process_token(token_t* tok)
 	case tok_pp_if:
 	case tok_pp_ifdef:
 	case tok_pp_ifndef:
-		return _process_condition(tok);
+		return _process_condition(tok, NULL);
 	case tok_pp_undef:
 		return _process_undef(tok);
 	case tok_pp_null:
 		//consume
+		tok_release(tok);
 		return true;
 	case tok_identifier:
 		return _process_identifier(tok);
@@ -1277,30 +1604,18 @@ static bool _process_token(token_t* tok)
 
 static bool _load_built_in_defs()
 {
-	source_range_t* sr = (source_range_t*)malloc(sizeof(source_range_t));
-	memset(sr, 0, sizeof(source_range_t));
-	sr->ptr = pp_built_in_defs();
-	sr->end = sr->ptr + strlen(sr->ptr);
+	source_range_t sr;
+	sr.ptr = pp_built_in_defs();
+	sr.end = sr.ptr + strlen(sr.ptr);
 
-	if (!src_is_valid_range(sr))
-	{
-		free(sr);
+	if (!src_is_valid_range(&sr))
 		return false;
-	}
 
-	//lex the file
-	token_range_t toks = lex_source(sr);
-	if (!toks.start)
-		return false;
-
-	return _process_token_range(&toks);
+	return _process_source(&sr, NULL, NULL);
 }
 
-token_range_t pre_proc_file(const char* src_dir, token_range_t* range)
+static token_range_t _pre_proc()
 {
-	src_dir;
-	_begin_token_range_expansion(range);
-
 	token_range_t result = { NULL, NULL };
 	
 	if (!_load_built_in_defs())
@@ -1314,23 +1629,112 @@ token_range_t pre_proc_file(const char* src_dir, token_range_t* range)
 		tok = _pop_next();
 	}
 	_emit_token(tok);
-	return _context->result;
+	return _pp()->result;
 }
 
-void pre_proc_init()
+token_range_t pre_proc_file(jcc_context_t* ctx, const char* src_dir, token_range_t* range)
 {
-	_context = (pp_context_t*)malloc(sizeof(pp_context_t));
-	memset(_context, 0, sizeof(pp_context_t));
-	_context->defs = sht_create(128);
-	_context->praga_once_paths = sht_create(128);
+	src_dir;
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_macros);
+	_begin_token_range_expansion(range, true);
+
+	return _pre_proc();
+}
 
-	_push_dest(&_context->result);
+token_range_t pre_proc_source(jcc_context_t* ctx, const char* src_dir, source_range_t* sr)
+{
+	src_dir;
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_macros);
+	lex_cursor_t* lexer = lex_begin(ctx, sr, NULL);
+	_begin_lexer_expansion(lexer, sr);
+
+	token_range_t result = _pre_proc();
+	if (lex_failed(lexer))
+		result.start = result.end = NULL;
+	return result;
 }
 
-void pre_proc_deinit()
+void pre_proc_init(jcc_context_t* ctx)
 {
-	ht_destroy(_context->defs);
-	ht_destroy(_context->praga_once_paths);
-	free(_context);
-	_context = NULL;
+	pre_proc_deinit(ctx);
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_macros);
+
+	pp_context_t* pp = (pp_context_t*)mem_alloc(mc_macros, sizeof(pp_context_t));
+	memset(pp, 0, sizeof(pp_context_t));
+	pp->defs = iht_create(128);
+	pp->praga_once_paths = sht_create(128);
+	pp->include_guards = sht_create(128);
+	pp->names.defined = tok_intern("defined", 7);
+	pp->names.once = tok_intern("once", 4);
+	pp->names.file = tok_intern("__FILE__", 8);
+	pp->names.line = tok_intern("__LINE__", 8);
+	pp->names.date = tok_intern("__DATE__", 8);
+	pp->names.time = tok_intern("__TIME__", 8);
+	pp->hide_sets.capacity = 64;
+	pp->hide_sets.sets = (hide_set_t*)mem_alloc(mc_macros, sizeof(hide_set_t) * pp->hide_sets.capacity);
+	memset(&pp->hide_sets.sets[0], 0, sizeof(hide_set_t));
+	pp->hide_sets.count = 1; //the empty set
+	pp->hide_sets.lookup = ht_create(64, &_hide_set_hash, &_hide_set_comp, &_hide_set_destroy_item);
+	pp->inc_path = sb_create(128);
+	ctx->pp = pp;
+
+	_push_dest(&pp->result);
+}
+
+void pre_proc_deinit(jcc_context_t* ctx)
+{
+	pp_context_t* pp = ctx->pp;
+	if (!pp)
+		return;
+
+	input_range_t* ir = pp->input_stack;
+	while (ir)
+	{
+		input_range_t* next = ir->next;
+		if (ir->lexer)
+			lex_end(ir->lexer);
+		mem_free(ir);
+		ir = next;
+	}
+	ir = pp->free_inputs;
+	while (ir)
+	{
+		input_range_t* next = ir->next;
+		mem_free(ir);
+		ir = next;
+	}
+	//including any still expanding, or collecting arguments, when an error ended the preprocessor
+	expansion_context_t* me = pp->all_expansions;
+	while (me)
+	{
+		expansion_context_t* next = me->next_alloc;
+		mem_free(me->args);
+		mem_free(me);
+		me = next;
+	}
+	while (pp->dest_stack)
+	{
+		dest_range_t* next = pp->dest_stack->next;
+		mem_free(pp->dest_stack);
+		pp->dest_stack = next;
+	}
+
+	//the macros' tokens are released with the context's token arena
+	ht_iterator_t it = ht_begin(pp->defs);
+	while (!ht_end(pp->defs, &it))
+	{
+		mem_free(it.node->val);
+		ht_next(pp->defs, &it);
+	}
+	ht_destroy(pp->defs);
+	ht_destroy(pp->praga_once_paths);
+	ht_destroy(pp->include_guards);
+	ht_destroy(pp->hide_sets.lookup);
+	mem_free(pp->hide_sets.sets);
+	sb_destroy(pp->inc_path);
+	mem_free(pp);
+	ctx->pp = NULL;
 }
\ No newline at end of file
@@ -49,7 +49,7 @@ static inline bool _expect_kind(token_t* tok, tok_kind kind)
 {
 	if (tok->kind != kind)
 	{
-		diag_err(tok, ERR_SYNTAX, "syntax error: expected '%s' before '%s'",
+		diag_err(tok_loc(tok), ERR_SYNTAX, "syntax error: expected '%s' before '%s'",
 			tok_kind_spelling(kind), diag_tok_desc(tok));
 		return false;
 	}
@@ -174,7 +174,7 @@ static token_t* _eval_sub_expr(token_t* tok,
 		if (int_val_required_width(&result->val) > 32)
 		{
 			//overflow
-			diag_err(tok, ERR_VALUE_OVERFLOW, "expression overflowed");
+			diag_err(tok_loc(tok), ERR_VALUE_OVERFLOW, "expression overflowed");
 			return NULL;
 		}
 	}
@@ -190,7 +190,7 @@ static token_t* _eval_defined(token_t* tok, const_expr_result_t* result, pp_cont
 
 	if (!_expect_kind(tok, tok_identifier)) return NULL;
 
-	result->val = sht_lookup(pp->defs, tok->data.str) ? int_val_one() : int_val_zero();
+	result->val = iht_lookup(pp->defs, tok->data.str) ? int_val_one() : int_val_zero();
 	tok = tok->next;
 	if (paren)
 	{
@@ -207,17 +207,17 @@ static token_t* _eval_value(token_t* tok, const_expr_result_t* result, pp_contex
 	case tok_identifier:
 	{
 		//handle defined X, defined (X)
-		char* name = tok->data.str;
+		const char* name = tok->data.str;
 		
-		if (strcmp(name, "defined") == 0)
+		if (name == pp->names.defined)
 			return _eval_defined(tok->next, result, pp);
 
-		diag_err(tok, ERR_SYNTAX, "unexpected identifier: '%s' in constant expression", name);
+		diag_err(tok_loc(tok), ERR_SYNTAX, "unexpected identifier: '%s' in constant expression", name);
 		return NULL;
 	}
 	case tok_num_literal:
 		//result->value = int_val_as_uint32(&tok->data.int_val);
-		result->val = tok->data.int_val;
+		result->val = *tok->data.int_val;
 		return tok->next;
 		break;
 	case tok_exclaim:
@@ -8,6 +8,10 @@
 
 #include "std_types.h"
 
+#include "jcc_context.h"
+#include "time_trace.h"
+#include "mem_cat.h"
+
 #include <libj/include/hash_table.h>
 
 #include <stdio.h>
@@ -16,19 +20,32 @@
 #include <string.h>
 #include <stdlib.h>
 
-static identfier_map_t* _id_map;
-static sema_observer_t _observer;
+struct sema_context
+{
+	identfier_map_t* id_map;
+	sema_observer_t observer;
+	func_context_t cur_func_ctx;
+	uint32_t next_label;
 
-identfier_map_t* sema_id_map()
+	/*
+	translation unit being built by sema_analyse(), destroyed with the context if the analysis does not complete
+	*/
+	valid_trans_unit_t* tl;
+};
+
+static inline sema_context_t* _sema()
 {
-	return _id_map; 
+	return jcc_ctx()->sema;
 }
 
-static func_context_t _cur_func_ctx;
+identfier_map_t* sema_id_map()
+{
+	return _sema()->id_map; 
+}
 
 func_context_t* sema_get_cur_fn_ctx()
 {
-	return &_cur_func_ctx;
+	return &_sema()->cur_func_ctx;
 }
 
 proc_decl_result sema_process_function_decl(ast_declaration_t* decl);
@@ -36,11 +53,10 @@ bool process_statement(ast_statement_t* smnt);
 
 void sema_make_label_name(char* name)
 {
-	static uint32_t next_label = 0;
-	sprintf(name, "_lbl%d", ++next_label);
+	sprintf(name, "_lbl%d", ++_sema()->next_label);
 }
 
-static bool _report_err(token_t* tok, int err, const char* format, ...)
+static bool _report_err(src_loc_t loc, int err, const char* format, ...)
 {
 	char buff[512];
 
@@ -49,7 +65,7 @@ static bool _report_err(token_t* tok, int err, const char* format, ...)
 	vsnprintf(buff, 512, format, args);
 	va_end(args);
 
-	diag_err(tok, err, buff);
+	diag_err(loc, err, buff);
 	return false;
 }
 
@@ -68,7 +84,7 @@ static bool _is_member_name_unique(ast_user_type_spec_t* user_type_spec, ast_str
 	ast_struct_member_t* member = user_type_spec->data.struct_members;
 	while (member)
 	{
-		if (member != unique && strcmp(member->decl->name, unique->decl->name) == 0)
+		if (member != unique && member->decl->name == unique->decl->name)
 			return false;
 		member = member->next;
 	}
@@ -81,9 +97,9 @@ static bool _process_struct_members(ast_user_type_spec_t* user_type_spec)
 	ast_struct_member_t* member = user_type_spec->data.struct_members;
 	while (member)
 	{
-		if (strlen(member->decl->name) > 0 && !_is_member_name_unique(user_type_spec, member))
+		if (member->decl->name && !_is_member_name_unique(user_type_spec, member))
 		{
-			return _report_err(member->decl->tokens.start, ERR_DUP_SYMBOL,
+			return _report_err(member->decl->loc.start, ERR_DUP_SYMBOL,
 				"duplicate %s member %s",
 				ast_user_type_kind_name(user_type_spec->kind),
 				member->decl->name);
@@ -91,7 +107,7 @@ static bool _process_struct_members(ast_user_type_spec_t* user_type_spec)
 
 		if (!sema_resolve_type_ref(member->decl->type_ref) || member->decl->type_ref->spec->size == 0)
 		{
-			return _report_err(member->decl->tokens.start, ERR_TYPE_INCOMPLETE,
+			return _report_err(member->decl->loc.start, ERR_TYPE_INCOMPLETE,
 				"%s member %s is of incomplete type",
 				ast_user_type_kind_name(user_type_spec->kind),
 				member->decl->name);
@@ -101,19 +117,19 @@ static bool _process_struct_members(ast_user_type_spec_t* user_type_spec)
 		{
 			if (ast_type_is_array(member->decl->type_ref->spec))
 			{
-				return _report_err(member->decl->data.var.bit_sz->tokens.start, ERR_UNSUPPORTED,
+				return _report_err(member->decl->data.var.bit_sz->loc.start, ERR_UNSUPPORTED,
 					"bit field cannt be declared as an array");
 			}
 
 			if (!ast_type_is_int(member->decl->type_ref->spec))
 			{
-				return _report_err(member->decl->data.var.bit_sz->tokens.start, ERR_UNSUPPORTED,
+				return _report_err(member->decl->data.var.bit_sz->loc.start, ERR_UNSUPPORTED,
 					"type not valid for bit field");
 			}
 
 			if (!sema_is_const_int_expr(member->decl->data.var.bit_sz))
 			{
-				return _report_err(member->decl->data.var.bit_sz->tokens.start, ERR_INITIALISER_NOT_CONST,
+				return _report_err(member->decl->data.var.bit_sz->loc.start, ERR_INITIALISER_NOT_CONST,
 					"bit field size must be a constant integer expression");
 			}
 
@@ -123,19 +139,19 @@ static bool _process_struct_members(ast_user_type_spec_t* user_type_spec)
 
 			if (val.v.uint64 > 32)
 			{
-				return _report_err(member->decl->data.var.bit_sz->tokens.start, ERR_UNSUPPORTED,
+				return _report_err(member->decl->data.var.bit_sz->loc.start, ERR_UNSUPPORTED,
 					"bit field size exceeds 32 bits");
 			}
 
 			if (val.v.int64 < 0)
 			{
-				return _report_err(member->decl->data.var.bit_sz->tokens.start, ERR_UNSUPPORTED,
+				return _report_err(member->decl->data.var.bit_sz->loc.start, ERR_UNSUPPORTED,
 					"bit field size must be positive");
 			}
 
-			if (val.v.uint64 == 0 && strlen(member->decl->name) > 0)
+			if (val.v.uint64 == 0 && member->decl->name)
 			{
-				return _report_err(member->decl->data.var.bit_sz->tokens.start, ERR_UNSUPPORTED,
+				return _report_err(member->decl->data.var.bit_sz->loc.start, ERR_UNSUPPORTED,
 					"field with bit field size 0 must be anonymous");
 			}
 
@@ -155,7 +171,7 @@ static ast_declaration_t* _create_enum_item_decl(ast_enum_member_t* member, int_
 	{
 		if (!sema_is_const_int_expr(member->value))
 		{
-			_report_err(member->value->tokens.start, ERR_INITIALISER_NOT_CONST,
+			_report_err(member->value->loc.start, ERR_INITIALISER_NOT_CONST,
 				"enum member value must be a constant integer expression");
 			return NULL;
 		}
@@ -164,22 +180,20 @@ static ast_declaration_t* _create_enum_item_decl(ast_enum_member_t* member, int_
 	}
 	else
 	{
-		value = (ast_expression_t*)malloc(sizeof(ast_expression_t));
-		memset(value, 0, sizeof(ast_expression_t));
-		value->tokens = member->tokens; //?
+		value = (ast_expression_t*)ast_alloc(sizeof(ast_expression_t));
+		value->loc = member->loc; //?
 		value->kind = expr_int_literal;
 		value->data.int_literal.val = default_val;
 		
 	}
 	//create a declaration representing the enumerator
-	ast_declaration_t* decl = (ast_declaration_t*)malloc(sizeof(ast_declaration_t));
-	memset(decl, 0, sizeof(ast_declaration_t));
-	decl->tokens = member->tokens;
+	ast_declaration_t* decl = (ast_declaration_t*)ast_alloc(sizeof(ast_declaration_t));
+	decl->loc = member->loc;
 	decl->kind = decl_var;
-	strncpy(decl->name, member->name, MAX_LITERAL_NAME);
+	decl->name = member->name;
 	//type is int32
-	decl->type_ref = (ast_type_ref_t*)malloc(sizeof(ast_type_ref_t));
-	decl->type_ref->tokens = member->tokens; //?
+	decl->type_ref = (ast_type_ref_t*)ast_alloc(sizeof(ast_type_ref_t));
+	decl->type_ref->loc = member->loc; //?
 	decl->type_ref->spec = int32_type_spec;
 	decl->type_ref->flags = TF_QUAL_CONST;
 	//const int init expression
@@ -199,10 +213,10 @@ static bool _process_enum_constants(ast_user_type_spec_t* user_type_spec)
 	
 	while (member)
 	{
-		ast_declaration_t* exist = idm_find_decl(_id_map, member->name);
+		ast_declaration_t* exist = idm_find_decl(sema_id_map(), member->name);
 		if (exist)
 		{
-			_report_err(member->tokens.start, ERR_DUP_SYMBOL,
+			_report_err(member->loc.start, ERR_DUP_SYMBOL,
 				"duplicate enumerator %s, previously defined as %s", member->name, ast_decl_kind_name(exist->kind));
 			return false;
 		}
@@ -212,7 +226,7 @@ static bool _process_enum_constants(ast_user_type_spec_t* user_type_spec)
 		if (!decl)
 			return false;
 
-		idm_add_decl(_id_map, decl);
+		idm_add_decl(sema_id_map(), decl);
 
 		next_val = int_val_inc(decl->data.var.init_expr->data.int_literal.val);
 		member = member->next;
@@ -230,7 +244,7 @@ static bool _user_type_is_definition(ast_user_type_spec_t* type)
 static ast_type_spec_t* _process_user_type(ast_type_spec_t* spec)
 {
 	//add early as we may have members of our own type
-	idm_add_tag(_id_map, spec); //todo - what about anonymous structs?
+	idm_add_tag(sema_id_map(), spec); //todo - what about anonymous structs?
 
 	bool valid;
 	if (spec->data.user_type_spec->kind == user_type_enum)
@@ -248,7 +262,7 @@ static ast_type_spec_t* _process_user_type(ast_type_spec_t* spec)
 	return spec;
 }
 
-bool sema_resolve_function_sig_types(ast_func_sig_type_spec_t* fsig, token_t* start)
+bool sema_resolve_function_sig_types(ast_func_sig_type_spec_t* fsig, src_loc_t start)
 {
 	//return type
 	fsig->ret_type = sema_resolve_type(fsig->ret_type, start);
@@ -261,7 +275,7 @@ bool sema_resolve_function_sig_types(ast_func_sig_type_spec_t* fsig, token_t* st
 	{
 		if (param->decl->type_ref->spec->kind == type_void)
 		{
-			diag_err(param->decl->tokens.start, ERR_INVALID_PARAMS,
+			diag_err(param->decl->loc.start, ERR_INVALID_PARAMS,
 				"function param '%s' of void type",
 				param->decl->name);
 			return false;
@@ -283,11 +297,11 @@ bool sema_resolve_function_sig_types(ast_func_sig_type_spec_t* fsig, token_t* st
 	return true;
 }
 
-ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
+ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, src_loc_t start)
 {
 	if (spec->kind == type_alias)
 	{
-		ast_declaration_t* decl = idm_find_decl(_id_map, spec->data.alias);
+		ast_declaration_t* decl = idm_find_decl(sema_id_map(), spec->data.alias);
 		if (!decl)
 		{
 			_report_err(start, ERR_UNKNOWN_TYPE, "type alias %s unknown", spec->data.alias);
@@ -331,14 +345,14 @@ ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
 			array_spec->element_type = sema_resolve_type(array_spec->element_type, start);
 			if (!array_spec->element_type || array_spec->element_type->size == 0)
 			{
-				_report_err(array_spec->size_expr->tokens.start, ERR_INITIALISER_NOT_CONST,
+				_report_err(array_spec->size_expr->loc.start, ERR_INITIALISER_NOT_CONST,
 					"array element size unknown");
 				return NULL;
 			}
 
 			if (!sema_is_const_int_expr(array_spec->size_expr))
 			{
-				_report_err(array_spec->size_expr->tokens.start, ERR_INITIALISER_NOT_CONST,
+				_report_err(array_spec->size_expr->loc.start, ERR_INITIALISER_NOT_CONST,
 					"array size must be a constant integer expression");
 				return NULL;
 			}
@@ -348,7 +362,7 @@ ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
 
 			if (expr_val.is_signed && expr_val.v.int64 <= 0)
 			{
-				_report_err(array_spec->size_expr->tokens.start, ERR_INVALID_INIT,
+				_report_err(array_spec->size_expr->loc.start, ERR_INVALID_INIT,
 					"array size must be a positive integer expression");
 				return NULL;
 			}
@@ -374,16 +388,16 @@ ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
 		If found: return
 		If not found: Add to id_map
 	*/
-	token_t* loc = spec->data.user_type_spec->tokens.start;
+	src_loc_t loc = spec->data.user_type_spec->loc.start;
 	if (_user_type_is_definition(spec->data.user_type_spec))
 	{
 		//ignore anonymous types
-		if (strlen(spec->data.user_type_spec->name) == 0)
+		if (!spec->data.user_type_spec->name)
 		{
 			return _process_user_type(spec);
 		}
 
-		ast_type_spec_t* exist = idm_find_block_tag(_id_map, spec->data.user_type_spec->name);
+		ast_type_spec_t* exist = idm_find_block_tag(sema_id_map(), spec->data.user_type_spec->name);
 		if (spec == exist)
 			return exist;
 
@@ -423,7 +437,6 @@ ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
 				_process_struct_members(exist->data.user_type_spec);
 			}
 			exist->size = abi_calc_user_type_layout(exist);
-			ast_destroy_type_spec(spec);
 			spec = exist;
 		}
 		else
@@ -431,13 +444,13 @@ ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
 			spec = _process_user_type(spec);
 		}
 
-		if (_observer.user_type_def_cb)
-			_observer.user_type_def_cb(spec);
+		if (_sema()->observer.user_type_def_cb)
+			_sema()->observer.user_type_def_cb(spec);
 	}
 	else
 	{
 		//declaration
-		ast_type_spec_t* exist = idm_find_tag(_id_map, spec->data.user_type_spec->name);
+		ast_type_spec_t* exist = idm_find_tag(sema_id_map(), spec->data.user_type_spec->name);
 		if (exist)
 		{
 			if (exist->data.user_type_spec->kind != spec->data.user_type_spec->kind)
@@ -449,7 +462,6 @@ ast_type_spec_t* sema_resolve_type(ast_type_spec_t* spec, token_t* start)
 					ast_user_type_kind_name(spec->data.user_type_spec->kind));
 				return NULL;
 			}
-			ast_destroy_type_spec(spec);
 			spec = exist;
 		}
 		else
@@ -469,7 +481,7 @@ bool sema_resolve_type_ref(ast_type_ref_t* ref)
 {
 	assert(ref->spec);
 
-	ast_type_spec_t* spec = sema_resolve_type(ref->spec, ref->tokens.start);
+	ast_type_spec_t* spec = sema_resolve_type(ref->spec, ref->loc.start);
 	if (spec)
 	{
 		ref->spec = spec;
@@ -626,11 +638,9 @@ bool process_block_list(ast_block_item_t* blocks)
 	ast_block_item_t* block = blocks;
 	while (block)
 	{
+		//the caller leaves the block, on failure as well as success
 		if (!process_block_item(block))
-		{
-			idm_leave_block(_id_map);
 			return false;
-		}
 		block = block->next;
 	}
 	return true;
@@ -643,7 +653,7 @@ bool process_for_statement(ast_statement_t* smnt)
 storage class auto or register
 	*/
 
-	ast_declaration_t* decl = smnt->data.for_smnt.decls.first;
+	ast_declaration_t* decl = smnt->data.for_smnt.decls;
 	while (decl)
 	{
 		if (!process_declaration(decl))
@@ -670,13 +680,13 @@ bool process_goto_statement(ast_statement_t* smnt)
 
 bool process_label_statement(ast_statement_t* smnt)
 {
-	if(sht_contains(sema_get_cur_fn_ctx()->labels, smnt->data.label_smnt.label))
+	if(iht_contains(sema_get_cur_fn_ctx()->labels, smnt->data.label_smnt.label))
 	{
-		return _report_err(smnt->tokens.start, ERR_DUP_LABEL,
+		return _report_err(smnt->loc.start, ERR_DUP_LABEL,
 			"dupliate label '%s' in function '%s'",
 			smnt->data.label_smnt.label, sema_get_cur_fn_ctx()->decl->name);
 	}
-	sht_insert(sema_get_cur_fn_ctx()->labels, smnt->data.label_smnt.label, 0);
+	iht_insert(sema_get_cur_fn_ctx()->labels, smnt->data.label_smnt.label, 0);
 
 	return process_statement(smnt->data.label_smnt.smnt);
 }
@@ -691,7 +701,7 @@ bool process_case_statement(ast_switch_smnt_data_t* switch_data, ast_statement_t
 	{
 		if (switch_data->sema.dflt_case)
 		{
-			return _report_err(case_smnt->tokens.start, ERR_INVALID_SWITCH,
+			return _report_err(case_smnt->loc.start, ERR_INVALID_SWITCH,
 				"Multiple default cases in switch statement");
 		}
 		switch_data->sema.dflt_case = case_data;
@@ -703,7 +713,7 @@ bool process_case_statement(ast_switch_smnt_data_t* switch_data, ast_statement_t
 
 		if (case_data->expr->kind != expr_int_literal)
 		{
-			return _report_err(case_data->expr->tokens.start, ERR_INVALID_SWITCH,
+			return _report_err(case_data->expr->loc.start, ERR_INVALID_SWITCH,
 				"case must be a constant expression");
 		}
 		switch_data->sema.case_smnts[switch_data->sema.case_count] = case_data;
@@ -717,7 +727,7 @@ bool process_case_statement(ast_switch_smnt_data_t* switch_data, ast_statement_t
 	
 	if (switch_data->sema.case_count == 256)
 	{
-		return _report_err(case_smnt->tokens.start, ERR_INVALID_SWITCH,
+		return _report_err(case_smnt->loc.start, ERR_INVALID_SWITCH,
 			"maximum number of case statements exceeded in switch");
 	}
 	return true;
@@ -789,15 +799,14 @@ bool process_switch_statement(ast_statement_t * smnt)
 	ast_statement_t* inner = smnt->data.switch_smnt.smnt;
 	if (inner)
 	{
-		smnt->data.switch_smnt.sema.case_smnts = (ast_case_smnt_data_t**)malloc(sizeof(ast_case_smnt_data_t*) * 256);
-		memset(smnt->data.switch_smnt.sema.case_smnts, 0, sizeof(ast_case_smnt_data_t*) * 256);
+		smnt->data.switch_smnt.sema.case_smnts = (ast_case_smnt_data_t**)ast_alloc(sizeof(ast_case_smnt_data_t*) * 256);
 		smnt->data.switch_smnt.sema.case_count = 0;
 		if (!process_switch_statement_inner(&smnt->data.switch_smnt, inner))
 			return false;
 	}
 	if (smnt->data.switch_smnt.sema.case_count == 0)
 	{
-		return _report_err(smnt->tokens.start, ERR_INVALID_SWITCH,
+		return _report_err(smnt->loc.start, ERR_INVALID_SWITCH,
 			"switch statement has no case or default statement");
 	}
 
@@ -815,7 +824,7 @@ bool process_switch_statement(ast_statement_t * smnt)
 				return;
 			case 2:
 			*/
-		return _report_err(smnt->tokens.start, ERR_INVALID_SWITCH,
+		return _report_err(smnt->loc.start, ERR_INVALID_SWITCH,
 			"invalid case in switch");
 	}
 	return true;
@@ -841,7 +850,7 @@ bool process_return_statement(ast_statement_t* smnt)
 	}
 	else if (ast_func_decl_return_type(sema_get_cur_fn_ctx()->decl)->kind != type_void)
 	{
-		return _report_err(smnt->tokens.start, ERR_INVALID_RETURN,
+		return _report_err(smnt->loc.start, ERR_INVALID_RETURN,
 			"function must return a value");
 	}
 	return true;
@@ -867,9 +876,9 @@ bool process_statement(ast_statement_t* smnt)
 	case smnt_for:
 	case smnt_for_decl:
 	{
-		idm_enter_block(_id_map);
+		idm_enter_block(sema_id_map());
 		bool result = process_for_statement(smnt);
-		idm_leave_block(_id_map);
+		idm_leave_block(sema_id_map());
 		return result;
 	}
 	case smnt_if:
@@ -882,9 +891,9 @@ bool process_statement(ast_statement_t* smnt)
 		break;
 	case smnt_compound:
 	{
-		idm_enter_block(_id_map);
+		idm_enter_block(sema_id_map());
 		bool ret = process_block_list(smnt->data.compound.blocks);
-		idm_leave_block(_id_map);
+		idm_leave_block(sema_id_map());
 		return ret;
 	}
 	case smnt_return:
@@ -897,7 +906,7 @@ bool process_statement(ast_statement_t* smnt)
 		return process_goto_statement(smnt);
 		break;
 	case smnt_case:
-		return _report_err(smnt->tokens.start, ERR_SYNTAX,
+		return _report_err(smnt->loc.start, ERR_SYNTAX,
 			"case must be within a switch statement");
 	}
 
@@ -907,12 +916,13 @@ bool process_statement(ast_statement_t* smnt)
 bool process_function_definition(ast_declaration_t* decl)
 {
 	//set up function data
-	idm_enter_function(_id_map, decl->type_ref->spec->data.func_sig_spec->params);
+	idm_enter_function(sema_id_map(), decl->type_ref->spec->data.func_sig_spec->params);
 
 	sema_get_cur_fn_ctx()->decl = decl;
-	sema_get_cur_fn_ctx()->labels = sht_create(64);
+	sema_get_cur_fn_ctx()->labels = iht_create(64);
 	sema_get_cur_fn_ctx()->goto_smnts = phs_create(64);
 	
+	trace_begin(jcc_ctx(), "Function", decl->name);
 	bool ret = process_block_list(decl->data.func.blocks);
 
 	//check that any goto statements reference valid labels
@@ -921,15 +931,16 @@ bool process_function_definition(ast_declaration_t* decl)
 	{
 		ast_statement_t* goto_smnt = (ast_statement_t*)it.val;
 
-		if (!sht_contains(sema_get_cur_fn_ctx()->labels, goto_smnt->data.goto_smnt.label))
+		if (!iht_contains(sema_get_cur_fn_ctx()->labels, goto_smnt->data.goto_smnt.label))
 		{
-			return _report_err(goto_smnt->tokens.start, ERR_UNKNOWN_LABEL,
+			ret = _report_err(goto_smnt->loc.start, ERR_UNKNOWN_LABEL,
 				"goto statement references unknown label '%s'",
 				goto_smnt->data.goto_smnt.label);
-
+			break;
 		}
 		phs_next(sema_get_cur_fn_ctx()->goto_smnts, &it);
 	}
+	trace_end(jcc_ctx());
 
 	ht_destroy(sema_get_cur_fn_ctx()->goto_smnts);
 	sema_get_cur_fn_ctx()->goto_smnts = NULL;
@@ -937,13 +948,13 @@ bool process_function_definition(ast_declaration_t* decl)
 	sema_get_cur_fn_ctx()->labels = NULL;
 	sema_get_cur_fn_ctx()->decl = NULL;
 
-	idm_leave_function(_id_map);
+	idm_leave_function(sema_id_map());
 	return ret;
 }
 
 static void _add_fn_decl(valid_trans_unit_t* tl, ast_declaration_t* fn)
 {
-	tl_decl_t* tl_decl = (tl_decl_t*)malloc(sizeof(tl_decl_t));
+	tl_decl_t* tl_decl = (tl_decl_t*)mem_alloc(mc_symbols, sizeof(tl_decl_t));
 	memset(tl_decl, 0, sizeof(tl_decl_t));
 	tl_decl->decl = fn;
 	tl_decl->next = tl->fn_decls;
@@ -952,29 +963,68 @@ static void _add_fn_decl(valid_trans_unit_t* tl, ast_declaration_t* fn)
 
 static void _add_var_decl(valid_trans_unit_t* tl, ast_declaration_t* fn)
 {
-	tl_decl_t* tl_decl = (tl_decl_t*)malloc(sizeof(tl_decl_t));
+	tl_decl_t* tl_decl = (tl_decl_t*)mem_alloc(mc_symbols, sizeof(tl_decl_t));
 	memset(tl_decl, 0, sizeof(tl_decl_t));
 	tl_decl->decl = fn;
 	tl_decl->next = tl->var_decls;
 	tl->var_decls = tl_decl;
 }
 
-void sema_init(sema_observer_t observer)
+void sema_init(jcc_context_t* ctx, sema_observer_t observer)
+{
+	sema_deinit(ctx);
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_symbols);
+
+	sema_context_t* sema = (sema_context_t*)mem_alloc(mc_symbols, sizeof(sema_context_t));
+	memset(sema, 0, sizeof(sema_context_t));
+	sema->id_map = idm_create();
+	sema->observer = observer;
+	ctx->sema = sema;
+}
+
+void sema_deinit(jcc_context_t* ctx)
+{
+	sema_context_t* sema = ctx->sema;
+	if (!sema)
+		return;
+	//the analysis of this translation unit ended with an error
+	if (sema->tl)
+	{
+		if (ctx->ast_arena == sema->tl->ast->arena)
+			ctx->ast_arena = NULL;
+		tl_destroy(sema->tl);
+	}
+	if (sema->cur_func_ctx.labels)
+		ht_destroy(sema->cur_func_ctx.labels);
+	if (sema->cur_func_ctx.goto_smnts)
+		ht_destroy(sema->cur_func_ctx.goto_smnts);
+	idm_destroy(sema->id_map);
+	mem_free(sema);
+	ctx->sema = NULL;
+}
+
+static valid_trans_unit_t* _analysis_failed()
 {
-	types_init();
-	_id_map = idm_create();
-	_observer = observer;
+	tl_destroy(_sema()->tl);
+	_sema()->tl = NULL;
+	return NULL;
 }
 
-valid_trans_unit_t* sema_analyse(ast_trans_unit_t* ast)
+valid_trans_unit_t* sema_analyse(jcc_context_t* ctx, ast_trans_unit_t* ast)
 {
+	jcc_ctx_set(ctx);
+	mem_set_scope(mc_symbols);
+	//nodes created during analysis belong to the translation unit
+	ctx->ast_arena = ast->arena;
+
 	sema_get_cur_fn_ctx()->decl = NULL;
 	sema_get_cur_fn_ctx()->labels = NULL;
 
-	valid_trans_unit_t* tl = (valid_trans_unit_t*)malloc(sizeof(valid_trans_unit_t));
+	valid_trans_unit_t* tl = (valid_trans_unit_t*)mem_alloc(mc_symbols, sizeof(valid_trans_unit_t));
 	memset(tl, 0, sizeof(valid_trans_unit_t));
 	tl->ast = ast;
-	tl->string_literals = _id_map->string_literals;
+	_sema()->tl = tl;
 	ast_declaration_t* decl = ast->decls.first;
 	while (decl)
 	{
@@ -984,7 +1034,7 @@ valid_trans_unit_t* sema_analyse(ast_trans_unit_t* ast)
 			proc_decl_result result = sema_process_global_variable_declaration(decl);
 
 			if (result == proc_decl_error)
-				return NULL;
+				return _analysis_failed();
 			if (result == proc_decl_new_def)
 			{
 				_add_var_decl(tl, decl);
@@ -994,7 +1044,7 @@ valid_trans_unit_t* sema_analyse(ast_trans_unit_t* ast)
 		{
 			proc_decl_result result = sema_process_function_decl(decl);
 			if (result == proc_decl_error)
-				return NULL;
+				return _analysis_failed();
 			if (result == proc_decl_new_def)
 			{
 				_add_fn_decl(tl, decl);
@@ -1002,9 +1052,7 @@ valid_trans_unit_t* sema_analyse(ast_trans_unit_t* ast)
 				if (decl->data.func.blocks)
 				{
 					if (!process_function_definition(decl))
-					{
-						return NULL;
-					}
+						return _analysis_failed();
 					
 				}
 			}
@@ -1015,18 +1063,33 @@ valid_trans_unit_t* sema_analyse(ast_trans_unit_t* ast)
 		}
 		decl = next;
 	}
-	idm_destroy(_id_map);
-	_id_map = NULL;
+	//the translation unit takes the string literals, the rest of the map is no longer needed
+	tl->string_literals = sema_id_map()->string_literals;
+	sema_id_map()->string_literals = NULL;
+	idm_destroy(sema_id_map());
+	_sema()->id_map = NULL;
+	_sema()->tl = NULL;
 	return tl;
 }
 
+static void _destroy_decls(tl_decl_t* decl)
+{
+	while (decl)
+	{
+		tl_decl_t* next = decl->next;
+		mem_free(decl);
+		decl = next;
+	}
+}
+
 void tl_destroy(valid_trans_unit_t* tl)
 {
 	if (!tl)
 		return;
 	
+	_destroy_decls(tl->fn_decls);
+	_destroy_decls(tl->var_decls);
+	idm_destroy_string_literals(tl->string_literals);
 	ast_destory_translation_unit(tl->ast);
-	free(tl);
-
-	
+	mem_free(tl);
 }
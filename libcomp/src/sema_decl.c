@@ -9,7 +9,7 @@ expr_result_t sema_process_compound_init(ast_expression_t* expr, ast_type_spec_t
 
 bool sema_process_array_compound_init(ast_expression_t* expr, ast_type_spec_t* array_spec)
 {
-	ast_type_spec_t* elem_type = sema_resolve_type(array_spec->data.array_spec->element_type, expr->tokens.start);
+	ast_type_spec_t* elem_type = sema_resolve_type(array_spec->data.array_spec->element_type, expr->loc.start);
 	if (!elem_type)
 		return false;
 	array_spec->data.array_spec->element_type = elem_type;
@@ -49,7 +49,7 @@ bool sema_process_array_compound_init(ast_expression_t* expr, ast_type_spec_t* a
 	{
 		if (elem_count != array_spec->data.array_spec->sema.array_sz)
 		{
-			diag_err(expr->tokens.start, ERR_INVALID_INIT,
+			diag_err(expr->loc.start, ERR_INVALID_INIT,
 				"incorrect number of items in array initialisation");
 			return false;
 		}
@@ -67,7 +67,7 @@ bool sema_process_struct_compound_init(ast_expression_t* expr, ast_type_spec_t*
 	{
 		if (init_item == NULL)
 		{
-			diag_err(expr->tokens.start, ERR_SYNTAX, "Incorrect number of init expressions for compound type");
+			diag_err(expr->loc.start, ERR_SYNTAX, "Incorrect number of init expressions for compound type");
 			return false;
 		}
 
@@ -100,7 +100,7 @@ bool sema_process_struct_compound_init(ast_expression_t* expr, ast_type_spec_t*
 
 	if (init_item)
 	{
-		diag_err(expr->tokens.start, ERR_SYNTAX, "Incorrect number of init expressions for compound type");
+		diag_err(expr->loc.start, ERR_SYNTAX, "Incorrect number of init expressions for compound type");
 		return false;
 	}
 
@@ -123,7 +123,7 @@ expr_result_t sema_process_compound_init(ast_expression_t* expr, ast_type_spec_t
 	}
 	else
 	{
-		diag_err(expr->tokens.start, ERR_TYPE_INCOMPLETE,
+		diag_err(expr->loc.start, ERR_TYPE_INCOMPLETE,
 			"compound initialiser requires array or sruct / union type");
 		result.failure = true;
 		return result;
@@ -159,7 +159,7 @@ static bool _process_global_var_init(ast_declaration_t* decl)
 			{ 
 				if (!sema_is_const_pointer(expr) && expr->kind != expr_int_literal)
 				{
-					diag_err(expr->tokens.start,
+					diag_err(expr->loc.start,
 						ERR_INITIALISER_NOT_CONST,
 						"global pointer '%s' must be initialised with a const value",
 						ast_type_name(var_type));
@@ -171,7 +171,7 @@ static bool _process_global_var_init(ast_declaration_t* decl)
 				if (!int_val_will_fit(&expr->data.int_literal.val, var_type))
 				{
 					//sema_report_type_conversion_error(decl->data.var.init_expr, &decl->data.var.init_expr->data.int_literal.val, var_type, "assignment");
-					diag_err(expr->tokens.start,
+					diag_err(expr->loc.start,
 						ERR_INCOMPATIBLE_TYPE,
 						"assignment to incompatible type. expected %s",
 						ast_type_name(var_type));
@@ -180,7 +180,7 @@ static bool _process_global_var_init(ast_declaration_t* decl)
 			}
 			else
 			{
-				diag_err(decl->tokens.start, ERR_INITIALISER_NOT_CONST,
+				diag_err(decl->loc.start, ERR_INITIALISER_NOT_CONST,
 					"global var '%s' initialised with non-const integer expression", decl->name);
 				return false;
 			}
@@ -199,7 +199,7 @@ proc_decl_result sema_process_global_variable_declaration(ast_declaration_t* dec
 
 	if (exist && exist->kind == decl_func)
 	{
-		diag_err(decl->tokens.start, ERR_DUP_SYMBOL,
+		diag_err(decl->loc.start, ERR_DUP_SYMBOL,
 			"global var declaration of '%s' shadows function at",
 			decl->name);
 		return proc_decl_error;
@@ -211,7 +211,7 @@ proc_decl_result sema_process_global_variable_declaration(ast_declaration_t* dec
 		if (!type || !sema_is_same_type(exist->type_ref->spec, type))
 		{
 			//different types
-			diag_err(decl->tokens.start, ERR_DUP_SYMBOL,
+			diag_err(decl->loc.start, ERR_DUP_SYMBOL,
 				"incompatible redeclaration of global var '%s'",
 				decl->name);
 			return proc_decl_error;
@@ -220,7 +220,7 @@ proc_decl_result sema_process_global_variable_declaration(ast_declaration_t* dec
 		if (exist->data.var.init_expr && decl->data.var.init_expr)
 		{
 			//multiple definitions
-			diag_err(decl->tokens.start, ERR_DUP_SYMBOL,
+			diag_err(decl->loc.start, ERR_DUP_SYMBOL,
 				"redefinition of global var '%s'",
 				decl->name);
 			return proc_decl_error;
@@ -244,7 +244,7 @@ proc_decl_result sema_process_global_variable_declaration(ast_declaration_t* dec
 
 	if (decl->type_ref->spec->size == 0)
 	{
-		diag_err(decl->tokens.start, ERR_TYPE_INCOMPLETE,
+		diag_err(decl->loc.start, ERR_TYPE_INCOMPLETE,
 			"global var '%s' uses incomplete type '%s'",
 			decl->name, ast_type_name(decl->type_ref->spec));
 		return proc_decl_error;
@@ -259,7 +259,7 @@ bool sema_process_variable_declaration(ast_declaration_t* decl)
 	ast_declaration_t* existing = idm_find_block_decl(sema_id_map(), decl->name);
 	if (existing && existing->kind == decl_var)
 	{
-		diag_err(decl->tokens.start, ERR_DUP_VAR,
+		diag_err(decl->loc.start, ERR_DUP_VAR,
 			"variable '%s' already declared at",
 			ast_declaration_name(decl));
 		return false;
@@ -267,7 +267,7 @@ bool sema_process_variable_declaration(ast_declaration_t* decl)
 
 	if (!sema_resolve_type_ref(decl->type_ref))
 	{
-		diag_err(decl->tokens.start, ERR_TYPE_INCOMPLETE,
+		diag_err(decl->loc.start, ERR_TYPE_INCOMPLETE,
 			"var '%s' is of incomplete type",
 			ast_declaration_name(decl));
 		return false;
@@ -303,7 +303,7 @@ bool sema_process_variable_declaration(ast_declaration_t* decl)
 	//check this here as the size may have been set while processing the init expression in the case of an array 'int []i = {1, 2}'
 	if (decl->type_ref->spec->size == 0)
 	{
-		diag_err(decl->tokens.start, ERR_TYPE_INCOMPLETE,
+		diag_err(decl->loc.start, ERR_TYPE_INCOMPLETE,
 			"var '%s' is of incomplete type",
 			ast_declaration_name(decl));
 		return false;
@@ -320,12 +320,12 @@ bool sema_process_type_decl(ast_declaration_t* decl)
 	if (!sema_resolve_type_ref(decl->type_ref))
 		return false;
 
-	if (strlen(decl->name))
+	if (decl->name)
 	{
 		ast_declaration_t* existing = idm_find_block_decl(sema_id_map(), decl->name);
 		if (existing)
 		{
-			diag_err(decl->tokens.start, ERR_DUP_TYPE_DEF,
+			diag_err(decl->loc.start, ERR_DUP_TYPE_DEF,
 				"typedef forces redefinition of %s", decl->name);
 			return false;
 		}
@@ -346,14 +346,14 @@ bool resolve_function_decl_types(ast_declaration_t* decl)
 {
 	ast_func_sig_type_spec_t* fsig = decl->type_ref->spec->data.func_sig_spec;
 
-	if (!sema_resolve_function_sig_types(fsig, decl->tokens.start))
+	if (!sema_resolve_function_sig_types(fsig, decl->loc.start))
 		return false;
 
 	if (_is_fn_definition(decl) &&
 		fsig->ret_type->kind != type_void &&
 		fsig->ret_type->size == 0)
 	{
-		diag_err(decl->tokens.start, ERR_TYPE_INCOMPLETE,
+		diag_err(decl->loc.start, ERR_TYPE_INCOMPLETE,
 			"function '%s' returns incomplete type '%s'",
 			decl->name, ast_type_name(fsig->ret_type));
 		return false;
@@ -367,7 +367,7 @@ bool resolve_function_decl_types(ast_declaration_t* decl)
 			param_type->kind != type_void &&
 			param_type->size == 0)
 		{
-			diag_err(param->decl->tokens.start, ERR_TYPE_INCOMPLETE,
+			diag_err(param->decl->loc.start, ERR_TYPE_INCOMPLETE,
 				"function param '%s' of incomplete type '%s'",
 				param->decl->name, param_type->data.user_type_spec->name);
 			return false;
@@ -386,7 +386,7 @@ proc_decl_result sema_process_function_decl(ast_declaration_t* decl)
 	ast_declaration_t* exist = idm_find_decl(sema_id_map(), name);
 	if (exist && exist->kind == decl_var)
 	{
-		diag_err(decl->tokens.start, ERR_DUP_SYMBOL,
+		diag_err(decl->loc.start, ERR_DUP_SYMBOL,
 			"declaration of function '%s' shadows variable at",
 			name);
 		return proc_decl_error;
@@ -397,7 +397,7 @@ proc_decl_result sema_process_function_decl(ast_declaration_t* decl)
 	ast_func_params_t* params = ast_func_decl_params(decl);
 	if (params->ellipse_param && params->param_count == 0)
 	{
-		diag_err(decl->tokens.start, ERR_SYNTAX,
+		diag_err(decl->loc.start, ERR_SYNTAX,
 			"use of ellipse parameter in '%s' requires at least one other parameter",
 			name);
 		return proc_decl_error;
@@ -405,7 +405,7 @@ proc_decl_result sema_process_function_decl(ast_declaration_t* decl)
 
 	if (ast_type_is_array(ast_func_decl_return_type(decl)))
 	{
-		diag_err(decl->tokens.start, ERR_SYNTAX,
+		diag_err(decl->loc.start, ERR_SYNTAX,
 			"function '%s' may not return array type", name);
 		return proc_decl_error;
 	}
@@ -418,14 +418,14 @@ proc_decl_result sema_process_function_decl(ast_declaration_t* decl)
 		if (_is_fn_definition(exist) && _is_fn_definition(decl))
 		{
 			//multiple definition
-			diag_err(decl->tokens.start, ERR_DUP_SYMBOL,
+			diag_err(decl->loc.start, ERR_DUP_SYMBOL,
 				"redefinition of function '%s'", name);
 			return proc_decl_error;
 		}
 
 		if (!sema_is_same_func_sig(exist->type_ref->spec->data.func_sig_spec, decl->type_ref->spec->data.func_sig_spec))
 		{
-			diag_err(decl->tokens.start, ERR_INVALID_PARAMS,
+			diag_err(decl->loc.start, ERR_INVALID_PARAMS,
 				"differing function signature in definition of '%s'", name);
 			return proc_decl_error;
 		}
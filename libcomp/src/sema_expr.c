@@ -17,7 +17,7 @@ static expr_result_t _report_err(ast_expression_t* expr, int err, const char* fo
 	vsnprintf(buff, 512, format, args);
 	va_end(args);
 
-	diag_err(expr->tokens.start, err, buff);
+	diag_err(expr->loc.start, err, buff);
 
 	expr_result_t result;
 	memset(&result, 0, sizeof(expr_result_t));
@@ -568,9 +568,13 @@ static expr_result_t _process_func_call(ast_expression_t* expr)
 			"func call bad target");
 	}
 
-	if (expr->data.func_call.param_count != fsig->params->param_count)
+	uint32_t param_count = 0;
+	for (ast_func_call_param_t* p = expr->data.func_call.first_param; p; p = p->next)
+		param_count++;
+
+	if (param_count != fsig->params->param_count)
 	{
-		if (expr->data.func_call.param_count < fsig->params->param_count ||
+		if (param_count < fsig->params->param_count ||
 			!fsig->params->ellipse_param)
 		{
 			//not enough params, or no variable arg
@@ -617,7 +621,6 @@ static expr_result_t _process_func_call(ast_expression_t* expr)
 			p_count++;
 		}
 	}
-	expr->data.func_call.sema.target_type = tt;
 	result.result_type = fsig->ret_type;
 	return result;
 }
@@ -677,7 +680,7 @@ expr_result_t _process_cast(ast_expression_t* expr)
 	if (result.failure)
 		return result;
 
-	ast_type_spec_t* target_type = sema_resolve_type(expr->data.cast.type_ref->spec, expr->tokens.start);
+	ast_type_spec_t* target_type = sema_resolve_type(expr->data.cast.type_ref->spec, expr->loc.start);
 	if (target_type)
 		result.result_type = target_type;
 	else
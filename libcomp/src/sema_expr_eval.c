@@ -71,9 +71,10 @@ ast_expression_t* _sema_eval_constant_expr(ast_expression_t* expr)
 			return NULL;
 
 		int_val_t val = int_val_unary_op(&inner->data.int_literal.val, expr->data.unary_op.operation);
+		ast_type_spec_t* type = inner->sema.result.type; //inner is destroyed by the conversion
 
 		expr = _conv_expr_to_int_literal(expr, val);
-		expr->sema.result.type = inner->sema.result.type; //todo
+		expr->sema.result.type = type; //todo
 		break;
 	}
 	case expr_binary_op:
@@ -84,9 +85,10 @@ ast_expression_t* _sema_eval_constant_expr(ast_expression_t* expr)
 			return NULL;
 
 		int_val_t val = int_val_binary_op(&lhs->data.int_literal.val, &rhs->data.int_literal.val, expr->data.binary_op.operation);
+		ast_type_spec_t* type = lhs->sema.result.type; //lhs is destroyed by the conversion
 
 		expr = _conv_expr_to_int_literal(expr, val);
-		expr->sema.result.type = lhs->sema.result.type; //todo
+		expr->sema.result.type = type; //todo
 		break;
 	}
 	case expr_int_literal:
@@ -1,7 +1,11 @@
 #include "source.h"
+#include "jcc_context.h"
+#include "mem_cat.h"
+#include "lex_scan.h"
 
 #include <libj/include/hash_table.h>
 #include <libj/include/platform.h>
+#include <libj/include/str_buff.h>
 
 #include <stdbool.h>
 #include <string.h>
@@ -13,152 +17,290 @@
 typedef struct
 {
 	source_range_t range;
+
+	/*
+	start of each line, built by the first position lookup in the file. NULL until then
+	*/
 	const char** lines;
 	uint32_t line_count;
-	const char* path;	//full path
+	const char* path;	//full path, NULL for a range not loaded from a file
 	const char* file_name;	//file name only
+	src_loc_t loc_base;	//location of range.ptr, SRC_LOC_NONE if the location space was exhausted
+	bool mapped;	//range was mapped by src_map_file()
+	bool owned;	//range was allocated by the context, as a scratch block
 }source_file_t;
 
-/*
-Map of path to source_file_t* for each open file
+#define MAX_INCLUDE_DIRS 20
 
-We can find the file associated with a char pointer by looking at the source ranges of each file
-*/
-static hash_table_t* _files;
+#define SCRATCH_BLOCK_SZ 4096
+
+struct src_context
+{
+	/*
+	Map of path to source_file_t* for each open file
+
+	We can find the file associated with a char pointer by looking at the source ranges of each file
+	*/
+	hash_table_t* files;
+
+	/*
+	Paths which could not be loaded, each is only tried once
+	*/
+	hash_table_t* missing;
+
+	/*
+	Map of each header search, its kind, directory and name, to the source_file_t* found or NULL
+	*/
+	hash_table_t* headers;
+
+	/*
+	every file ordered by the start of its range, positions are found by binary search
+	*/
+	source_file_t** by_pos;
+	uint32_t file_count;
+	uint32_t file_capacity;
+
+	/*
+	files with a location in the order they were loaded, which is also the order of their locations
+	*/
+	source_file_t** by_loc;
+	uint32_t loc_file_count;
+
+	/*
+	location given to the next file
+	*/
+	src_loc_t next_loc;
+
+	/*
+	file of the last position looked up, consecutive lookups are usually in the same file
+	*/
+	source_file_t* last_found;
+
+	/*
+	the scratch block being filled by src_scratch() and the chars of it used
+	*/
+	source_file_t* scratch;
+	size_t scratch_used;
+
+	/*
+	Include path information
+	*/
+	const char* include_dirs[MAX_INCLUDE_DIRS];
+
+	/*
+	Callback to load a file
+	*/
+	src_load_cb load_cb;
+	void* load_data;
+};
 
 /*
-Include path information
+length of the line ending at ptr, "\r\n", "\n" or "\r"
 */
-#define MAX_INCLUDE_DIRS 20
-static const char* _include_dirs[MAX_INCLUDE_DIRS];
+static int _line_ending_len(const char* ptr, const char* end)
+{
+	if (*ptr == '\r')
+		return ptr + 1 < end && ptr[1] == '\n' ? 2 : 1;
+	return 1;
+}
+
+static void _init_line_data(source_file_t* f)
+{
+	uint32_t capacity = 256;
+	f->lines = (const char**)mem_alloc(mc_source, sizeof(const char*) * capacity);
+	f->lines[0] = f->range.ptr;
+	f->line_count = 1;
+
+	//store pointers to the start of each line, the line endings are found 16 or 32 bytes at a time
+	const char* ptr = f->range.ptr;
+	const char* end = f->range.end;
+	while ((ptr = lex_scan_either(ptr, end, '\n', '\r')) < end)
+	{
+		ptr += _line_ending_len(ptr, end);
+		if (f->line_count == capacity)
+		{
+			capacity *= 2;
+			f->lines = (const char**)mem_realloc((void*)f->lines, mc_source, sizeof(const char*) * capacity);
+		}
+		f->lines[f->line_count++] = ptr;
+	}
+}
 
 /*
-Callback to load a file
+add file to the files ordered by position and give it the next block of locations
 */
-static src_load_cb _load_cb;
-static void* _load_data;
-
-static int _is_line_ending(const char* ptr)
+static void _add_file(src_context_t* src, source_file_t* file)
 {
-	if (*ptr == '\r')
+	if (src->file_count == src->file_capacity)
 	{
-		return *(++ptr) == '\n' ? 2 : 1;
+		src->file_capacity = src->file_capacity ? src->file_capacity * 2 : 32;
+		src->by_pos = (source_file_t**)mem_realloc(src->by_pos, mc_source, sizeof(source_file_t*) * src->file_capacity);
+		src->by_loc = (source_file_t**)mem_realloc(src->by_loc, mc_source, sizeof(source_file_t*) * src->file_capacity);
 	}
-	else if (*ptr == '\n')
+
+	//the block includes the end of the range, where the eof token is
+	size_t len = (size_t)(file->range.end - file->range.ptr);
+	if (len < (size_t)(UINT32_MAX - src->next_loc))
 	{
-		return 1;
+		file->loc_base = src->next_loc;
+		src->next_loc += (src_loc_t)len + 1;
+		src->by_loc[src->loc_file_count++] = file;
 	}
-	return 0;
+
+	uint32_t idx = src->file_count;
+	while (idx > 0 && src->by_pos[idx - 1]->range.ptr > file->range.ptr)
+		idx--;
+	memmove(&src->by_pos[idx + 1], &src->by_pos[idx], sizeof(source_file_t*) * (src->file_count - idx));
+	src->by_pos[idx] = file;
+	src->file_count++;
+}
+
+static inline bool _file_contains(source_file_t* file, const char* pos)
+{
+	return pos >= file->range.ptr && pos <= file->range.end;
 }
 
-static uint32_t _count_lines(source_range_t* range)
+source_file_t* _get_file_for_pos(src_context_t* src, const char* pos)
 {
-	const char* ptr = range->ptr;
-	uint32_t result = 1;
-	while (ptr < range->end)
+	if (src->last_found && _file_contains(src->last_found, pos))
+		return src->last_found;
+
+	//the last file starting at or before pos
+	uint32_t lo = 0;
+	uint32_t hi = src->file_count;
+	while (lo < hi)
 	{
-		int adv = _is_line_ending(ptr);
-		if (adv)
-		{
-			result++;
-			ptr += adv;
-		}
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (src->by_pos[mid]->range.ptr <= pos)
+			lo = mid + 1;
 		else
-		{
-			ptr++;
-		}
+			hi = mid;
 	}
-	return result;
+
+	if (lo == 0 || !_file_contains(src->by_pos[lo - 1], pos))
+		return NULL;
+	src->last_found = src->by_pos[lo - 1];
+	return src->last_found;
 }
 
-static void _init_line_data(source_file_t* f)
+static inline bool _file_contains_loc(source_file_t* file, src_loc_t loc)
 {
-	//allocate buffer
-	f->line_count = _count_lines(&f->range);
-	f->lines = (const char**)malloc(sizeof(const char*) * f->line_count);
+	return file->loc_base && loc >= file->loc_base && loc - file->loc_base <= (src_loc_t)(file->range.end - file->range.ptr);
+}
 
-	//store pointers to the start of each line
-	const char* ptr = f->range.ptr;
-	int line = 1;
-	f->lines[0] = ptr;
-	while (ptr < f->range.end)
+static source_file_t* _get_file_for_loc(src_context_t* src, src_loc_t loc)
+{
+	if (src->last_found && _file_contains_loc(src->last_found, loc))
+		return src->last_found;
+
+	//the last file with a location at or before loc
+	uint32_t lo = 0;
+	uint32_t hi = src->loc_file_count;
+	while (lo < hi)
 	{
-		int adv = _is_line_ending(ptr);
-		if (adv)
-		{
-			ptr += adv;
-			f->lines[line] = ptr;
-			line++;
-		}
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (src->by_loc[mid]->loc_base <= loc)
+			lo = mid + 1;
 		else
-		{
-			ptr++;
-		}
+			hi = mid;
 	}
+
+	if (lo == 0 || !_file_contains_loc(src->by_loc[lo - 1], loc))
+		return NULL;
+	src->last_found = src->by_loc[lo - 1];
+	return src->last_found;
 }
 
-source_file_t* _get_file_for_pos(const char* pos)
+src_loc_t src_get_loc(jcc_context_t* ctx, const char* pos)
 {
-	sht_iterator_t it = sht_begin(_files);
-	while (!sht_end(_files, &it))
-	{
-		source_file_t* sf = (source_file_t*)it.val;
+	source_file_t* file = ctx->src && pos ? _get_file_for_pos(ctx->src, pos) : NULL;
+	if (!file || !file->loc_base)
+		return SRC_LOC_NONE;
+	return file->loc_base + (src_loc_t)(pos - file->range.ptr);
+}
 
-		if (pos >= sf->range.ptr && pos <= sf->range.end)
-			return sf;
+const char* src_loc_ptr(jcc_context_t* ctx, src_loc_t loc)
+{
+	source_file_t* file = ctx->src && loc != SRC_LOC_NONE ? _get_file_for_loc(ctx->src, loc) : NULL;
+	return file ? file->range.ptr + (loc - file->loc_base) : NULL;
+}
 
-		sht_next(_files, &it);
+file_pos_t src_get_loc_info(jcc_context_t* ctx, src_loc_t loc)
+{
+	const char* pos = src_loc_ptr(ctx, loc);
+	if (!pos)
+	{
+		file_pos_t result;
+		memset(&result, 0, sizeof(file_pos_t));
+		return result;
 	}
-	return NULL;
+	return src_get_pos_info(ctx, pos);
 }
 
-file_pos_t src_get_pos_info(const char* pos)
+file_pos_t src_get_pos_info(jcc_context_t* ctx, const char* pos)
 {
 	file_pos_t result;
 	memset(&result, 0, sizeof(file_pos_t));
 	
-	source_file_t* file = _get_file_for_pos(pos);
-	if (!file)
+	//positions in a range not loaded from a file, such as the scratch space, have no line
+	source_file_t* file = _get_file_for_pos(ctx->src, pos);
+	if (!file || !file->path)
 		return result;
 
 	result.path = file->path;
 	result.file_name = file->file_name;
 
-	uint32_t line = 0;
-	for (line = 1; line < file->line_count; line++)
-	{
-		if (pos < file->lines[line])
-		{
-			if (line == 0)
-			{
-				result.line = 1;
-				result.col = (uint16_t)((pos - file->range.ptr) + 1);
-			}
-			else
-			{
-				result.line = line;
-				result.col = (uint16_t)(pos - file->lines[line - 1] + 1);
-			}
-			return result;
-		}
-	}
+	if (!file->lines)
+		_init_line_data(file);
 
-	if (pos <= file->range.end)
+	//the last line starting at or before pos
+	uint32_t lo = 1;
+	uint32_t hi = file->line_count;
+	while (lo < hi)
 	{
-		result.line = file->line_count;
-		result.col = (uint16_t)(pos - file->lines[result.line - 1] + 1);
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (file->lines[mid] <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
+	result.line = lo;
+	result.col = (uint16_t)(pos - file->lines[lo - 1] + 1);
 	return result;
 }
 
+source_range_t* src_find_file(jcc_context_t* ctx, const char* pos, const char** path)
+{
+	source_file_t* file = _get_file_for_pos(ctx->src, pos);
+	if (!file)
+		return NULL;
+	*path = file->path;
+	return &file->range;
+}
+
+uint64_t src_hash(const void* data, size_t len)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	uint64_t h = 0xcbf29ce484222325ull ^ len;
+	for (; len >= 8; p += 8, len -= 8)
+	{
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+		h ^= h >> 29;
+	}
+	for (; len; p++, len--)
+		h = (h ^ *p) * 0x100000001b3ull;
+	return h;
+}
+
 static source_file_t* _init_source(source_range_t src)
 {
-	source_file_t* file = (source_file_t*)malloc(sizeof(source_file_t));
+	source_file_t* file = (source_file_t*)mem_alloc(mc_source, sizeof(source_file_t));
 	memset(file, 0, sizeof(source_file_t));
 	
 	file->range = src;
-	_init_line_data(file);
 	return file;
 }
 
@@ -175,67 +317,180 @@ bool src_is_valid_range(source_range_t* src)
 	return src && src->ptr && src->end && src->ptr < src->end;
 }
 
-//only used by unit tests
-void src_register_range(source_range_t src, char* path)
+void src_register_range(jcc_context_t* ctx, source_range_t src, const char* path)
 {
+	mem_cat_t scope = mem_set_scope(mc_source);
 	source_file_t* file = _init_source(src);
-	file->path = path;
-	sht_insert(_files, file->path, file);
+	if (path)
+	{
+		file->path = mem_strdup(mc_source, path);
+		file->file_name = path_filename(file->path);
+		sht_insert(ctx->src->files, file->path, file);
+	}
+	_add_file(ctx->src, file);
+	mem_set_scope(scope);
 }
 
-source_file_t* _load_file(const char* dir, const char* fn)
+src_loc_t src_range_loc(jcc_context_t* ctx, source_range_t* range)
 {
-	source_range_t src = _load_cb(dir, fn, _load_data);
-	if (!src_is_valid_range(&src)) return NULL;
+	if (!ctx->src)
+		return SRC_LOC_NONE;
 
-	source_file_t* file = _init_source(src);
-	file->path = path_combine(dir, fn);
-	file->file_name = path_filename(file->path);
-	sht_insert(_files, file->path, file);
+	if (!_get_file_for_pos(ctx->src, range->ptr))
+		src_register_range(ctx, *range, NULL);
+	return src_get_loc(ctx, range->ptr);
+}
+
+const char* src_scratch(jcc_context_t* ctx, const char* str, size_t len)
+{
+	src_context_t* src = ctx->src;
+	source_file_t* block = src->scratch;
+	if (!block || src->scratch_used + len + 1 > (size_t)(block->range.end - block->range.ptr))
+	{
+		size_t sz = len + 1 > SCRATCH_BLOCK_SZ ? len + 1 : SCRATCH_BLOCK_SZ;
+		source_range_t range;
+		range.ptr = (const char*)mem_alloc(mc_source, sz);
+		range.end = range.ptr + sz;
+
+		mem_cat_t scope = mem_set_scope(mc_source);
+		block = _init_source(range);
+		block->owned = true;
+		_add_file(src, block);
+		mem_set_scope(scope);
+		src->scratch = block;
+		src->scratch_used = 0;
+	}
+
+	char* result = (char*)block->range.ptr + src->scratch_used;
+	memcpy(result, str, len);
+	result[len] = '\0';
+	src->scratch_used += len + 1;
+	return result;
+}
+
+source_file_t* _load_file(src_context_t* src, const char* dir, const char* fn)
+{
+	mem_cat_t scope = mem_set_scope(mc_source);
+	const char* path = path_combine(dir, fn);
+
+	//each path is loaded, or found to be missing, once
+	source_file_t* file = (source_file_t*)sht_lookup(src->files, path);
+	if (file || sht_contains(src->missing, path))
+	{
+		mem_free((void*)path);
+		mem_set_scope(scope);
+		return file;
+	}
+
+	source_range_t range = src->load_cb(dir, fn, src->load_data);
+	if (src_is_valid_range(&range))
+	{
+		file = _init_source(range);
+		file->mapped = src->load_cb == &src_map_file;
+		file->path = path;
+		file->file_name = path_filename(file->path);
+		sht_insert(src->files, file->path, file);
+		_add_file(src, file);
+	}
+	else
+	{
+		if (range.ptr && src->load_cb == &src_map_file)
+			file_unmap(range.ptr, range.end - range.ptr);
+		sht_insert(src->missing, path, (void*)1);
+		mem_free((void*)path);
+	}
+
+	mem_set_scope(scope);
 	return file;
 }
 
-source_range_t* src_load_header(const char* cur_dir, const char* fn, include_kind kind)
+source_range_t src_map_file(const char* dir, const char* file, void* data)
 {
-	kind;
+	data;
+	const char* path = path_combine(dir, file);
 
+	source_range_t result = { NULL, NULL };
+	size_t len = 0;
+	const char* ptr = file_map(path, &len);
+	if (ptr)
+	{
+		result.ptr = ptr;
+		result.end = ptr + len;
+	}
+	mem_free((void*)path);
+	return result;
+}
+
+static source_file_t* _search_header(src_context_t* src, const char* cur_dir, const char* fn, include_kind kind)
+{
 	source_file_t* file = NULL;
 	if (kind == include_local)
 	{
-		file = _load_file(cur_dir, fn); //local dir first if local include
+		file = _load_file(src, cur_dir, fn); //local dir first if local include
 		if (file)
-			return &file->range;
+			return file;
 	}
 
 	//search list
 	int i;
-	for (i = 0; i < MAX_INCLUDE_DIRS && _include_dirs[i]; i++)
+	for (i = 0; i < MAX_INCLUDE_DIRS && src->include_dirs[i]; i++)
 	{
-		file = _load_file(_include_dirs[i], fn);
+		file = _load_file(src, src->include_dirs[i], fn);
 		if (file)
-			return &file->range;
+			return file;
 	}
 	
 	if (kind != include_local)
-		file = _load_file(cur_dir, fn); //local dir last if system include
+		file = _load_file(src, cur_dir, fn); //local dir last if system include
+
+	return file;
+}
+
+source_range_t* src_load_header(jcc_context_t* ctx, const char* cur_dir, const char* fn, include_kind kind)
+{
+	src_context_t* src = ctx->src;
+
+	//the same search always has the same result
+	str_buff_t* key = sb_create(128);
+	sb_append_ch(key, kind == include_local ? '"' : '<');
+	sb_append(key, cur_dir);
+	sb_append_ch(key, '|');
+	sb_append(key, fn);
+
+	source_file_t* file;
+	if (sht_contains(src->headers, sb_str(key)))
+	{
+		file = (source_file_t*)sht_lookup(src->headers, sb_str(key));
+	}
+	else
+	{
+		file = _search_header(src, cur_dir, fn, kind);
+		mem_cat_t scope = mem_set_scope(mc_source);
+		sht_insert(src->headers, sb_str(key), file);
+		mem_set_scope(scope);
+	}
+	sb_destroy(key);
 
 	return file ? &file->range : NULL;
 }
 
-source_range_t* src_load_file(const char* path, const char* file_name)
+source_range_t* src_load_file(jcc_context_t* ctx, const char* path, const char* file_name)
 {
-	source_file_t* file = _load_file(path, file_name);
+	source_file_t* file = _load_file(ctx->src, path, file_name);
 	return file ? &file->range : NULL;
 }
 
-void src_add_header_path(const char* path)
+void src_add_header_path(jcc_context_t* ctx, const char* path)
 {
+	src_context_t* src = ctx->src;
 	for (int i = 0; i < MAX_INCLUDE_DIRS; i++)
 	{
-		if (!_include_dirs[i])
+		if (!src->include_dirs[i])
 		{
-			_include_dirs[i] = path_resolve(path);
-			if (!_include_dirs[i])
+			mem_cat_t scope = mem_set_scope(mc_source);
+			src->include_dirs[i] = path_resolve(path);
+			mem_set_scope(scope);
+			if (!src->include_dirs[i])
 				fprintf(stderr, "failed to resolve include path '%s'\n", path);
 			return;
 		}
@@ -243,24 +498,49 @@ void src_add_header_path(const char* path)
 	fputs("too many include paths", stderr);
 }
 
-void src_init(src_load_cb load_cb, void* load_data)
+void src_init(jcc_context_t* ctx, src_load_cb load_cb, void* load_data)
 {
-	memset((void*)_include_dirs, 0, MAX_INCLUDE_DIRS * sizeof(const char*));
-	_files = sht_create(32);
-	_load_cb = load_cb;
-	_load_data = load_data;
+	src_deinit(ctx);
+
+	mem_cat_t scope = mem_set_scope(mc_source);
+	src_context_t* src = (src_context_t*)mem_alloc(mc_source, sizeof(src_context_t));
+	memset(src, 0, sizeof(src_context_t));
+	src->files = sht_create(32);
+	src->missing = sht_create(32);
+	src->headers = sht_create(32);
+	src->next_loc = 1;
+	mem_set_scope(scope);
+	src->load_cb = load_cb;
+	src->load_data = load_data;
+	ctx->src = src;
 }
 
-void src_deinit()
+void src_deinit(jcc_context_t* ctx)
 {
-	sht_iterator_t it = sht_begin(_files);
-	while (!sht_end(_files, &it))
+	src_context_t* src = ctx->src;
+	if (!src)
+		return;
+
+	//every range with a location, including those without a path
+	for (uint32_t i = 0; i < src->file_count; i++)
 	{
-		source_file_t* sf = (source_file_t*)it.val;
-		free((void*)sf->path);
-		free((void*)sf->file_name);
-		free(sf);
-		sht_next(_files, &it);
+		source_file_t* sf = src->by_pos[i];
+		if (sf->mapped)
+			file_unmap(sf->range.ptr, sf->range.end - sf->range.ptr);
+		if (sf->owned)
+			mem_free((void*)sf->range.ptr);
+		mem_free((void*)sf->path);
+		mem_free((void*)sf->file_name);
+		mem_free((void*)sf->lines);
+		mem_free(sf);
 	}
-	ht_destroy(_files);
+	ht_destroy(src->files);
+	ht_destroy(src->missing);
+	ht_destroy(src->headers);
+	mem_free(src->by_pos);
+	mem_free(src->by_loc);
+	for (int i = 0; i < MAX_INCLUDE_DIRS; i++)
+		mem_free((void*)src->include_dirs[i]);
+	mem_free(src);
+	ctx->src = NULL;
 }
\ No newline at end of file
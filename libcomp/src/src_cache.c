@@ -0,0 +1,271 @@
+#include "src_cache.h"
+#include "jcc_context.h"
+#include "pp_internal.h"
+#include "mem_cat.h"
+
+#include <libj/include/hash_table.h>
+#include <libj/include/platform.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TOK_ARENA_BLOCK_SZ (16 * 1024)
+
+#define CACHED_LOC_BASE 1
+
+typedef struct cached_file
+{
+	source_range_t range;
+	file_info_t info;
+
+	/*
+	false for in memory ranges such as the built in definitions
+	*/
+	bool mapped;
+
+	/*
+	generation in which info was last compared with the file on disk
+	*/
+	uint32_t checked;
+
+	/*
+	tokens lexed from range, start is NULL until lexed.
+	They and their payloads are allocated from tok_arena.
+	Their locations are as if range.ptr was at location CACHED_LOC_BASE
+	*/
+	token_range_t tokens;
+	arena_t* tok_arena;
+
+	/*
+	next entry in the stale list
+	*/
+	struct cached_file* next;
+}cached_file_t;
+
+struct src_cache
+{
+	/*
+	Map of full path to cached_file_t*
+	*/
+	hash_table_t* files;
+
+	/*
+	Map of range start to cached_file_t* for all current entries
+	*/
+	hash_table_t* ranges;
+
+	/*
+	Paths found not to exist during the current generation
+	*/
+	hash_table_t* missing;
+
+	/*
+	Entries replaced during the current generation, released by the next src_cache_begin()
+	*/
+	cached_file_t* stale;
+
+	uint32_t generation;
+};
+
+static size_t _ptr_hash(void* key)
+{
+	//mappings are page aligned so mix in the high bits
+	size_t val = (size_t)key;
+	return (val >> 12) ^ (val >> 4);
+}
+
+static bool _ptr_comp(void* lhs, void* rhs)
+{
+	return lhs == rhs;
+}
+
+static void _no_destroy(void* key, void* val)
+{
+	(void)key; (void)val;
+}
+
+static void _destroy_tokens(cached_file_t* file)
+{
+	arena_destroy(file->tok_arena);
+	file->tok_arena = NULL;
+	file->tokens.start = file->tokens.end = NULL;
+}
+
+static void _destroy_file(cached_file_t* file)
+{
+	_destroy_tokens(file);
+	if (file->mapped)
+		file_unmap(file->range.ptr, file->range.end - file->range.ptr);
+	mem_free(file);
+}
+
+/*
+copy each token from range->start to range->end inclusive into arena, moving locations from the block at from to the one at to.
+When ctx is not NULL the copies are assigned ids from it and their identifiers are interned in it
+*/
+static token_range_t _copy_tokens(jcc_context_t* ctx, arena_t* arena, token_range_t* range, src_loc_t from, src_loc_t to)
+{
+	token_range_t result = { NULL, NULL };
+	token_t* tok = range->start;
+	while (tok)
+	{
+		token_t* copy = tok_copy(arena, ctx ? ctx->idents : NULL, tok);
+		copy->id = ctx ? ctx->next_tok_id++ : 0;
+		copy->loc = tok->loc != SRC_LOC_NONE && to != SRC_LOC_NONE ? tok->loc - from + to : SRC_LOC_NONE;
+		copy->next = NULL;
+		copy->prev = result.end;
+
+		if (result.end)
+			result.end->next = copy;
+		else
+			result.start = copy;
+		result.end = copy;
+
+		if (tok == range->end)
+			break;
+		tok = tok->next;
+	}
+	return result;
+}
+
+static void _retire(src_cache_t* cache, const char* path, cached_file_t* file)
+{
+	//tokens handed out during this generation may point into the file so keep it until the next
+	ht_remove(cache->ranges, (void*)file->range.ptr);
+	sht_remove(cache->files, path);
+	file->next = cache->stale;
+	cache->stale = file;
+}
+
+static void _release_stale(src_cache_t* cache)
+{
+	while (cache->stale)
+	{
+		cached_file_t* file = cache->stale;
+		cache->stale = file->next;
+		_destroy_file(file);
+	}
+}
+
+source_range_t src_cache_load(const char* dir, const char* fn, void* data)
+{
+	src_cache_t* cache = (src_cache_t*)data;
+	source_range_t result = { NULL, NULL };
+
+	const char* path = path_combine(dir, fn);
+
+	if (sht_contains(cache->missing, path))
+	{
+		mem_free((void*)path);
+		return result;
+	}
+
+	cached_file_t* file = (cached_file_t*)sht_lookup(cache->files, path);
+	if (file && file->checked != cache->generation)
+	{
+		file_info_t info;
+		if (file_info(path, &info) && info.size == file->info.size && info.mtime == file->info.mtime)
+		{
+			file->checked = cache->generation;
+		}
+		else
+		{
+			_retire(cache, path, file);
+			file = NULL;
+		}
+	}
+
+	if (!file)
+	{
+		file_info_t info;
+		size_t len = 0;
+		const char* ptr = file_info(path, &info) ? file_map(path, &len) : NULL;
+		if (!ptr)
+		{
+			sht_insert(cache->missing, path, (void*)1);
+			mem_free((void*)path);
+			return result;
+		}
+
+		file = (cached_file_t*)mem_alloc(mc_source, sizeof(cached_file_t));
+		memset(file, 0, sizeof(cached_file_t));
+		file->range.ptr = ptr;
+		file->range.end = ptr + len;
+		file->info = info;
+		file->info.size = len;
+		file->mapped = true;
+		file->checked = cache->generation;
+		sht_insert(cache->files, path, file);
+		ht_insert(cache->ranges, (void*)file->range.ptr, file);
+	}
+
+	mem_free((void*)path);
+	return file->range;
+}
+
+bool src_cache_find_tokens(jcc_context_t* ctx, src_cache_t* cache, source_range_t* sr, token_range_t* result)
+{
+	cached_file_t* file = (cached_file_t*)ht_lookup(cache->ranges, (void*)sr->ptr);
+	if (!file || !file->tokens.start || file->range.end != sr->end)
+		return false;
+
+	*result = _copy_tokens(ctx, ctx->tok_arena, &file->tokens, CACHED_LOC_BASE, src_range_loc(ctx, sr));
+	return true;
+}
+
+void src_cache_store_tokens(jcc_context_t* ctx, src_cache_t* cache, source_range_t* sr, token_range_t* toks)
+{
+	cached_file_t* file = (cached_file_t*)ht_lookup(cache->ranges, (void*)sr->ptr);
+	if (!file || file->range.end != sr->end)
+		return;
+
+	_destroy_tokens(file);
+	file->tok_arena = arena_create(mc_tokens, TOK_ARENA_BLOCK_SZ, TOK_ARENA_ALIGN);
+	file->tokens = _copy_tokens(NULL, file->tok_arena, toks, src_range_loc(ctx, sr), CACHED_LOC_BASE);
+}
+
+void src_cache_begin(src_cache_t* cache)
+{
+	_release_stale(cache);
+	ht_destroy(cache->missing);
+	cache->missing = sht_create(64);
+	cache->generation++;
+}
+
+src_cache_t* src_cache_create()
+{
+	src_cache_t* cache = (src_cache_t*)mem_alloc(mc_source, sizeof(src_cache_t));
+	memset(cache, 0, sizeof(src_cache_t));
+	cache->files = sht_create(256);
+	cache->ranges = ht_create(256, &_ptr_hash, &_ptr_comp, &_no_destroy);
+	cache->missing = sht_create(64);
+	cache->generation = 1;
+
+	//the built in definitions are lexed at the start of every compilation
+	cached_file_t* built_in = (cached_file_t*)mem_alloc(mc_source, sizeof(cached_file_t));
+	memset(built_in, 0, sizeof(cached_file_t));
+	built_in->range.ptr = pp_built_in_defs();
+	built_in->range.end = built_in->range.ptr + strlen(built_in->range.ptr);
+	ht_insert(cache->ranges, (void*)built_in->range.ptr, built_in);
+
+	return cache;
+}
+
+void src_cache_destroy(src_cache_t* cache)
+{
+	if (!cache)
+		return;
+
+	_release_stale(cache);
+
+	ht_iterator_t it = ht_begin(cache->ranges);
+	while (!ht_end(cache->ranges, &it))
+	{
+		_destroy_file((cached_file_t*)it.node->val);
+		ht_next(cache->ranges, &it);
+	}
+	ht_destroy(cache->ranges);
+	ht_destroy(cache->files);
+	ht_destroy(cache->missing);
+	mem_free(cache);
+}
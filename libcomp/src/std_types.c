@@ -13,25 +13,13 @@ static ast_type_spec_t _ll_int_type =	{ type_int64,		8, NULL };
 static ast_type_spec_t _ll_uint_type =	{ type_uint64,		8, NULL };
 
 
-ast_type_spec_t* void_type_spec = NULL;
-ast_type_spec_t* int8_type_spec = NULL;
-ast_type_spec_t* uint8_type_spec = NULL;
-ast_type_spec_t* int16_type_spec = NULL;
-ast_type_spec_t* uint16_type_spec = NULL;
-ast_type_spec_t* int32_type_spec = NULL;
-ast_type_spec_t* uint32_type_spec = NULL;
-ast_type_spec_t* int64_type_spec = NULL;
-ast_type_spec_t* uint64_type_spec = NULL;
-
-void types_init()
-{
-	void_type_spec = &_void_type;
-	int8_type_spec = &_char_type;
-	uint8_type_spec = &_uchar_type;
-	int16_type_spec = &_short_type;
-	uint16_type_spec = &_ushort_type;
-	int32_type_spec = &_int_type;
-	uint32_type_spec = &_uint_type;
-	int64_type_spec = &_ll_int_type;
-	uint64_type_spec = &_ll_uint_type;
-}
+/* initialised statically so the shared built in types are never written at runtime */
+ast_type_spec_t* void_type_spec = &_void_type;
+ast_type_spec_t* int8_type_spec = &_char_type;
+ast_type_spec_t* uint8_type_spec = &_uchar_type;
+ast_type_spec_t* int16_type_spec = &_short_type;
+ast_type_spec_t* uint16_type_spec = &_ushort_type;
+ast_type_spec_t* int32_type_spec = &_int_type;
+ast_type_spec_t* uint32_type_spec = &_uint_type;
+ast_type_spec_t* int64_type_spec = &_ll_int_type;
+ast_type_spec_t* uint64_type_spec = &_ll_uint_type;
@@ -0,0 +1,138 @@
+#include "time_trace.h"
+#include "mem_cat.h"
+
+#include <libj/include/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+typedef struct
+{
+	const char* name;
+	char* detail;
+	uint64_t start;
+	uint64_t end;
+}trace_span_t;
+
+struct time_trace
+{
+	uint64_t created;
+
+	/*
+	spans in the order they were opened
+	*/
+	trace_span_t* spans;
+	uint32_t span_count;
+	uint32_t span_capacity;
+
+	/*
+	indices of the currently open spans, innermost last
+	*/
+	uint32_t* open;
+	uint32_t open_count;
+	uint32_t open_capacity;
+};
+
+time_trace_t* trace_create()
+{
+	time_trace_t* trace = (time_trace_t*)mem_alloc(mc_general, sizeof(time_trace_t));
+	memset(trace, 0, sizeof(time_trace_t));
+	trace->created = time_now_ns();
+	return trace;
+}
+
+void trace_destroy(time_trace_t* trace)
+{
+	if (!trace)
+		return;
+
+	for (uint32_t i = 0; i < trace->span_count; i++)
+		mem_free(trace->spans[i].detail);
+	mem_free(trace->spans);
+	mem_free(trace->open);
+	mem_free(trace);
+}
+
+void trace_span_begin(time_trace_t* trace, const char* name, const char* detail)
+{
+	if (trace->span_count == trace->span_capacity)
+	{
+		trace->span_capacity = trace->span_capacity ? trace->span_capacity * 2 : 256;
+		trace->spans = (trace_span_t*)mem_realloc(trace->spans, mc_general, sizeof(trace_span_t) * trace->span_capacity);
+	}
+	if (trace->open_count == trace->open_capacity)
+	{
+		trace->open_capacity = trace->open_capacity ? trace->open_capacity * 2 : 32;
+		trace->open = (uint32_t*)mem_realloc(trace->open, mc_general, sizeof(uint32_t) * trace->open_capacity);
+	}
+
+	trace_span_t* span = &trace->spans[trace->span_count];
+	span->name = name;
+	span->detail = detail ? mem_strdup(mc_general, detail) : NULL;
+	span->end = 0;
+	trace->open[trace->open_count++] = trace->span_count++;
+
+	//read the clock last so the bookkeeping is not counted
+	span->start = time_now_ns();
+}
+
+void trace_span_end(time_trace_t* trace)
+{
+	uint64_t now = time_now_ns();
+
+	assert(trace->open_count);
+	if (trace->open_count == 0)
+		return;
+	trace->spans[trace->open[--trace->open_count]].end = now;
+}
+
+static void _write_json_str(FILE* f, const char* str)
+{
+	fputc('"', f);
+	for (const char* c = str; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			fprintf(f, "\\%c", *c);
+		else if ((unsigned char)*c < 0x20)
+			fprintf(f, "\\u%04x", (unsigned char)*c);
+		else
+			fputc(*c, f);
+	}
+	fputc('"', f);
+}
+
+bool trace_write(time_trace_t* trace, const char* path)
+{
+	FILE* f = fopen(path, "w");
+	if (!f)
+		return false;
+
+	//spans still open when the trace is written end now
+	uint64_t now = time_now_ns();
+
+	fputs("{\"traceEvents\":[", f);
+	for (uint32_t i = 0; i < trace->span_count; i++)
+	{
+		trace_span_t* span = &trace->spans[i];
+		uint64_t end = span->end ? span->end : now;
+
+		fputs(i ? ",\n" : "\n", f);
+		fputs("{\"name\":", f);
+		_write_json_str(f, span->name);
+		fprintf(f, ",\"cat\":\"jcc\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f",
+			(double)(span->start - trace->created) / 1000.0,
+			(double)(end - span->start) / 1000.0);
+		if (span->detail)
+		{
+			fputs(",\"args\":{\"detail\":", f);
+			_write_json_str(f, span->detail);
+			fputc('}', f);
+		}
+		fputc('}', f);
+	}
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", f);
+
+	return fclose(f) == 0;
+}
@@ -0,0 +1,333 @@
+#include "tok_file.h"
+#include "jcc_context.h"
+#include "mem_cat.h"
+
+#include <libj/include/platform.h>
+#include <libj/include/str_buff.h>
+#include <libj/include/hash_table.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define TOK_FILE_MAGIC 0x4b4f544a //JTOK
+
+/*
+increase when the layout or the token kinds change
+*/
+#define TOK_FILE_VERSION 1
+
+#define NO_PAYLOAD UINT32_MAX
+
+/*
+The file is the header, tok_count token records then payload_size bytes of payloads
+*/
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t src_size;
+	uint64_t src_mtime;
+	uint64_t src_hash;
+
+	/*
+	hash of the records and payloads, a partly written file is never used
+	*/
+	uint64_t body_hash;
+	uint32_t tok_count;
+	uint32_t payload_size;
+}tok_file_header_t;
+
+typedef struct
+{
+	uint32_t offset; //of the token in the source
+	uint32_t len;
+	uint8_t kind;
+	uint8_t flags;
+	uint16_t reserved;
+
+	/*
+	offset in the payloads, NO_PAYLOAD if none.
+	Identifiers and string literals have a NUL terminated string and number literals a num_payload_t.
+	Identifiers with the same spelling share one payload so each spelling is interned once when loaded
+	*/
+	uint32_t payload;
+}tok_record_t;
+
+typedef struct
+{
+	uint64_t val;
+	uint64_t is_signed;
+}num_payload_t;
+
+/*
+<dir>/<hash of path>.tok
+*/
+static str_buff_t* _tok_file_path(const char* dir, const char* path)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.tok", (unsigned long long)src_hash(path, strlen(path)));
+
+	str_buff_t* sb = sb_create(256);
+	sb_append(sb, dir);
+	sb_append_ch(sb, '/');
+	sb_append(sb, name);
+	return sb;
+}
+
+/*
+payloads are 8 byte aligned
+*/
+static size_t _payload_size(token_t* tok)
+{
+	if ((tok->kind == tok_identifier || tok->kind == tok_string_literal) && tok->data.str)
+		return (strlen(tok->data.str) + 1 + 7) & ~(size_t)7;
+	if (tok->kind == tok_num_literal && tok->data.int_val)
+		return sizeof(num_payload_t);
+	return 0;
+}
+
+/*
+the offset of tok's payload, allocating it from size if tok is not an identifier seen before
+*/
+static uint32_t _payload_offset(token_t* tok, hash_table_t* idents, size_t* size)
+{
+	size_t offset = *size;
+	if (tok->kind == tok_identifier)
+	{
+		void* existing = iht_lookup(idents, tok->data.str);
+		if (existing)
+			return (uint32_t)((size_t)existing - 1);
+		iht_insert(idents, tok->data.str, (void*)(offset + 1));
+	}
+	*size += _payload_size(tok);
+	return (uint32_t)offset;
+}
+
+static bool _valid_payload(tok_record_t* rec, const char* payloads, uint32_t payload_size)
+{
+	if (rec->payload == NO_PAYLOAD)
+		return true;
+	if (rec->payload >= payload_size)
+		return false;
+
+	if (rec->kind == tok_identifier && rec->payload % 8)
+		return false;
+	if (rec->kind == tok_identifier || rec->kind == tok_string_literal)
+		return memchr(payloads + rec->payload, 0, payload_size - rec->payload) != NULL;
+	if (rec->kind == tok_num_literal)
+		return payload_size - rec->payload >= sizeof(num_payload_t);
+	return false;
+}
+
+/*
+idents holds the interned spelling of each identifier payload, by offset / 8.
+base is the location of the source range
+*/
+static token_t* _create_tok(tok_record_t* rec, src_loc_t base, const char* payloads, const char** idents)
+{
+	token_t* tok = tok_create();
+	tok->loc = base != SRC_LOC_NONE ? base + rec->offset : SRC_LOC_NONE;
+	tok->len = rec->len;
+	tok->kind = rec->kind;
+	tok->flags = rec->flags;
+
+	if (rec->payload == NO_PAYLOAD)
+		return tok;
+
+	const char* payload = payloads + rec->payload;
+	if (rec->kind == tok_identifier)
+	{
+		const char** ident = &idents[rec->payload / 8];
+		if (!*ident)
+			*ident = tok_intern(payload, strlen(payload));
+		tok->data.str = *ident;
+	}
+	else if (rec->kind == tok_string_literal)
+	{
+		tok->data.str = tok_alloc_str(payload, strlen(payload));
+	}
+	else
+	{
+		num_payload_t num;
+		memcpy(&num, payload, sizeof(num_payload_t));
+		int_val_t val = num.is_signed ? int_val_signed((int64_t)num.val) : int_val_unsigned(num.val);
+		tok->data.int_val = tok_alloc_int_val(val);
+	}
+	return tok;
+}
+
+static bool _load(jcc_context_t* ctx, const char* data, size_t len, file_info_t* info, source_range_t* sr, token_range_t* result)
+{
+	tok_file_header_t header;
+	if (len < sizeof(tok_file_header_t))
+		return false;
+	memcpy(&header, data, sizeof(tok_file_header_t));
+
+	size_t body_len = len - sizeof(tok_file_header_t);
+	if (header.magic != TOK_FILE_MAGIC ||
+		header.version != TOK_FILE_VERSION ||
+		header.src_size != info->size ||
+		header.src_mtime != info->mtime ||
+		header.tok_count == 0 ||
+		(uint64_t)header.tok_count * sizeof(tok_record_t) + header.payload_size != body_len)
+		return false;
+
+	const char* body = data + sizeof(tok_file_header_t);
+	if (src_hash(body, body_len) != header.body_hash ||
+		src_hash(sr->ptr, (size_t)(sr->end - sr->ptr)) != header.src_hash)
+		return false;
+
+	const char* payloads = body + (size_t)header.tok_count * sizeof(tok_record_t);
+	for (uint32_t i = 0; i < header.tok_count; i++)
+	{
+		tok_record_t rec;
+		memcpy(&rec, body + i * sizeof(tok_record_t), sizeof(tok_record_t));
+		if (rec.kind > tok_string_literal ||
+			(uint64_t)rec.offset + rec.len > header.src_size ||
+			!_valid_payload(&rec, payloads, header.payload_size))
+			return false;
+	}
+
+	size_t idents_size = sizeof(const char*) * (header.payload_size / 8 + 1);
+	const char** idents = (const char**)mem_alloc(mc_tokens, idents_size);
+	memset(idents, 0, idents_size);
+
+	src_loc_t base = src_range_loc(ctx, sr);
+	result->start = result->end = NULL;
+	for (uint32_t i = 0; i < header.tok_count; i++)
+	{
+		tok_record_t rec;
+		memcpy(&rec, body + i * sizeof(tok_record_t), sizeof(tok_record_t));
+		token_t* tok = _create_tok(&rec, base, payloads, idents);
+		tok->prev = result->end;
+		if (result->end)
+			result->end->next = tok;
+		else
+			result->start = tok;
+		result->end = tok;
+	}
+	mem_free(idents);
+	return result->end->kind == tok_eof;
+}
+
+bool tok_file_load(jcc_context_t* ctx, const char* dir, const char* path, source_range_t* sr, token_range_t* result)
+{
+	file_info_t info;
+	if (!file_info(path, &info) || info.size != (uint64_t)(sr->end - sr->ptr))
+		return false;
+
+	jcc_ctx_set(ctx);
+	str_buff_t* tok_path = _tok_file_path(dir, path);
+	size_t len = 0;
+	const char* data = file_map(sb_str(tok_path), &len);
+	sb_destroy(tok_path);
+	if (!data)
+		return false;
+
+	mem_cat_t scope = mem_set_scope(mc_tokens);
+	bool loaded = _load(ctx, data, len, &info, sr, result);
+	mem_set_scope(scope);
+
+	file_unmap(data, len);
+	return loaded;
+}
+
+bool tok_file_store(jcc_context_t* ctx, const char* dir, const char* path, source_range_t* sr, token_range_t* toks)
+{
+	file_info_t info;
+	if (!file_info(path, &info) || info.size != (uint64_t)(sr->end - sr->ptr))
+		return false;
+
+	src_loc_t base = src_range_loc(ctx, sr);
+	if (base == SRC_LOC_NONE)
+		return false;
+
+	tok_file_header_t header;
+	memset(&header, 0, sizeof(tok_file_header_t));
+	header.magic = TOK_FILE_MAGIC;
+	header.version = TOK_FILE_VERSION;
+	header.src_size = info.size;
+	header.src_mtime = info.mtime;
+	header.src_hash = src_hash(sr->ptr, (size_t)info.size);
+
+	//the first pass counts the tokens and places the payloads
+	hash_table_t* idents = iht_create(256);
+	size_t payload_size = 0;
+	for (token_t* tok = toks->start; tok; tok = tok == toks->end ? NULL : tok->next)
+	{
+		header.tok_count++;
+		_payload_offset(tok, idents, &payload_size);
+	}
+	if (payload_size >= NO_PAYLOAD)
+	{
+		ht_destroy(idents);
+		return false;
+	}
+	header.payload_size = (uint32_t)payload_size;
+
+	size_t body_len = header.tok_count * sizeof(tok_record_t) + payload_size;
+	uint8_t* body = (uint8_t*)mem_alloc(mc_tokens, body_len);
+	memset(body, 0, body_len);
+
+	tok_record_t* rec = (tok_record_t*)body;
+	uint8_t* payloads = body + header.tok_count * sizeof(tok_record_t);
+	size_t written = 0;
+	for (token_t* tok = toks->start; tok; tok = tok == toks->end ? NULL : tok->next, rec++)
+	{
+		rec->offset = tok->loc - base;
+		rec->len = tok->len;
+		rec->kind = tok->kind;
+		rec->flags = tok->flags;
+		rec->payload = NO_PAYLOAD;
+
+		if (_payload_size(tok) == 0)
+			continue;
+
+		//placed in the same order as the first pass, an identifier seen before is already written
+		rec->payload = tok->kind == tok_identifier ? (uint32_t)((size_t)iht_lookup(idents, tok->data.str) - 1) : (uint32_t)written;
+		if (rec->payload != written)
+			continue;
+
+		if (tok->kind == tok_num_literal)
+		{
+			num_payload_t num = { tok->data.int_val->v.uint64, tok->data.int_val->is_signed };
+			memcpy(payloads + rec->payload, &num, sizeof(num_payload_t));
+		}
+		else
+		{
+			memcpy(payloads + rec->payload, tok->data.str, strlen(tok->data.str));
+		}
+		written += _payload_size(tok);
+	}
+	ht_destroy(idents);
+	header.body_hash = src_hash(body, body_len);
+
+	//written under a unique name then renamed so other processes only see complete files
+	str_buff_t* final_path = _tok_file_path(dir, path);
+	str_buff_t* tmp_path = sb_create(256);
+	sb_append(tmp_path, sb_str(final_path));
+	char suffix[48];
+	snprintf(suffix, sizeof(suffix), ".%llx.%llx.tmp", (unsigned long long)time_now_ns(), (unsigned long long)(size_t)body);
+	sb_append(tmp_path, suffix);
+
+	bool result = false;
+	FILE* f = fopen(sb_str(tmp_path), "wb");
+	if (f)
+	{
+		result = fwrite(&header, sizeof(tok_file_header_t), 1, f) == 1 &&
+			fwrite(body, 1, body_len, f) == body_len;
+		result = fclose(f) == 0 && result;
+		if (result)
+		{
+			remove(sb_str(final_path));
+			result = rename(sb_str(tmp_path), sb_str(final_path)) == 0;
+		}
+		if (!result)
+			remove(sb_str(tmp_path));
+	}
+
+	mem_free(body);
+	sb_destroy(tmp_path);
+	sb_destroy(final_path);
+	return result;
+}
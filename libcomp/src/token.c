@@ -1,4 +1,6 @@
 #include "token.h"
+#include "jcc_context.h"
+#include "mem_cat.h"
 
 #include <libj/include/str_buff.h>
 
@@ -197,9 +199,12 @@ const char* tok_kind_spelling(tok_kind k)
 size_t tok_spelling_len(token_t* tok)
 {
 	size_t len = 0;
-	const char* src = tok->loc;
+	const char* spelling = tok_spelling(tok);
+	if (!spelling)
+		return 0;
+	const char* src = spelling;
 
-	while (src < (tok->loc + tok->len))
+	while (src < (spelling + tok->len))
 	{
 		if (*src == '\\')
 		{
@@ -222,6 +227,9 @@ size_t tok_spelling_len(token_t* tok)
 
 void tok_spelling_extract(const char* src_loc, size_t src_len, str_buff_t* result)
 {
+	if (!src_loc)
+		return;
+
 	const char* src = src_loc;
 	while (src < src_loc + src_len)
 	{
@@ -253,12 +261,22 @@ void tok_spelling_cpy(token_t* tok, char* dest, size_t dest_len)
 	else
 	{
 		str_buff_t* sb = sb_create(dest_len);
-		tok_spelling_extract(tok->loc, tok->len, sb);
+		tok_spelling_extract(tok_spelling(tok), tok->len, sb);
 		strncpy(dest, sb_str(sb), dest_len);
 		sb_destroy(sb);
 	}
 }
 
+src_loc_t tok_loc(token_t* tok)
+{
+	return tok ? tok->loc : SRC_LOC_NONE;
+}
+
+const char* tok_spelling(token_t* tok)
+{
+	return src_loc_ptr(jcc_ctx(), tok->loc);
+}
+
 token_t* tok_find_next(token_t* start, tok_kind kind)
 {
 	token_t* tok = start;
@@ -273,16 +291,6 @@ token_t* tok_find_next(token_t* start, tok_kind kind)
 	return NULL;
 }
 
-void tok_destory(token_t* tok)
-{
-	if (!tok) return;
-	if (tok->kind == tok_string_literal || tok->kind == tok_identifier)
-	{
-		free(tok->data.str);
-	}
-	free(tok);
-}
-
 
 /*
 Two replacement lists are identical if and only if the preprocessing tokens in both have
@@ -297,10 +305,12 @@ bool tok_equals(token_t* lhs, token_t* rhs)
 	if (!result)
 		return false;
 
-	if (lhs->kind == tok_identifier || lhs->kind == tok_string_literal)
-		result = strcmp(lhs->data.str, rhs->data.str) == 0;		
+	if (lhs->kind == tok_identifier)
+		result = lhs->data.str == rhs->data.str;
+	else if (lhs->kind == tok_string_literal)
+		result = strcmp(lhs->data.str, rhs->data.str) == 0;
 	else if (lhs->kind == tok_num_literal)
-		result = int_val_eq(&lhs->data.int_val, &rhs->data.int_val);
+		result = int_val_eq(lhs->data.int_val, rhs->data.int_val);
 	return result;
 }
 
@@ -321,13 +331,90 @@ bool tok_range_equals(token_range_t* lhr, token_range_t* rhr)
 	return lhs == lhr->end && rhs == rhr->end;
 }
 
+static token_t* _alloc_tok()
+{
+	jcc_context_t* ctx = jcc_ctx();
+	token_t* tok = ctx->free_toks;
+	if (tok)
+	{
+		ctx->free_toks = tok->next;
+		return tok;
+	}
+	return (token_t*)arena_alloc(ctx->tok_arena, sizeof(token_t));
+}
+
 token_t* tok_duplicate(token_t* tok)
 {
-	token_t* result = (token_t*)malloc(sizeof(token_t));
+	token_t* result = _alloc_tok();
+	*result = *tok;
+	return result;
+}
+
+void tok_release(token_t* tok)
+{
+	jcc_context_t* ctx = jcc_ctx();
+	tok->next = ctx->free_toks;
+	ctx->free_toks = tok;
+}
+
+void tok_range_release(token_range_t* range)
+{
+	token_t* tok = range->start;
+	while (tok && tok != range->end)
+	{
+		token_t* next = tok->next;
+		tok_release(tok);
+		tok = next;
+	}
+	if (range->end)
+		tok_release(range->end);
+	range->start = range->end = NULL;
+}
+
+static char* _copy_str(arena_t* arena, const char* str, size_t len)
+{
+	char* result = (char*)arena_alloc(arena, len + 1);
+	memcpy(result, str, len);
+	return result;
+}
+
+token_t* tok_copy(arena_t* arena, intern_table_t* idents, token_t* tok)
+{
+	token_t* result = (token_t*)arena_alloc(arena, sizeof(token_t));
 	*result = *tok;
+	if (tok->kind == tok_identifier && tok->data.str && idents)
+	{
+		result->data.str = intern_cstr(idents, tok->data.str);
+	}
+	else if ((tok->kind == tok_identifier || tok->kind == tok_string_literal) && tok->data.str)
+	{
+		result->data.str = _copy_str(arena, tok->data.str, strlen(tok->data.str));
+	}
+	else if (tok->kind == tok_num_literal && tok->data.int_val)
+	{
+		result->data.int_val = (int_val_t*)arena_alloc(arena, sizeof(int_val_t));
+		*result->data.int_val = *tok->data.int_val;
+	}
+	return result;
+}
+
+int_val_t* tok_alloc_int_val(int_val_t val)
+{
+	int_val_t* result = (int_val_t*)arena_alloc(jcc_ctx()->tok_arena, sizeof(int_val_t));
+	*result = val;
 	return result;
 }
 
+char* tok_alloc_str(const char* str, size_t len)
+{
+	return _copy_str(jcc_ctx()->tok_arena, str, len);
+}
+
+const char* tok_intern(const char* str, size_t len)
+{
+	return intern_str(jcc_ctx()->idents, str, len);
+}
+
 void tok_printf(token_t* tok)
 {
 	if (tok->flags & TF_START_LINE)
@@ -336,7 +423,7 @@ void tok_printf(token_t* tok)
 		printf(" ");
 
 	str_buff_t* sb = sb_create(128);
-	tok_spelling_extract(tok->loc, tok->len, sb);
+	tok_spelling_extract(tok_spelling(tok), tok->len, sb);
 	printf("%s", sb->buff);
 	sb_destroy(sb);
 }
@@ -353,15 +440,11 @@ void tok_range_print(token_range_t* range)
 	printf("\n");
 }
 
-static uint32_t _next = 1;
-
 token_t* tok_create()
 {
-	token_t* tok = (token_t*)malloc(sizeof(token_t));
+	token_t* tok = _alloc_tok();
 	memset(tok, 0, sizeof(token_t));
-
-	tok->id = _next;
-	_next++;
+	tok->id = jcc_ctx()->next_tok_id++;
 
 	return tok;
 }
@@ -373,27 +456,12 @@ token_range_t* tok_range_dup(token_range_t* range)
 
 token_range_t* tok_range_create(token_t* start, token_t* end)
 {
-	token_range_t* range = (token_range_t*)malloc(sizeof(token_range_t));
+	token_range_t* range = (token_range_t*)mem_alloc(mc_tokens, sizeof(token_range_t));
 	range->start = start;
 	range->end = end;
 	return range;
 }
 
-void tok_range_destroy(token_range_t* range)
-{
-	token_t* tok = range->start;
-
-	while(tok)
-	{
-		token_t* next = tok->next;
-		tok_destory(tok);
-
-		if (tok == range->end)
-			break;
-		tok = next;
-	};
-}
-
 bool tok_range_empty(token_range_t* range)
 {
 	return range->start == range->end;
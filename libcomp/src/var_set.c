@@ -1,5 +1,6 @@
 #include "var_set.h"
 #include "diag.h"
+#include "mem_cat.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,20 +11,26 @@
 
 static var_data_t* _make_stack_var(int bsp_offset, const char* name)
 {
-	var_data_t* var = (var_data_t*)malloc(sizeof(var_data_t));
+	var_data_t* var = (var_data_t*)mem_alloc(mc_codegen, sizeof(var_data_t));
 	memset(var, 0, sizeof(var_data_t));
 	var->kind = var_stack;
 	var->bsp_offset = bsp_offset;
-	strcpy(var->name, name);
+	var->name = name;
 	return var;
 }
 
+static void _destroy_var(var_data_t* var)
+{
+	mem_free(var->global_name);
+	mem_free(var);
+}
+
 static var_data_t* var_cur_block_find(var_set_t* vars, const char* name)
 {
 	var_data_t* var = vars->vars;
 	while (var && var->kind != var_block_mark)
 	{
-		if (strcmp(name, var->name) == 0)
+		if (name == var->name)
 			return var;
 
 		var = var->next;
@@ -41,15 +48,15 @@ void var_destory_set(var_set_t* vars)
 	while (var)
 	{
 		next = var->next;
-		free(var);
+		_destroy_var(var);
 		var = next;
 	}
-	free(vars);
+	mem_free(vars);
 }
 
 var_set_t* var_init_set()
 {
-	var_set_t* set = (var_set_t*)malloc(sizeof(var_set_t));
+	var_set_t* set = (var_set_t*)mem_alloc(mc_codegen, sizeof(var_set_t));
 	memset(set, 0, sizeof(var_set_t));
 	var_enter_block(set); //make an initial block marker with bsp_offset of 0
 	set->global_marker = set->vars;
@@ -97,7 +104,7 @@ void var_leave_function(var_set_t* vars)
 		}
 
 		var_data_t* next = var->next;
-		free(var);
+		_destroy_var(var);
 		var = next;
 	}
 	assert(false);
@@ -105,7 +112,7 @@ void var_leave_function(var_set_t* vars)
 
 void var_enter_block(var_set_t* vars)
 {
-	var_data_t* var = _make_stack_var(vars->bsp_offset, "");
+	var_data_t* var = _make_stack_var(vars->bsp_offset, NULL);
 	var->kind = var_block_mark;
 	// add to start of list
 	var->next = vars->vars;
@@ -123,12 +130,12 @@ void var_leave_block(var_set_t* vars)
 			int bsp_end = var->bsp_offset;
 			vars->vars = var->next;
 			vars->bsp_offset = bsp_end;
-			free(var);
+			_destroy_var(var);
 			return;
 		}
 
 		var_data_t* next = var->next;
-		free(var);
+		_destroy_var(var);
 		var = next;
 	}
 	assert(false);
@@ -165,7 +172,9 @@ var_data_t* var_decl_global_var(var_set_t* vars, ast_declaration_t* decl)
 	var->kind = var_global;
 	var->var_decl = decl;
 
-	sprintf(var->global_name, "_var_%s", var->name);
+	size_t len = strlen(var->name) + 6;
+	var->global_name = (char*)mem_alloc(mc_codegen, len);
+	snprintf(var->global_name, len, "_var_%s", var->name);
 
 	//insert after global marker
 	var->next = vars->global_marker->next;
@@ -180,7 +189,7 @@ var_data_t* var_find(var_set_t* vars, const char* name)
 	// Search from most recently declared variable
 	while (var)
 	{
-		if (strcmp(name, var->name) == 0)
+		if (name == var->name)
 			return var;
 		var = var->next;
 	}
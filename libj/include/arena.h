@@ -0,0 +1,35 @@
+#pragma once
+
+//bump allocator. Memory is released all at once when the arena is destroyed
+
+#include "mem.h"
+
+#include <stddef.h>
+
+typedef struct arena arena_t;
+
+/*
+alignment suitable for any type
+*/
+#define ARENA_ALIGN 16
+
+/*
+create an empty arena which allocates blocks of block_sz bytes in category cat.
+Each allocation is rounded up to align, a power of two no greater than ARENA_ALIGN
+*/
+arena_t* arena_create(mem_cat_t cat, size_t block_sz, size_t align);
+
+/*
+release the arena and everything allocated from it
+*/
+void arena_destroy(arena_t* arena);
+
+/*
+allocate sz bytes of zero filled memory, aligned as given to arena_create()
+*/
+void* arena_alloc(arena_t* arena, size_t sz);
+
+/*
+number of bytes allocated from the arena
+*/
+size_t arena_used(arena_t* arena);
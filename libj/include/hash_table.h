@@ -4,25 +4,44 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "mem.h"
+
 typedef size_t (*ht_hash_fn)(void*);
 typedef bool (*ht_key_comp_fn)(void*, void*);
 typedef void (*ht_destroy_item_fn)(void*, void*);
 
+/*
+a slot in the table, empty when hash is 0
+*/
 typedef struct ht_node
 {
 	void* key;
 	void* val;
-	struct ht_node* next;
+	uint32_t hash;
 }ht_node_t;
 
+/*
+open addressing hash table with linear probing.
+The table grows to keep its load below 3/4 and removal shifts later entries back so no tombstones are left.
+Inserting a key which is already present replaces its item, destroying the old key and item
+*/
 typedef struct
 {
 	ht_hash_fn hash;
 	ht_key_comp_fn key_comp;
 	ht_destroy_item_fn destory_item;
 
+	/*
+	number of slots, a power of 2
+	*/
 	uint32_t sz;
-	ht_node_t** table;
+	uint32_t count;
+	ht_node_t* table;
+
+	/*
+	category of the table's allocations, the caller's scope when created
+	*/
+	mem_cat_t cat;
 }hash_table_t;
 
 typedef struct
@@ -31,6 +50,9 @@ typedef struct
 	ht_node_t* node;
 }ht_iterator_t;
 
+/*
+sz is the number of items expected, the table grows beyond it as required
+*/
 hash_table_t* ht_create(uint32_t sz, ht_hash_fn hash, ht_key_comp_fn key_comp, ht_destroy_item_fn destroy_item);
 void ht_destroy(hash_table_t* ht);
 void ht_insert(hash_table_t* ht, void* key, void* item);
@@ -61,6 +83,16 @@ sht_iterator_t sht_begin(hash_table_t* ht);
 bool sht_end(hash_table_t* ht, sht_iterator_t* it);
 bool sht_next(hash_table_t* ht, sht_iterator_t* it);
 
+/* interned string hash table
+keys are strings from an intern_table_t, hashed with their stored hash and compared by pointer.
+Keys are not copied
+*/
+hash_table_t* iht_create(uint32_t sz);
+void iht_insert(hash_table_t* ht, const char* key, void* val);
+bool iht_contains(hash_table_t* ht, const char* key);
+bool iht_remove(hash_table_t* ht, const char* key);
+void* iht_lookup(hash_table_t* ht, const char* key);
+
 /* pointer hash set */
 typedef struct
 {
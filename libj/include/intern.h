@@ -0,0 +1,68 @@
+#pragma once
+
+//string interning. Each distinct string is stored once so equal strings can be compared by pointer
+
+#include "mem.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct intern_table intern_table_t;
+
+/*
+create an empty table which allocates in category cat
+*/
+intern_table_t* intern_create(mem_cat_t cat);
+
+/*
+destroy the table and every string interned in it
+*/
+void intern_destroy(intern_table_t* table);
+
+/*
+the interned copy of the len bytes at str, which need not be NUL terminated.
+The result is NUL terminated and lives as long as the table
+*/
+const char* intern_str(intern_table_t* table, const char* str, size_t len);
+
+/*
+as intern_str() for a NUL terminated string
+*/
+const char* intern_cstr(intern_table_t* table, const char* str);
+
+/*
+the interned copy of str[0..len) or NULL if it has not been interned
+*/
+const char* intern_find(intern_table_t* table, const char* str, size_t len);
+
+/*
+number of distinct strings in the table
+*/
+uint32_t intern_count(intern_table_t* table);
+
+/*
+hash of len bytes at str, as stored with interned strings
+*/
+uint32_t intern_hash_str(const char* str, size_t len);
+
+/*
+each interned string is preceded by its hash and length
+*/
+typedef struct
+{
+	uint32_t hash;
+	uint32_t len;
+}intern_header_t;
+
+/*
+hash and length of an interned string, without rehashing it
+*/
+static inline uint32_t intern_hash(const char* interned)
+{
+	return ((const intern_header_t*)interned - 1)->hash;
+}
+
+static inline uint32_t intern_len(const char* interned)
+{
+	return ((const intern_header_t*)interned - 1)->len;
+}
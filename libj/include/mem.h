@@ -0,0 +1,69 @@
+#pragma once
+
+//memory allocation. libj and its users allocate through the installed allocator
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+Allocations are tagged with a category, a small integer whose meaning is defined by the user of the library
+*/
+#define MEM_MAX_CATEGORIES 16
+typedef uint8_t mem_cat_t;
+
+typedef struct
+{
+	void* (*alloc)(mem_cat_t cat, size_t size, void* data);
+	void* (*realloc)(void* ptr, mem_cat_t cat, size_t size, void* data);
+	void (*free)(void* ptr, void* data);
+	void* data;
+}allocator_t;
+
+/*
+Install an allocator.
+Must be called before anything is allocated as blocks cannot be freed by a different allocator
+*/
+void mem_set_allocator(const allocator_t* allocator);
+
+void* mem_alloc(mem_cat_t cat, size_t size);
+
+/*
+cat is used when ptr is NULL, otherwise the block keeps its category
+*/
+void* mem_realloc(void* ptr, mem_cat_t cat, size_t size);
+
+void mem_free(void* ptr);
+
+char* mem_strdup(mem_cat_t cat, const char* str);
+
+/*
+The category used by the calling thread for allocations made on its behalf by libj,
+such as containers and returned strings.
+mem_set_scope() returns the previous category
+*/
+mem_cat_t mem_set_scope(mem_cat_t cat);
+mem_cat_t mem_scope();
+
+/*
+allocation statistics for a category
+*/
+typedef struct
+{
+	uint64_t count;		//number of allocations
+	uint64_t total;		//bytes allocated
+	uint64_t current;	//bytes currently allocated
+	uint64_t peak;		//highest value of current
+}mem_stats_t;
+
+/*
+Install an allocator which records mem_stats_t for each category. Has no effect if already installed
+*/
+void mem_enable_stats();
+
+/*
+statistics for cat or, when cat is MEM_ALL_CATEGORIES, for all allocations.
+returns false if statistics are not enabled
+*/
+#define MEM_ALL_CATEGORIES MEM_MAX_CATEGORIES
+bool mem_get_stats(mem_cat_t cat, mem_stats_t* stats);
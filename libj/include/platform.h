@@ -6,8 +6,81 @@
 #define PLATFORM_WIN
 #endif
 
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef PLATFORM_LINUX
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL __declspec(thread)
+#endif
+
 const char* path_resolve(const char* path);
 const char* path_dirname(const char* path);
 const char* path_filename(const char* path);
 const char* path_combine(const char* dir, const char* file);
-char* path_convert_slashes(char* path);
\ No newline at end of file
+char* path_convert_slashes(char* path);
+
+/*
+threads
+thread_t and mutex_t are allocated with malloc rather than mem_alloc as the statistics allocator uses a mutex
+*/
+typedef struct thread thread_t;
+typedef void (*thread_fn)(void* data);
+
+/*
+start a thread running fn(data)
+*/
+thread_t* thread_start(thread_fn fn, void* data);
+
+/*
+wait for the thread to finish and free it
+*/
+void thread_join(thread_t* thread);
+
+/*
+number of processors available to the process
+*/
+uint32_t cpu_count();
+
+/*
+monotonic clock in nanoseconds
+*/
+uint64_t time_now_ns();
+
+/*
+mutex
+*/
+typedef struct mutex mutex_t;
+
+mutex_t* mutex_create();
+void mutex_destroy(mutex_t* mutex);
+void mutex_lock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
+
+/*
+size and last modification time of a regular file
+*/
+typedef struct
+{
+	uint64_t size;
+	uint64_t mtime; //nanoseconds
+}file_info_t;
+
+/*
+returns false if path does not name a regular file
+*/
+bool file_info(const char* path, file_info_t* info);
+
+/*
+map a file into memory read only. Returns NULL if the file cannot be opened.
+The mapping is followed by at least one zero byte so the contents can be treated as a NUL terminated string.
+len receives the size of the file, excluding the terminator
+*/
+const char* file_map(const char* path, size_t* len);
+
+/*
+release a mapping returned by file_map()
+*/
+void file_unmap(const char* ptr, size_t len);
@@ -16,6 +16,12 @@ str_buff_t* sb_create(size_t sz);
 //append str and return internal buffer
 char* sb_append(str_buff_t* sb, const char* str);
 
+//append len chars of str and return internal buffer
+char* sb_append_len(str_buff_t* sb, const char* str, size_t len);
+
+//empty the buffer, keeping its allocation
+void sb_clear(str_buff_t* sb);
+
 char* sb_str(str_buff_t* sb);
 
 //append int and return internal buffer
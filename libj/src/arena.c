@@ -0,0 +1,100 @@
+#include "arena.h"
+
+#include <assert.h>
+#include <string.h>
+
+typedef struct arena_block
+{
+	struct arena_block* next;
+	size_t sz;
+}arena_block_t;
+
+//block data starts after the header, keeping the alignment
+#define BLOCK_HEADER_SZ ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena
+{
+	mem_cat_t cat;
+	size_t block_sz;
+	size_t align;
+
+	/*
+	free space in the current block
+	*/
+	char* pos;
+	char* end;
+
+	/*
+	all blocks, most recent first
+	*/
+	arena_block_t* blocks;
+
+	size_t used;
+};
+
+static arena_block_t* _alloc_block(arena_t* arena, size_t sz)
+{
+	arena_block_t* block = (arena_block_t*)mem_alloc(arena->cat, BLOCK_HEADER_SZ + sz);
+	memset(block, 0, BLOCK_HEADER_SZ + sz);
+	block->sz = sz;
+	block->next = arena->blocks;
+	arena->blocks = block;
+	return block;
+}
+
+arena_t* arena_create(mem_cat_t cat, size_t block_sz, size_t align)
+{
+	assert(align && align <= ARENA_ALIGN && (align & (align - 1)) == 0);
+
+	arena_t* arena = (arena_t*)mem_alloc(cat, sizeof(arena_t));
+	memset(arena, 0, sizeof(arena_t));
+	arena->cat = cat;
+	arena->block_sz = block_sz;
+	arena->align = align;
+	return arena;
+}
+
+void arena_destroy(arena_t* arena)
+{
+	if (!arena)
+		return;
+
+	arena_block_t* block = arena->blocks;
+	while (block)
+	{
+		arena_block_t* next = block->next;
+		mem_free(block);
+		block = next;
+	}
+	mem_free(arena);
+}
+
+void* arena_alloc(arena_t* arena, size_t sz)
+{
+	sz = (sz + arena->align - 1) & ~(arena->align - 1);
+	arena->used += sz;
+
+	if ((size_t)(arena->end - arena->pos) >= sz)
+	{
+		void* result = arena->pos;
+		arena->pos += sz;
+		return result;
+	}
+
+	if (sz > arena->block_sz / 4)
+	{
+		//large allocations get a block of their own so the rest of the current block is not wasted
+		arena_block_t* block = _alloc_block(arena, sz);
+		return (char*)block + BLOCK_HEADER_SZ;
+	}
+
+	arena_block_t* block = _alloc_block(arena, arena->block_sz);
+	arena->pos = (char*)block + BLOCK_HEADER_SZ + sz;
+	arena->end = (char*)block + BLOCK_HEADER_SZ + arena->block_sz;
+	return (char*)block + BLOCK_HEADER_SZ;
+}
+
+size_t arena_used(arena_t* arena)
+{
+	return arena->used;
+}
@@ -1,140 +1,174 @@
 #include "hash_table.h"
+#include "intern.h"
 
 #include <stdio.h>
 #include <string.h>
 
+#define HT_MIN_SZ 8
+
+/*
+mix the user's hash so the low bits used to index the table depend on all of it,
+pointer hashes in particular have their low bits clear. 0 marks an empty slot
+*/
+static inline uint32_t _slot_hash(hash_table_t* ht, void* key)
+{
+	uint64_t h = (uint64_t)ht->hash(key) * 0x9E3779B97F4A7C15ull;
+	uint32_t result = (uint32_t)(h >> 32);
+	return result ? result : 1;
+}
+
+static ht_node_t* _alloc_table(mem_cat_t cat, uint32_t sz)
+{
+	ht_node_t* table = (ht_node_t*)mem_alloc(cat, sizeof(ht_node_t) * sz);
+	memset(table, 0, sizeof(ht_node_t) * sz);
+	return table;
+}
+
 hash_table_t* ht_create(uint32_t sz, ht_hash_fn hash, ht_key_comp_fn key_comp, ht_destroy_item_fn destroy_item)
 {
-	hash_table_t* ht = (hash_table_t*)malloc(sizeof(hash_table_t));
+	mem_cat_t cat = mem_scope();
+	hash_table_t* ht = (hash_table_t*)mem_alloc(cat, sizeof(hash_table_t));
 	memset(ht, 0, sizeof(hash_table_t));
+	ht->cat = cat;
 	
 	ht->hash = hash;
 	ht->key_comp = key_comp;
 	ht->destory_item = destroy_item;
-	ht->sz = sz;
-	ht->table = (ht_node_t**)malloc(sizeof(ht_node_t*) * ht->sz);
-	memset(ht->table, 0, sizeof(ht_node_t*) * ht->sz);
+
+	//room for sz items without growing
+	ht->sz = HT_MIN_SZ;
+	while (ht->sz / 4 * 3 < sz)
+		ht->sz *= 2;
+	ht->table = _alloc_table(cat, ht->sz);
 	return ht;
 }
 
 void ht_destroy(hash_table_t* ht)
 {
-	for (uint32_t i = 0;i < ht->sz; i++)
+	for (uint32_t i = 0; i < ht->sz; i++)
 	{
-		ht_node_t* node = ht->table[i];
-
-		while (node)
-		{
-			ht_node_t* next = node->next;
+		ht_node_t* node = &ht->table[i];
+		if (node->hash)
 			ht->destory_item(node->key, node->val);
-			free(node);
-			node = next;
-		}
 	}
 
-	free(ht->table);
-	free(ht);
+	mem_free(ht->table);
+	mem_free(ht);
 }
 
-void ht_insert(hash_table_t* ht, void* key, void* val)
+static void _place(ht_node_t* table, uint32_t sz, ht_node_t* node)
 {
-	uint32_t h = ht->hash(key) % ht->sz;
-
-	ht_node_t* node = (ht_node_t*)malloc(sizeof(ht_node_t));
-	node->key = key;
-	node->val = val;
-	node->next = NULL;
-	if (!ht->table[h])
-	{
-		ht->table[h] = node;
-	}
-	else
-	{
-		node->next = ht->table[h];
-		ht->table[h] = node;
-	}
+	uint32_t mask = sz - 1;
+	uint32_t idx = node->hash & mask;
+	while (table[idx].hash)
+		idx = (idx + 1) & mask;
+	table[idx] = *node;
 }
 
-bool ht_contains(hash_table_t* ht, void* key)
+static void _grow(hash_table_t* ht)
 {
-	uint32_t h = ht->hash(key) % ht->sz;
-	ht_node_t* node = ht->table[h];
+	uint32_t sz = ht->sz * 2;
+	ht_node_t* table = _alloc_table(ht->cat, sz);
 
-	while (node)
+	for (uint32_t i = 0; i < ht->sz; i++)
 	{
-		if (ht->key_comp(key, node->key))
-			return true;
-		node = node->next;
+		if (ht->table[i].hash)
+			_place(table, sz, &ht->table[i]);
 	}
-	return false;
+	mem_free(ht->table);
+	ht->table = table;
+	ht->sz = sz;
 }
 
-void* ht_lookup(hash_table_t* ht, void* key)
+static ht_node_t* _find(hash_table_t* ht, void* key)
 {
-	uint32_t h = ht->hash(key) % ht->sz;
-	ht_node_t* node = ht->table[h];
+	uint32_t mask = ht->sz - 1;
+	uint32_t hash = _slot_hash(ht, key);
+	uint32_t idx = hash & mask;
 
-	while (node)
+	while (ht->table[idx].hash)
 	{
-		if (ht->key_comp(key, node->key))
-			return node->val;
-		node = node->next;
+		ht_node_t* node = &ht->table[idx];
+		if (node->hash == hash && ht->key_comp(key, node->key))
+			return node;
+		idx = (idx + 1) & mask;
 	}
 	return NULL;
 }
 
-bool ht_empty(hash_table_t* ht)
+void ht_insert(hash_table_t* ht, void* key, void* val)
 {
-	for (uint32_t i = 0; i < ht->sz; i++)
+	ht_node_t* existing = _find(ht, key);
+	if (existing)
 	{
-		if (ht->table[i])
-			return false;
+		//the new item replaces the old one
+		ht->destory_item(existing->key, existing->val);
+		existing->key = key;
+		existing->val = val;
+		return;
 	}
-	return true;
+
+	if ((ht->count + 1) * 4 > ht->sz * 3)
+		_grow(ht);
+
+	ht_node_t node = { key, val, _slot_hash(ht, key) };
+	_place(ht->table, ht->sz, &node);
+	ht->count++;
+}
+
+bool ht_contains(hash_table_t* ht, void* key)
+{
+	return _find(ht, key) != NULL;
+}
+
+void* ht_lookup(hash_table_t* ht, void* key)
+{
+	ht_node_t* node = _find(ht, key);
+	return node ? node->val : NULL;
+}
+
+bool ht_empty(hash_table_t* ht)
+{
+	return ht->count == 0;
 }
 
 uint32_t ht_count(hash_table_t* ht)
 {
-	uint32_t nodes = 0;
-	for (uint32_t i = 0; i < ht->sz; i++)
+	return ht->count;
+}
+
+/*
+empty the slot at idx, moving back any later entry of the same run which would otherwise become unreachable
+*/
+static void _remove_at(hash_table_t* ht, uint32_t idx)
+{
+	uint32_t mask = ht->sz - 1;
+	uint32_t next = (idx + 1) & mask;
+
+	while (ht->table[next].hash)
 	{
-		ht_node_t* node = ht->table[i];
-		while (node)
+		uint32_t home = ht->table[next].hash & mask;
+		//distance of the entry from its home slot, and of the hole
+		if (((next - home) & mask) >= ((next - idx) & mask))
 		{
-			nodes++;
-			node = node->next;
+			ht->table[idx] = ht->table[next];
+			idx = next;
 		}
+		next = (next + 1) & mask;
 	}
-	return nodes;
+	memset(&ht->table[idx], 0, sizeof(ht_node_t));
+	ht->count--;
 }
 
 bool ht_remove(hash_table_t* ht, void* key)
 {
-	uint32_t h = ht->hash(key) % ht->sz;
-	
-	if (!ht->table[h]) return false;
+	ht_node_t* node = _find(ht, key);
+	if (!node)
+		return false;
 
-	bool found = false;
-	ht_node_t* node = ht->table[h];
-	ht_node_t* new_list = NULL;
-	while (node)
-	{
-		ht_node_t* next = node->next;
-		if (ht->key_comp(key, node->key))
-		{
-			ht->destory_item(node->key, node->val);
-			free(node);
-			found = true;
-		}
-		else
-		{
-			node->next = new_list;
-			new_list = node;
-		}
-		node = next;
-	}
-	ht->table[h] = new_list;
-	return found;
+	ht->destory_item(node->key, node->val);
+	_remove_at(ht, (uint32_t)(node - ht->table));
+	return true;
 }
 
 ht_iterator_t ht_begin(hash_table_t* ht)
@@ -142,10 +176,10 @@ ht_iterator_t ht_begin(hash_table_t* ht)
 	ht_iterator_t result = { 0, NULL };
 	for (uint32_t i = 0; i < ht->sz; i++)
 	{
-		if (ht->table[i])
+		if (ht->table[i].hash)
 		{
 			result.index = i;
-			result.node = ht->table[i];
+			result.node = &ht->table[i];
 			return result;
 		}
 	}
@@ -160,44 +194,34 @@ bool ht_end(hash_table_t* ht, ht_iterator_t* it)
 
 bool ht_next(hash_table_t* ht, ht_iterator_t* it)
 {
-	it->node = it->node->next;
-
-	if (it->node == NULL)
+	it->node = NULL;
+	while (++it->index < ht->sz)
 	{
-		do
+		if (ht->table[it->index].hash)
 		{
-			it->index++;
-			if (it->index == ht->sz)
-			{
-				it->node = NULL;
-				break;
-			}
-			it->node = ht->table[it->index];
-		} while (it->node == NULL);
+			it->node = &ht->table[it->index];
+			break;
+		}
 	}
 	return it->node != NULL;
 }
 
 void ht_print_stats(hash_table_t* ht)
 {
-	uint32_t nodes = 0;
-	uint32_t max_depth = 0;
+	uint32_t max_probe = 0;
+	uint64_t total_probe = 0;
 
 	for (uint32_t i = 0; i < ht->sz; i++)
 	{
-		ht_node_t* node = ht->table[i];
-
-		uint32_t depth = 0;
-		while (node)
-		{
-			nodes++;
-			depth++;
-			node = node->next;
-		}
-		if (depth > max_depth)
-			max_depth = depth;
+		if (!ht->table[i].hash)
+			continue;
+		uint32_t probe = (i - ht->table[i].hash) & (ht->sz - 1);
+		total_probe += probe;
+		if (probe > max_probe)
+			max_probe = probe;
 	}
-	printf("HT\tnodes: %d max depth: %d", nodes, max_depth);
+	printf("HT\tcount: %u slots: %u max probe: %u mean probe: %.2f",
+		ht->count, ht->sz, max_probe, ht->count ? (double)total_probe / ht->count : 0.0);
 }
 
 /* string hash table */
@@ -220,7 +244,7 @@ static bool _sht_comp(void* lhs, void* rhs)
 static void _sht_destroy_item(void* key, void* val)
 {
 	val;
-	free(key);
+	mem_free(key);
 }
 
 hash_table_t* sht_create(uint32_t sz)
@@ -230,7 +254,7 @@ hash_table_t* sht_create(uint32_t sz)
 
 void sht_insert(hash_table_t* ht, const char* key, void* val)
 {
-	char* keydup = strdup(key);
+	char* keydup = mem_strdup(ht->cat, key);
 	ht_insert(ht, keydup, val);
 }
 
@@ -280,6 +304,48 @@ bool sht_next(hash_table_t* ht, sht_iterator_t* it)
 	return true;
 }
 
+/* interned string hash table */
+
+static size_t _iht_hash(void* key)
+{
+	return intern_hash((const char*)key);
+}
+
+static bool _iht_comp(void* lhs, void* rhs)
+{
+	return lhs == rhs;
+}
+
+static void _iht_destroy_item(void* key, void* val)
+{
+	(void)key; (void)val;
+}
+
+hash_table_t* iht_create(uint32_t sz)
+{
+	return ht_create(sz, &_iht_hash, &_iht_comp, &_iht_destroy_item);
+}
+
+void iht_insert(hash_table_t* ht, const char* key, void* val)
+{
+	ht_insert(ht, (void*)key, val);
+}
+
+bool iht_contains(hash_table_t* ht, const char* key)
+{
+	return ht_contains(ht, (void*)key);
+}
+
+bool iht_remove(hash_table_t* ht, const char* key)
+{
+	return ht_remove(ht, (void*)key);
+}
+
+void* iht_lookup(hash_table_t* ht, const char* key)
+{
+	return ht_lookup(ht, (void*)key);
+}
+
 /* pointer hash set */
 static size_t _phs_hash(void* key)
 {
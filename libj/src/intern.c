@@ -0,0 +1,134 @@
+#include "intern.h"
+#include "arena.h"
+
+#include <string.h>
+
+#define INTERN_ARENA_BLOCK_SZ (32 * 1024)
+#define INTERN_INITIAL_SLOTS 1024
+
+/*
+open addressing table of pointers to the interned strings,
+the string's header holds the hash so probing does not touch the characters until the hashes match
+*/
+struct intern_table
+{
+	mem_cat_t cat;
+	arena_t* strings;
+
+	const char** slots;
+	uint32_t slot_count; //power of 2
+	uint32_t count;
+};
+
+uint32_t intern_hash_str(const char* str, size_t len)
+{
+	//FNV-1a
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= (uint8_t)str[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static const char** _alloc_slots(mem_cat_t cat, uint32_t count)
+{
+	const char** slots = (const char**)mem_alloc(cat, sizeof(const char*) * count);
+	memset(slots, 0, sizeof(const char*) * count);
+	return slots;
+}
+
+intern_table_t* intern_create(mem_cat_t cat)
+{
+	intern_table_t* table = (intern_table_t*)mem_alloc(cat, sizeof(intern_table_t));
+	memset(table, 0, sizeof(intern_table_t));
+	table->cat = cat;
+	table->strings = arena_create(cat, INTERN_ARENA_BLOCK_SZ, ARENA_ALIGN);
+	table->slot_count = INTERN_INITIAL_SLOTS;
+	table->slots = _alloc_slots(cat, table->slot_count);
+	return table;
+}
+
+void intern_destroy(intern_table_t* table)
+{
+	if (!table)
+		return;
+	arena_destroy(table->strings);
+	mem_free(table->slots);
+	mem_free(table);
+}
+
+static uint32_t _find_slot(const char** slots, uint32_t slot_count, const char* str, size_t len, uint32_t hash)
+{
+	uint32_t mask = slot_count - 1;
+	uint32_t idx = hash & mask;
+	while (slots[idx])
+	{
+		const char* s = slots[idx];
+		if (intern_hash(s) == hash && intern_len(s) == len && memcmp(s, str, len) == 0)
+			break;
+		idx = (idx + 1) & mask;
+	}
+	return idx;
+}
+
+static void _grow(intern_table_t* table)
+{
+	uint32_t slot_count = table->slot_count * 2;
+	const char** slots = _alloc_slots(table->cat, slot_count);
+
+	for (uint32_t i = 0; i < table->slot_count; i++)
+	{
+		const char* s = table->slots[i];
+		if (!s)
+			continue;
+
+		uint32_t idx = intern_hash(s) & (slot_count - 1);
+		while (slots[idx])
+			idx = (idx + 1) & (slot_count - 1);
+		slots[idx] = s;
+	}
+	mem_free(table->slots);
+	table->slots = slots;
+	table->slot_count = slot_count;
+}
+
+const char* intern_str(intern_table_t* table, const char* str, size_t len)
+{
+	uint32_t hash = intern_hash_str(str, len);
+	uint32_t idx = _find_slot(table->slots, table->slot_count, str, len, hash);
+	if (table->slots[idx])
+		return table->slots[idx];
+
+	intern_header_t* header = (intern_header_t*)arena_alloc(table->strings, sizeof(intern_header_t) + len + 1);
+	header->hash = hash;
+	header->len = (uint32_t)len;
+	char* result = (char*)(header + 1);
+	memcpy(result, str, len);
+	result[len] = '\0';
+
+	table->slots[idx] = result;
+	table->count++;
+
+	//keep the load below 3/4
+	if (table->count * 4 >= table->slot_count * 3)
+		_grow(table);
+	return result;
+}
+
+const char* intern_cstr(intern_table_t* table, const char* str)
+{
+	return intern_str(table, str, strlen(str));
+}
+
+const char* intern_find(intern_table_t* table, const char* str, size_t len)
+{
+	uint32_t hash = intern_hash_str(str, len);
+	return table->slots[_find_slot(table->slots, table->slot_count, str, len, hash)];
+}
+
+uint32_t intern_count(intern_table_t* table)
+{
+	return table->count;
+}
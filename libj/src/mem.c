@@ -0,0 +1,183 @@
+#include "mem.h"
+#include "platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static void* _sys_alloc(mem_cat_t cat, size_t size, void* data)
+{
+	(void)cat; (void)data;
+	return malloc(size);
+}
+
+static void* _sys_realloc(void* ptr, mem_cat_t cat, size_t size, void* data)
+{
+	(void)cat; (void)data;
+	return realloc(ptr, size);
+}
+
+static void _sys_free(void* ptr, void* data)
+{
+	(void)data;
+	free(ptr);
+}
+
+static allocator_t _allocator = { &_sys_alloc, &_sys_realloc, &_sys_free, NULL };
+
+static THREAD_LOCAL mem_cat_t _scope = 0;
+
+void mem_set_allocator(const allocator_t* allocator)
+{
+	_allocator = *allocator;
+}
+
+void* mem_alloc(mem_cat_t cat, size_t size)
+{
+	return _allocator.alloc(cat, size, _allocator.data);
+}
+
+void* mem_realloc(void* ptr, mem_cat_t cat, size_t size)
+{
+	return _allocator.realloc(ptr, cat, size, _allocator.data);
+}
+
+void mem_free(void* ptr)
+{
+	if (ptr)
+		_allocator.free(ptr, _allocator.data);
+}
+
+char* mem_strdup(mem_cat_t cat, const char* str)
+{
+	size_t len = strlen(str) + 1;
+	char* result = (char*)mem_alloc(cat, len);
+	memcpy(result, str, len);
+	return result;
+}
+
+mem_cat_t mem_set_scope(mem_cat_t cat)
+{
+	mem_cat_t prev = _scope;
+	_scope = cat;
+	return prev;
+}
+
+mem_cat_t mem_scope()
+{
+	return _scope;
+}
+
+/*
+Statistics allocator.
+Each block is preceded by a header recording its size and category
+*/
+typedef struct
+{
+	size_t size;
+	mem_cat_t cat;
+}block_header_t;
+
+//keep the block correctly aligned for any type
+#define HEADER_SIZE 16
+
+typedef struct
+{
+	mutex_t* lock;
+	mem_stats_t cats[MEM_MAX_CATEGORIES + 1];
+}stats_t;
+
+static stats_t _stats;
+
+static void _record_alloc(mem_cat_t cat, size_t size)
+{
+	mem_stats_t* s[2] = { &_stats.cats[cat], &_stats.cats[MEM_ALL_CATEGORIES] };
+	for (int i = 0; i < 2; i++)
+	{
+		s[i]->count++;
+		s[i]->total += size;
+		s[i]->current += size;
+		if (s[i]->current > s[i]->peak)
+			s[i]->peak = s[i]->current;
+	}
+}
+
+static void _record_free(mem_cat_t cat, size_t size)
+{
+	_stats.cats[cat].current -= size;
+	_stats.cats[MEM_ALL_CATEGORIES].current -= size;
+}
+
+static void* _stats_alloc(mem_cat_t cat, size_t size, void* data)
+{
+	(void)data;
+	assert(cat < MEM_MAX_CATEGORIES);
+	char* block = (char*)malloc(HEADER_SIZE + size);
+	if (!block)
+		return NULL;
+
+	block_header_t* header = (block_header_t*)block;
+	header->size = size;
+	header->cat = cat;
+
+	mutex_lock(_stats.lock);
+	_record_alloc(cat, size);
+	mutex_unlock(_stats.lock);
+	return block + HEADER_SIZE;
+}
+
+static void _stats_free(void* ptr, void* data)
+{
+	(void)data;
+	block_header_t* header = (block_header_t*)((char*)ptr - HEADER_SIZE);
+
+	mutex_lock(_stats.lock);
+	_record_free(header->cat, header->size);
+	mutex_unlock(_stats.lock);
+	free(header);
+}
+
+static void* _stats_realloc(void* ptr, mem_cat_t cat, size_t size, void* data)
+{
+	if (!ptr)
+		return _stats_alloc(cat, size, data);
+
+	block_header_t* header = (block_header_t*)((char*)ptr - HEADER_SIZE);
+	size_t old_size = header->size;
+	cat = header->cat;
+
+	char* block = (char*)realloc(header, HEADER_SIZE + size);
+	if (!block)
+		return NULL;
+	header = (block_header_t*)block;
+	header->size = size;
+
+	mutex_lock(_stats.lock);
+	_record_free(cat, old_size);
+	_record_alloc(cat, size);
+	mutex_unlock(_stats.lock);
+	return block + HEADER_SIZE;
+}
+
+void mem_enable_stats()
+{
+	assert(sizeof(block_header_t) <= HEADER_SIZE);
+	if (_stats.lock)
+		return;
+	memset(&_stats, 0, sizeof(stats_t));
+	_stats.lock = mutex_create();
+
+	allocator_t allocator = { &_stats_alloc, &_stats_realloc, &_stats_free, NULL };
+	mem_set_allocator(&allocator);
+}
+
+bool mem_get_stats(mem_cat_t cat, mem_stats_t* stats)
+{
+	if (!_stats.lock)
+		return false;
+
+	mutex_lock(_stats.lock);
+	*stats = _stats.cats[cat];
+	mutex_unlock(_stats.lock);
+	return true;
+}
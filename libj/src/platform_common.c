@@ -1,4 +1,5 @@
 #include "platform.h"
+#include "mem.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -18,7 +19,7 @@ char* path_convert_slashes(char* path)
 
 const char* path_combine(const char* dir, const char* file)
 {
-	char* buff = (char*)malloc(strlen(dir) + strlen(file) + 2);
+	char* buff = (char*)mem_alloc(mem_scope(), strlen(dir) + strlen(file) + 2);
 
 	strcpy(buff, dir);
 	buff = path_convert_slashes(buff);
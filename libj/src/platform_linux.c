@@ -1,14 +1,26 @@
 #include "platform.h"
+#include "mem.h"
 
 #ifdef PLATFORM_LINUX
 
 #include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 const char* path_resolve(const char* path)
 {
-	return realpath(path, NULL);
+	char* resolved = realpath(path, NULL);
+	if (!resolved)
+		return NULL;
+	char* result = mem_strdup(mem_scope(), resolved);
+	free(resolved);
+	return result;
 }
 
 const char* path_dirname(const char* path)
@@ -21,7 +33,7 @@ const char* path_dirname(const char* path)
 		free(path_cpy);
 		return NULL;
 	}
-	char* result = strdup(tmp);
+	char* result = mem_strdup(mem_scope(), tmp);
 	free(path_cpy);
 	return result;
 }
@@ -29,9 +41,146 @@ const char* path_dirname(const char* path)
 const char* path_filename(const char* path)
 {
 	const char* fn = basename((char*)path);
-	char* buff = (char*)malloc(strlen(fn) + 1);
+	char* buff = (char*)mem_alloc(mem_scope(), strlen(fn) + 1);
 	strcpy(buff, fn);
 	return buff;
 }
 
-#endif
\ No newline at end of file
+struct thread
+{
+	pthread_t handle;
+	thread_fn fn;
+	void* data;
+};
+
+static void* _thread_main(void* data)
+{
+	thread_t* thread = (thread_t*)data;
+	thread->fn(thread->data);
+	return NULL;
+}
+
+thread_t* thread_start(thread_fn fn, void* data)
+{
+	thread_t* thread = (thread_t*)malloc(sizeof(thread_t));
+	memset(thread, 0, sizeof(thread_t));
+	thread->fn = fn;
+	thread->data = data;
+	if (pthread_create(&thread->handle, NULL, &_thread_main, thread) != 0)
+	{
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void thread_join(thread_t* thread)
+{
+	pthread_join(thread->handle, NULL);
+	free(thread);
+}
+
+uint32_t cpu_count()
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (uint32_t)count : 1;
+}
+
+uint64_t time_now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+struct mutex
+{
+	pthread_mutex_t handle;
+};
+
+mutex_t* mutex_create()
+{
+	mutex_t* mutex = (mutex_t*)malloc(sizeof(mutex_t));
+	pthread_mutex_init(&mutex->handle, NULL);
+	return mutex;
+}
+
+void mutex_destroy(mutex_t* mutex)
+{
+	pthread_mutex_destroy(&mutex->handle);
+	free(mutex);
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	pthread_mutex_lock(&mutex->handle);
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	pthread_mutex_unlock(&mutex->handle);
+}
+
+bool file_info(const char* path, file_info_t* info)
+{
+	struct stat st;
+	if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+		return false;
+
+	info->size = (uint64_t)st.st_size;
+	info->mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000 + (uint64_t)st.st_mtim.tv_nsec;
+	return true;
+}
+
+/*
+The file is mapped over an anonymous reservation which is at least one byte longer.
+Bytes after the end of the file in its last page read as zero and if the file
+ends on a page boundary the following page of the reservation provides the terminator
+*/
+static size_t _map_len(size_t len)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	return (len / page + 1) * page;
+}
+
+const char* file_map(const char* path, size_t* len)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	size_t file_len = (size_t)st.st_size;
+	size_t map_len = _map_len(file_len);
+	char* base = (char*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	if (file_len && mmap(base, file_len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(base, map_len);
+		close(fd);
+		return NULL;
+	}
+	close(fd);
+
+	*len = file_len;
+	return base;
+}
+
+void file_unmap(const char* ptr, size_t len)
+{
+	if (ptr)
+		munmap((void*)ptr, _map_len(len));
+}
+
+#endif
@@ -1,9 +1,11 @@
 #include "platform.h"
+#include "mem.h"
 
 #ifdef PLATFORM_WIN
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <windows.h>
 #include <fileapi.h>
@@ -17,10 +19,10 @@ static bool _file_exists(const char* path)
 
 const char* path_resolve(const char* path)
 {
-	char* buff = (char*)malloc(MAX_PATH + 1);
+	char* buff = (char*)mem_alloc(mem_scope(), MAX_PATH + 1);
 	if (GetFullPathNameA(path, MAX_PATH + 1, buff, NULL) == 0 || !_file_exists(buff))
 	{
-		free(buff);
+		mem_free(buff);
 		return NULL;
 	}
 	return path_convert_slashes(buff);
@@ -28,11 +30,11 @@ const char* path_resolve(const char* path)
 
 const char* path_dirname(const char* path)
 {
-	char* buff = (char*)malloc(MAX_PATH + 1);
+	char* buff = (char*)mem_alloc(mem_scope(), MAX_PATH + 1);
 	char* file_part;
 	if (GetFullPathNameA(path, MAX_PATH + 1, buff, &file_part) == 0)
 	{
-		free(buff);
+		mem_free(buff);
 		buff = NULL;
 	}
 	*file_part = '\0';
@@ -45,9 +47,144 @@ const char* path_filename(const char* path)
 	char* file_part;
 	if (GetFullPathNameA(path, MAX_PATH+1, buff, &file_part) == 0)
 		return NULL;
-	char* fn = (char*)malloc(strlen(file_part) + 1);
+	char* fn = (char*)mem_alloc(mem_scope(), strlen(file_part) + 1);
 	strcpy(fn, file_part);
 	return fn;
 }
 
+struct thread
+{
+	HANDLE handle;
+	thread_fn fn;
+	void* data;
+};
+
+static DWORD WINAPI _thread_main(LPVOID data)
+{
+	thread_t* thread = (thread_t*)data;
+	thread->fn(thread->data);
+	return 0;
+}
+
+thread_t* thread_start(thread_fn fn, void* data)
+{
+	thread_t* thread = (thread_t*)malloc(sizeof(thread_t));
+	memset(thread, 0, sizeof(thread_t));
+	thread->fn = fn;
+	thread->data = data;
+	thread->handle = CreateThread(NULL, 0, &_thread_main, thread, 0, NULL);
+	if (!thread->handle)
+	{
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void thread_join(thread_t* thread)
+{
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	free(thread);
+}
+
+uint32_t cpu_count()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+}
+
+uint64_t time_now_ns()
+{
+	static LARGE_INTEGER freq;
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000000 +
+		(uint64_t)(count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+}
+
+struct mutex
+{
+	CRITICAL_SECTION cs;
+};
+
+mutex_t* mutex_create()
+{
+	mutex_t* mutex = (mutex_t*)malloc(sizeof(mutex_t));
+	InitializeCriticalSection(&mutex->cs);
+	return mutex;
+}
+
+void mutex_destroy(mutex_t* mutex)
+{
+	DeleteCriticalSection(&mutex->cs);
+	free(mutex);
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	EnterCriticalSection(&mutex->cs);
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	LeaveCriticalSection(&mutex->cs);
+}
+
+bool file_info(const char* path, file_info_t* info)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data) ||
+		(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+
+	info->size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	//FILETIME counts 100ns intervals
+	info->mtime = (((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime) * 100;
+	return true;
+}
+
+/*
+A view of a file mapping cannot extend past the end of a read only file so the
+file is read into a buffer with a terminator instead
+*/
+const char* file_map(const char* path, size_t* len)
+{
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(f, &size))
+	{
+		CloseHandle(f);
+		return NULL;
+	}
+
+	DWORD file_len = (DWORD)size.QuadPart;
+	char* buff = (char*)mem_alloc(mem_scope(), file_len + 1);
+	DWORD read = 0;
+	if (!ReadFile(f, buff, file_len, &read, NULL) || read != file_len)
+	{
+		mem_free(buff);
+		CloseHandle(f);
+		return NULL;
+	}
+	CloseHandle(f);
+
+	buff[file_len] = '\0';
+	*len = file_len;
+	return buff;
+}
+
+void file_unmap(const char* ptr, size_t len)
+{
+	len;
+	mem_free((void*)ptr);
+}
+
 #endif
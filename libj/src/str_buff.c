@@ -1,22 +1,20 @@
 #include "str_buff.h"
+#include "mem.h"
 
 #include <string.h>
 
 static void _expand_buff(str_buff_t* sb)
 {
 	sb->sz *= 2;
-	char* buff = (char*)malloc(sb->sz);
-	strcpy(buff, sb->buff);
-	free(sb->buff);
-	sb->buff = buff;
+	sb->buff = (char*)mem_realloc(sb->buff, 0, sb->sz);
 }
 
 str_buff_t* sb_create(size_t sz)
 {
-	str_buff_t* result = (str_buff_t*)malloc(sizeof(str_buff_t));
+	str_buff_t* result = (str_buff_t*)mem_alloc(mem_scope(), sizeof(str_buff_t));
 	result->sz = sz;
 	result->len = 0;
-	result->buff = (char*)malloc(sz);
+	result->buff = (char*)mem_alloc(mem_scope(), sz);
 	result->buff[0] = '\0';
 	return result;
 }
@@ -26,33 +24,41 @@ char* sb_release(str_buff_t* sb)
 	if (!sb)
 		return NULL;
 	char* result = sb->buff;
-	free(sb);
+	mem_free(sb);
 	return result;
 }
 
 void sb_destroy(str_buff_t* sb)
 {
-	free(sb_release(sb));
+	mem_free(sb_release(sb));
 }
 
 char* sb_append_ch(str_buff_t* sb, const char ch)
 {
-	static char tmp[2];
-	tmp[0] = ch;
-	tmp[1] = '\0';
-	return sb_append(sb, tmp);
+	return sb_append_len(sb, &ch, 1);
 }
 
 char* sb_append(str_buff_t* sb, const char* str)
 {
-	size_t len = strlen(str);
+	return sb_append_len(sb, str, strlen(str));
+}
+
+char* sb_append_len(str_buff_t* sb, const char* str, size_t len)
+{
 	while (sb->len + len >= sb->sz)
 		_expand_buff(sb);
-	strcat(sb->buff, str);
+	memcpy(sb->buff + sb->len, str, len);
 	sb->len += len;
+	sb->buff[sb->len] = '\0';
 	return sb->buff;
 }
 
+void sb_clear(str_buff_t* sb)
+{
+	sb->len = 0;
+	sb->buff[0] = '\0';
+}
+
 //append int and return internal buffer
 char* sb_append_int(str_buff_t* sb, int64_t val, int base)
 {
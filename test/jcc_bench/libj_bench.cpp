@@ -0,0 +1,198 @@
+#include <benchmark/benchmark.h>
+
+extern "C"
+{
+#include <libj/include/hash_table.h>
+#include <libj/include/str_buff.h>
+#include <libj/include/byte_buff.h>
+}
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	//identifier like keys, similar to those the compiler stores
+	std::vector<std::string> make_keys(size_t count)
+	{
+		std::vector<std::string> keys;
+		keys.reserve(count);
+		char buff[32];
+		for (size_t i = 0; i < count; i++)
+		{
+			snprintf(buff, sizeof(buff), "ident_%zu_%zx", i, i * 2654435761u);
+			keys.push_back(buff);
+		}
+		return keys;
+	}
+
+	size_t ptr_hash(void* key)
+	{
+		return (size_t)key >> 4;
+	}
+
+	bool ptr_comp(void* lhs, void* rhs)
+	{
+		return lhs == rhs;
+	}
+
+	void no_destroy(void* key, void* val)
+	{
+		key; val;
+	}
+}
+
+static void BM_sht_insert(benchmark::State& state)
+{
+	std::vector<std::string> keys = make_keys((size_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		hash_table_t* ht = sht_create(128);
+		for (const std::string& key : keys)
+			sht_insert(ht, key.c_str(), (void*)&key);
+		ht_destroy(ht);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void BM_sht_lookup(benchmark::State& state)
+{
+	std::vector<std::string> keys = make_keys((size_t)state.range(0));
+	std::vector<std::string> missing = make_keys((size_t)state.range(0) * 2);
+
+	hash_table_t* ht = sht_create(128);
+	for (const std::string& key : keys)
+		sht_insert(ht, key.c_str(), (void*)&key);
+
+	for (auto _ : state)
+	{
+		//half the lookups hit, the second half of missing was never inserted
+		for (size_t i = 0; i < missing.size(); i++)
+			benchmark::DoNotOptimize(sht_lookup(ht, missing[i].c_str()));
+	}
+	ht_destroy(ht);
+	state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)missing.size());
+}
+
+static void BM_ht_ptr_insert_lookup(benchmark::State& state)
+{
+	std::vector<uint64_t> items((size_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		hash_table_t* ht = ht_create(128, &ptr_hash, &ptr_comp, &no_destroy);
+		for (uint64_t& item : items)
+			ht_insert(ht, &item, &item);
+		for (uint64_t& item : items)
+			benchmark::DoNotOptimize(ht_lookup(ht, &item));
+		ht_destroy(ht);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0) * 2);
+}
+
+//the table starts at its minimum size and grows as items are added
+static void BM_sht_insert_grow(benchmark::State& state)
+{
+	std::vector<std::string> keys = make_keys((size_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		hash_table_t* ht = sht_create(0);
+		for (const std::string& key : keys)
+			sht_insert(ht, key.c_str(), (void*)&key);
+		ht_destroy(ht);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void BM_ht_remove(benchmark::State& state)
+{
+	std::vector<uint64_t> items((size_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		hash_table_t* ht = ht_create(128, &ptr_hash, &ptr_comp, &no_destroy);
+		for (uint64_t& item : items)
+			ht_insert(ht, &item, &item);
+		state.ResumeTiming();
+
+		for (uint64_t& item : items)
+			ht_remove(ht, &item);
+
+		state.PauseTiming();
+		ht_destroy(ht);
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void BM_ht_count(benchmark::State& state)
+{
+	std::vector<uint64_t> items((size_t)state.range(0));
+	hash_table_t* ht = ht_create(128, &ptr_hash, &ptr_comp, &no_destroy);
+	for (uint64_t& item : items)
+		ht_insert(ht, &item, &item);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(ht_count(ht));
+		benchmark::DoNotOptimize(ht_empty(ht));
+	}
+	ht_destroy(ht);
+}
+
+static void BM_sb_append(benchmark::State& state)
+{
+	const char* words[] = { "int", " ", "identifier", "(", "0x1234", ")", ";\n" };
+
+	size_t bytes = 0;
+	for (auto _ : state)
+	{
+		str_buff_t* sb = sb_create(64);
+		for (int64_t i = 0; i < state.range(0); i++)
+		{
+			sb_append(sb, words[i % 7]);
+			sb_append_ch(sb, ' ');
+		}
+		bytes += sb->len;
+		sb_destroy(sb);
+	}
+	state.SetBytesProcessed((int64_t)bytes);
+}
+
+static void BM_sb_append_int(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		str_buff_t* sb = sb_create(64);
+		for (int64_t i = 0; i < state.range(0); i++)
+			sb_append_int(sb, i * 7919, 10);
+		sb_destroy(sb);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void BM_bb_append(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		byte_buff_t* bb = bb_create(64);
+		for (int64_t i = 0; i < state.range(0); i++)
+			bb_append(bb, (uint8_t)i);
+		bb_destroy(bb);
+	}
+	state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_sht_insert)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_sht_lookup)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_ht_ptr_insert_lookup)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_sht_insert_grow)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_ht_remove)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_ht_count)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_sb_append)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_sb_append_int)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_bb_append)->RangeMultiplier(8)->Range(64, 1 << 18);
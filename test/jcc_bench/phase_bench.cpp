@@ -0,0 +1,287 @@
+#include "synth_source.h"
+
+#include <benchmark/benchmark.h>
+
+extern "C"
+{
+#include <libcomp/include/jcc_context.h>
+#include <libcomp/include/source.h>
+#include <libcomp/include/lexer.h>
+#include <libcomp/include/lex_scan.h>
+#include <libcomp/include/pp.h>
+#include <libcomp/include/parse.h>
+#include <libcomp/include/sema.h>
+#include <libcomp/include/code_gen.h>
+#include <libj/include/arena.h>
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+Each phase is measured in isolation, the phases before it run with the timer paused.
+Throughput is reported against the size of the source so the phases can be compared
+*/
+
+namespace
+{
+	//the synthetic input is valid C, any diagnostic is a bug in the generator or the compiler
+	void on_diag(src_loc_t loc, uint32_t err, const char* msg, void* data)
+	{
+		loc; data;
+		fprintf(stderr, "unexpected diagnostic %u: %s\n", err, msg);
+		abort();
+	}
+
+	source_range_t no_includes(const char* dir, const char* file, void* data)
+	{
+		dir; file; data;
+		source_range_t result = { NULL, NULL };
+		return result;
+	}
+
+	void discard_asm(const char* line, bool lf, void* data)
+	{
+		line; lf; data;
+	}
+
+	/*
+	A compilation of a single in memory source, run one phase at a time
+	*/
+	class Pipeline
+	{
+	public:
+		Pipeline(const std::string& src)
+		{
+			lex_scan_init();
+			mCtx = jcc_context_create();
+			diag_set_handler(mCtx, &on_diag, NULL);
+			src_init(mCtx, &no_includes, NULL);
+			lex_init(mCtx);
+
+			mRange.ptr = src.c_str();
+			mRange.end = mRange.ptr + src.length();
+			src_register_range(mCtx, mRange, "bench.c");
+		}
+
+		~Pipeline()
+		{
+			tl_destroy(mTL);
+			ast_destory_translation_unit(mAst);
+			jcc_context_destroy(mCtx);
+		}
+
+		void Lex()
+		{
+			mTokens = lex_source(mCtx, &mRange);
+		}
+
+		void PreProc()
+		{
+			pre_proc_init(mCtx);
+			mTokens = pre_proc_file(mCtx, ".", &mTokens);
+			pre_proc_deinit(mCtx);
+		}
+
+		//lex on demand as the pre processor needs tokens
+		void LexPreProc()
+		{
+			pre_proc_init(mCtx);
+			mTokens = pre_proc_source(mCtx, ".", &mRange);
+			pre_proc_deinit(mCtx);
+		}
+
+		//memory taken by tokens so far
+		size_t TokenBytes()
+		{
+			return arena_used(mCtx->tok_arena);
+		}
+
+		void Parse()
+		{
+			parse_init(mCtx, mTokens.start);
+			mAst = parse_translation_unit(mCtx);
+		}
+
+		void Analyse()
+		{
+			sema_observer_t observer{ nullptr };
+			sema_init(mCtx, observer);
+			mTL = sema_analyse(mCtx, mAst);
+			//the translation unit owns the ast
+			mAst = NULL;
+		}
+
+		void CodeGen()
+		{
+			code_gen(mCtx, mTL, &discard_asm, NULL, false);
+		}
+
+		Pipeline(const Pipeline&) = delete;
+		Pipeline& operator=(const Pipeline&) = delete;
+
+	private:
+		jcc_context_t* mCtx;
+		source_range_t mRange;
+		token_range_t mTokens = { NULL, NULL };
+		ast_trans_unit_t* mAst = NULL;
+		valid_trans_unit_t* mTL = NULL;
+	};
+
+	void set_throughput(benchmark::State& state, const std::string& src)
+	{
+		state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)src.length());
+		state.counters["source_bytes"] = (double)src.length();
+	}
+}
+
+static void BM_Lex(benchmark::State& state)
+{
+	std::string src = synth_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		state.ResumeTiming();
+
+		p->Lex();
+
+		state.PauseTiming();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+static void BM_LexCommented(benchmark::State& state)
+{
+	std::string src = synth_commented_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		state.ResumeTiming();
+
+		p->Lex();
+
+		state.PauseTiming();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+static void BM_PreProc(benchmark::State& state)
+{
+	std::string src = synth_macro_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		p->Lex();
+		state.ResumeTiming();
+
+		p->PreProc();
+
+		state.PauseTiming();
+		state.counters["token_bytes"] = (double)p->TokenBytes();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+static void BM_LexPreProc(benchmark::State& state)
+{
+	std::string src = synth_macro_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		state.ResumeTiming();
+
+		p->LexPreProc();
+
+		state.PauseTiming();
+		state.counters["token_bytes"] = (double)p->TokenBytes();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+static void BM_Parse(benchmark::State& state)
+{
+	std::string src = synth_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		p->Lex();
+		state.ResumeTiming();
+
+		p->Parse();
+
+		state.PauseTiming();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+static void BM_Sema(benchmark::State& state)
+{
+	std::string src = synth_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		p->Lex();
+		p->Parse();
+		state.ResumeTiming();
+
+		p->Analyse();
+
+		state.PauseTiming();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+static void BM_CodeGen(benchmark::State& state)
+{
+	std::string src = synth_source((uint32_t)state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		Pipeline* p = new Pipeline(src);
+		p->Lex();
+		p->Parse();
+		p->Analyse();
+		state.ResumeTiming();
+
+		p->CodeGen();
+
+		state.PauseTiming();
+		delete p;
+		state.ResumeTiming();
+	}
+	set_throughput(state, src);
+}
+
+//size is the number of synthetic units, roughly 650 bytes of source each
+BENCHMARK(BM_Lex)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LexCommented)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PreProc)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LexPreProc)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Parse)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Sema)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CodeGen)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,138 @@
+#include "synth_source.h"
+
+#include <stdio.h>
+
+namespace
+{
+	//small fixed LCG so the generated code never depends on the platform's rand()
+	struct Rng
+	{
+		uint32_t state = 12345;
+
+		uint32_t next(uint32_t range)
+		{
+			state = state * 1103515245 + 12345;
+			return (state >> 16) % range;
+		}
+	};
+
+	const char* binary_ops[] = { "+", "-", "*", "&", "|", "^" };
+
+	void append(std::string& out, const char* format, uint32_t a, uint32_t b = 0, uint32_t c = 0)
+	{
+		char buff[512];
+		snprintf(buff, sizeof(buff), format, a, b, c);
+		out += buff;
+	}
+
+	//macro parameters are named so they never collide with the identifiers passed as arguments
+	void emit_macros(std::string& out, uint32_t i)
+	{
+		append(out, "#define K_%u %u\n", i, i * 7 + 3);
+		append(out, "#define ADD_%u(m_, n_) ((m_) + (n_) + K_%u)\n", i, i);
+		append(out, "#define MIX_%u(m_, n_) ADD_%u(MUL(m_, 3), SHL(n_, 1))\n", i, i);
+		append(out, "#define FIELD_%u(m_) ((m_)->b + (m_)->c[1])\n", i);
+		append(out, "#if K_%u > 1000\n#define LIMIT_%u K_%u\n#else\n", i, i, i);
+		append(out, "#define LIMIT_%u 1000\n#endif\n\n", i);
+	}
+
+	//the documentation style of vendor headers, a long block comment and indented line comments
+	void emit_comments(std::string& out, uint32_t i)
+	{
+		append(out, "/*\n * rec_%u\n *\n", i);
+		out += " * A record in a singly linked list. Each record carries a small payload which the walk and\n";
+		out += " * calc functions below combine into a single value. The layout of this structure is part of\n";
+		out += " * the interface ** do not reorder the members ** as callers depend on the offsets.\n";
+		out += " *\n * Thread safety: none, callers serialise access to a list / its records.\n */\n";
+		out += "\t\t// ---------------------------------------------------------------------\n";
+		append(out, "\t\t// unit %u, generated for benchmarking; contains no code of interest\n", i);
+		out += "\t\t// ---------------------------------------------------------------------\n\n";
+	}
+
+	void emit_unit(std::string& out, uint32_t i, bool macros, Rng& rng)
+	{
+		append(out, "struct rec_%u\n{\n\tint a;\n\tchar b;\n\tint c[4];\n\tstruct rec_%u* next;\n};\n\n", i, i);
+		append(out, "enum kind_%u { kind_%u_a, kind_%u_b = 4, ", i, i, i);
+		append(out, "kind_%u_c };\n\n", i);
+		append(out, "int global_%u = %u;\n\n", i, i);
+
+		//expression in a and b
+		std::string expr;
+		if (macros)
+		{
+			append(expr, "MIX_%u(a, b) ", i);
+			expr += binary_ops[rng.next(6)];
+			append(expr, " ADD_%u(b, 1)", i);
+		}
+		else
+		{
+			for (uint32_t t = 0; t < 4; t++)
+			{
+				if (t)
+				{
+					expr += ' ';
+					expr += binary_ops[rng.next(6)];
+					expr += ' ';
+				}
+				append(expr, t % 2 ? "(b + %u)" : "(a * %u)", rng.next(100) + 1);
+			}
+		}
+
+		append(out, "int calc_%u(int a, int b)\n{\n\tint r = ", i);
+		out += expr;
+		out += ";\n";
+		if (macros)
+			append(out, "\tif (r > LIMIT_%u)\n\t\tr = r - LIMIT_%u;\n", i, i);
+		else
+			append(out, "\tif (r > %u)\n\t\tr = r - %u;\n", rng.next(1000) + 1, rng.next(1000) + 1);
+		out += "\treturn r;\n}\n\n";
+
+		append(out, "int walk_%u(struct rec_%u* r, int n)\n{\n\tint total = 0;\n", i, i);
+		out += "\tfor (int x = 0; x < n && r; x++)\n\t{\n";
+		if (macros)
+			append(out, "\t\ttotal = total + FIELD_%u(r);\n", i);
+		else
+			out += "\t\ttotal = total + r->b + r->c[1];\n";
+		append(out, "\t\ttotal = total ^ calc_%u(total, x);\n", i);
+		out += "\t\tr = r->next;\n\t}\n\treturn total;\n}\n\n";
+
+		append(out, "int select_%u(enum kind_%u k)\n{\n\tswitch (k)\n\t{\n", i, i);
+		append(out, "\tcase kind_%u_a:\n\t\treturn global_%u;\n", i, i);
+		append(out, "\tcase kind_%u_b:\n\t\treturn global_%u * 2;\n", i, i);
+		out += "\tdefault:\n\t\tbreak;\n\t}\n";
+		append(out, "\tchar* s = \"unit %u\";\n\treturn s[0];\n}\n\n", i);
+	}
+
+	std::string generate(uint32_t units, bool macros, bool comments)
+	{
+		Rng rng;
+		std::string out;
+		if (macros)
+			out += "#define MUL(m_, n_) ((m_) * (n_))\n#define SHL(m_, n_) ((m_) << (n_))\n\n";
+		for (uint32_t i = 0; i < units; i++)
+		{
+			if (macros)
+				emit_macros(out, i);
+			if (comments)
+				emit_comments(out, i);
+			emit_unit(out, i, macros, rng);
+		}
+		out += "int main()\n{\n\treturn 0;\n}\n";
+		return out;
+	}
+}
+
+std::string synth_source(uint32_t units)
+{
+	return generate(units, false, false);
+}
+
+std::string synth_macro_source(uint32_t units)
+{
+	return generate(units, true, false);
+}
+
+std::string synth_commented_source(uint32_t units)
+{
+	return generate(units, false, true);
+}
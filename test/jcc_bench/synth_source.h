@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+/*
+Deterministic synthetic C used as benchmark input.
+The output is a single self contained translation unit, without includes, which compiles cleanly.
+Its size grows linearly with units, each unit adds a struct, an enum, a global and a few functions
+*/
+std::string synth_source(uint32_t units);
+
+/*
+As synth_source() but most expressions are written using object and function like macros,
+nested several levels deep, and wrapped in conditional blocks
+*/
+std::string synth_macro_source(uint32_t units);
+
+/*
+As synth_source() with each unit preceded by the block and line comments typical of vendor headers,
+roughly half the bytes are comments
+*/
+std::string synth_commented_source(uint32_t units);
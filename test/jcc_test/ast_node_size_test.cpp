@@ -0,0 +1,34 @@
+#include "validation_fixture.h"
+
+#include <map>
+#include <string>
+
+namespace
+{
+	std::map<std::string, size_t> node_sizes()
+	{
+		std::map<std::string, size_t> result;
+		for (const ast_node_size_t* node = ast_node_sizes(); node->name; node++)
+			result[node->name] = node->size;
+		return result;
+	}
+}
+
+TEST(AstNodeSize, report)
+{
+	auto sizes = node_sizes();
+
+	EXPECT_EQ(sizeof(ast_expression_t), sizes["ast_expression_t"]);
+	EXPECT_EQ(sizeof(ast_statement_t), sizes["ast_statement_t"]);
+	EXPECT_EQ(sizeof(ast_declaration_t), sizes["ast_declaration_t"]);
+}
+
+TEST(AstNodeSize, compact)
+{
+	//the largest member of each union sets the node size, keep them within a pointer or two of each other
+	EXPECT_LE(sizeof(ast_expression_t), sizeof(src_loc_range_t) + 5 * sizeof(void*));
+	EXPECT_LE(sizeof(ast_statement_t), sizeof(src_loc_range_t) + 6 * sizeof(void*));
+	EXPECT_LE(sizeof(ast_declaration_t), sizeof(src_loc_range_t) + 6 * sizeof(void*));
+	EXPECT_LE(sizeof(ast_user_type_spec_t), sizeof(src_loc_range_t) + 3 * sizeof(void*));
+	EXPECT_LE(sizeof(ast_enum_member_t), sizeof(src_loc_range_t) + 3 * sizeof(void*));
+}
@@ -1,6 +1,7 @@
 extern "C"
 {
 #include <libcomp/include/comp_opt.h>
+#include <libj/include/mem.h>
 }
 
 #include <gmock/gmock.h>
@@ -98,4 +99,169 @@ TEST(CmdLineParser, test_version)
 
 	comp_opt_t opt = parse_command_line(2, argv);
 	EXPECT_EQ(true, opt.valid);
-}
\ No newline at end of file
+}
+
+TEST(CmdLineParser, multiple_inputs)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"a.c",
+		"-j",
+		"4",
+		"b.c",
+		"c.c"
+	};
+
+	comp_opt_t opt = parse_command_line(6, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(3, opt.input_count);
+	EXPECT_EQ(4, opt.jobs);
+	EXPECT_THAT(opt.input_path, StrEq("a.c"));
+	EXPECT_THAT(opt.input_paths[1], StrEq("b.c"));
+	EXPECT_THAT(opt.input_paths[2], StrEq("c.c"));
+	EXPECT_EQ(3, comp_opt_find_output_clash(&opt));
+}
+
+TEST(CmdLineParser, multiple_inputs_same_name)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"expressions/add.c",
+		"sub.c",
+		"binary_ops/add.c"
+	};
+
+	comp_opt_t opt = parse_command_line(4, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(2, comp_opt_find_output_clash(&opt));
+
+	const char* path = comp_opt_asm_path(opt.input_paths[2]);
+	EXPECT_THAT(path, StrEq("add.s"));
+	mem_free((void*)path);
+}
+
+TEST(CmdLineParser, invalid_jobs)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"a.c",
+		"-j",
+		"0"
+	};
+
+	comp_opt_t opt = parse_command_line(4, argv);
+	EXPECT_EQ(false, opt.valid);
+}
+
+TEST(CmdLineParser, server)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"--server",
+		"-c",
+		"jcc.cfg"
+	};
+
+	comp_opt_t opt = parse_command_line(4, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(true, opt.server);
+	EXPECT_EQ(0, opt.input_count);
+	EXPECT_THAT(opt.config_path, StrEq("jcc.cfg"));
+}
+
+TEST(CmdLineParser, time_trace)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"-ftime-trace",
+		"a.c"
+	};
+
+	comp_opt_t opt = parse_command_line(3, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(true, opt.time_trace);
+	EXPECT_EQ(false, opt.pre_proc_only);
+	EXPECT_THAT(opt.input_path, StrEq("a.c"));
+}
+
+TEST(CmdLineParser, mem_report)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"a.c",
+		"-fmem-report"
+	};
+
+	comp_opt_t opt = parse_command_line(3, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(true, opt.mem_report);
+	EXPECT_EQ(false, opt.dump_type_info);
+}
+
+TEST(CmdLineParser, token_cache)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"--token-cache",
+		"cache",
+		"a.c"
+	};
+
+	comp_opt_t opt = parse_command_line(4, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_THAT(opt.token_cache_dir, StrEq("cache"));
+	EXPECT_THAT(opt.input_path, StrEq("a.c"));
+}
+
+TEST(CmdLineParser, token_cache_no_dir)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"a.c",
+		"--token-cache"
+	};
+
+	comp_opt_t opt = parse_command_line(3, argv);
+	EXPECT_EQ(false, opt.valid);
+}
+
+TEST(CmdLineParser, emit_pch)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"-emit-pch",
+		"prefix.h"
+	};
+
+	comp_opt_t opt = parse_command_line(3, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(true, opt.emit_pch);
+	EXPECT_EQ(false, opt.pre_proc_only);
+	EXPECT_THAT(opt.input_path, StrEq("prefix.h"));
+}
+
+TEST(CmdLineParser, include_pch)
+{
+	const char* argv[] =
+	{
+		"testapp",
+		"-include-pch",
+		"prefix.pch",
+		"a.c"
+	};
+
+	comp_opt_t opt = parse_command_line(4, argv);
+	EXPECT_EQ(true, opt.valid);
+	EXPECT_EQ(false, opt.emit_pch);
+	EXPECT_THAT(opt.include_pch, StrEq("prefix.pch"));
+	EXPECT_THAT(opt.input_path, StrEq("a.c"));
+}
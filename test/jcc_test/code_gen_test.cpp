@@ -0,0 +1,35 @@
+#include "validation_fixture.h"
+
+extern "C"
+{
+#include <libcomp/include/code_gen.h>
+}
+
+class CodeGenTest : public CompilerTest
+{
+public:
+	std::string Generate(const std::string& code)
+	{
+		ExpectNoError(code);
+		std::string result;
+		code_gen(mCtx, mTL, &on_asm, &result, false);
+		return result;
+	}
+
+	static void on_asm(const char* line, bool lf, void* data)
+	{
+		std::string& out = *(std::string*)data;
+		out += line;
+		if (lf)
+			out += "\n";
+	}
+};
+
+TEST_F(CodeGenTest, long_string_literal_not_truncated)
+{
+	std::string str(1000, 'x');
+	std::string code = "const char* s = \"" + str + "\"; int main() { return 0; }";
+
+	std::string output = Generate(code);
+	EXPECT_NE(std::string::npos, output.find(".string \"" + str + "\"\n"));
+}
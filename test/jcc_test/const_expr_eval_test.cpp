@@ -14,7 +14,7 @@ public:
 		SetSource(code);
 		Lex();
 
-		parse_init(mTokens);
+		parse_init(mCtx, mTokens);
 		ast_expression_t* expr = parse_constant_expression();
 
 		return sema_fold_const_int_expr(expr);
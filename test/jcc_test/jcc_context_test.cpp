@@ -0,0 +1,248 @@
+#include "validation_fixture.h"
+
+#include <thread>
+#include <map>
+#include <setjmp.h>
+
+extern "C"
+{
+#include <libcomp/include/code_gen.h>
+#include <libcomp/include/mem_cat.h>
+}
+
+namespace
+{
+	struct Compilation
+	{
+		jcc_context_t* ctx;
+		std::string src;
+		std::string asm_out;
+		uint32_t errors = 0;
+		jmp_buf* err_jmp = nullptr;
+
+		//sources found by CompileFile(), keyed by file name
+		const std::map<std::string, std::string>* files = nullptr;
+
+		//translation unit being generated, the caller destroys it if an error ends code gen
+		valid_trans_unit_t* tl = nullptr;
+
+		Compilation(const std::string& code)
+			: src(code)
+		{
+			ctx = jcc_context_create();
+			diag_set_handler(ctx, &on_diag, this);
+		}
+
+		~Compilation()
+		{
+			tl_destroy(tl);
+			jcc_context_destroy(ctx);
+		}
+
+		static void on_diag(src_loc_t, uint32_t, const char*, void* data)
+		{
+			Compilation* c = (Compilation*)data;
+			c->errors++;
+			//end the compilation at the first error, as the compiler does
+			if (c->err_jmp)
+				longjmp(*c->err_jmp, 1);
+		}
+
+		static void on_asm(const char* line, bool lf, void* data)
+		{
+			std::string& out = ((Compilation*)data)->asm_out;
+			out += line;
+			if (lf)
+				out += "\n";
+		}
+
+		static source_range_t on_load(const char*, const char* file, void* data)
+		{
+			const std::map<std::string, std::string>* files = ((Compilation*)data)->files;
+			source_range_t sr = { nullptr, nullptr };
+			auto it = files->find(file);
+			if (it != files->end())
+			{
+				sr.ptr = it->second.c_str();
+				sr.end = sr.ptr + it->second.length();
+			}
+			return sr;
+		}
+
+		token_t* Lex()
+		{
+			source_range_t sr;
+			sr.ptr = src.c_str();
+			sr.end = sr.ptr + src.length();
+			lex_init(ctx);
+			return lex_source(ctx, &sr).start;
+		}
+
+		bool Compile()
+		{
+			return Compile(Lex());
+		}
+
+		//preprocess and compile name, loading it and any headers from files
+		bool CompileFile(const char* name)
+		{
+			src_init(ctx, &on_load, this);
+			source_range_t* sr = src_load_file(ctx, ".", name);
+			if (!sr)
+				return false;
+			lex_init(ctx);
+			pre_proc_init(ctx);
+			return Compile(pre_proc_source(ctx, NULL, sr).start);
+		}
+
+		bool Compile(token_t* toks)
+		{
+			if (!toks)
+				return false;
+			parse_init(ctx, toks);
+			ast_trans_unit_t* ast = parse_translation_unit(ctx);
+			if (!ast)
+				return false;
+			sema_observer_t observer{ nullptr };
+			sema_init(ctx, observer);
+			tl = sema_analyse(ctx, ast);
+			if (!tl)
+				return false;
+			code_gen(ctx, tl, &on_asm, this, false);
+			tl_destroy(tl);
+			tl = nullptr;
+			return true;
+		}
+	};
+
+	const char* _good_src = "int fn(int a) { while(a) { if(a > 5) break; a--; } return a; } int main() { return fn(10); }";
+	const char* _bad_src = "int main() { return x; }";
+	const char* _bad_syntax_src = "int main() { return 1 +; }";
+
+	uint64_t CurrentBytes(mem_category cat)
+	{
+		mem_stats_t stats;
+		EXPECT_TRUE(mem_get_stats(cat, &stats));
+		return stats.current;
+	}
+
+	bool CompileUntilError(Compilation& c, const char* file = nullptr)
+	{
+		jmp_buf err_jmp;
+		c.err_jmp = &err_jmp;
+		if (setjmp(err_jmp) == 0)
+			return file ? c.CompileFile(file) : c.Compile();
+		return false;
+	}
+}
+
+TEST(JccContext, interleaved_phases)
+{
+	Compilation a(_good_src);
+	Compilation b(_bad_src);
+
+	token_t* toks_a = a.Lex();
+	token_t* toks_b = b.Lex();
+
+	parse_init(a.ctx, toks_a);
+	parse_init(b.ctx, toks_b);
+	ast_trans_unit_t* ast_b = parse_translation_unit(b.ctx);
+	ast_trans_unit_t* ast_a = parse_translation_unit(a.ctx);
+	ASSERT_NE(nullptr, ast_a);
+	ASSERT_NE(nullptr, ast_b);
+
+	sema_observer_t observer{ nullptr };
+	sema_init(a.ctx, observer);
+	sema_init(b.ctx, observer);
+	EXPECT_EQ(nullptr, sema_analyse(b.ctx, ast_b));
+	valid_trans_unit_t* tl = sema_analyse(a.ctx, ast_a);
+	ASSERT_NE(nullptr, tl);
+	tl_destroy(tl);
+
+	EXPECT_EQ(0U, a.errors);
+	EXPECT_EQ(1U, b.errors);
+}
+
+TEST(JccContext, concurrent_compilations)
+{
+	Compilation expected(_good_src);
+	ASSERT_TRUE(expected.Compile());
+
+	std::vector<std::thread> threads;
+	std::vector<std::string> results(4);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		threads.emplace_back([&results, i]()
+		{
+			for (int j = 0; j < 20; j++)
+			{
+				Compilation c(_good_src);
+				if (c.Compile() && c.errors == 0)
+					results[i] = c.asm_out;
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+
+	for (auto& r : results)
+		EXPECT_EQ(expected.asm_out, r);
+}
+
+TEST(JccContext, failed_compilation_releases_ast)
+{
+	for (const char* src : { _bad_src, _bad_syntax_src })
+	{
+		uint64_t before = CurrentBytes(mc_ast);
+		{
+			Compilation c(src);
+			EXPECT_FALSE(c.Compile());
+		}
+		EXPECT_EQ(before, CurrentBytes(mc_ast));
+
+		//the error ends the compilation part way through parsing or analysis
+		{
+			Compilation c(src);
+			EXPECT_FALSE(CompileUntilError(c));
+			EXPECT_EQ(1U, c.errors);
+		}
+		EXPECT_EQ(before, CurrentBytes(mc_ast));
+	}
+}
+
+TEST(JccContext, server_requests_hold_no_memory)
+{
+	const std::map<std::string, std::string> files = {
+		{ "inc.h", "#define SQ(x) ((x) * (x))\n#define CAT(a, b) a##b\n#define STR(a) #a\nstruct point { int x; int y; };\n" },
+		{ "good.c", "#include \"inc.h\"\nint CAT(g, 2) = 2;\nint main() { struct point p; const char* s = STR(str); p.x = SQ(g2); return __LINE__; }" },
+		{ "sema_err.c", "#include \"inc.h\"\nint main() { struct point p; return x; }" },
+		{ "syntax_err.c", "int main() { return 1 +; }" },
+		{ "codegen_err.c", "int main() { break; return 0; }" },
+		{ "define_err.c", "#define A(x) x ##\nint main() { return 0; }" },
+		{ "args_err.c", "#define F(x) x\nint main() { return F(1; }" },
+		{ "include_err.c", "#include \"missing.h\"\n" }
+	};
+
+	//each request compiles a file in a new context and ends at its first error, as --server does
+	auto requests = [&files]()
+	{
+		for (auto& f : files)
+		{
+			Compilation c("");
+			c.files = &files;
+			bool ok = CompileUntilError(c, f.first.c_str());
+			EXPECT_EQ(f.first == "good.c" || f.first == "inc.h", ok) << f.first;
+		}
+	};
+
+	requests();
+	uint64_t before[mc_count];
+	for (int cat = 0; cat < mc_count; cat++)
+		before[cat] = CurrentBytes((mem_category)cat);
+
+	for (int i = 0; i < 20; i++)
+		requests();
+
+	for (int cat = 0; cat < mc_count; cat++)
+		EXPECT_EQ(before[cat], CurrentBytes((mem_category)cat)) << mem_category_name((mem_category)cat);
+}
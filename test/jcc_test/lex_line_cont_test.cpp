@@ -123,4 +123,43 @@ c)");
 	ExpectTokTypes({ tok_identifier, tok_eof });
 	EXPECT_EQ(3, tok_spelling_len(GetToken(0)));
 
-}
\ No newline at end of file
+}
+TEST_F(LexLineContTest, SeveralSplices)
+{
+	//each continuation is found in turn, with long runs of ordinary characters between them
+	std::string code = "int first_identifier_in_the_file = 1;\nint sec\\\nond = 2; int third_identifier = 3\\\r\n4;\nint fourth\\\n;";
+
+	ExpectNoError();
+	Lex(code);
+
+	ExpectTokTypes({
+			tok_int, tok_identifier, tok_equal, tok_num_literal, tok_semi_colon,
+			tok_int, tok_identifier, tok_equal, tok_num_literal, tok_semi_colon,
+			tok_int, tok_identifier, tok_equal, tok_num_literal, tok_semi_colon,
+			tok_int, tok_identifier, tok_semi_colon,
+			tok_eof });
+	EXPECT_STREQ("second", GetToken(6)->data.str);
+	ExpectIntLiteral(GetToken(13), 34);
+	EXPECT_STREQ("fourth", GetToken(16)->data.str);
+}
+
+TEST_F(LexLineContTest, LineComment)
+{
+	//a continuation extends a line comment onto the next line
+	std::string code = "int a; // comment \\\nint b;\nint c;";
+
+	Lex(code);
+	ExpectCode(R"(int a;
+int c;)");
+}
+
+TEST_F(LexLineContTest, BackslashNotSplice)
+{
+	std::string code = "#include <dir\\file.h>\nint a;";
+
+	Lex(code);
+	ExpectTokTypes({
+			tok_pp_include, tok_lesser, tok_identifier, tok_fullstop, tok_identifier, tok_greater,
+			tok_int, tok_identifier, tok_semi_colon,
+			tok_eof });
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+extern "C"
+{
+#include <libcomp/include/lex_scan.h>
+}
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool is_blank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	bool is_identifier(char c)
+	{
+		return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	/*
+	runs of characters which each kernel skips, broken by a single character which stops it at varying offsets.
+	Includes bytes above 0x7F and characters either side of each range checked by the kernels
+	*/
+	std::string make_input(const std::string& run, const std::string& stops)
+	{
+		std::string result;
+		uint32_t state = 1;
+		for (int i = 0; i < 200; i++)
+		{
+			state = state * 1103515245 + 12345;
+			size_t len = (state >> 16) % 70;
+			for (size_t j = 0; j < len; j++)
+				result += run[(j + i) % run.size()];
+			result += stops[i % stops.size()];
+		}
+		return result;
+	}
+
+	class LexScanTest : public testing::TestWithParam<lex_scan_isa>
+	{
+	protected:
+		void SetUp() override
+		{
+			mPrev = lex_scan_get_isa();
+			mSupported = lex_scan_set_isa(GetParam()) == GetParam();
+		}
+
+		void TearDown() override
+		{
+			lex_scan_set_isa(mPrev);
+		}
+
+		template <typename Kernel, typename Stop>
+		void ExpectScan(const std::string& input, Kernel kernel, Stop stop)
+		{
+			//nothing to check when the cpu does not support the isa
+			if (!mSupported)
+				return;
+
+			const char* end = input.c_str() + input.size();
+			for (const char* p = input.c_str(); p <= end; p++)
+			{
+				const char* expected = p;
+				while (expected < end && !stop(*expected))
+					expected++;
+				ASSERT_EQ(expected - input.c_str(), kernel(p, end) - input.c_str()) << "from " << p - input.c_str();
+			}
+		}
+
+	private:
+		lex_scan_isa mPrev;
+		bool mSupported;
+	};
+}
+
+TEST_P(LexScanTest, blanks)
+{
+	std::string input = make_input(" \t", "\n\r\vx\x1f!\xa0");
+
+	ExpectScan(input, &lex_scan_blanks, [](char c) { return !is_blank(c); });
+}
+
+TEST_P(LexScanTest, identifier)
+{
+	std::string input = make_input("azAZ09_mQ5", "@[`{/:\\ \x80\xff-");
+
+	ExpectScan(input, &lex_scan_identifier, [](char c) { return !is_identifier(c); });
+}
+
+TEST_P(LexScanTest, either)
+{
+	std::string input = make_input("abc /+)\t\r\x90", "*\\\n");
+
+	ExpectScan(input,
+		[](const char* p, const char* end) { return lex_scan_either(p, end, '*', '\\'); },
+		[](char c) { return c == '*' || c == '\\'; });
+	ExpectScan(input,
+		[](const char* p, const char* end) { return lex_scan_either(p, end, '\n', '\\'); },
+		[](char c) { return c == '\n' || c == '\\'; });
+}
+
+INSTANTIATE_TEST_CASE_P(Isa, LexScanTest, testing::Values(lex_scan_scalar, lex_scan_sse2, lex_scan_avx2));
@@ -17,21 +17,46 @@ line 4;
 	*/
 
 	Lex(code);
-	EXPECT_EQ(1U, src_get_pos_info(GetToken(0)->loc).line);
-	EXPECT_EQ(1U, src_get_pos_info(GetToken(1)->loc).line);
-	EXPECT_EQ(1U, src_get_pos_info(GetToken(2)->loc).line);
+	EXPECT_EQ(1U, src_get_loc_info(mCtx, GetToken(0)->loc).line);
+	EXPECT_EQ(1U, src_get_loc_info(mCtx, GetToken(1)->loc).line);
+	EXPECT_EQ(1U, src_get_loc_info(mCtx, GetToken(2)->loc).line);
 
-	EXPECT_EQ(2U, src_get_pos_info(GetToken(3)->loc).line);
-	EXPECT_EQ(2U, src_get_pos_info(GetToken(4)->loc).line);
-	EXPECT_EQ(2U, src_get_pos_info(GetToken(5)->loc).line);
+	EXPECT_EQ(2U, src_get_loc_info(mCtx, GetToken(3)->loc).line);
+	EXPECT_EQ(2U, src_get_loc_info(mCtx, GetToken(4)->loc).line);
+	EXPECT_EQ(2U, src_get_loc_info(mCtx, GetToken(5)->loc).line);
 
-	EXPECT_EQ(3U, src_get_pos_info(GetToken(6)->loc).line);
-	EXPECT_EQ(3U, src_get_pos_info(GetToken(7)->loc).line);
-	EXPECT_EQ(3U, src_get_pos_info(GetToken(8)->loc).line);
+	EXPECT_EQ(3U, src_get_loc_info(mCtx, GetToken(6)->loc).line);
+	EXPECT_EQ(3U, src_get_loc_info(mCtx, GetToken(7)->loc).line);
+	EXPECT_EQ(3U, src_get_loc_info(mCtx, GetToken(8)->loc).line);
 
-	EXPECT_EQ(4U, src_get_pos_info(GetToken(9)->loc).line);
-	EXPECT_EQ(4U, src_get_pos_info(GetToken(10)->loc).line);
-	EXPECT_EQ(4U, src_get_pos_info(GetToken(11)->loc).line);
+	EXPECT_EQ(4U, src_get_loc_info(mCtx, GetToken(9)->loc).line);
+	EXPECT_EQ(4U, src_get_loc_info(mCtx, GetToken(10)->loc).line);
+	EXPECT_EQ(4U, src_get_loc_info(mCtx, GetToken(11)->loc).line);
+}
+
+TEST_F(LexerTest, tok_loc)
+{
+	std::string code = "int i;\n  i = 2;";
+	Lex(code, "dir/test.c");
+
+	file_pos_t pos = src_get_loc_info(mCtx, tok_loc(GetToken(3)));
+	EXPECT_STREQ("dir/test.c", pos.path);
+	EXPECT_EQ(2U, pos.line);
+	EXPECT_EQ(3, pos.col);
+	EXPECT_EQ(tok_spelling(GetToken(3)), src_loc_ptr(mCtx, tok_loc(GetToken(3))));
+	EXPECT_EQ('i', *tok_spelling(GetToken(3)));
+}
+
+TEST_F(LexerTest, diag_loc)
+{
+	src_loc_t loc = SRC_LOC_NONE;
+	EXPECT_CALL(*this, on_diag(_, ERR_SYNTAX, _)).WillOnce(SaveArg<0>(&loc));
+	std::string code = "int i;\n c = '';";
+	Lex(code);
+
+	file_pos_t pos = src_get_loc_info(mCtx, loc);
+	EXPECT_EQ(2U, pos.line);
+	EXPECT_EQ(6, pos.col);
 }
 
 TEST_F(LexerTest, foo)
@@ -62,6 +87,44 @@ int foo
 int foo2 = 5;)");
 }
 
+TEST_F(LexerTest, comment_slashslash_empty)
+{
+	std::string code = R"(
+int foo //
+int foo2 = 5;)";
+
+	Lex(code);
+	ExpectCode(R"(
+int foo
+int foo2 = 5;)");
+}
+
+TEST_F(LexerTest, comment_long)
+{
+	//longer than the scanning kernels' step, with '*' and '/' which do not end the comment
+	std::string code = R"(
+int foo /* a comment which runs on for more than 32 bytes * / ** and over
+	a second line ****/;
+int foo2 = 5; // a line comment which also runs on for more than 32 bytes /* */
+int foo3;)";
+
+	Lex(code);
+	ExpectCode(R"(
+int foo ;
+int foo2 = 5;
+int foo3;)");
+}
+
+TEST_F(LexerTest, identifier_long)
+{
+	std::string code = "int an_identifier_longer_than_32_characters_0123456789 =an_identifier_longer_than_32_characters_0123456789;";
+
+	Lex(code);
+	ExpectTokTypes({ tok_int, tok_identifier, tok_equal, tok_identifier, tok_semi_colon, tok_eof });
+	EXPECT_STREQ("an_identifier_longer_than_32_characters_0123456789", GetToken(1)->data.str);
+	EXPECT_EQ(GetToken(1)->data.str, GetToken(3)->data.str);
+}
+
 TEST_F(LexerTest, comment_mid_line)
 {
 	std::string code = R"(
@@ -237,6 +300,32 @@ TEST_F(LexerTest, err_char_const_too_long)
 	Lex(code);
 }
 
+TEST_F(LexerTest, token_arena_bytes)
+{
+	std::string code;
+	for (int i = 0; i < 1000; i++)
+		code += "; ";
+
+	size_t before = arena_used(mCtx->tok_arena);
+	Lex(code);
+
+	//1000 semi colons and the end of file, none has a payload
+	size_t per_tok = (arena_used(mCtx->tok_arena) - before) / 1001;
+	EXPECT_EQ(0U, (arena_used(mCtx->tok_arena) - before) % 1001);
+	EXPECT_EQ(sizeof(token_t), per_tok);
+	if (sizeof(void*) == 8)
+		EXPECT_EQ(40U, per_tok);
+}
+
+TEST_F(LexerTest, err_token_too_long)
+{
+	std::string code = "int " + std::string(TOK_MAX_LEN + 1, 'a') + ";";
+
+	ExpectError(ERR_SYNTAX);
+	Lex(code);
+	EXPECT_EQ(nullptr, tokens.start);
+}
+
 TEST_F(LexerTest, err_char_const_unterminated)
 {
 	std::string code = R"(int x = 'a;)";
@@ -309,3 +398,76 @@ TEST_F(LexerTest, empty_comment)
 
 	ExpectTokTypes({ tok_eof });
 }
+
+TEST_F(LexerTest, keywords)
+{
+	Lex(R"(int char short long void signed unsigned float double const volatile typedef extern static auto register
+inline return if else for while do break continue struct union enum sizeof switch case default goto)");
+
+	ExpectTokTypes({ tok_int, tok_char, tok_short, tok_long, tok_void, tok_signed, tok_unsigned, tok_float,
+		tok_double, tok_const, tok_volatile, tok_typedef, tok_extern, tok_static, tok_auto, tok_register,
+		tok_inline, tok_return, tok_if, tok_else, tok_for, tok_while, tok_do, tok_break, tok_continue,
+		tok_struct, tok_union, tok_enum, tok_sizeof, tok_switch, tok_case, tok_default, tok_goto, tok_eof });
+}
+
+TEST_F(LexerTest, keyword_like_identifiers)
+{
+	Lex(R"(i in inte Int dO iff _if elsewhere caseX goto_ unsignedd)");
+
+	for (int i = 0; i < 11; i++)
+		EXPECT_EQ(tok_identifier, GetToken(i)->kind);
+	EXPECT_EQ(tok_eof, GetToken(11)->kind);
+}
+
+TEST_F(LexerTest, keyword_split_by_line_continuation)
+{
+	Lex("in\\\nt a\\\nb;");
+
+	ExpectTokTypes({ tok_int, tok_identifier, tok_semi_colon, tok_eof });
+	EXPECT_STREQ("ab", GetToken(1)->data.str);
+}
+
+TEST_F(LexerTest, cursor)
+{
+	std::string code = R"(int i = 1;
+#define X(a) a \
+	+ 1
+X(i) /* comment */ "str")";
+
+	Lex(code);
+
+	source_range_t sr = { code.c_str(), code.c_str() + code.length() };
+	lex_cursor_t* cursor = lex_begin(mCtx, &sr, NULL);
+
+	//the same tokens as lexing the whole range, one at a time
+	for (token_t* expected = tokens.start; expected; expected = expected->next)
+	{
+		token_t* tok = lex_next(cursor);
+		EXPECT_EQ(expected->kind, tok->kind);
+		EXPECT_EQ(expected->loc, tok->loc);
+		EXPECT_EQ(expected->len, tok->len);
+		EXPECT_EQ(expected->flags, tok->flags);
+		EXPECT_EQ(nullptr, tok->next);
+
+		if (tok->kind == tok_eof)
+			EXPECT_EQ(tok, lex_next(cursor));
+	}
+	EXPECT_FALSE(lex_failed(cursor));
+	lex_end(cursor);
+}
+
+TEST_F(LexerTest, err_cursor_comment_unterminated)
+{
+	std::string code = R"(int foo /* abc ;
+int foo2 = 5;)";
+	source_range_t sr = { code.c_str(), code.c_str() + code.length() };
+
+	ExpectError(ERR_SYNTAX);
+
+	lex_cursor_t* cursor = lex_begin(mCtx, &sr, NULL);
+	EXPECT_EQ(tok_int, lex_next(cursor)->kind);
+	EXPECT_EQ(tok_identifier, lex_next(cursor)->kind);
+	EXPECT_EQ(tok_eof, lex_next(cursor)->kind);
+	EXPECT_TRUE(lex_failed(cursor));
+	lex_end(cursor);
+}
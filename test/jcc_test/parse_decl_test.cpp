@@ -14,7 +14,7 @@ public:
 		SetSource(code);
 		Lex();
 
-		parse_init(mTokens);
+		parse_init(mCtx, mTokens);
 
 		decls = try_parse_decl_list(context);
 		ast_declaration_t* decl = decls.first;
@@ -184,11 +184,11 @@ TEST_F(ParstDeclTest, multi_d_array_type)
 	//p is an array containing 5 elements
 	ExpectArrayDecl(0, "p", 5);
 	ast_type_spec_t* spec = DeclNo(0)->type_ref->spec;
-	sema_resolve_type(spec, DeclNo(0)->tokens.start);
+	sema_resolve_type(spec, DeclNo(0)->loc.start);
 	EXPECT_EQ(40, spec->size);
 	//each of those elements are an array of int32 2 elements long
 	ast_type_spec_t* elem_spec = spec->data.array_spec->element_type;
-	sema_resolve_type(elem_spec, DeclNo(0)->tokens.start);
+	sema_resolve_type(elem_spec, DeclNo(0)->loc.start);
 	ASSERT_EQ(elem_spec->kind, type_array);
 	ExpectArraySize(elem_spec, 2);
 	EXPECT_EQ(8, elem_spec->size);
@@ -203,11 +203,11 @@ TEST_F(ParstDeclTest, multi_d_array_type2)
 	//p is an array containing 2 elements
 	ExpectArrayDecl(0, "p", 2);
 	ast_type_spec_t* spec = DeclNo(0)->type_ref->spec;
-	sema_resolve_type(spec, DeclNo(0)->tokens.start);
+	sema_resolve_type(spec, DeclNo(0)->loc.start);
 	EXPECT_EQ(96, spec->size);
 	//each of those elements are an array containing 3 elements
 	ast_type_spec_t* elem_spec = spec->data.array_spec->element_type;
-	sema_resolve_type(elem_spec, DeclNo(0)->tokens.start);
+	sema_resolve_type(elem_spec, DeclNo(0)->loc.start);
 	ASSERT_EQ(elem_spec->kind, type_array);
 	ExpectArraySize(elem_spec, 3);
 	//EXPECT_EQ(8, elem_spec->size);
@@ -13,7 +13,7 @@ public:
 		SetSource(code);
 		Lex();
 
-		parse_init(mTokens);
+		parse_init(mCtx, mTokens);
 		
 		type_ref = try_parse_type_ref();
 		return type_ref;
@@ -0,0 +1,156 @@
+#include "validation_fixture.h"
+
+extern "C"
+{
+#include <libcomp/include/pch.h>
+}
+
+#include <filesystem>
+#include <stdio.h>
+
+class PchTest : public TestWithErrorHandling
+{
+public:
+	PchTest()
+	{
+		mDir = ::testing::TempDir() + "pch_test";
+		std::filesystem::create_directories(mDir);
+		mPchPath = mDir + "/prefix.pch";
+
+		src_init(mCtx, &src_map_file, NULL);
+		lex_init(mCtx);
+		pre_proc_init(mCtx);
+	}
+
+	~PchTest()
+	{
+		std::filesystem::remove_all(mDir);
+	}
+
+	void WriteFile(const std::string& name, const std::string& content)
+	{
+		FILE* f = fopen((mDir + "/" + name).c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		fwrite(content.data(), 1, content.size(), f);
+		fclose(f);
+	}
+
+	//preprocess the header in a separate context and write its pch
+	bool Emit(const std::string& name)
+	{
+		jcc_context_t* ctx = jcc_context_create();
+		diag_set_handler(ctx, &diag_cb, this);
+		src_init(ctx, &src_map_file, NULL);
+		lex_init(ctx);
+		pre_proc_init(ctx);
+
+		bool result = false;
+		source_range_t* sr = src_load_file(ctx, mDir.c_str(), name.c_str());
+		if (sr)
+		{
+			token_range_t toks = pre_proc_source(ctx, mDir.c_str(), sr);
+			result = toks.start && pch_write(ctx, mPchPath.c_str(), &toks);
+		}
+		jcc_context_destroy(ctx);
+		jcc_ctx_set(mCtx);
+		return result;
+	}
+
+	bool Load()
+	{
+		return pch_load(mCtx, mPchPath.c_str());
+	}
+
+	void PreProc(const std::string& src)
+	{
+		mSrc = src;
+		source_range_t sr = { mSrc.c_str(), mSrc.c_str() + mSrc.length() };
+		src_register_range(mCtx, sr, (mDir + "/main.c").c_str());
+		tokens = pre_proc_source(mCtx, mDir.c_str(), &sr);
+	}
+
+	void ExpectCode(const std::string& code)
+	{
+		source_range_t sr = { code.c_str(), code.c_str() + code.length() };
+		token_range_t expected = lex_source(mCtx, &sr);
+		EXPECT_TRUE(tok_range_equals(&tokens, &expected));
+	}
+
+	std::string mDir;
+	std::string mPchPath;
+	std::string mSrc;
+	token_range_t tokens = { NULL, NULL };
+};
+
+TEST_F(PchTest, header_tokens_and_macros)
+{
+	WriteFile("prefix.h", R"(#define SQ(x) ((x) * (x))
+#define NAME "abc"
+int g;
+)");
+	ASSERT_TRUE(Emit("prefix.h"));
+
+	ASSERT_TRUE(Load());
+	PreProc("const char* s = NAME;\nint i = SQ(2);\n");
+	ExpectCode(R"(int g;
+const char* s = "abc";
+int i = ((2) * (2));
+)");
+}
+
+TEST_F(PchTest, header_token_locations)
+{
+	WriteFile("prefix.h", "\nint g;\n");
+	ASSERT_TRUE(Emit("prefix.h"));
+
+	ASSERT_TRUE(Load());
+	PreProc("int i;\n");
+	ASSERT_NE(nullptr, tokens.start);
+
+	file_pos_t pos = src_get_loc_info(mCtx, tokens.start->loc);
+	EXPECT_EQ(mDir + "/prefix.h", pos.path);
+	EXPECT_EQ(2u, pos.line);
+	EXPECT_EQ(1, pos.col);
+}
+
+TEST_F(PchTest, include_guards_kept)
+{
+	WriteFile("a.h", R"(#ifndef A_H
+#define A_H
+int a;
+#endif
+)");
+	WriteFile("b.h", R"(#pragma once
+int b;
+)");
+	WriteFile("prefix.h", R"(#include "a.h"
+#include "b.h"
+)");
+	ASSERT_TRUE(Emit("prefix.h"));
+
+	ASSERT_TRUE(Load());
+	PreProc(R"(#include "a.h"
+#include "b.h"
+int i;
+)");
+	ExpectCode(R"(int a;
+int b;
+int i;
+)");
+}
+
+TEST_F(PchTest, changed_header_not_loaded)
+{
+	WriteFile("prefix.h", "int g;\n");
+	ASSERT_TRUE(Emit("prefix.h"));
+
+	//same size, different contents
+	WriteFile("prefix.h", "int h;\n");
+	EXPECT_FALSE(Load());
+}
+
+TEST_F(PchTest, invalid_file_not_loaded)
+{
+	WriteFile("prefix.pch", "int g;\n");
+	EXPECT_FALSE(Load());
+}
@@ -762,3 +762,58 @@ xglue(HIGH, LOW);
 
 }
 
+
+TEST_F(PreProcDefineTest, self_reference_rescanned_as_arg)
+{
+	//TEST is hidden from its own expansion after it is substituted for ID's parameter
+	std::string src = R"(
+#define TEST TEST x
+#define ID(A) A
+ID(TEST);
+)";
+
+	PreProc(src);
+	ExpectCode("TEST x;");
+}
+
+TEST_F(PreProcDefineTest, hide_sets_shared)
+{
+	std::string src = R"(
+#define ONE 1
+#define TWO ONE + ONE
+#define ADD(A, B) ((A) + (B) + TWO)
+)";
+	for (int i = 0; i < 200; i++)
+		src += "ADD(TWO, ADD(ONE, TWO));\n";
+
+	PreProc(src);
+
+	//each distinct combination of hidden macros is stored once, however often it is expanded
+	EXPECT_LT(mCtx->pp->hide_sets.count, 16U);
+}
+
+TEST_F(PreProcDefineTest, arg_expands_to_nothing)
+{
+	std::string src = R"(
+#define EMPTY
+#define F(x) [x]
+F(EMPTY);
+)";
+
+	PreProc(src);
+	ExpectCode("[];");
+}
+
+TEST_F(PreProcDefineTest, arg_invoked_after_expansion)
+{
+	//the argument f names a macro whose arguments follow it in APPLY's replacement list
+	std::string src = R"(
+#define SQ(x) ((x) * (x))
+#define APPLY(f, v) f(v)
+APPLY(SQ, 2);
+int f = v;
+)";
+
+	PreProc(src);
+	ExpectCode("((2) * (2));\nint f = v;");
+}
@@ -15,7 +15,7 @@ public:
 		range.end = tok_find_next(tokens.start, tok_eof);
 
 		uint32_t val;
-		pp_context_t ctx = { sht_create(128), range.start, range.end };
+		pp_context_t ctx = { iht_create(128), range.start, range.end };
 		pre_proc_eval_expr(&ctx, range, &val);
 
 		if(expected.has_value())
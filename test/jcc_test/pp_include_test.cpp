@@ -212,8 +212,8 @@ TEST_F(PreProcIncludeTest, pragma_once)
 	std::string inc = R"(#pragma once
 int i;)";
 
-	//File load will be called twice so that the handler has the opportunity to search for a file
-	ExpectFileLoad("inc1.h", inc, Exactly(2));
+	//the file is only loaded once, the second #include is dropped by the #pragma once
+	ExpectFileLoad("inc1.h", inc);
 
 	std::string src = R"(#include "inc1.h"
 #include "inc1.h"
@@ -244,3 +244,141 @@ int b = 1;
 3
 2)");
 }
+
+TEST_F(PreProcIncludeTest, include_streamed_source)
+{
+	ExpectFileLoad("stdio.h", stdio_code);
+
+	PreProcSource(inc_code);
+	ExpectCode(expected_code);
+}
+
+TEST_F(PreProcIncludeTest, include_guarded_tokens_reused)
+{
+	std::string inc = "#ifndef INC_H\n#define INC_H\n";
+	for (int i = 0; i < 100; i++)
+		inc += "int x;\n";
+	//the declaration outside the guard means the file is lexed each time
+	inc += "#endif\nint y;\n";
+
+	std::string src;
+	for (int i = 0; i < 10; i++)
+		src += "#include \"inc.h\"\n";
+
+	ExpectFileLoad("inc.h", inc);
+
+	PreProcSource(src);
+	EXPECT_EQ(tok_int, tokens.start->kind);
+
+	//the output holds one copy of the header, tokens skipped by the later includes are reused
+	size_t header_bytes = 300 * sizeof(token_t);
+	EXPECT_LT(arena_used(mCtx->tok_arena), 2 * header_bytes) << arena_used(mCtx->tok_arena);
+}
+
+TEST_F(PreProcIncludeTest, err_include_lex_error)
+{
+	std::string inc = "int i; /* abc";
+	std::string src = R"(#include "inc1.h"
+int j;
+)";
+
+	ExpectFileLoad("inc1.h", inc);
+	ExpectError(ERR_SYNTAX);
+
+	PreProcSource(src);
+	EXPECT_EQ(nullptr, tokens.start);
+}
+
+TEST_F(PreProcIncludeTest, err_include_unterminated_conditional)
+{
+	std::string src = R"(#if 1
+int j;
+)";
+
+	ExpectError(ERR_SYNTAX);
+
+	PreProcSource(src);
+	EXPECT_EQ(nullptr, tokens.start);
+}
+
+TEST_F(PreProcIncludeTest, include_guard)
+{
+	std::string inc = R"(#ifndef INC_H
+#define INC_H
+int i;
+#endif
+)";
+	std::string src = R"(#include "inc1.h"
+#include "inc1.h"
+#include "inc1.h"
+int j;
+)";
+
+	ExpectFileLoad("inc1.h", inc);
+
+	PreProc(src);
+	ExpectCode(R"(int i;
+int j;
+)");
+}
+
+TEST_F(PreProcIncludeTest, include_guard_undefined)
+{
+	std::string inc = R"(#ifndef INC_H
+#define INC_H
+int i;
+#endif
+)";
+	std::string src = R"(#include "inc1.h"
+#undef INC_H
+#include "inc1.h"
+#include "inc1.h"
+)";
+
+	ExpectFileLoad("inc1.h", inc);
+
+	PreProc(src);
+	ExpectCode(R"(int i;
+int i;
+)");
+}
+
+TEST_F(PreProcIncludeTest, include_guard_else)
+{
+	std::string inc = R"(#ifndef INC_H
+#define INC_H
+int i;
+#else
+int j;
+#endif
+)";
+	std::string src = R"(#include "inc1.h"
+#include "inc1.h"
+)";
+
+	ExpectFileLoad("inc1.h", inc);
+
+	PreProc(src);
+	ExpectCode(R"(int i;
+int j;
+)");
+}
+
+TEST_F(PreProcIncludeTest, include_guard_tokens_outside)
+{
+	std::string inc = R"(int i;
+#ifndef INC_H
+#define INC_H
+#endif
+)";
+	std::string src = R"(#include "inc1.h"
+#include "inc1.h"
+)";
+
+	ExpectFileLoad("inc1.h", inc);
+
+	PreProc(src);
+	ExpectCode(R"(int i;
+int i;
+)");
+}
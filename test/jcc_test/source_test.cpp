@@ -0,0 +1,182 @@
+#include "validation_fixture.h"
+
+extern "C"
+{
+#include <libj/include/platform.h>
+}
+
+#include <map>
+#include <string>
+
+class SourceTest : public TestWithErrorHandling
+{
+public:
+	SourceTest()
+	{
+		src_init(mCtx, &load_file, this);
+	}
+
+	static source_range_t load_file(const char* dir, const char* file, void* data)
+	{
+		SourceTest* This = (SourceTest*)data;
+		std::string path = std::string(dir) + "/" + file;
+		This->mLoads[path]++;
+
+		source_range_t result = { NULL, NULL };
+		auto it = This->mFiles.find(path);
+		if (it != This->mFiles.end())
+		{
+			result.ptr = it->second.c_str();
+			result.end = result.ptr + it->second.size();
+		}
+		return result;
+	}
+
+	std::map<std::string, std::string> mFiles;
+	std::map<std::string, int> mLoads;
+};
+
+TEST_F(SourceTest, file_loaded_once)
+{
+	mFiles["dir/a.c"] = "int i;";
+
+	source_range_t* first = src_load_file(mCtx, "dir", "a.c");
+	source_range_t* second = src_load_file(mCtx, "dir", "a.c");
+
+	ASSERT_NE(nullptr, first);
+	EXPECT_EQ(first, second);
+	EXPECT_EQ(1, mLoads["dir/a.c"]);
+}
+
+TEST_F(SourceTest, missing_file_tried_once)
+{
+	EXPECT_EQ(nullptr, src_load_file(mCtx, "dir", "a.c"));
+	EXPECT_EQ(nullptr, src_load_file(mCtx, "dir", "a.c"));
+	EXPECT_EQ(1, mLoads["dir/a.c"]);
+}
+
+TEST_F(SourceTest, header_search_once)
+{
+	src_add_header_path(mCtx, "/");
+	const char* resolved = path_resolve(::testing::TempDir().c_str());
+	std::string inc_dir = resolved;
+	mem_free((void*)resolved);
+	src_add_header_path(mCtx, inc_dir.c_str());
+	mFiles[inc_dir + "/b.h"] = "int j;";
+
+	source_range_t* first = src_load_header(mCtx, "src", "b.h", include_system);
+	source_range_t* second = src_load_header(mCtx, "src", "b.h", include_system);
+	ASSERT_NE(nullptr, first);
+	EXPECT_EQ(first, second);
+
+	//a local include searches the current directory first, then finds the same file
+	EXPECT_EQ(first, src_load_header(mCtx, "src", "b.h", include_local));
+
+	EXPECT_EQ(1, mLoads["//b.h"]);
+	EXPECT_EQ(1, mLoads["src/b.h"]);
+	EXPECT_EQ(1, mLoads[inc_dir + "/b.h"]);
+}
+
+TEST_F(SourceTest, missing_header_search_once)
+{
+	src_add_header_path(mCtx, "/");
+
+	EXPECT_EQ(nullptr, src_load_header(mCtx, "src", "c.h", include_system));
+	EXPECT_EQ(nullptr, src_load_header(mCtx, "src", "c.h", include_system));
+	EXPECT_EQ(nullptr, src_load_header(mCtx, "src", "c.h", include_local));
+
+	EXPECT_EQ(1, mLoads["//c.h"]);
+	EXPECT_EQ(1, mLoads["src/c.h"]);
+}
+
+TEST_F(SourceTest, pos_info_line_endings)
+{
+	mFiles["dir/a.c"] = "a\nb\r\nc\rd\n";
+	source_range_t* sr = src_load_file(mCtx, "dir", "a.c");
+	ASSERT_NE(nullptr, sr);
+
+	const uint32_t lines[] = { 1, 1, 2, 2, 2, 3, 3, 4, 4, 5 };
+	const uint16_t cols[] = { 1, 2, 1, 2, 3, 1, 2, 1, 2, 1 };
+	for (uint32_t i = 0; i <= (uint32_t)(sr->end - sr->ptr); i++)
+	{
+		file_pos_t pos = src_get_pos_info(mCtx, sr->ptr + i);
+		EXPECT_EQ(lines[i], pos.line) << i;
+		EXPECT_EQ(cols[i], pos.col) << i;
+		EXPECT_STREQ("dir/a.c", pos.path);
+	}
+}
+
+TEST_F(SourceTest, pos_info_many_files)
+{
+	for (int i = 0; i < 100; i++)
+		mFiles["dir/" + std::to_string(i) + ".h"] = "int i;\nint j" + std::to_string(i) + ";\n";
+
+	std::vector<source_range_t*> ranges;
+	for (int i = 0; i < 100; i++)
+		ranges.push_back(src_load_file(mCtx, "dir", (std::to_string(i) + ".h").c_str()));
+
+	for (int i = 99; i >= 0; i--)
+	{
+		ASSERT_NE(nullptr, ranges[i]);
+		file_pos_t pos = src_get_pos_info(mCtx, ranges[i]->ptr + 11);
+		EXPECT_EQ("dir/" + std::to_string(i) + ".h", pos.path);
+		EXPECT_EQ(2u, pos.line);
+		EXPECT_EQ(5, pos.col);
+	}
+}
+
+TEST_F(SourceTest, pos_info_outside_files)
+{
+	mFiles["dir/a.c"] = "int i;";
+	ASSERT_NE(nullptr, src_load_file(mCtx, "dir", "a.c"));
+
+	std::string other = "int j;";
+	file_pos_t pos = src_get_pos_info(mCtx, other.c_str());
+	EXPECT_EQ(nullptr, pos.path);
+	EXPECT_EQ(0u, pos.line);
+}
+
+TEST_F(SourceTest, loc_round_trip)
+{
+	for (int i = 0; i < 100; i++)
+		mFiles["dir/" + std::to_string(i) + ".h"] = "int j" + std::to_string(i) + ";\n";
+
+	std::vector<source_range_t*> ranges;
+	for (int i = 0; i < 100; i++)
+		ranges.push_back(src_load_file(mCtx, "dir", (std::to_string(i) + ".h").c_str()));
+
+	//every position, including the end of each file, has its own location
+	src_loc_t prev = SRC_LOC_NONE;
+	for (source_range_t* sr : ranges)
+	{
+		ASSERT_NE(nullptr, sr);
+		for (const char* pos = sr->ptr; pos <= sr->end; pos++)
+		{
+			src_loc_t loc = src_get_loc(mCtx, pos);
+			EXPECT_GT(loc, prev);
+			EXPECT_EQ(pos, src_loc_ptr(mCtx, loc));
+			prev = loc;
+		}
+	}
+
+	file_pos_t pos = src_get_loc_info(mCtx, src_get_loc(mCtx, ranges[42]->ptr + 4));
+	EXPECT_STREQ("dir/42.h", pos.path);
+	EXPECT_EQ(1u, pos.line);
+	EXPECT_EQ(5, pos.col);
+}
+
+TEST_F(SourceTest, loc_outside_files)
+{
+	mFiles["dir/a.c"] = "int i;";
+	source_range_t* sr = src_load_file(mCtx, "dir", "a.c");
+	ASSERT_NE(nullptr, sr);
+
+	std::string other = "int j;";
+	EXPECT_EQ(SRC_LOC_NONE, src_get_loc(mCtx, other.c_str()));
+	EXPECT_EQ(nullptr, src_loc_ptr(mCtx, SRC_LOC_NONE));
+	EXPECT_EQ(nullptr, src_loc_ptr(mCtx, src_get_loc(mCtx, sr->end) + 1));
+
+	file_pos_t pos = src_get_loc_info(mCtx, SRC_LOC_NONE);
+	EXPECT_EQ(nullptr, pos.path);
+	EXPECT_EQ(0u, pos.line);
+}
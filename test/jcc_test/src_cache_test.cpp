@@ -0,0 +1,104 @@
+#include "validation_fixture.h"
+
+extern "C"
+{
+#include <libcomp/include/src_cache.h>
+}
+
+#include <stdio.h>
+
+class SrcCacheTest : public TestWithErrorHandling
+{
+public:
+	SrcCacheTest()
+	{
+		mDir = ::testing::TempDir();
+		mCache = src_cache_create();
+	}
+
+	~SrcCacheTest()
+	{
+		src_cache_destroy(mCache);
+		remove((mDir + "src_cache_test.h").c_str());
+	}
+
+	void WriteFile(const std::string& content)
+	{
+		FILE* f = fopen((mDir + "src_cache_test.h").c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		fwrite(content.data(), 1, content.size(), f);
+		fclose(f);
+	}
+
+	source_range_t Load()
+	{
+		return src_cache_load(mDir.c_str(), "src_cache_test.h", mCache);
+	}
+
+	token_range_t Lex(source_range_t sr)
+	{
+		mCtx->cache = mCache;
+		lex_init(mCtx);
+		return lex_source(mCtx, &sr);
+	}
+
+	std::string mDir;
+	src_cache_t* mCache;
+};
+
+TEST_F(SrcCacheTest, file_kept_between_compilations)
+{
+	WriteFile("int x;");
+
+	src_cache_begin(mCache);
+	source_range_t first = Load();
+	ASSERT_TRUE(src_is_valid_range(&first));
+
+	src_cache_begin(mCache);
+	source_range_t second = Load();
+	EXPECT_EQ(first.ptr, second.ptr);
+	EXPECT_EQ(first.end, second.end);
+}
+
+TEST_F(SrcCacheTest, tokens_copied_from_cache)
+{
+	WriteFile("int x = 1;");
+
+	src_cache_begin(mCache);
+	token_range_t lexed = Lex(Load());
+	ASSERT_NE(nullptr, lexed.start);
+
+	src_cache_begin(mCache);
+	token_range_t cached = Lex(Load());
+	ASSERT_NE(nullptr, cached.start);
+
+	token_range_t lhs = { lexed.start, lexed.end };
+	token_range_t rhs = { cached.start, cached.end };
+	EXPECT_TRUE(tok_range_equals(&lhs, &rhs));
+	EXPECT_NE(lexed.start, cached.start);
+	EXPECT_NE(lexed.start->id, cached.start->id);
+	EXPECT_EQ(lexed.start->loc, cached.start->loc);
+}
+
+TEST_F(SrcCacheTest, changed_file_reloaded)
+{
+	WriteFile("int x;");
+
+	src_cache_begin(mCache);
+	source_range_t first = Load();
+	ASSERT_TRUE(src_is_valid_range(&first));
+
+	WriteFile("int longer_name;");
+
+	src_cache_begin(mCache);
+	source_range_t second = Load();
+	ASSERT_TRUE(src_is_valid_range(&second));
+	EXPECT_EQ("int longer_name;", std::string(second.ptr, second.end));
+}
+
+TEST_F(SrcCacheTest, missing_file)
+{
+	src_cache_begin(mCache);
+	source_range_t sr = src_cache_load(mDir.c_str(), "src_cache_test_missing.h", mCache);
+	EXPECT_FALSE(src_is_valid_range(&sr));
+}
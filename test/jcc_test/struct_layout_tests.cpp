@@ -13,7 +13,7 @@ public:
 		SetSource(code);
 		Lex();
 
-		parse_init(mTokens);
+		parse_init(mCtx, mTokens);
 
 		ast_decl_list_t decls = try_parse_decl_list(dpc_normal);
 		ASSERT_NE(nullptr, decls.first);
@@ -23,12 +23,12 @@ public:
 
 	ast_struct_member_t* Member(const std::string& name)
 	{
-		return ast_find_struct_member(result->data.user_type_spec, name.c_str());
+		return ast_find_struct_member(result->data.user_type_spec, tok_intern(name.c_str(), name.length()));
 	}
 
 	size_t MemberOffset(const std::string& name)
 	{
-		auto member = ast_find_struct_member(result->data.user_type_spec, name.c_str());
+		auto member = Member(name);
 		return member->sema.offset;
 	}
 
@@ -1,7 +1,16 @@
 #include <gtest/gtest.h>
 
+extern "C"
+{
+#include <libj/include/mem.h>
+#include <libcomp/include/lex_scan.h>
+}
+
 int main(int argc, char** argv) 
 {
+	//tests check the memory held by each category, stats must be enabled before anything is allocated
+	mem_enable_stats();
+	lex_scan_init();
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
 }
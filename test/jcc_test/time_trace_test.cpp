@@ -0,0 +1,42 @@
+#include "validation_fixture.h"
+
+extern "C"
+{
+#include <libcomp/include/time_trace.h>
+}
+
+#include <fstream>
+#include <sstream>
+
+TEST(TimeTrace, nested_spans_written)
+{
+	time_trace_t* trace = trace_create();
+	trace_span_begin(trace, "Outer", "dir\\file \"a\".c");
+	trace_span_begin(trace, "Inner", NULL);
+	trace_span_end(trace);
+	trace_span_end(trace);
+
+	std::string path = ::testing::TempDir() + "time_trace_test.json";
+	ASSERT_TRUE(trace_write(trace, path.c_str()));
+	trace_destroy(trace);
+
+	std::ifstream f(path);
+	std::stringstream ss;
+	ss << f.rdbuf();
+	std::string json = ss.str();
+	remove(path.c_str());
+
+	EXPECT_EQ(0U, json.find("{\"traceEvents\":["));
+	EXPECT_NE(std::string::npos, json.find("\"name\":\"Outer\""));
+	EXPECT_NE(std::string::npos, json.find("\"detail\":\"dir\\\\file \\\"a\\\".c\""));
+	EXPECT_LT(json.find("\"name\":\"Outer\""), json.find("\"name\":\"Inner\""));
+}
+
+TEST(TimeTrace, disabled_by_default)
+{
+	jcc_context_t* ctx = jcc_context_create();
+	EXPECT_EQ(nullptr, ctx->trace);
+	trace_begin(ctx, "Span", NULL);
+	trace_end(ctx);
+	jcc_context_destroy(ctx);
+}
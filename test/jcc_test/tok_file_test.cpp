@@ -0,0 +1,143 @@
+#include "validation_fixture.h"
+
+extern "C"
+{
+#include <libcomp/include/tok_file.h>
+}
+
+#include <filesystem>
+#include <stdio.h>
+
+class TokFileTest : public TestWithErrorHandling
+{
+public:
+	TokFileTest()
+	{
+		mDir = ::testing::TempDir() + "tok_file_test";
+		std::filesystem::create_directories(mDir);
+		mPath = mDir + "/test.h";
+		lex_init(mCtx);
+	}
+
+	~TokFileTest()
+	{
+		std::filesystem::remove_all(mDir);
+	}
+
+	void WriteFile(const std::string& content)
+	{
+		mSrc = content;
+		FILE* f = fopen(mPath.c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		fwrite(content.data(), 1, content.size(), f);
+		fclose(f);
+	}
+
+	source_range_t Range()
+	{
+		source_range_t sr = { mSrc.c_str(), mSrc.c_str() + mSrc.length() };
+		return sr;
+	}
+
+	bool Store(token_range_t* toks)
+	{
+		source_range_t sr = Range();
+		return tok_file_store(mCtx, mDir.c_str(), mPath.c_str(), &sr, toks);
+	}
+
+	bool Load(token_range_t* result)
+	{
+		source_range_t sr = Range();
+		return tok_file_load(mCtx, mDir.c_str(), mPath.c_str(), &sr, result);
+	}
+
+	std::string mDir;
+	std::string mPath;
+	std::string mSrc;
+};
+
+TEST_F(TokFileTest, tokens_loaded)
+{
+	WriteFile("int x = 10u;\n#define A \"abc\"\nchar* s = A;");
+
+	source_range_t sr = Range();
+	token_range_t lexed = lex_source(mCtx, &sr);
+	ASSERT_NE(nullptr, lexed.start);
+	ASSERT_TRUE(Store(&lexed));
+
+	token_range_t loaded;
+	ASSERT_TRUE(Load(&loaded));
+	EXPECT_TRUE(tok_range_equals(&lexed, &loaded));
+
+	token_t* lhs = lexed.start;
+	token_t* rhs = loaded.start;
+	for (; lhs && rhs; lhs = lhs->next, rhs = rhs->next)
+	{
+		EXPECT_EQ(lhs->kind, rhs->kind);
+		EXPECT_EQ(lhs->loc, rhs->loc);
+		EXPECT_EQ(lhs->len, rhs->len);
+		EXPECT_TRUE(tok_equals(lhs, rhs));
+	}
+	EXPECT_EQ(nullptr, lhs);
+	EXPECT_EQ(nullptr, rhs);
+	EXPECT_EQ(tok_eof, loaded.end->kind);
+}
+
+TEST_F(TokFileTest, changed_source_not_loaded)
+{
+	WriteFile("int x;");
+
+	source_range_t sr = Range();
+	token_range_t lexed = lex_source(mCtx, &sr);
+	ASSERT_TRUE(Store(&lexed));
+
+	//same size, different contents
+	WriteFile("int y;");
+
+	token_range_t loaded;
+	EXPECT_FALSE(Load(&loaded));
+}
+
+TEST_F(TokFileTest, truncated_file_not_loaded)
+{
+	WriteFile("int x = 1;");
+
+	source_range_t sr = Range();
+	token_range_t lexed = lex_source(mCtx, &sr);
+	ASSERT_TRUE(Store(&lexed));
+
+	for (auto& entry : std::filesystem::directory_iterator(mDir))
+	{
+		if (entry.path().extension() == ".tok")
+			std::filesystem::resize_file(entry.path(), entry.file_size() - 8);
+	}
+
+	token_range_t loaded;
+	EXPECT_FALSE(Load(&loaded));
+}
+
+TEST_F(TokFileTest, include_lexed_from_token_file)
+{
+	WriteFile("int x;");
+	mCtx->tok_cache_dir = mDir.c_str();
+
+	//the first cursor writes the token file, the second reads it
+	for (int i = 0; i < 2; i++)
+	{
+		source_range_t sr = Range();
+		lex_cursor_t* cursor = lex_begin(mCtx, &sr, mPath.c_str());
+		EXPECT_EQ(tok_int, lex_next(cursor)->kind);
+		token_t* ident = lex_next(cursor);
+		EXPECT_EQ(tok_identifier, ident->kind);
+		EXPECT_EQ(sr.ptr + 4, tok_spelling(ident));
+		EXPECT_EQ(tok_semi_colon, lex_next(cursor)->kind);
+		EXPECT_EQ(tok_eof, lex_next(cursor)->kind);
+		EXPECT_FALSE(lex_failed(cursor));
+		lex_end(cursor);
+
+		size_t tok_files = 0;
+		for (auto& entry : std::filesystem::directory_iterator(mDir))
+			tok_files += entry.path().extension() == ".tok";
+		EXPECT_EQ(1u, tok_files);
+	}
+}
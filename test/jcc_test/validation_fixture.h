@@ -19,6 +19,8 @@ extern "C"
 #include <libcomp/include/abi.h>
 #include <libcomp/include/parse_internal.h>
 #include <libcomp/include/std_types.h>
+#include <libcomp/include/jcc_context.h>
+#include <libj/include/arena.h>
 }
 
 using namespace ::testing;
@@ -27,13 +29,14 @@ struct TestWithErrorHandling : public ::testing::Test
 {
 	TestWithErrorHandling()
 	{
-		diag_set_handler(&diag_cb, this);
+		mCtx = jcc_context_create();
+		diag_set_handler(mCtx, &diag_cb, this);
 		EXPECT_CALL(*this, on_diag(_, _, _)).Times(0);
 	}
 
 	virtual ~TestWithErrorHandling()
 	{
-		diag_set_handler(NULL, NULL);
+		jcc_context_destroy(mCtx);
 	}
 
 	void ExpectError(uint32_t err, testing::Cardinality times = Exactly(1))
@@ -46,12 +49,14 @@ struct TestWithErrorHandling : public ::testing::Test
 		EXPECT_CALL(*this, on_diag(_, _, _)).Times(Exactly(0));
 	}
 
-	static void diag_cb(token_t* tok, uint32_t err, const char* msg, void* data)
+	static void diag_cb(src_loc_t loc, uint32_t err, const char* msg, void* data)
 	{
-		((TestWithErrorHandling*)data)->on_diag(tok, err, msg);
+		((TestWithErrorHandling*)data)->on_diag(loc, err, msg);
 	}
 
-	MOCK_METHOD3(on_diag, void(token_t* tok, uint32_t err, const char* msg));
+	MOCK_METHOD3(on_diag, void(src_loc_t loc, uint32_t err, const char* msg));
+
+	jcc_context_t* mCtx;
 };
 
 class CompilerTest : public TestWithErrorHandling
@@ -60,9 +65,9 @@ public:
 
 	CompilerTest()
 	{
-		lex_init();
+		lex_init(mCtx);
 		sema_observer_t observer{ nullptr };
-		sema_init(observer);
+		sema_init(mCtx, observer);
 	}
 
 	void SetSource(const std::string& src)
@@ -76,14 +81,14 @@ public:
 		sr.ptr = mSrc.c_str();
 		sr.end = sr.ptr + mSrc.length();
 
-		mTokens = lex_source(&sr).start;
+		mTokens = lex_source(mCtx, &sr).start;
 		return mTokens != nullptr;
 	}
 
 	bool Parse()
 	{
-		parse_init(mTokens);
-		mAst = parse_translation_unit();
+		parse_init(mCtx, mTokens);
+		mAst = parse_translation_unit(mCtx);
 		return mAst != nullptr;
 	}
 
@@ -100,7 +105,7 @@ public:
 
 	bool Analyse()
 	{
-		mTL = sema_analyse(mAst);
+		mTL = sema_analyse(mCtx, mAst);
 		return mTL != nullptr;
 	}
 
@@ -131,15 +136,9 @@ public:
 
 	LexTest()
 	{
-		src_init(&load_file, this);
-		lex_init();
-		pre_proc_init();
-	}
-
-	~LexTest()
-	{
-		pre_proc_deinit();
-		src_deinit();
+		src_init(mCtx, &load_file, this);
+		lex_init(mCtx);
+		pre_proc_init(mCtx);
 	}
 
 	void Lex(const std::string& src, const std::string path = "test.c")
@@ -148,9 +147,9 @@ public:
 		sr.ptr = src.c_str();
 		sr.end = sr.ptr + src.length();
 
-		src_register_range(sr, strdup(path.c_str()));
+		src_register_range(mCtx, sr, path.c_str());
 
-		tokens = lex_source(&sr);
+		tokens = lex_source(mCtx, &sr);
 	}
 
 	token_range_t tokens = { NULL, NULL };
@@ -170,7 +169,7 @@ public:
 	void ExpectIntLiteral(token_t* t, T val)
 	{
 		EXPECT_EQ(t->kind, tok_num_literal);
-		EXPECT_EQ(int_val_as_uint32(&t->data.int_val), (uint32_t)val);
+		EXPECT_EQ(int_val_as_uint32(t->data.int_val), (uint32_t)val);
 	}
 
 	void ExpectStringLiteral(token_t* t, const char* expected)
@@ -207,7 +206,7 @@ public:
 		sr.ptr = code.c_str();
 		sr.end = sr.ptr + code.length();
 
-		token_range_t expected = lex_source(&sr);
+		token_range_t expected = lex_source(mCtx, &sr);
 		
 		EXPECT_TRUE(tok_range_equals(&tokens, &expected));
 	}
@@ -223,7 +222,19 @@ public:
 	{
 		Lex(src, path);
 		if (!tok_range_empty(&tokens))
-			tokens = pre_proc_file(".", &tokens);
+			tokens = pre_proc_file(mCtx, ".", &tokens);
+	}
+
+	//lex as the pre processor needs the tokens
+	void PreProcSource(const std::string& src, const std::string path = "test.c")
+	{
+		source_range_t sr;
+		sr.ptr = src.c_str();
+		sr.end = sr.ptr + src.length();
+
+		src_register_range(mCtx, sr, path.c_str());
+
+		tokens = pre_proc_source(mCtx, ".", &sr);
 	}
 
 	MOCK_METHOD1(on_load_file, source_range_t(const std::string&));
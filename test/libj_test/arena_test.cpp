@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+extern "C"
+{
+#include <libj/include/arena.h>
+}
+
+#include <stdint.h>
+
+TEST(Arena, alloc_aligned_zeroed)
+{
+	arena_t* arena = arena_create(0, 256, ARENA_ALIGN);
+
+	char* prev = NULL;
+	for (size_t i = 1; i < 200; i++)
+	{
+		char* p = (char*)arena_alloc(arena, i);
+		ASSERT_NE(nullptr, p);
+		EXPECT_EQ(0U, (uintptr_t)p % 16);
+		for (size_t j = 0; j < i; j++)
+			ASSERT_EQ(0, p[j]);
+		memset(p, 0xff, i);
+		EXPECT_NE(prev, p);
+		prev = p;
+	}
+	arena_destroy(arena);
+}
+
+TEST(Arena, large_alloc)
+{
+	arena_t* arena = arena_create(0, 256, ARENA_ALIGN);
+
+	char* small = (char*)arena_alloc(arena, 16);
+	char* large = (char*)arena_alloc(arena, 4096);
+	char* next = (char*)arena_alloc(arena, 16);
+
+	memset(large, 1, 4096);
+	//the large block does not displace the current block
+	EXPECT_EQ(small + 16, next);
+	EXPECT_EQ(16U + 4096U + 16U, arena_used(arena));
+	arena_destroy(arena);
+}
+
+TEST(Arena, smaller_alignment)
+{
+	arena_t* arena = arena_create(0, 256, 8);
+
+	char* first = (char*)arena_alloc(arena, 40);
+	char* second = (char*)arena_alloc(arena, 40);
+	char* third = (char*)arena_alloc(arena, 3);
+	char* fourth = (char*)arena_alloc(arena, 8);
+
+	//allocations are packed at the arena's alignment
+	EXPECT_EQ(first + 40, second);
+	EXPECT_EQ(second + 40, third);
+	EXPECT_EQ(third + 8, fourth);
+	EXPECT_EQ(0U, (uintptr_t)fourth % 8);
+	EXPECT_EQ(40U + 40U + 8U + 8U, arena_used(arena));
+	arena_destroy(arena);
+}
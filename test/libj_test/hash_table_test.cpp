@@ -6,6 +6,8 @@ extern "C"
 #include <libj/include/hash_table.h>
 }
 
+#include <vector>
+
 TEST(StringHashTable, insert_iter)
 {
 	hash_table_t* ht = sht_create(3);
@@ -71,4 +73,102 @@ TEST(StringHashTable, lots)
 	EXPECT_EQ(1024, ht_count(ht));
 	ht_print_stats(ht);
 	ht_destroy(ht);
-}
\ No newline at end of file
+}
+TEST(StringHashTable, grow)
+{
+	char buff[32];
+
+	hash_table_t* ht = sht_create(4);
+	uint32_t initial_sz = ht->sz;
+
+	for (uint32_t i = 0; i < 5000; i++)
+	{
+		sprintf(buff, "key %u", i);
+		sht_insert(ht, buff, (void*)(uintptr_t)(i + 1));
+	}
+	EXPECT_EQ(5000U, ht_count(ht));
+	EXPECT_GT(ht->sz, initial_sz);
+	EXPECT_LE(ht_count(ht) * 4, ht->sz * 3);
+
+	for (uint32_t i = 0; i < 5000; i++)
+	{
+		sprintf(buff, "key %u", i);
+		ASSERT_EQ((void*)(uintptr_t)(i + 1), sht_lookup(ht, buff));
+	}
+	EXPECT_EQ(nullptr, sht_lookup(ht, "key 5000"));
+	ht_destroy(ht);
+}
+
+TEST(StringHashTable, remove_keeps_others_reachable)
+{
+	char buff[32];
+
+	hash_table_t* ht = sht_create(8);
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		sprintf(buff, "key %u", i);
+		sht_insert(ht, buff, (void*)(uintptr_t)(i + 1));
+	}
+
+	//remove every third item, the rest must still be found
+	for (uint32_t i = 0; i < 1000; i += 3)
+	{
+		sprintf(buff, "key %u", i);
+		ASSERT_TRUE(sht_remove(ht, buff));
+	}
+	EXPECT_EQ(1000U - 334U, ht_count(ht));
+
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		sprintf(buff, "key %u", i);
+		if (i % 3 == 0)
+			ASSERT_FALSE(sht_contains(ht, buff));
+		else
+			ASSERT_EQ((void*)(uintptr_t)(i + 1), sht_lookup(ht, buff));
+	}
+	ht_destroy(ht);
+}
+
+TEST(StringHashTable, duplicate_keys)
+{
+	hash_table_t* ht = sht_create(8);
+
+	sht_insert(ht, "dup", (void*)1);
+	sht_insert(ht, "dup", (void*)2);
+	sht_insert(ht, "other", (void*)3);
+
+	//the latest item replaces the earlier one
+	EXPECT_EQ(2U, ht_count(ht));
+	EXPECT_EQ((void*)2, sht_lookup(ht, "dup"));
+
+	EXPECT_TRUE(sht_remove(ht, "dup"));
+	EXPECT_FALSE(sht_contains(ht, "dup"));
+	EXPECT_EQ(1U, ht_count(ht));
+	EXPECT_EQ((void*)3, sht_lookup(ht, "other"));
+	ht_destroy(ht);
+}
+
+TEST(PointerHashSet, aligned_pointers)
+{
+	std::vector<uint64_t> items(4096);
+
+	hash_table_t* ht = phs_create(16);
+	for (uint64_t& item : items)
+		phs_insert(ht, &item);
+	EXPECT_EQ(items.size(), ht_count(ht));
+
+	size_t count = 0;
+	phs_iterator_t it = phs_begin(ht);
+	while (!phs_end(ht, &it))
+	{
+		EXPECT_GE((uint64_t*)it.val, &items.front());
+		EXPECT_LE((uint64_t*)it.val, &items.back());
+		count++;
+		phs_next(ht, &it);
+	}
+	EXPECT_EQ(items.size(), count);
+
+	for (uint64_t& item : items)
+		ASSERT_TRUE(ht_contains(ht, &item));
+	ht_destroy(ht);
+}
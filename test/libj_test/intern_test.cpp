@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+extern "C"
+{
+#include <libj/include/intern.h>
+}
+
+#include <string>
+#include <vector>
+
+TEST(Intern, same_spelling_same_pointer)
+{
+	intern_table_t* table = intern_create(0);
+
+	const char* src = "name_x name";
+	const char* a = intern_str(table, src, 4);
+	const char* b = intern_str(table, src + 7, 4);
+	const char* c = intern_cstr(table, "name_x");
+
+	EXPECT_STREQ("name", a);
+	EXPECT_EQ(a, b);
+	EXPECT_NE(a, c);
+	EXPECT_EQ(4U, intern_len(a));
+	EXPECT_EQ(intern_hash_str("name", 4), intern_hash(a));
+	EXPECT_EQ(2U, intern_count(table));
+
+	EXPECT_EQ(c, intern_find(table, "name_x", 6));
+	EXPECT_EQ(nullptr, intern_find(table, "nam", 3));
+	intern_destroy(table);
+}
+
+TEST(Intern, grow)
+{
+	intern_table_t* table = intern_create(0);
+
+	std::vector<std::string> keys;
+	std::vector<const char*> interned;
+	for (int i = 0; i < 5000; i++)
+	{
+		keys.push_back("ident_" + std::to_string(i));
+		interned.push_back(intern_cstr(table, keys.back().c_str()));
+	}
+
+	EXPECT_EQ(5000U, intern_count(table));
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		ASSERT_EQ(interned[i], intern_cstr(table, keys[i].c_str()));
+		ASSERT_STREQ(keys[i].c_str(), interned[i]);
+	}
+	intern_destroy(table);
+}
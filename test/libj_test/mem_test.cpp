@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+extern "C"
+{
+#include <libj/include/mem.h>
+#include <libj/include/str_buff.h>
+}
+
+TEST(Mem, stats_per_category)
+{
+	//blocks from the system allocator must not be freed once stats are enabled,
+	//nothing allocated by earlier tests is still alive
+	mem_enable_stats();
+
+	void* a = mem_alloc(3, 100);
+	void* b = mem_alloc(3, 50);
+	mem_stats_t stats;
+	ASSERT_TRUE(mem_get_stats(3, &stats));
+	EXPECT_EQ(2U, stats.count);
+	EXPECT_EQ(150U, stats.total);
+	EXPECT_EQ(150U, stats.current);
+
+	mem_free(a);
+	b = mem_realloc(b, 0, 200);
+	ASSERT_TRUE(mem_get_stats(3, &stats));
+	EXPECT_EQ(200U, stats.current);
+	EXPECT_EQ(200U, stats.peak);
+
+	mem_free(b);
+	ASSERT_TRUE(mem_get_stats(3, &stats));
+	EXPECT_EQ(0U, stats.current);
+	EXPECT_EQ(200U, stats.peak);
+}
+
+TEST(Mem, containers_use_scope)
+{
+	mem_enable_stats();
+
+	mem_cat_t prev = mem_set_scope(5);
+	str_buff_t* sb = sb_create(64);
+	mem_set_scope(prev);
+
+	mem_stats_t stats;
+	ASSERT_TRUE(mem_get_stats(5, &stats));
+	EXPECT_EQ(2U, stats.count);
+
+	sb_destroy(sb);
+	ASSERT_TRUE(mem_get_stats(5, &stats));
+	EXPECT_EQ(0U, stats.current);
+}
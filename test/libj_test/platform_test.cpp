@@ -10,4 +10,33 @@ TEST(Platform, path)
 {
 	const char* path = "file.txt";
 	const char* cur_path = path_dirname(path);
-}
\ No newline at end of file
+}
+TEST(Platform, file_map_terminated)
+{
+	//sizes either side of a page boundary
+	size_t sizes[] = { 1, 4095, 4096, 8192 };
+	for (size_t size : sizes)
+	{
+		std::string path = ::testing::TempDir() + "file_map_test.txt";
+		std::string content(size, 'x');
+		FILE* f = fopen(path.c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		fwrite(content.data(), 1, size, f);
+		fclose(f);
+
+		size_t len = 0;
+		const char* ptr = file_map(path.c_str(), &len);
+		ASSERT_NE(nullptr, ptr);
+		EXPECT_EQ(size, len);
+		EXPECT_EQ(content, std::string(ptr, len));
+		EXPECT_EQ('\0', ptr[len]);
+		file_unmap(ptr, len);
+		remove(path.c_str());
+	}
+}
+
+TEST(Platform, file_map_missing)
+{
+	size_t len = 0;
+	EXPECT_EQ(nullptr, file_map("does_not_exist.txt", &len));
+}